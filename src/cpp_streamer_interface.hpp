@@ -2,6 +2,7 @@
 #define CPP_STREAMER_INTERFACE_H
 #include "media_packet.hpp"
 #include "logger.hpp"
+#include "metrics.hpp"
 
 #include <stdint.h>
 #include <stddef.h>
@@ -38,6 +39,10 @@ public:
     virtual void StartNetwork(const std::string& url, void* loop_handle) = 0;
     virtual void AddOption(const std::string& key, const std::string& value) = 0;
     virtual void SetReporter(StreamerReport* reporter) = 0;
+    //register the metrics of the streamer before StartNetwork, the registry must outlive the streamer
+    virtual void SetMetrics(MetricsRegistry* registry) {
+        metrics_.Register(registry, StreamerName());
+    }
 
 protected:
     Logger* logger_ = nullptr;
@@ -45,6 +50,7 @@ protected:
     std::map<std::string, CppStreamerInterface*> sinkers_;
     std::map<std::string, std::string> options_;
     StreamerReport* report_ = nullptr;
+    StreamerMetrics metrics_;
 };
 
 
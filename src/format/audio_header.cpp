@@ -240,8 +240,6 @@ int MakeAdts(uint8_t* data, uint8_t object_type,
     data[2] = data[2] | ((object_type - 1)<<6);
     data[2] = data[2] | ((sample_rate_index)<<2);
     data[2] = data[2] | ((channel >> 2));
-    printf("obj type:%d, rate index:%d, channel:%d, data[2]:0x%02x, rate:%d.\r\n",
-            object_type, sample_rate_index, channel, data[2], sample_rate);
     //0x80
     data[3] &= 0x00;
     data[3] = data[3] | (channel << 6);
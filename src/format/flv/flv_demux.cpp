@@ -66,6 +66,9 @@ int FlvDemuxer::SourceData(Media_Packet_Ptr pkt_ptr) {
     if (!pkt_ptr) {
         return 0;
     }
+    metrics_.OnPacket(pkt_ptr->buffer_ptr_->DataLen());
+    metrics_.BeginStage();
+    metrics_.OnIngress(pkt_ptr->ingress_us_);
 
     return InputPacket(pkt_ptr);
 }
@@ -171,7 +174,7 @@ int FlvDemuxer::HandlePacket() {
         }
         if (p[1] == 0x00) {
             if ((p[0] & 0xf0) == FLV_AUDIO_AAC_CODEC) {
-                bool ret = GetAudioInfoByAsc(p + 2, output_pkt_ptr->buffer_ptr_->DataLen() - 2,
+                bool ret = GetAudioInfoByAsc(p + 2, tag_data_size_ - 2,
                                        output_pkt_ptr->aac_asc_type_, output_pkt_ptr->sample_rate_,
                                        output_pkt_ptr->channel_);
                 if (ret) {
@@ -264,6 +267,9 @@ int FlvDemuxer::HandlePacket() {
                     sps_ptr->buffer_ptr_->AppendData((char*)sps, sps_len);
                     pps_ptr->buffer_ptr_->AppendData((char*)pps, pps_len);
 
+                    buffer_.ConsumeData(tag_data_size_ + FLV_TAG_PRE_SIZE);
+                    tag_header_ready_ = false;
+
                     SinkData(sps_ptr);
                     SinkData(pps_ptr);
                     return 0;
@@ -278,6 +284,9 @@ int FlvDemuxer::HandlePacket() {
                 output_pkt_ptr->fmt_type_ = MEDIA_FORMAT_FLV;
                 output_pkt_ptr->buffer_ptr_->Reset();
                 output_pkt_ptr->buffer_ptr_->AppendData((char*)nalu, len);
+                buffer_.ConsumeData(tag_data_size_ + FLV_TAG_PRE_SIZE);
+                tag_header_ready_ = false;
+
                 SinkData(output_pkt_ptr);
                 return 0;
            }
@@ -338,7 +347,7 @@ int FlvDemuxer::HandlePacket() {
                 if ((p[0] & 0xf0) == FLV_AUDIO_AAC_CODEC && p[1] == 0x00) {
                     LogInfof(logger_, "asc header len:%d", output_pkt_ptr->buffer_ptr_->DataLen() - 2);
                     LogInfoData(logger_, p + 2, output_pkt_ptr->buffer_ptr_->DataLen() - 2, "asc header");
-                    bool ret = GetAudioInfoByAsc(p + 2, output_pkt_ptr->buffer_ptr_->DataLen() - 2,
+                    bool ret = GetAudioInfoByAsc(p + 2, tag_data_size_ - 2,
                                            output_pkt_ptr->aac_asc_type_, output_pkt_ptr->sample_rate_,
                                            output_pkt_ptr->channel_);
                     if (ret) {
@@ -434,13 +443,17 @@ int FlvDemuxer::DecodeMetaData(uint8_t* data, int data_len, Media_Packet_Ptr pkt
 }
 
 int FlvDemuxer::SinkData(Media_Packet_Ptr pkt_ptr) {
+    metrics_.EndStage();
     if (options_["re"] == "true") {
         waiter_.Wait(pkt_ptr);
+        metrics_.OnRelease(pkt_ptr->ingress_us_);
     }
     int ret = 0;
+    metrics_.OnOutput(pkt_ptr->ingress_us_);
     for (auto& item : sinkers_) {
         ret += item.second->SourceData(pkt_ptr);
     }
+    metrics_.BeginStage();
     return ret;
 }
 
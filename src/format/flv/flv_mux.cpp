@@ -67,6 +67,14 @@ int FlvMuxer::SourceData(Media_Packet_Ptr pkt_ptr) {
     if (!pkt_ptr) {
         return 0;
     }
+    metrics_.OnPacket(pkt_ptr->buffer_ptr_->DataLen());
+    metrics_.BeginStage();
+    metrics_.OnIngress(pkt_ptr->ingress_us_);
+
+    return MuxPacket(pkt_ptr);
+}
+
+int FlvMuxer::MuxPacket(Media_Packet_Ptr pkt_ptr) {
 
     if (pkt_ptr->av_type_ == MEDIA_VIDEO_TYPE) {
         uint8_t* p = (uint8_t*)pkt_ptr->buffer_ptr_->Data();
@@ -82,6 +90,13 @@ int FlvMuxer::SourceData(Media_Packet_Ptr pkt_ptr) {
             LogErrorf(logger_, "flv mux input data fail to find nalu start code");
             return -1;
         }
+        if (H264_IS_SPS(p[nalu_type_pos]) || H264_IS_PPS(p[nalu_type_pos])) {
+            //the access unit with sps/pps/idr, mux them one by one
+            std::vector<size_t> offsets;
+            if (AnnexBNaluOffsets(p, len, offsets) && offsets.size() > 1) {
+                return SourceNalus(pkt_ptr, offsets);
+            }
+        }
 
         if (len < (int)sizeof(sps_) && len < (int)sizeof(pps_)) {
             if (H264_IS_SPS(p[nalu_type_pos])) {
@@ -130,6 +145,52 @@ int FlvMuxer::SourceData(Media_Packet_Ptr pkt_ptr) {
     return InputPacket(pkt_ptr);
 }
 
+/*
+ * the nalus are split by offset over the packet buffer: sps/pps are kept in
+ * sps_/pps_, and the last nalu(eg. idr) is muxed in place of the packet.
+ */
+int FlvMuxer::SourceNalus(Media_Packet_Ptr pkt_ptr, const std::vector<size_t>& offsets) {
+    uint8_t* data = (uint8_t*)pkt_ptr->buffer_ptr_->Data();
+
+    for (size_t index = 0; (index + 1) < offsets.size(); index++) {
+        uint8_t* p = data + offsets[index];
+        size_t nalu_len = offsets[index + 1] - offsets[index];
+        int nalu_type_pos = GetNaluTypePos(p);
+        if (nalu_type_pos < 3) {
+            continue;
+        }
+        int payload_len = (int)nalu_len - nalu_type_pos;
+
+        if (H264_IS_SPS(p[nalu_type_pos]) && payload_len < (int)sizeof(sps_)) {
+            memcpy(sps_, p + nalu_type_pos, payload_len);
+            sps_len_ = payload_len;
+            continue;
+        }
+        if (H264_IS_PPS(p[nalu_type_pos]) && payload_len < (int)sizeof(pps_)) {
+            memcpy(pps_, p + nalu_type_pos, payload_len);
+            pps_len_ = payload_len;
+            continue;
+        }
+        //seldom, eg. sei inside the access unit
+        Media_Packet_Ptr nalu_ptr = std::make_shared<Media_Packet>(
+                std::make_shared<DataBuffer>(nalu_len + 2 * PRE_RESERVE_HEADER_SIZE));
+        nalu_ptr->copy_properties(*(pkt_ptr.get()));
+        nalu_ptr->buffer_ptr_->AppendData((char*)p, nalu_len);
+        nalu_ptr->is_seq_hdr_   = false;
+        nalu_ptr->is_key_frame_ = H264_IS_KEYFRAME(p[nalu_type_pos]);
+        MuxPacket(nalu_ptr);
+    }
+
+    uint8_t* p = (uint8_t*)pkt_ptr->buffer_ptr_->ConsumeData((int)offsets.back());
+    int nalu_type_pos = GetNaluTypePos(p);
+    if (nalu_type_pos < 3) {
+        return -1;
+    }
+    pkt_ptr->is_seq_hdr_   = H264_IS_SPS(p[nalu_type_pos]) || H264_IS_PPS(p[nalu_type_pos]);
+    pkt_ptr->is_key_frame_ = H264_IS_KEYFRAME(p[nalu_type_pos]);
+    return MuxPacket(pkt_ptr);
+}
+
 void FlvMuxer::StartNetwork(const std::string& url, void* loop_handle) {
 }
 
@@ -298,9 +359,12 @@ void FlvMuxer::OutputPacket(Media_Packet_Ptr pkt_ptr) {
         return;
     }
 
+    metrics_.EndStage();
+    metrics_.OnOutput(pkt_ptr->ingress_us_);
     for (auto& item : sinkers_) {
         item.second->SourceData(pkt_ptr);
     }
+    metrics_.BeginStage();
     return;
 }
 
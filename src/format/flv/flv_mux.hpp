@@ -6,6 +6,8 @@
 #include "logger.hpp"
 
 #include <map>
+#include <memory>
+#include <vector>
 
 extern "C" {
 void* make_flvmux_streamer();
@@ -37,6 +39,8 @@ public:
 
 private:
     int MuxFlvHeader(Media_Packet_Ptr pkt_ptr);
+    int MuxPacket(Media_Packet_Ptr pkt_ptr);
+    int SourceNalus(Media_Packet_Ptr pkt_ptr, const std::vector<size_t>& offsets);
     void OutputPacket(Media_Packet_Ptr pkt_ptr);
     void Report(const std::string& type, const std::string& value);
 
@@ -30,44 +30,50 @@ std::string HevcHeaderDump(const Hevc_Header& header) {
     return ss.str();
 }
 
-bool AnnexB2Nalus(uint8_t* data, size_t len, std::vector<std::shared_ptr<DataBuffer>>& nalus) {
+bool AnnexBNaluOffsets(const uint8_t* data, size_t len, std::vector<size_t>& offsets) {
     if (len < 4) {
         return false;
     }
-    std::vector<size_t> pos_vec;
-    uint8_t* p = data;
+    const uint8_t* p = data;
 
     while (p < data + len) {
         size_t left_len = data + len - p;
 
         if (left_len >= 4) {
             if (p[0] == 0 && p[1] == 0 && p[2] == 0 && p[3] == 1) {
-                pos_vec.push_back((size_t)p);
+                offsets.push_back(p - data);
                 p += 4;
                 continue;
             }
         }
         if (left_len >= 3) {
             if (p[0] == 0 && p[1] == 0 && p[2] == 1) {
-                pos_vec.push_back((size_t)p);
+                offsets.push_back(p - data);
                 p += 3;
                 continue;
             }
         }
         p++;
     }
+    return true;
+}
+
+bool AnnexB2Nalus(uint8_t* data, size_t len, std::vector<std::shared_ptr<DataBuffer>>& nalus) {
+    std::vector<size_t> offsets;
+
+    if (!AnnexBNaluOffsets(data, len, offsets)) {
+        return false;
+    }
 
-    uint8_t* end_pos = data + len;
-    for(size_t index = 0; index < pos_vec.size(); index++) {
-        size_t current_pos = pos_vec[index];
+    for(size_t index = 0; index < offsets.size(); index++) {
         size_t nalu_len = 0;
-        if ((index + 1) < pos_vec.size()) {
-            nalu_len = pos_vec[index + 1] - pos_vec[index];
+        if ((index + 1) < offsets.size()) {
+            nalu_len = offsets[index + 1] - offsets[index];
         } else {
-            nalu_len = (size_t)end_pos - current_pos;
+            nalu_len = len - offsets[index];
         }
         std::shared_ptr<DataBuffer> data_ptr = std::make_shared<DataBuffer>(nalu_len + 1024);
-        data_ptr->AppendData((char*)current_pos, nalu_len);
+        data_ptr->AppendData((char*)data + offsets[index], nalu_len);
         nalus.push_back(data_ptr);
     }
     return true;
@@ -227,6 +227,9 @@ inline bool Is_AnnexB_Header(uint8_t* data, size_t len) {
 }
 
 
+//the offsets of the start codes in data, each nalu ends at the next offset or at len
+bool AnnexBNaluOffsets(const uint8_t* data, size_t len, std::vector<size_t>& offsets);
+
 bool AnnexB2Nalus(uint8_t* data, size_t len, std::vector<std::shared_ptr<DataBuffer>>& nalus);
 
 bool AnnexB2Avcc(uint8_t* data, size_t len, std::vector<std::shared_ptr<DataBuffer>>& nalus);
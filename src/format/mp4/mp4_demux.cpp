@@ -197,11 +197,14 @@ void Mp4Demuxer::OnRead() {
 }
 
 int Mp4Demuxer::SourceData(Media_Packet_Ptr pkt_ptr) {
+    metrics_.BeginStage();
     if (pkt_ptr->io_reader_) {
         io_reader_ = pkt_ptr->io_reader_;
         OnRead();
         return 0;
     }
+    metrics_.OnPacket(pkt_ptr->buffer_ptr_->DataLen());
+    metrics_.OnIngress(pkt_ptr->ingress_us_);
     buffer_.AppendData(pkt_ptr->buffer_ptr_->Data(), pkt_ptr->buffer_ptr_->DataLen());
 
     uint8_t* p = (uint8_t*)buffer_.Data();
@@ -697,13 +700,22 @@ void Mp4Demuxer::makeMovItems() {
 }
 
 void Mp4Demuxer::Output(Media_Packet_Ptr pkt_ptr) {
+    //the samples read from the io reader are the packets handled
+    if (io_reader_) {
+        metrics_.OnPacket(pkt_ptr->buffer_ptr_->DataLen());
+        metrics_.OnIngress(pkt_ptr->ingress_us_);
+    }
+    metrics_.EndStage();
     if (options_["re"] == "true") {
         waiter_.Wait(pkt_ptr);
+        metrics_.OnRelease(pkt_ptr->ingress_us_);
     }
-    
+    metrics_.OnOutput(pkt_ptr->ingress_us_);
+
     for(auto& sinker : sinkers_) {
         sinker.second->SourceData(pkt_ptr);
     }
+    metrics_.BeginStage();
 }
 
 void Mp4Demuxer::AddOption(const std::string& key, const std::string& value) {
@@ -97,6 +97,9 @@ void MpegtsDemux::ReportEvent(const std::string& type, const std::string& value)
 }
 
 int MpegtsDemux::SourceData(Media_Packet_Ptr pkt_ptr) {
+    metrics_.OnPacket(pkt_ptr->buffer_ptr_->DataLen());
+    metrics_.BeginStage();
+    metrics_.OnIngress(pkt_ptr->ingress_us_);
     return Decode(pkt_ptr->buffer_ptr_);
 }
 
@@ -609,8 +612,10 @@ void MpegtsDemux::OnCallback(unsigned short pid, uint64_t dts, uint64_t pts) {
 }
 
 void MpegtsDemux::Output(Media_Packet_Ptr pkt_ptr) {
+    metrics_.EndStage();
     if (options_["re"] == "true") {
         waiter_.Wait(pkt_ptr);
+        metrics_.OnRelease(pkt_ptr->ingress_us_);
     }
 
     /*
@@ -622,9 +627,11 @@ void MpegtsDemux::Output(Media_Packet_Ptr pkt_ptr) {
     }
     */
 
+    metrics_.OnOutput(pkt_ptr->ingress_us_);
     for(auto& sinker : sinkers_) {
         sinker.second->SourceData(pkt_ptr);
     }
+    metrics_.BeginStage();
 }
 
 bool MpegtsDemux::IsPmt(unsigned short pid) {
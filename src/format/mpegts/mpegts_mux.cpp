@@ -165,6 +165,9 @@ int MpegtsMux::SourceData(Media_Packet_Ptr pkt_ptr) {
     if (!pkt_ptr) {
         return -1;
     }
+    metrics_.OnPacket(pkt_ptr->buffer_ptr_->DataLen());
+    metrics_.BeginStage();
+    metrics_.OnIngress(pkt_ptr->ingress_us_);
     return InputPacket(pkt_ptr);
 }
 
@@ -206,6 +209,7 @@ int MpegtsMux::WritePmt() {
 int MpegtsMux::InputPacket(Media_Packet_Ptr pkt_ptr) {
     if (pkt_ptr->av_type_ == MEDIA_METADATA_TYPE) {
         LogInfof(logger_, "mpegts mux discard metadata packet");
+        metrics_.OnDrop();
         return 0;
     }
 
@@ -220,6 +224,7 @@ int MpegtsMux::InputPacket(Media_Packet_Ptr pkt_ptr) {
             SetAudioCodec(pkt_ptr->codec_type_);
         }
         wait_queue_.push(pkt_ptr);
+        metrics_.SetQueueDepth(wait_queue_.size());
         return 0;
     }
 
@@ -235,6 +240,7 @@ int MpegtsMux::InputPacket(Media_Packet_Ptr pkt_ptr) {
         auto current_pkt_ptr = wait_queue_.front();
         wait_queue_.pop();
         HandlePacket(current_pkt_ptr);
+        metrics_.SetQueueDepth(wait_queue_.size());
     }
     return HandlePacket(pkt_ptr);
 }
@@ -1004,6 +1010,10 @@ int MpegtsMux::WritePes(Media_Packet_Ptr pkt_ptr) {
 }
 
 void MpegtsMux::TsOutput(Media_Packet_Ptr pkt_ptr, uint8_t* data) {
+    metrics_.EndStage();
+    if (pkt_ptr) {
+        metrics_.OnOutput(pkt_ptr->ingress_us_);
+    }
     if (!sinkers_.empty()) {
         for (auto& sinker : sinkers_) {
             Media_Packet_Ptr ts_pkt_ptr = std::make_shared<Media_Packet>(256);
@@ -1016,6 +1026,7 @@ void MpegtsMux::TsOutput(Media_Packet_Ptr pkt_ptr, uint8_t* data) {
             sinker.second->SourceData(ts_pkt_ptr);
         }
     }
+    metrics_.BeginStage();
     return;
 }
 
@@ -24,7 +24,7 @@ uint32_t SdpTransform::GetVideoSsrc() {
         return 0;
     }
     for (auto item : ssrc_info_map_) {
-        if (item.second.is_video && !item.second.is_rtx) {
+        if (item.second.is_video && !item.second.is_rtx && !item.second.is_fec) {
             return item.first;
         }
     }
@@ -56,6 +56,15 @@ uint32_t SdpTransform::GetVideoRtxSsrc() {
     return 0;
 }
 
+uint32_t SdpTransform::GetVideoFecSsrc() {
+    for (auto& item : ssrc_info_map_) {
+        if (item.second.is_video && item.second.is_fec) {
+            return item.first;
+        }
+    }
+    return 0;
+}
+
 std::string SdpTransform::GenSdpString() {
     std::stringstream ss;
     
@@ -129,6 +138,7 @@ int SdpTransform::ParseM(const std::string& line) {
 
 //a=rtpmap:106 H264/90000
 //a=rtpmap:107 rtx/90000
+//a=rtpmap:108 flexfec/90000
 //a=rtpmap:111 opus/48000/2
 int SdpTransform::ParseRtpMap(const std::string& line) {
     const std::string rtpmap_attr("a=rtpmap");
@@ -161,9 +171,13 @@ int SdpTransform::ParseRtpMap(const std::string& line) {
 
     if (current_is_video_) {
         video_rtp_map_infos_[pt] = info;
-        if (info.codec_type == "rtx") {
+        std::string codec_type = info.codec_type;
+        String2Lower(codec_type);
+        if (codec_type == "rtx") {
             video_rtx_clock_rate_ = info.clock_rate;
             LogInfof(logger_, "video rtx clock rate:%d", video_rtx_clock_rate_);
+        } else if (codec_type.find("flexfec") == 0) {
+            LogInfof(logger_, "video flexfec payload type:%d", pt);
         } else {
             video_clock_rate_ = info.clock_rate;
             LogInfof(logger_, "video  clock rate:%d", video_clock_rate_);
@@ -332,7 +346,7 @@ int SdpTransform::ParseSsrcInfo(const std::string& line) {
         std::string cname = ssrc_string.substr(cname_attr.length() + 1);
         auto iter = ssrc_info_map_.find(ssrc);
         if (iter == ssrc_info_map_.end()) {
-            SSRCInfo info;
+            SSRCInfo info = {};
             info.ssrc = ssrc;
             info.is_video = current_is_video_;
             info.cname = cname;
@@ -358,7 +372,7 @@ int SdpTransform::ParseSsrcInfo(const std::string& line) {
 
         auto iter = ssrc_info_map_.find(ssrc);
         if (iter == ssrc_info_map_.end()) {
-            SSRCInfo info;
+            SSRCInfo info = {};
             info.ssrc = ssrc;
             info.is_video = current_is_video_;
             info.msid = msid;
@@ -423,6 +437,36 @@ int SdpTransform::ParseSsrcGroupFid(const std::string& line) {
     return 0;
 }
 
+//rfc8627: a=ssrc-group:FEC-FR 278971352 3519442101, the media ssrc and the fec ssrc
+int SdpTransform::ParseSsrcGroupFec(const std::string& line) {
+    const std::string fec_attr = "a=ssrc-group:FEC-FR";
+    std::string ssrcs_string = line.substr(fec_attr.length() + 1);
+    std::vector<std::string> ssrc_vec;
+
+    StringSplit(ssrcs_string, " ", ssrc_vec);
+
+    LogInfof(logger_, "ParseSsrcGroupFec line:%s", line.c_str());
+    if (ssrc_vec.size() < 2 || !current_is_video_) {
+        LogErrorf(logger_, "fec ssrc group error:%s", line.c_str());
+        return -1;
+    }
+    uint32_t main_ssrc = (uint32_t)atoll(ssrc_vec[0].c_str());
+    uint32_t fec_ssrc  = (uint32_t)atoll(ssrc_vec[1].c_str());
+
+    auto fec_iter = ssrc_info_map_.find(fec_ssrc);
+    if (fec_iter == ssrc_info_map_.end()) {
+        LogErrorf(logger_, "fec ssrc find error:%u", fec_ssrc);
+        return -1;
+    }
+    fec_iter->second.is_rtx   = false;
+    fec_iter->second.is_fec   = true;
+    fec_iter->second.rtx_ssrc = 0;
+
+    video_fec_ssrc_ = fec_ssrc;
+    LogInfof(logger_, "SsrcGroupFec main ssrc:%u, fec ssrc:%u", main_ssrc, fec_ssrc);
+    return 0;
+}
+
 int SdpTransform::ParseLine(std::string line) {
     size_t pos = 0;
     const std::string candidate_attr("a=candidate:");
@@ -438,6 +482,7 @@ int SdpTransform::ParseLine(std::string line) {
     const std::string ext_attr("a=extmap");
     const std::string ssrc_attr("a=ssrc");
     const std::string fid_attr = "a=ssrc-group:FID";
+    const std::string fec_attr = "a=ssrc-group:FEC-FR";
 
     RemoveSubfix(line, "\r");
 
@@ -516,6 +561,12 @@ int SdpTransform::ParseLine(std::string line) {
         return ParseSsrcGroupFid(line);
     }
 
+    //a=ssrc-group:FEC-FR 278971352 3519442101
+    pos = line.find(fec_attr);
+    if (pos == 0) {
+        return ParseSsrcGroupFec(line);
+    }
+
     //a=ssrc:1279799722 cname:ZDA1fh2h/FIKv0Lf
     //a=ssrc:1279799722 msid:7d3a1915-764a-43d3-be25-41a12def895a fc115548-c635-4565-85c7-84c3443ea453
     pos = line.find(ssrc_attr);
@@ -557,6 +608,11 @@ int SdpTransform::ParseLine(std::string line) {
         return 0;
     }
 
+    if (line == "a=sendonly" || line == "a=recvonly" || line == "a=sendrecv") {
+        direction_ = line.substr(2);
+        return 0;
+    }
+
     pos = line.find(ufrag_attr);
     if (pos == 0) {
         if (!dtls_->remote_fragment_.empty()) {
@@ -614,6 +670,9 @@ std::string SdpTransform::GetBasicAttr(bool has_video, bool has_audio) {
     std::stringstream ss;
     int index = 0;
 
+    if (ice_lite_) {
+        ss << "a=ice-lite\n";
+    }
     ss << "a=extmap-allow-mixed\n";
     ss << "a=msid-semantic: WMS\n";
     ss << "a=group:BUNDLE";
@@ -842,6 +901,9 @@ std::string SdpTransform::GetIceInfo(RtcDtls* dtls) {
     ss << "a=ice-pwd:" << dtls->local_pwd_ << "\n";
     ss << "a=fingerprint:" << dtls->fg_algorithm_ << " " << dtls->fingerprint_ << "\n";
     ss << "a=ice-options:trickle\n";
+    for (auto& candidate : candidates_) {
+        ss << "a=candidate:" << candidate << "\n";
+    }
 
     return ss.str();
 }
@@ -851,6 +913,7 @@ a=ssrc:4255034931 msid:- d21a6392-a5f0-450d-ac79-d4494eca0142
 a=ssrc:274918202 cname:tj5+r5YWeiHIF+5n
 a=ssrc:274918202 msid:- d21a6392-a5f0-450d-ac79-d4494eca0142
 a=ssrc-group:FID 4255034931 274918202
+a=ssrc-group:FEC-FR 4255034931 3519442101
 a=rtcp-mux
 a=rtcp-rsize 
  */
@@ -860,11 +923,22 @@ std::string SdpTransform::GetSsrcs(bool is_video) {
     if (is_video) {
         std::stringstream ss_video;
         std::stringstream ss_rtx;
+        std::stringstream ss_fec;
         for(auto& ssrc_item : ssrc_info_map_) {
             if (!ssrc_item.second.is_video) {
                 continue;
             }
-            if (ssrc_item.second.is_rtx) {
+            if (ssrc_item.second.is_fec) {
+                ss_fec << "a=ssrc:" << ssrc_item.second.ssrc;
+                ss_fec << " msid:" << ssrc_item.second.msid;
+                ss_fec << " " << ssrc_item.second.msid_appdata;
+                ss_fec << "\n";
+                ss_fec << "a=ssrc:" << ssrc_item.second.ssrc;
+                ss_fec << " cname:" << ssrc_item.second.cname;
+                ss_fec << "\n";
+
+                video_fec_ssrc_ = ssrc_item.second.ssrc;
+            } else if (ssrc_item.second.is_rtx) {
                 ss_rtx << "a=ssrc:" << ssrc_item.second.ssrc;
                 ss_rtx << " msid:" << ssrc_item.second.msid;
                 ss_rtx << " " << ssrc_item.second.msid_appdata;
@@ -886,9 +960,12 @@ std::string SdpTransform::GetSsrcs(bool is_video) {
                 video_ssrc_ = ssrc_item.second.ssrc;
             }
         }
-        ss << ss_video.str() << ss_rtx.str();
+        ss << ss_video.str() << ss_rtx.str() << ss_fec.str();
 
         ss << "a=ssrc-group:FID " << video_ssrc_ << " " << video_rtx_ssrc_ << "\n";
+        if (!ss_fec.str().empty()) {
+            ss << "a=ssrc-group:FEC-FR " << video_ssrc_ << " " << video_fec_ssrc_ << "\n";
+        }
         ss << "a=rtcp-mux\n";
         ss << "a=rtcp-rsize\n";
     } else {
@@ -949,8 +1026,10 @@ std::string SdpTransform::GetAudioDesc() {
 }
 
 int SdpTransform::GetVideoPayloadType() {
+    int fec_payload_type = GetVideoFecPayloadType();
+
     for (auto& item : video_fmtp_vec_) {
-        if (item.is_video && !item.is_rtx) {
+        if (item.is_video && !item.is_rtx && item.payload_type != fec_payload_type) {
             return item.payload_type;
         }
     }
@@ -958,8 +1037,8 @@ int SdpTransform::GetVideoPayloadType() {
     for (auto& item : video_rtp_map_infos_) {
         std::string codec_type = item.second.codec_type;
         String2Lower(codec_type);
-        if (codec_type == "h264" || codec_type == "vp8"
-            || codec_type == "vp9") {
+        if (codec_type == "h264" || codec_type == "h265"
+            || codec_type == "vp8" || codec_type == "vp9") {
             return item.second.payload_type;
         }
     }
@@ -976,6 +1055,18 @@ int SdpTransform::GetVideoRtxPayloadType() {
     return -1;
 }
 
+//the flexfec of rfc8627, or flexfec-03 of the draft
+int SdpTransform::GetVideoFecPayloadType() {
+    for (auto& item : video_rtp_map_infos_) {
+        std::string codec_type = item.second.codec_type;
+        String2Lower(codec_type);
+        if (codec_type.find("flexfec") == 0) {
+            return item.second.payload_type;
+        }
+    }
+    return -1;
+}
+
 int SdpTransform::GetAudioPayloadType() {
     for (auto& item : audio_fmtp_vec_) {
         LogInfof(logger_, "audio fmtp item payload_type:%d, is video:%d", item.payload_type, item.is_video);
@@ -1010,6 +1101,10 @@ bool SdpTransform::IsVideoRtxEnable() {
    
 }
 
+bool SdpTransform::IsVideoFecEnable() {
+    return GetVideoFecPayloadType() > 0 && GetVideoFecSsrc() > 0;
+}
+
 int SdpTransform::GetVideoClockRate() {
     return video_clock_rate_;
 }
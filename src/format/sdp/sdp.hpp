@@ -15,6 +15,7 @@ namespace cpp_streamer
 
 #define VPLAYLOAD_DEF_TYPE   106
 #define RTX_PAYLOAD_DEF_TYPE 107
+#define FEC_PAYLOAD_DEF_TYPE 108
 #define APLAYLOAD_DEF_TYPE   111
 
 typedef struct {
@@ -50,6 +51,7 @@ typedef struct {
     std::string msid_appdata;
     std::string cname;
     uint32_t rtx_ssrc;
+    bool is_fec;//the flexfec repair stream of the video ssrc
 } SSRCInfo;
 
 class RtcDtls;
@@ -66,16 +68,19 @@ public:
 
     int GetVideoPayloadType();
     int GetVideoRtxPayloadType();
+    int GetVideoFecPayloadType();
     int GetAudioPayloadType();
 
     uint32_t GetVideoSsrc();
     uint32_t GetAudioSsrc();
     uint32_t GetVideoRtxSsrc();
+    uint32_t GetVideoFecSsrc();
 
     bool IsVideoNackEnable();
     bool IsAudioNackEnable();
     bool IsVideoRtxEnable();
     void SetVideoRtxFlag(bool flag);
+    bool IsVideoFecEnable();
 
     int GetVideoClockRate();
     int GetVideoRtxClockRate();
@@ -90,6 +95,7 @@ private:
     int ParseExtMap(const std::string& line);
     int ParseSsrcInfo(const std::string& line);
     int ParseSsrcGroupFid(const std::string& line);
+    int ParseSsrcGroupFec(const std::string& line);
 
 private:
     std::string GetProtoVersion();
@@ -179,9 +185,14 @@ public:
     int amid_ = -1;
     std::string direction_ = "sendonly";
 
+public:
+    bool ice_lite_ = false;//the answer of the loopback server
+    std::vector<std::string> candidates_;//eg. "1 1 udp 2130706431 127.0.0.1 8000 typ host"
+
 public:
     uint32_t video_ssrc_      = 0;
     uint32_t video_rtx_ssrc_  = 0;
+    uint32_t video_fec_ssrc_  = 0;
     uint32_t audio_ssrc_      = 0;
     int video_clock_rate_     = 90000;
     int video_rtx_clock_rate_ = 90000;
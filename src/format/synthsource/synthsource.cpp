@@ -0,0 +1,337 @@
+#include "synthsource.hpp"
+#include "uuid.hpp"
+#include "timeex.hpp"
+
+#include <sstream>
+#include <algorithm>
+#include <string.h>
+
+void* make_synthsource_streamer() {
+    cpp_streamer::SynthSource* source = new cpp_streamer::SynthSource();
+
+    return source;
+}
+
+void destroy_synthsource_streamer(void* streamer) {
+    cpp_streamer::SynthSource* source = (cpp_streamer::SynthSource*)streamer;
+
+    delete source;
+}
+
+namespace cpp_streamer
+{
+#define SYNTH_SOURCE_NAME   "synthsource"
+#define SYNTH_FRAME_MIN     16
+#define AAC_SAMPLE_RATE     44100
+#define AAC_FRAME_SAMPLES   1024
+#define OPUS_FRAME_MS       20
+
+//x264 high profile 1280x720, the pps of the same stream
+static const uint8_t H264_SPS[] = {0x67, 0x64, 0x00, 0x1f, 0xac, 0xd9, 0x40, 0x50, 0x05, 0xbb, 0x01, 0x10,
+                                   0x00, 0x00, 0x03, 0x00, 0x10, 0x00, 0x00, 0x03, 0x03, 0xc0, 0xf1, 0x83,
+                                   0x19, 0x60};
+static const uint8_t H264_PPS[] = {0x68, 0xeb, 0xe3, 0xcb, 0x22, 0xc0};
+static const uint8_t START_CODE[] = {0x00, 0x00, 0x00, 0x01};
+
+//aac lc, 44100hz, stereo
+static const uint8_t AAC_ASC[] = {0x12, 0x10};
+
+std::map<std::string, std::string> SynthSource::def_options_ = {
+    {"vcodec", "h264"},     //h264 or none
+    {"acodec", "opus"},     //opus, aac or none
+    {"bitrate", "2000"},    //the video bitrate in kbps
+    {"fps", "30"},
+    {"gop", "60"},          //the frames from one key frame to the next
+    {"key_ratio", "6"},     //the key frame size to the delta frame size
+    {"size_jitter", "20"},  //the frame sizes vary in +/- percent
+    {"abitrate", "64"},     //the audio bitrate in kbps
+    {"duration", "0"},      //in seconds, 0: endless
+    {"seed", "1"}           //the random seed of the frame sizes and the filler
+};
+
+SynthSource::SynthSource()
+{
+    name_ = SYNTH_SOURCE_NAME;
+    name_ += "_";
+    name_ += UUID::MakeUUID();
+    options_ = def_options_;
+}
+
+SynthSource::~SynthSource()
+{
+    Stop();
+}
+
+std::string SynthSource::StreamerName() {
+    return name_;
+}
+
+void SynthSource::SetLogger(Logger* logger) {
+    logger_ = logger;
+}
+
+int SynthSource::AddSinker(CppStreamerInterface* sinker) {
+    if (!sinker) {
+        return sinkers_.size();
+    }
+    sinkers_[sinker->StreamerName()] = sinker;
+    return sinkers_.size();
+}
+
+int SynthSource::RemoveSinker(const std::string& name) {
+    return sinkers_.erase(name);
+}
+
+//it makes the packets itself, the input is not used
+int SynthSource::SourceData(Media_Packet_Ptr pkt_ptr) {
+    return 0;
+}
+
+void SynthSource::AddOption(const std::string& key, const std::string& value) {
+    auto iter = options_.find(key);
+    if (iter == options_.end()) {
+        std::stringstream ss;
+        ss << "the option key:" << key << " does not exist";
+        throw CppStreamException(ss.str().c_str());
+    }
+    options_[key] = value;
+    LogInfof(logger_, "set synthsource options key:%s, value:%s", key.c_str(), value.c_str());
+}
+
+void SynthSource::SetReporter(StreamerReport* reporter) {
+    report_ = reporter;
+}
+
+void SynthSource::Report(const std::string& type, const std::string& value) {
+    if (report_) {
+        report_->OnReport(name_, type, value);
+    }
+}
+
+void SynthSource::LoadOptions() {
+    int bitrate    = atoi(options_["bitrate"].c_str());
+    int key_ratio  = atoi(options_["key_ratio"].c_str());
+    int abitrate   = atoi(options_["abitrate"].c_str());
+    std::string acodec = options_["acodec"];
+
+    fps_          = atoi(options_["fps"].c_str());
+    gop_          = atoi(options_["gop"].c_str());
+    size_jitter_  = atoi(options_["size_jitter"].c_str());
+    duration_ms_  = atoll(options_["duration"].c_str()) * 1000;
+    video_enable_ = (options_["vcodec"] == "h264");
+
+    if (video_enable_ && (bitrate <= 0 || fps_ <= 0 || gop_ <= 0 || key_ratio <= 0)) {
+        CSM_THROW_ERROR("synthsource video options error, bitrate:%d, fps:%d, gop:%d, key_ratio:%d",
+                bitrate, fps_, gop_, key_ratio);
+    }
+    if (!video_enable_ && options_["vcodec"] != "none") {
+        CSM_THROW_ERROR("synthsource video codec:%s is not supported", options_["vcodec"].c_str());
+    }
+    if (size_jitter_ < 0 || size_jitter_ >= 100) {
+        CSM_THROW_ERROR("synthsource size jitter:%d error", size_jitter_);
+    }
+
+    if (acodec == "opus") {
+        audio_codec_ = MEDIA_CODEC_OPUS;
+        audio_size_  = (size_t)abitrate * 1000 / 8 * OPUS_FRAME_MS / 1000;
+    } else if (acodec == "aac") {
+        audio_codec_ = MEDIA_CODEC_AAC;
+        audio_size_  = (size_t)abitrate * 1000 / 8 * AAC_FRAME_SAMPLES / AAC_SAMPLE_RATE;
+    } else if (acodec == "none") {
+        audio_codec_ = MEDIA_CODEC_UNKOWN;
+    } else {
+        CSM_THROW_ERROR("synthsource audio codec:%s is not supported", acodec.c_str());
+    }
+    if (audio_codec_ != MEDIA_CODEC_UNKOWN && abitrate <= 0) {
+        CSM_THROW_ERROR("synthsource audio bitrate:%d error", abitrate);
+    }
+
+    if (video_enable_) {
+        //one gop: (gop - 1) delta frames and a key frame of key_ratio delta frames
+        size_t gop_bytes = (size_t)bitrate * 1000 / 8 * gop_ / fps_;
+        delta_size_ = gop_bytes / (gop_ - 1 + key_ratio);
+        key_size_   = delta_size_ * key_ratio;
+    }
+
+    //the filler bytes are never zero, so there is no start code emulation in the payload
+    random_.seed((uint32_t)atoi(options_["seed"].c_str()));
+    filler_.resize(SYNTH_FILLER_SIZE);
+    for (size_t index = 0; index < filler_.size(); index++) {
+        filler_[index] = (uint8_t)(random_() % 255 + 1);
+    }
+}
+
+void SynthSource::StartNetwork(const std::string& url, void* loop_handle) {
+    if (!loop_handle) {
+        CSM_THROW_ERROR("synthsource needs the loop handle");
+    }
+    if (timer_) {
+        CSM_THROW_ERROR("synthsource has been started");
+    }
+    LoadOptions();
+
+    loop_ = (uv_loop_t*)loop_handle;
+    timer_ = (uv_timer_t*)malloc(sizeof(uv_timer_t));
+    uv_timer_init(loop_, timer_);
+    timer_->data = this;
+
+    start_ms_ = now_millisec();
+    uv_timer_start(timer_, OnSynthSourceTimer, 0, SYNTH_SOURCE_TICK_MS);
+    LogInfof(logger_, "synthsource starts, video:%s, key frame:%lu, delta frame:%lu, fps:%d, gop:%d, audio:%s, audio frame:%lu, duration:%ldms",
+            video_enable_ ? "h264" : "none", key_size_, delta_size_, fps_, gop_,
+            codectype_tostring(audio_codec_).c_str(), audio_size_, duration_ms_);
+}
+
+void SynthSource::Stop() {
+    if (!timer_) {
+        return;
+    }
+    uv_timer_stop(timer_);
+    timer_->data = nullptr;
+    uv_close(reinterpret_cast<uv_handle_t*>(timer_), OnSynthSourceHandleClose);
+    timer_ = nullptr;
+}
+
+//the frames whose dts is due are output in the dts order
+void SynthSource::OnTimer() {
+    int64_t elapsed_ms = now_millisec() - start_ms_;
+
+    if (duration_ms_ > 0 && elapsed_ms > duration_ms_) {
+        elapsed_ms = duration_ms_;
+    }
+    if (audio_codec_ == MEDIA_CODEC_AAC && audio_index_ == 0) {
+        OutputAudioSeq();
+    }
+    while (true) {
+        int64_t video_dts = video_enable_ ? video_index_ * 1000 / fps_ : INT64_MAX;
+        int64_t audio_dts = INT64_MAX;
+
+        if (audio_codec_ == MEDIA_CODEC_OPUS) {
+            audio_dts = audio_index_ * OPUS_FRAME_MS;
+        } else if (audio_codec_ == MEDIA_CODEC_AAC) {
+            audio_dts = audio_index_ * AAC_FRAME_SAMPLES * 1000 / AAC_SAMPLE_RATE;
+        }
+        int64_t dts = std::min(video_dts, audio_dts);
+        if (duration_ms_ > 0 && dts >= duration_ms_) {
+            LogInfof(logger_, "synthsource is over, duration:%ldms, packets:%ld",
+                    duration_ms_, packet_count_);
+            Stop();
+            Report("end", std::to_string(packet_count_));
+            return;
+        }
+        if (dts > elapsed_ms) {
+            break;
+        }
+        if (video_dts <= audio_dts) {
+            OutputVideoFrame();
+        } else {
+            OutputAudioFrame();
+        }
+    }
+}
+
+size_t SynthSource::NextFrameSize(size_t average) {
+    if (size_jitter_ > 0) {
+        int jitter = (int)(random_() % (2 * size_jitter_ + 1)) - size_jitter_;
+        average = average * (100 + jitter) / 100;
+    }
+    return (average < SYNTH_FRAME_MIN) ? SYNTH_FRAME_MIN : average;
+}
+
+void SynthSource::AppendFiller(Media_Packet_Ptr pkt_ptr, size_t len) {
+    size_t offset = random_() % filler_.size();
+
+    while (len > 0) {
+        size_t copy_len = std::min(len, filler_.size() - offset);
+        pkt_ptr->buffer_ptr_->AppendData((char*)filler_.data() + offset, copy_len);
+        len   -= copy_len;
+        offset = 0;
+    }
+}
+
+void SynthSource::OutputVideoFrame() {
+    bool key = (video_index_ % gop_) == 0;
+    size_t size = NextFrameSize(key ? key_size_ : delta_size_);
+    size_t total = size + sizeof(START_CODE);
+    Media_Packet_Ptr pkt_ptr;
+
+    metrics_.BeginStage();
+    if (key) {
+        total += sizeof(START_CODE) * 2 + sizeof(H264_SPS) + sizeof(H264_PPS);
+    }
+    pkt_ptr = std::make_shared<Media_Packet>(total);
+    pkt_ptr->av_type_      = MEDIA_VIDEO_TYPE;
+    pkt_ptr->codec_type_   = MEDIA_CODEC_H264;
+    pkt_ptr->fmt_type_     = MEDIA_FORMAT_RAW;
+    pkt_ptr->dts_          = video_index_ * 1000 / fps_;
+    pkt_ptr->pts_          = pkt_ptr->dts_;
+    pkt_ptr->is_key_frame_ = key;
+
+    //the annexb access unit: [sps, pps,] the idr or p slice
+    if (key) {
+        pkt_ptr->buffer_ptr_->AppendData((char*)START_CODE, sizeof(START_CODE));
+        pkt_ptr->buffer_ptr_->AppendData((char*)H264_SPS, sizeof(H264_SPS));
+        pkt_ptr->buffer_ptr_->AppendData((char*)START_CODE, sizeof(START_CODE));
+        pkt_ptr->buffer_ptr_->AppendData((char*)H264_PPS, sizeof(H264_PPS));
+    }
+    uint8_t nalu_header = key ? 0x65 : 0x41;
+    pkt_ptr->buffer_ptr_->AppendData((char*)START_CODE, sizeof(START_CODE));
+    pkt_ptr->buffer_ptr_->AppendData((char*)&nalu_header, 1);
+    AppendFiller(pkt_ptr, size - 1);
+
+    video_index_++;
+    Output(pkt_ptr);
+}
+
+void SynthSource::OutputAudioFrame() {
+    Media_Packet_Ptr pkt_ptr = std::make_shared<Media_Packet>(audio_size_);
+
+    metrics_.BeginStage();
+    pkt_ptr->av_type_    = MEDIA_AUDIO_TYPE;
+    pkt_ptr->codec_type_ = audio_codec_;
+    pkt_ptr->fmt_type_   = MEDIA_FORMAT_RAW;
+    if (audio_codec_ == MEDIA_CODEC_OPUS) {
+        uint8_t toc = 0xfc;//celt fullband 20ms, stereo, one frame
+
+        pkt_ptr->dts_ = audio_index_ * OPUS_FRAME_MS;
+        pkt_ptr->buffer_ptr_->AppendData((char*)&toc, 1);
+        AppendFiller(pkt_ptr, audio_size_ - 1);
+    } else {
+        pkt_ptr->dts_ = audio_index_ * AAC_FRAME_SAMPLES * 1000 / AAC_SAMPLE_RATE;
+        AppendFiller(pkt_ptr, audio_size_);
+    }
+    pkt_ptr->pts_ = pkt_ptr->dts_;
+
+    audio_index_++;
+    Output(pkt_ptr);
+}
+
+void SynthSource::OutputAudioSeq() {
+    Media_Packet_Ptr pkt_ptr = std::make_shared<Media_Packet>(sizeof(AAC_ASC));
+
+    metrics_.BeginStage();
+    pkt_ptr->av_type_     = MEDIA_AUDIO_TYPE;
+    pkt_ptr->codec_type_  = MEDIA_CODEC_AAC;
+    pkt_ptr->fmt_type_    = MEDIA_FORMAT_RAW;
+    pkt_ptr->dts_         = 0;
+    pkt_ptr->pts_         = 0;
+    pkt_ptr->is_seq_hdr_  = true;
+    pkt_ptr->has_flv_audio_asc_ = true;
+    pkt_ptr->sample_rate_ = AAC_SAMPLE_RATE;
+    pkt_ptr->channel_     = 2;
+    pkt_ptr->buffer_ptr_->AppendData((char*)AAC_ASC, sizeof(AAC_ASC));
+    Output(pkt_ptr);
+}
+
+void SynthSource::Output(Media_Packet_Ptr pkt_ptr) {
+    packet_count_++;
+    metrics_.OnPacket(pkt_ptr->buffer_ptr_->DataLen());
+    metrics_.EndStage();
+    metrics_.OnRelease(pkt_ptr->ingress_us_);
+    metrics_.OnOutput(pkt_ptr->ingress_us_);
+    for (auto& sinker : sinkers_) {
+        sinker.second->SourceData(pkt_ptr);
+    }
+}
+
+}
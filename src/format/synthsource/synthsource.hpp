@@ -0,0 +1,111 @@
+#ifndef SYNTH_SOURCE_HPP
+#define SYNTH_SOURCE_HPP
+#include "cpp_streamer_interface.hpp"
+#include "media_packet.hpp"
+#include "logger.hpp"
+
+#include <uv.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string>
+#include <vector>
+#include <random>
+#include <map>
+
+extern "C" {
+void* make_synthsource_streamer();
+void destroy_synthsource_streamer(void* streamer);
+}
+
+namespace cpp_streamer
+{
+#define SYNTH_SOURCE_TICK_MS     10
+#define SYNTH_FILLER_SIZE        (256*1024)//the filler pool the payloads are copied from
+
+inline void OnSynthSourceTimer(uv_timer_t* handle);
+inline void OnSynthSourceHandleClose(uv_handle_t* handle);
+
+/*
+ * synthetic media source streamer for the load generation without input files:
+ * it outputs the h264 annexb access units(sps/pps/idr on the key frames, p slices
+ * between them) and the aac or opus frames, with the filler payloads, paced by the
+ * dts on a uv timer of the loop in StartNetwork. the url is not used.
+ * the video frame sizes come from the bitrate, the fps, the gop and key_ratio(the key
+ * frame size to the delta frame size), each one jittered by size_jitter percent.
+ * the packets are shared by all the sinkers, which must not modify them.
+ * it reports "end" with the packets count when the duration is over.
+ */
+class SynthSource : public CppStreamerInterface
+{
+friend void OnSynthSourceTimer(uv_timer_t* handle);
+
+public:
+    SynthSource();
+    virtual ~SynthSource();
+
+public:
+    virtual std::string StreamerName() override;
+    virtual void SetLogger(Logger* logger) override;
+    virtual int AddSinker(CppStreamerInterface* sinker) override;
+    virtual int RemoveSinker(const std::string& name) override;
+    virtual int SourceData(Media_Packet_Ptr pkt_ptr) override;
+    //loop_handle is required
+    virtual void StartNetwork(const std::string& url, void* loop_handle) override;
+    virtual void AddOption(const std::string& key, const std::string& value) override;
+    virtual void SetReporter(StreamerReport* reporter) override;
+
+private:
+    void LoadOptions();
+    void OnTimer();
+    void Stop();
+    void Report(const std::string& type, const std::string& value);
+
+    size_t NextFrameSize(size_t average);
+    void AppendFiller(Media_Packet_Ptr pkt_ptr, size_t len);
+    void OutputVideoFrame();
+    void OutputAudioFrame();
+    void OutputAudioSeq();
+    void Output(Media_Packet_Ptr pkt_ptr);
+
+private:
+    uv_loop_t* loop_   = nullptr;
+    uv_timer_t* timer_ = nullptr;
+    int64_t start_ms_  = -1;
+
+private:
+    bool video_enable_ = true;
+    MEDIA_CODEC_TYPE audio_codec_ = MEDIA_CODEC_OPUS;//MEDIA_CODEC_UNKOWN: no audio
+    int fps_           = 30;
+    int gop_           = 60;
+    size_t key_size_   = 0;
+    size_t delta_size_ = 0;
+    size_t audio_size_ = 0;
+    int size_jitter_   = 20;
+    int64_t duration_ms_ = 0;//0: endless
+
+private:
+    int64_t video_index_ = 0;
+    int64_t audio_index_ = 0;
+    int64_t packet_count_ = 0;
+    std::vector<uint8_t> filler_;
+    std::mt19937 random_;
+
+private:
+    static std::map<std::string, std::string> def_options_;
+};
+
+inline void OnSynthSourceTimer(uv_timer_t* handle) {
+    SynthSource* source = (SynthSource*)handle->data;
+    if (source) {
+        source->OnTimer();
+    }
+}
+
+inline void OnSynthSourceHandleClose(uv_handle_t* handle) {
+    free(handle);
+}
+
+}
+
+#endif
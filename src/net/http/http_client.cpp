@@ -1,4 +1,5 @@
 #include "http_client.hpp"
+#include "http_client_pool.hpp"
 #include "utils/logger.hpp"
 #include "utils/stringex.hpp"
 
@@ -10,17 +11,100 @@
 namespace cpp_streamer
 {
 
+int ParseHttpResponseHeader(const std::string& header_str, HttpClientResponse* resp, Logger* logger) {
+    std::vector<std::string> lines_vec;
+
+    StringSplit(header_str, "\r\n", lines_vec);
+    for (size_t i = 0; i < lines_vec.size(); i++) {
+        size_t pos = 0;
+        if (i == 0) {
+            std::vector<std::string> item_vec;
+            StringSplit(lines_vec[0], " ", item_vec);
+            if (item_vec.size() < 3) {
+                LogErrorf(logger, "http response line error:%s", lines_vec[0].c_str());
+                return -1;
+            }
+
+            pos = item_vec[0].find("/");
+            if (pos == std::string::npos) {
+                LogErrorf(logger, "http response proto error:%s", item_vec[0].c_str());
+                return -1;
+            }
+            resp->proto_   = item_vec[0].substr(0, pos);
+            resp->version_ = item_vec[0].substr(pos+1);
+            resp->status_code_ = atoi(item_vec[1].c_str());
+            if (item_vec.size() == 3) {
+                resp->status_      = item_vec[2];
+            } else {
+                std::string status_string("");
+                for (size_t i = 2; i < item_vec.size(); i++) {
+                    status_string += item_vec[i];
+                }
+                resp->status_ = status_string;
+            }
+            continue;
+        }
+        pos = lines_vec[i].find(":");
+        if (pos == std::string::npos) {
+            LogErrorf(logger, "http response header error:%s", lines_vec[i].c_str());
+            return -1;
+        }
+        std::string key   = lines_vec[i].substr(0, pos);
+        std::string value = lines_vec[i].substr(pos + 2);
+
+        if (key == "Content-Length") {
+            resp->content_length_ = atoi(value.c_str());
+            LogInfof(logger, "http content length:%d", resp->content_length_);
+        }
+        resp->headers_[key] = value;
+        LogInfof(logger, "header: %s: %s", key.c_str(), value.c_str());
+    }
+    return 0;
+}
+
+std::string MakeHttpRequest(HTTP_METHOD method, const std::string& host, const std::string& subpath,
+        const std::map<std::string, std::string>& headers, const std::string& data) {
+    std::stringstream http_stream;
+
+    if (method == HTTP_GET) {
+        http_stream << "GET " << subpath << " HTTP/1.1\r\n";
+    } else if (method == HTTP_POST) {
+        http_stream << "POST " << subpath << " HTTP/1.1\r\n";
+    } else {
+        CSM_THROW_ERROR("unkown http method:%d", method);
+    }
+    http_stream << "Accept: */*\r\n";
+    http_stream << "Host: " << host << "\r\n";
+    for (auto& header : headers) {
+        http_stream << header.first << ": " << header.second << "\r\n";
+    }
+    if (method == HTTP_POST) {
+        http_stream << "Content-Length: " << data.length() << "\r\n";
+    }
+    http_stream << "\r\n";
+    if (method == HTTP_POST) {
+        http_stream << data;
+    }
+    return http_stream.str();
+}
+
 HttpClient::HttpClient(uv_loop_t* loop,
                        const std::string& host,
                        uint16_t port,
                        HttpClientCallbackI* cb,
                        Logger* logger,
-                       bool ssl_enable): host_(host)
+                       bool ssl_enable,
+                       bool keep_alive): ssl_enable_(ssl_enable)
+                                         , host_(host)
                                          , port_(port)
                                          , cb_(cb)
                                          , logger_(logger)
 {
-    client_ = new TcpClient(loop, this, logger_, ssl_enable);
+    if (keep_alive) {
+        pool_ = HttpClientPool::Attach(loop, logger_);
+    } else {
+        client_ = new TcpClient(loop, this, logger_, ssl_enable);
+    }
 }
 
 HttpClient::~HttpClient()
@@ -30,6 +114,11 @@ HttpClient::~HttpClient()
         delete client_;
         client_ = nullptr;
     }
+    if (pool_) {
+        pool_->Cancel(this);
+        HttpClientPool::Detach(pool_);
+        pool_ = nullptr;
+    }
 }
 
 int HttpClient::Get(const std::string& subpath, const std::map<std::string, std::string>& headers) {
@@ -37,6 +126,11 @@ int HttpClient::Get(const std::string& subpath, const std::map<std::string, std:
     subpath_ = subpath;
     headers_ = headers;
 
+    if (pool_) {
+        LogInfof(logger_, "http get host:%s, port:%d, subpath:%s by pool", host_.c_str(), port_, subpath.c_str());
+        return pool_->Request(host_, port_, ssl_enable_,
+                MakeHttpRequest(method_, host_, subpath_, headers_, post_data_), this);
+    }
     LogInfof(logger_, "http get connect host:%s, port:%d, subpath:%s", host_.c_str(), port_, subpath.c_str());
     client_->Connect(host_, port_);
     return 0;
@@ -48,6 +142,12 @@ int HttpClient::Post(const std::string& subpath, const std::map<std::string, std
     post_data_ = data;
     headers_   = headers;
 
+    if (pool_) {
+        LogInfof(logger_, "http post host:%s, port:%d, subpath:%s by pool, post data:%s",
+                host_.c_str(), port_, subpath.c_str(), data.c_str());
+        return pool_->Request(host_, port_, ssl_enable_,
+                MakeHttpRequest(method_, host_, subpath_, headers_, post_data_), this);
+    }
     client_->Connect(host_, port_);
     LogInfof(logger_, "http post connect host:%s, port:%d, subpath:%s, post data:%s", 
             host_.c_str(), port_, subpath.c_str(), data.c_str());
@@ -56,6 +156,11 @@ int HttpClient::Post(const std::string& subpath, const std::map<std::string, std
 
 void HttpClient::Close() {
     LogInfof(logger_, "http close...");
+    if (pool_) {
+        //the connection is left in the pool
+        pool_->Cancel(this);
+        return;
+    }
     client_->Close();
 }
 
@@ -63,6 +168,20 @@ TcpClient* HttpClient::GetTcpClient() {
     return client_;
 }
 
+int64_t HttpClient::GetConnectMs() {
+    if (client_) {
+        return client_->GetConnectMs();
+    }
+    return connect_ms_;
+}
+
+void HttpClient::OnHttpRead(int ret, std::shared_ptr<HttpClientResponse> resp_ptr) {
+    if (resp_ptr) {
+        connect_ms_ = resp_ptr->connect_ms_;
+    }
+    cb_->OnHttpRead(ret, resp_ptr);
+}
+
 void HttpClient::OnConnect(int ret_code) {
     if (ret_code < 0) {
         LogErrorf(logger_, "http client OnConnect error:%d", ret_code);
@@ -70,30 +189,11 @@ void HttpClient::OnConnect(int ret_code) {
         cb_->OnHttpRead(ret_code, resp_ptr);
         return;
     }
-    std::stringstream http_stream;
-
     LogInfof(logger_, "on connect code:%d", ret_code);
-    if (method_ == HTTP_GET) {
-        http_stream << "GET " << subpath_ << " HTTP/1.1\r\n";
-    } else if (method_ == HTTP_POST) {
-        http_stream << "POST " << subpath_ << " HTTP/1.1\r\n";
-    } else {
-        CSM_THROW_ERROR("unkown http method:%d", method_);
-    }
-    http_stream << "Accept: */*\r\n";
-    http_stream << "Host: " << host_ << "\r\n";
-    for (auto& header : headers_) {
-        http_stream << header.first << ": " << header.second << "\r\n";
-    }
-    if (method_ == HTTP_POST) {
-        http_stream << "Content-Length: " << post_data_.length() << "\r\n";
-    }
-    http_stream << "\r\n";
-    if (method_ == HTTP_POST) {
-        http_stream << post_data_;
-    }
-    LogInfof(logger_, "http post:%s", http_stream.str().c_str());
-    client_->Send(http_stream.str().c_str(), http_stream.str().length());
+    std::string http_req = MakeHttpRequest(method_, host_, subpath_, headers_, post_data_);
+
+    LogInfof(logger_, "http post:%s", http_req.c_str());
+    client_->Send(http_req.c_str(), http_req.length());
 }
 
 void HttpClient::OnWrite(int ret_code, size_t sent_size) {
@@ -124,45 +224,13 @@ void HttpClient::OnRead(int ret_code, const char* data, size_t data_size) {
         std::string header_str(resp_ptr_->data_.Data(), resp_ptr_->data_.DataLen());
         size_t pos = header_str.find("\r\n\r\n");
         if (pos != std::string::npos) {
-            std::vector<std::string> lines_vec;
             resp_ptr_->header_ready_ = true;
             header_str = header_str.substr(0, pos);
             resp_ptr_->data_.ConsumeData(pos + 4);
 
-            StringSplit(header_str, "\r\n", lines_vec);
-            for (size_t i = 0; i < lines_vec.size(); i++) {
-                if (i == 0) {
-                    std::vector<std::string> item_vec;
-                    StringSplit(lines_vec[0], " ", item_vec);
-                    assert(item_vec.size() >= 3);
-
-                    pos = item_vec[0].find("/");
-                    assert(pos != std::string::npos);
-                    resp_ptr_->proto_   = item_vec[0].substr(0, pos);
-                    resp_ptr_->version_ = item_vec[0].substr(pos+1);
-                    resp_ptr_->status_code_ = atoi(item_vec[1].c_str());
-                    if (item_vec.size() == 3) {
-                        resp_ptr_->status_      = item_vec[2];
-                    } else {
-                        std::string status_string("");
-                        for (size_t i = 2; i < item_vec.size(); i++) {
-                            status_string += item_vec[i];
-                        }
-                        resp_ptr_->status_ = status_string;
-                    }
-                    continue;
-                }
-                pos = lines_vec[i].find(":");
-                assert(pos != std::string::npos);
-                std::string key   = lines_vec[i].substr(0, pos);
-                std::string value = lines_vec[i].substr(pos + 2);
-
-                if (key == "Content-Length") {
-                    resp_ptr_->content_length_ = atoi(value.c_str());
-                    LogInfof(logger_, "http content length:%d", resp_ptr_->content_length_);
-                }
-                resp_ptr_->headers_[key] = value;
-                LogInfof(logger_, "header: %s: %s", key.c_str(), value.c_str());
+            if (ParseHttpResponseHeader(header_str, resp_ptr_.get(), logger_) < 0) {
+                cb_->OnHttpRead(-1, resp_ptr_);
+                return;
             }
         } else {
             LogInfof(logger_, "header not ready, read more");
@@ -30,6 +30,7 @@ public:
     DataBuffer data_;
     bool header_ready_ = false;
     bool body_ready_   = false;
+    int64_t connect_ms_ = 0;//the time waiting for the connection(dns, tcp and tls)
 };
 
 class HttpClientCallbackI
@@ -38,11 +39,24 @@ public:
     virtual void OnHttpRead(int ret, std::shared_ptr<HttpClientResponse> resp_ptr) = 0;
 };
 
-class HttpClient : public TcpClientCallback
+class HttpClientPool;
+
+//the status line and the headers without the ending "\r\n\r\n"
+int ParseHttpResponseHeader(const std::string& header_str, HttpClientResponse* resp, Logger* logger);
+std::string MakeHttpRequest(HTTP_METHOD method, const std::string& host, const std::string& subpath,
+        const std::map<std::string, std::string>& headers, const std::string& data);
+
+/*
+ * one http request on its own connection by default,
+ * with keep_alive the request goes through the HttpClientPool of the loop,
+ * which reuses the connections to the same host:port:tls and pipelines the requests on them.
+ */
+class HttpClient : public TcpClientCallback, public HttpClientCallbackI
 {
 public:
     HttpClient(uv_loop_t* loop, const std::string& host, uint16_t port,
-            HttpClientCallbackI* cb, Logger* logger = nullptr, bool ssl_enable = false);
+            HttpClientCallbackI* cb, Logger* logger = nullptr, bool ssl_enable = false,
+            bool keep_alive = false);
     virtual ~HttpClient();
 
 public:
@@ -50,14 +64,21 @@ public:
     int Post(const std::string& subpath, const std::map<std::string, std::string>& headers, const std::string& data);
     void Close();
     TcpClient* GetTcpClient();
+    int64_t GetConnectMs();
     
 private:
     virtual void OnConnect(int ret_code) override;
     virtual void OnWrite(int ret_code, size_t sent_size) override;
     virtual void OnRead(int ret_code, const char* data, size_t data_size) override;
 
+private://the response from the pool
+    virtual void OnHttpRead(int ret, std::shared_ptr<HttpClientResponse> resp_ptr) override;
+
 private:
     TcpClient* client_ = nullptr;
+    HttpClientPool* pool_ = nullptr;
+    bool ssl_enable_   = false;
+    int64_t connect_ms_ = 0;
     std::string host_;
     uint16_t port_ = 0;
     HTTP_METHOD method_ = HTTP_GET;
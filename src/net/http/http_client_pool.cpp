@@ -0,0 +1,386 @@
+#include "http_client_pool.hpp"
+#include "timeex.hpp"
+
+#include <string>
+#include <sstream>
+#include <cstring>
+
+namespace cpp_streamer
+{
+//the request may be sent again when the server has not answered it, rfc7230 6.3.1
+static bool IsIdempotentRequest(const std::string& data) {
+    static const char* methods[] = {"GET ", "HEAD ", "PUT ", "DELETE ", "OPTIONS ", "TRACE "};
+
+    for (const char* method : methods) {
+        if (data.compare(0, strlen(method), method) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+HttpPoolConnection::HttpPoolConnection(HttpClientPool* pool,
+                                       uv_loop_t* loop,
+                                       const std::string& host,
+                                       uint16_t port,
+                                       bool ssl_enable,
+                                       Logger* logger):pool_(pool)
+                                                       , host_(host)
+                                                       , port_(port)
+                                                       , ssl_enable_(ssl_enable)
+                                                       , logger_(logger)
+{
+    client_  = new TcpClient(loop, this, logger_, ssl_enable);
+    idle_ms_ = now_millisec();
+}
+
+HttpPoolConnection::~HttpPoolConnection()
+{
+    if (client_) {
+        delete client_;
+        client_ = nullptr;
+    }
+}
+
+int HttpPoolConnection::Start() {
+    try {
+        client_->Connect(host_, port_);
+    } catch(CppStreamException& e) {
+        LogErrorf(logger_, "http pool connect host:%s, port:%d exception:%s",
+                host_.c_str(), port_, e.what());
+        broken_ = true;
+        return -1;
+    }
+    return 0;
+}
+
+void HttpPoolConnection::Request(const HttpPoolRequest& req) {
+    requests_.push_back(req);
+    if (connected_) {
+        requests_.back().connect_ms = 0;
+        SendRequest(requests_.back());
+    }
+}
+
+void HttpPoolConnection::Cancel(HttpClientCallbackI* cb) {
+    for (auto& req : requests_) {
+        if (req.cb == cb) {
+            //the response is still read and dropped to keep the order
+            req.cb = nullptr;
+        }
+    }
+}
+
+void HttpPoolConnection::SendRequest(HttpPoolRequest& req) {
+    if (req.sent) {
+        return;
+    }
+    req.sent = true;
+    try {
+        client_->Send(req.data.c_str(), req.data.length());
+    } catch(CppStreamException& e) {
+        LogErrorf(logger_, "http pool send exception:%s", e.what());
+        OnBroken(-1);
+    }
+}
+
+void HttpPoolConnection::OnConnect(int ret_code) {
+    if (ret_code < 0) {
+        LogErrorf(logger_, "http pool connect host:%s, port:%d error:%d", host_.c_str(), port_, ret_code);
+        OnBroken(ret_code);
+        return;
+    }
+    int64_t now_ms = now_millisec();
+
+    connected_ = true;
+    LogInfof(logger_, "http pool connected host:%s, port:%d, ssl:%s, connect:%ldms, pending:%lu",
+            host_.c_str(), port_, ssl_enable_ ? "true" : "false",
+            client_->GetConnectMs(), requests_.size());
+    for (size_t i = 0; i < requests_.size() && !broken_; i++) {
+        requests_[i].connect_ms = now_ms - requests_[i].start_ms;
+        SendRequest(requests_[i]);
+    }
+    if (!broken_) {
+        client_->AsyncRead();
+    }
+}
+
+void HttpPoolConnection::OnWrite(int ret_code, size_t sent_size) {
+    if (ret_code < 0) {
+        OnBroken(ret_code);
+        return;
+    }
+    client_->AsyncRead();
+}
+
+void HttpPoolConnection::OnRead(int ret_code, const char* data, size_t data_size) {
+    if (ret_code < 0) {
+        OnBroken(ret_code);
+        return;
+    }
+    if (data_size == 0) {
+        return;
+    }
+    recv_buffer_.AppendData(data, data_size);
+
+    if (ParseResponse() < 0) {
+        OnBroken(-1);
+    }
+}
+
+int HttpPoolConnection::ParseResponse() {
+    while (!broken_) {
+        if (!resp_ptr_) {
+            std::string header_str(recv_buffer_.Data(), recv_buffer_.DataLen());
+            size_t pos = header_str.find("\r\n\r\n");
+            if (pos == std::string::npos) {
+                return 0;
+            }
+            resp_ptr_ = std::make_shared<HttpClientResponse>();
+            resp_ptr_->header_ready_ = true;
+            if (ParseHttpResponseHeader(header_str.substr(0, pos), resp_ptr_.get(), logger_) < 0) {
+                return -1;
+            }
+            recv_buffer_.ConsumeData(pos + 4);
+        }
+        if ((int)recv_buffer_.DataLen() < resp_ptr_->content_length_) {
+            return 0;
+        }
+        if (resp_ptr_->content_length_ > 0) {
+            resp_ptr_->data_.AppendData(recv_buffer_.Data(), resp_ptr_->content_length_);
+            recv_buffer_.ConsumeData(resp_ptr_->content_length_);
+        }
+        resp_ptr_->body_ready_ = true;
+
+        std::shared_ptr<HttpClientResponse> resp_ptr = resp_ptr_;
+        resp_ptr_ = nullptr;
+
+        if (requests_.empty()) {
+            LogErrorf(logger_, "http pool host:%s gets a response without request", host_.c_str());
+            return -1;
+        }
+        HttpPoolRequest req = requests_.front();
+        requests_.pop_front();
+        done_count_++;
+        if (requests_.empty()) {
+            idle_ms_ = now_millisec();
+        }
+
+        auto iter = resp_ptr->headers_.find("Connection");
+        if (iter != resp_ptr->headers_.end() && iter->second == "close") {
+            //the following requests go to another connection
+            broken_ = true;
+        }
+        resp_ptr->connect_ms_ = req.connect_ms;
+        if (req.cb) {
+            req.cb->OnHttpRead(0, resp_ptr);
+        }
+    }
+    if (!requests_.empty()) {
+        OnBroken(-1);
+    }
+    return 0;
+}
+
+void HttpPoolConnection::OnBroken(int ret_code) {
+    bool reused = done_count_ > 0;
+
+    if (!broken_ || !requests_.empty()) {
+        LogInfof(logger_, "http pool connection host:%s, port:%d is closed, ret:%d, pending:%lu",
+                host_.c_str(), port_, ret_code, requests_.size());
+    }
+    broken_ = true;
+    client_->Close();
+
+    std::vector<HttpPoolRequest> retry_reqs;
+    std::vector<HttpPoolRequest> failed_reqs;
+    bool answering = (resp_ptr_ != nullptr);//the front request has got a partial response
+    while (!requests_.empty()) {
+        HttpPoolRequest& req = requests_.front();
+        //a written POST may have been handled by the server, only the unwritten or
+        //the idempotent requests are safe to send again
+        bool safe = !req.sent || (!answering && IsIdempotentRequest(req.data));
+        answering = false;
+        if (req.cb) {
+            if (reused && !req.retried && safe) {
+                //the server closed the idle connection before the request arrived
+                req.retried = true;
+                req.sent    = false;
+                retry_reqs.push_back(req);
+            } else {
+                failed_reqs.push_back(req);
+            }
+        }
+        requests_.pop_front();
+    }
+    if (!retry_reqs.empty()) {
+        pool_->Retry(host_, port_, ssl_enable_, retry_reqs);
+    }
+    std::shared_ptr<HttpClientResponse> resp_ptr;
+    for (auto& req : failed_reqs) {
+        req.cb->OnHttpRead(ret_code < 0 ? ret_code : -1, resp_ptr);
+    }
+}
+
+HttpClientPool* HttpClientPool::Attach(uv_loop_t* loop, Logger* logger) {
+    std::lock_guard<std::mutex> lock(GetMutex());
+    std::map<uv_loop_t*, HttpClientPool*>& pools = GetPools();
+
+    HttpClientPool* pool = nullptr;
+    auto iter = pools.find(loop);
+    if (iter == pools.end()) {
+        pool = new HttpClientPool(loop, logger);
+        pools[loop] = pool;
+    } else {
+        pool = iter->second;
+    }
+    pool->ref_count_++;
+    return pool;
+}
+
+void HttpClientPool::Detach(HttpClientPool* pool) {
+    std::lock_guard<std::mutex> lock(GetMutex());
+
+    if (--pool->ref_count_ > 0) {
+        return;
+    }
+    GetPools().erase(pool->loop_);
+    //the pool and its connections are released in the close callback,
+    //the connection which calls Detach in its response callback is still alive
+    uv_timer_stop(&pool->timer_);
+    uv_close((uv_handle_t*)&pool->timer_, OnHttpPoolClose);
+}
+
+HttpClientPool::HttpClientPool(uv_loop_t* loop, Logger* logger):loop_(loop)
+                                                                , logger_(logger)
+{
+    uv_timer_init(loop, &timer_);
+    timer_.data = this;
+    uv_timer_start(&timer_, OnHttpPoolTimer, HTTP_POOL_CHECK_MS, HTTP_POOL_CHECK_MS);
+    //the idle connections do not keep the loop running
+    uv_unref((uv_handle_t*)&timer_);
+}
+
+HttpClientPool::~HttpClientPool()
+{
+    for (auto& item : conns_) {
+        for (HttpPoolConnection* conn : item.second) {
+            delete conn;
+        }
+    }
+    conns_.clear();
+}
+
+std::mutex& HttpClientPool::GetMutex() {
+    static std::mutex s_mutex;
+    return s_mutex;
+}
+
+std::map<uv_loop_t*, HttpClientPool*>& HttpClientPool::GetPools() {
+    static std::map<uv_loop_t*, HttpClientPool*> s_pools;
+    return s_pools;
+}
+
+std::string HttpClientPool::GetKey(const std::string& host, uint16_t port, bool ssl_enable) {
+    std::stringstream ss;
+
+    ss << host << ":" << port << ":" << (ssl_enable ? "tls" : "tcp");
+    return ss.str();
+}
+
+int HttpClientPool::Request(const std::string& host, uint16_t port, bool ssl_enable,
+        const std::string& data, HttpClientCallbackI* cb) {
+    HttpPoolRequest req;
+
+    req.cb         = cb;
+    req.data       = data;
+    req.start_ms   = now_millisec();
+    req.connect_ms = 0;
+    req.sent       = false;
+    req.retried    = false;
+
+    return Dispatch(host, port, ssl_enable, req);
+}
+
+void HttpClientPool::Retry(const std::string& host, uint16_t port, bool ssl_enable,
+        std::vector<HttpPoolRequest>& reqs) {
+    std::shared_ptr<HttpClientResponse> resp_ptr;
+
+    for (auto& req : reqs) {
+        if (Dispatch(host, port, ssl_enable, req) < 0) {
+            req.cb->OnHttpRead(-1, resp_ptr);
+        }
+    }
+}
+
+int HttpClientPool::Dispatch(const std::string& host, uint16_t port, bool ssl_enable,
+        const HttpPoolRequest& req) {
+    std::list<HttpPoolConnection*>& conns = conns_[GetKey(host, port, ssl_enable)];
+    HttpPoolConnection* selected = nullptr;
+    size_t alive = 0;
+
+    for (HttpPoolConnection* conn : conns) {
+        if (conn->IsBroken()) {
+            continue;
+        }
+        alive++;
+        if (conn->GetPendingCount() == 0) {
+            selected = conn;
+            break;
+        }
+        if (!selected || conn->GetPendingCount() < selected->GetPendingCount()) {
+            selected = conn;
+        }
+    }
+    if (!selected || (selected->GetPendingCount() > 0 && alive < HTTP_POOL_MAX_CONNS)) {
+        HttpPoolConnection* conn = new HttpPoolConnection(this, loop_, host, port, ssl_enable, logger_);
+        if (conn->Start() < 0) {
+            delete conn;
+            return -1;
+        }
+        conns.push_back(conn);
+        selected = conn;
+        LogInfof(logger_, "http pool opens connection host:%s, port:%d, ssl:%s, connections:%lu",
+                host.c_str(), port, ssl_enable ? "true" : "false", alive + 1);
+    }
+    selected->Request(req);
+    return 0;
+}
+
+void HttpClientPool::Cancel(HttpClientCallbackI* cb) {
+    for (auto& item : conns_) {
+        for (HttpPoolConnection* conn : item.second) {
+            conn->Cancel(cb);
+        }
+    }
+}
+
+size_t HttpClientPool::GetConnectionCount() {
+    size_t count = 0;
+
+    for (auto& item : conns_) {
+        count += item.second.size();
+    }
+    return count;
+}
+
+void HttpClientPool::OnTimer() {
+    int64_t now_ms = now_millisec();
+
+    for (auto& item : conns_) {
+        std::list<HttpPoolConnection*>& conns = item.second;
+        for (auto iter = conns.begin(); iter != conns.end(); ) {
+            HttpPoolConnection* conn = *iter;
+            if (conn->IsBroken() || conn->IsIdleTimeout(now_ms)) {
+                LogDebugf(logger_, "http pool releases connection:%s, broken:%d",
+                        item.first.c_str(), conn->IsBroken());
+                delete conn;
+                iter = conns.erase(iter);
+                continue;
+            }
+            iter++;
+        }
+    }
+}
+
+}
@@ -0,0 +1,149 @@
+#ifndef HTTP_CLIENT_POOL_HPP
+#define HTTP_CLIENT_POOL_HPP
+#include "http_client.hpp"
+#include "tcp_client.hpp"
+#include "tcp_pub.hpp"
+#include "data_buffer.hpp"
+#include "logger.hpp"
+#include <uv.h>
+#include <string>
+#include <memory>
+#include <map>
+#include <list>
+#include <deque>
+#include <vector>
+#include <mutex>
+#include <stdint.h>
+#include <stddef.h>
+
+namespace cpp_streamer
+{
+#define HTTP_POOL_MAX_CONNS     8           //connections per host:port:tls
+#define HTTP_POOL_IDLE_MS       (30*1000)   //an idle connection is closed after it
+#define HTTP_POOL_CHECK_MS      1000
+
+class HttpClientPool;
+
+typedef struct {
+    HttpClientCallbackI* cb;
+    std::string data;   //the request line, headers and body
+    int64_t start_ms;
+    int64_t connect_ms;
+    bool sent;
+    bool retried;
+} HttpPoolRequest;
+
+/*
+ * one keep-alive connection of the pool:
+ * the requests are written as soon as the connection is ready without waiting for
+ * the previous response(pipelining), the responses are matched to the requests in order.
+ * only the responses with Content-Length(or without body) are supported.
+ */
+class HttpPoolConnection : public TcpClientCallback
+{
+public:
+    HttpPoolConnection(HttpClientPool* pool, uv_loop_t* loop,
+            const std::string& host, uint16_t port, bool ssl_enable, Logger* logger);
+    virtual ~HttpPoolConnection();
+
+public:
+    int Start();
+    void Request(const HttpPoolRequest& req);
+    void Cancel(HttpClientCallbackI* cb);
+    size_t GetPendingCount() { return requests_.size(); }
+    bool IsBroken() { return broken_; }
+    bool IsIdleTimeout(int64_t now_ms) {
+        return requests_.empty() && (now_ms - idle_ms_ > HTTP_POOL_IDLE_MS);
+    }
+
+protected:
+    virtual void OnConnect(int ret_code) override;
+    virtual void OnWrite(int ret_code, size_t sent_size) override;
+    virtual void OnRead(int ret_code, const char* data, size_t data_size) override;
+
+private:
+    void SendRequest(HttpPoolRequest& req);
+    int ParseResponse();
+    void OnBroken(int ret_code);
+
+private:
+    HttpClientPool* pool_ = nullptr;
+    TcpClient* client_    = nullptr;
+    std::string host_;
+    uint16_t port_        = 0;
+    bool ssl_enable_      = false;
+    bool connected_       = false;
+    bool broken_          = false;
+    size_t done_count_    = 0;//the responses received
+    int64_t idle_ms_      = 0;
+
+private:
+    std::deque<HttpPoolRequest> requests_;
+    DataBuffer recv_buffer_;
+    std::shared_ptr<HttpClientResponse> resp_ptr_;
+
+private:
+    Logger* logger_ = nullptr;
+};
+
+inline void OnHttpPoolTimer(uv_timer_t* handle);
+inline void OnHttpPoolClose(uv_handle_t* handle);
+
+/*
+ * keep-alive http connections of one uv loop, keyed by host:port:tls,
+ * a request takes an idle connection, or opens a new one under HTTP_POOL_MAX_CONNS,
+ * or is queued(pipelined) on the connection with the least pending requests.
+ * the tls sessions are resumed by SslClient when the pool opens more connections.
+ */
+class HttpClientPool
+{
+friend void OnHttpPoolTimer(uv_timer_t* handle);
+friend void OnHttpPoolClose(uv_handle_t* handle);
+
+public:
+    static HttpClientPool* Attach(uv_loop_t* loop, Logger* logger = nullptr);
+    static void Detach(HttpClientPool* pool);
+
+public:
+    int Request(const std::string& host, uint16_t port, bool ssl_enable,
+            const std::string& data, HttpClientCallbackI* cb);
+    //the callback is never called after Cancel
+    void Cancel(HttpClientCallbackI* cb);
+    //the unwritten or idempotent requests failed on a reused connection closed by the server are sent again once
+    void Retry(const std::string& host, uint16_t port, bool ssl_enable, std::vector<HttpPoolRequest>& reqs);
+    size_t GetConnectionCount();
+
+private:
+    HttpClientPool(uv_loop_t* loop, Logger* logger);
+    ~HttpClientPool();
+
+    static std::mutex& GetMutex();
+    static std::map<uv_loop_t*, HttpClientPool*>& GetPools();
+
+    std::string GetKey(const std::string& host, uint16_t port, bool ssl_enable);
+    int Dispatch(const std::string& host, uint16_t port, bool ssl_enable, const HttpPoolRequest& req);
+    void OnTimer();
+
+private:
+    uv_loop_t* loop_ = nullptr;
+    uv_timer_t timer_;
+    int ref_count_   = 0;
+    std::map<std::string, std::list<HttpPoolConnection*>> conns_;
+
+private:
+    Logger* logger_ = nullptr;
+};
+
+inline void OnHttpPoolTimer(uv_timer_t* handle) {
+    HttpClientPool* pool = (HttpClientPool*)handle->data;
+    pool->OnTimer();
+}
+
+inline void OnHttpPoolClose(uv_handle_t* handle) {
+    HttpClientPool* pool = (HttpClientPool*)handle->data;
+    delete pool;
+}
+
+}
+
+#endif
@@ -7,6 +7,11 @@
 #include <stdint.h>
 #include <sstream>
 #include <map>
+#include <vector>
+#include <memory>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
 
 namespace cpp_streamer
 {
@@ -31,6 +36,10 @@ public:
         return session_->RemoteEndpoint();
     }
 
+    std::string local_address() const {
+        return session_->LocalEndpoint();
+    }
+
 public:
     std::string method_;
     std::string uri_;
@@ -61,28 +70,11 @@ public:
     std::map<std::string, std::string> Headers() { return headers_; }
 
     int Write(const char* data, size_t len, bool continue_flag = false) {
-        std::stringstream ss;
-
         continue_flag_ = continue_flag;
         if (is_close_ || session_ == nullptr) {
             return -1;
         }
-
-        if (!written_header_) {
-            ss << proto_ << "/" << version_ << " " << status_code_ << " " << status_ << "\r\n";
-            if (!continue_flag) {
-                ss << "Content-Length:" << len  << "\r\n";
-            }
-            
-            for (const auto& header : headers_) {
-                ss << header.first << ": " << header.second << "\r\n";
-            }
-            ss << "\r\n";
-            size_t len = ss.str().length();
-            remain_bytes_ += len;
-            session_->Write(ss.str().c_str(), len);
-            written_header_ = true;
-        }
+        WriteHeader(continue_flag ? -1 : (int64_t)len);
 
         if (data && len > 0) {
             remain_bytes_ += len;
@@ -92,6 +84,78 @@ public:
         return 0;
     }
 
+    //no copy, the buffer is referenced by the write queue and must not be modified after written
+    int Write(std::shared_ptr<DataBuffer> buffer_ptr, bool continue_flag = false) {
+        std::vector<std::shared_ptr<DataBuffer>> buffers;
+
+        buffers.push_back(buffer_ptr);
+        return WriteChain(buffers, continue_flag);
+    }
+
+    //the buffers are sent in order without copy, Content-Length is the sum of them
+    int WriteChain(const std::vector<std::shared_ptr<DataBuffer>>& buffers, bool continue_flag = false) {
+        int64_t len = 0;
+
+        continue_flag_ = continue_flag;
+        if (is_close_ || session_ == nullptr) {
+            return -1;
+        }
+        for (const auto& buffer_ptr : buffers) {
+            len += buffer_ptr->DataLen();
+        }
+        WriteHeader(continue_flag ? -1 : len);
+
+        if (len > 0) {
+            remain_bytes_ += len;
+            session_->Write(buffers);
+        }
+        return 0;
+    }
+
+    //the file region is the whole body(len < 0: to the end of the file), sent by sendfile.
+    //return -1 before anything is written if the file can not be opened, so a 404 can be sent
+    int SendFile(const std::string& path, int64_t offset = 0, int64_t len = -1) {
+        struct stat st;
+
+        if (is_close_ || session_ == nullptr) {
+            return -1;
+        }
+        int fd = open(path.c_str(), O_RDONLY);
+        if (fd < 0) {
+            return -1;
+        }
+        if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode) || offset < 0 || offset > (int64_t)st.st_size) {
+            close(fd);
+            return -1;
+        }
+        if (len < 0 || offset + len > (int64_t)st.st_size) {
+            len = (int64_t)st.st_size - offset;
+        }
+        continue_flag_ = false;
+        WriteHeader(len);
+
+        remain_bytes_ += len;
+        return session_->SendFile(fd, offset, (size_t)len);
+    }
+
+    //over the tcp write queue high watermark, the writer should drop or wait
+    bool IsWriteBlocked() {
+        if (is_close_ || session_ == nullptr) {
+            return false;
+        }
+        return session_->IsWriteBlocked();
+    }
+
+    size_t GetWriteQueueSize() {
+        if (is_close_ || session_ == nullptr) {
+            return 0;
+        }
+        return session_->GetWriteQueueSize();
+    }
+
+    //the connection is closed, or the response is done on a kept alive connection
+    bool IsClosed() { return is_close_ || session_ == nullptr; }
+
     void Close() {
         if (is_close_) {
             return;
@@ -106,9 +170,41 @@ public:
         session_ = nullptr;
     }
 
+    bool IsHeaderWritten() { return written_header_; }
+    //without Content-Length the connection is closed after the response
+    bool HasContentLength() { return has_content_length_; }
+
+private:
+    //content_length < 0: the body ends when the connection is closed
+    void WriteHeader(int64_t content_length) {
+        std::stringstream ss;
+
+        if (written_header_) {
+            return;
+        }
+        ss << proto_ << "/" << version_ << " " << status_code_ << " " << status_ << "\r\n";
+        if (content_length >= 0) {
+            ss << "Content-Length:" << content_length  << "\r\n";
+        } else if (headers_.find("Connection") == headers_.end()
+                && headers_.find("Transfer-Encoding") == headers_.end()) {
+            ss << "Connection: close\r\n";
+        }
+
+        for (const auto& header : headers_) {
+            ss << header.first << ": " << header.second << "\r\n";
+        }
+        ss << "\r\n";
+        std::string header_str = ss.str();
+        remain_bytes_ += header_str.length();
+        session_->Write(header_str.c_str(), header_str.length());
+        written_header_     = true;
+        has_content_length_ = content_length >= 0;
+    }
+
 private:
     bool is_close_ = false;
     bool written_header_ = false;
+    bool has_content_length_ = false;
     std::string status_  = "OK";  // e.g. "OK"
     int status_code_     = 200;     // e.g. 200
     std::string proto_   = "HTTP";   // e.g. "HTTP"
@@ -0,0 +1,132 @@
+#include "http_server.hpp"
+
+namespace cpp_streamer
+{
+HttpServer::HttpServer(uint16_t port, uv_loop_t* loop, Logger* logger):TimerInterface(loop, HTTP_SERVER_CHECK_MS, true)
+                                                                    , port_(port)
+                                                                    , loop_(loop)
+                                                                    , logger_(logger)
+{
+    server_ptr_.reset(new TcpServer(loop_, port_, this));
+    StartTimer();
+    LogInfof(logger_, "HttpServer construct, port:%d", port);
+}
+
+HttpServer::HttpServer(uint16_t port,
+                    uv_loop_t* loop,
+                    const std::string& key_file,
+                    const std::string& cert_file,
+                    Logger* logger):TimerInterface(loop, HTTP_SERVER_CHECK_MS, true)
+                                , port_(port)
+                                , loop_(loop)
+                                , logger_(logger)
+                                , key_file_(key_file)
+                                , cert_file_(cert_file)
+{
+    server_ptr_.reset(new TcpServer(loop_, port_, this));
+    StartTimer();
+    LogInfof(logger_, "HttpServer construct, port:%d, key file:%s, cert file:%s",
+            port, key_file_.c_str(), cert_file_.c_str());
+}
+
+HttpServer::HttpServer(uv_loop_t* loop,
+                    const std::string& key_file,
+                    const std::string& cert_file,
+                    Logger* logger):TimerInterface(loop, HTTP_SERVER_CHECK_MS, true)
+                                , loop_(loop)
+                                , logger_(logger)
+                                , key_file_(key_file)
+                                , cert_file_(cert_file)
+{
+    StartTimer();
+    LogInfof(logger_, "HttpServer construct without listener, key file:%s, cert file:%s",
+            key_file_.c_str(), cert_file_.c_str());
+}
+
+HttpServer::~HttpServer()
+{
+    StopTimer();
+    if (server_ptr_) {
+        server_ptr_.release()->CloseAndDelete();
+    }
+    std::vector<HttpSession*> sessions;
+    for (auto& item : sessions_) {
+        sessions.push_back(item.second);
+    }
+    for (HttpSession* session : sessions) {
+        session->Close();
+    }
+    ReleaseClosedSessions();
+    LogInfof(logger_, "HttpServer destruct, port:%d", port_);
+}
+
+void HttpServer::AddHandle(const std::string& uri, HTTP_HANDLE_PTR handle_ptr) {
+    uri_handles_[uri] = handle_ptr;
+}
+
+void HttpServer::RemoveHandle(const std::string& uri) {
+    uri_handles_.erase(uri);
+}
+
+void HttpServer::OnAccept(int ret_code, uv_loop_t* loop, uv_stream_t* handle) {
+    HttpSession* session = nullptr;
+
+    if (ret_code < 0) {
+        return;
+    }
+    try {
+        if (key_file_.empty() || cert_file_.empty()) {
+            session = new HttpSession(loop, handle, this, logger_);
+        } else {
+            session = new HttpSession(loop, handle, this, key_file_, cert_file_, logger_);
+        }
+    } catch(const std::exception& e) {
+        LogErrorf(logger_, "http server port:%d accept exception:%s", port_, e.what());
+        return;
+    }
+    sessions_[session->RemoteEndpoint()] = session;
+}
+
+void HttpServer::OnClose(const std::string& endpoint) {
+    auto iter = sessions_.find(endpoint);
+    if (iter == sessions_.end()) {
+        return;
+    }
+    //it may be in its own callback now
+    closed_sessions_.push_back(iter->second);
+    sessions_.erase(iter);
+}
+
+HTTP_HANDLE_PTR HttpServer::GetHandle(HttpRequest* request) {
+    auto iter = uri_handles_.find(request->uri_);
+    if (iter == uri_handles_.end()) {
+        return nullptr;
+    }
+    return iter->second;
+}
+
+void HttpServer::OnTimer() {
+    std::vector<HttpSession*> idle_sessions;
+
+    for (auto& item : sessions_) {
+        if (!item.second->IsAlive()) {
+            idle_sessions.push_back(item.second);
+        }
+    }
+    for (HttpSession* session : idle_sessions) {
+        LogInfof(logger_, "http session:%s is idle, close it", session->RemoteEndpoint().c_str());
+        session->Close();
+    }
+    ReleaseClosedSessions();
+}
+
+void HttpServer::ReleaseClosedSessions() {
+    std::vector<HttpSession*> sessions;
+
+    sessions.swap(closed_sessions_);
+    for (HttpSession* session : sessions) {
+        delete session;
+    }
+}
+
+}
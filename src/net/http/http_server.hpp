@@ -0,0 +1,68 @@
+#ifndef HTTP_SERVER_HPP
+#define HTTP_SERVER_HPP
+#include "tcp_server.hpp"
+#include "http_common.hpp"
+#include "http_session.hpp"
+#include "logger.hpp"
+#include "timer.hpp"
+
+#include <memory>
+#include <string>
+#include <vector>
+#include <map>
+#include <stdint.h>
+#include <uv.h>
+
+namespace cpp_streamer
+{
+#define HTTP_SERVER_CHECK_MS (5*1000)//the idle sessions are closed after 4 checks
+
+/*
+ * http/1.x server: the handles are matched by the exact uri(without the params),
+ * the sessions closed are released in the timer, not in their own callbacks.
+ */
+class HttpServer : public TimerInterface, public TcpServerCallbackI, public HttpCallbackI
+{
+public:
+    HttpServer(uint16_t port, uv_loop_t* loop, Logger* logger);
+    HttpServer(uint16_t port, uv_loop_t* loop, const std::string& key_file, const std::string& cert_file, Logger* logger);
+    //no listener: the connections are accepted by a TcpShardServer shard on the loop,
+    //https is enabled when the key and cert files are given
+    HttpServer(uv_loop_t* loop, const std::string& key_file, const std::string& cert_file, Logger* logger);
+    virtual ~HttpServer();
+
+public:
+    void AddHandle(const std::string& uri, HTTP_HANDLE_PTR handle_ptr);
+    void RemoveHandle(const std::string& uri);
+    size_t GetSessionCount() { return sessions_.size(); }
+    uint16_t GetPort() { return port_; }
+
+protected://TcpServerCallbackI
+    virtual void OnAccept(int ret_code, uv_loop_t* loop, uv_stream_t* handle) override;
+
+protected://HttpCallbackI
+    virtual void OnClose(const std::string& endpoint) override;
+    virtual HTTP_HANDLE_PTR GetHandle(HttpRequest* request) override;
+
+protected://TimerInterface
+    virtual void OnTimer() override;
+
+private:
+    void ReleaseClosedSessions();
+
+private:
+    uint16_t port_      = 0;
+    uv_loop_t* loop_    = nullptr;
+    Logger* logger_     = nullptr;
+    std::string key_file_;
+    std::string cert_file_;
+    std::unique_ptr<TcpServer> server_ptr_ = nullptr;
+
+private:
+    std::map<std::string, HTTP_HANDLE_PTR> uri_handles_;
+    std::map<std::string, HttpSession*> sessions_;
+    std::vector<HttpSession*> closed_sessions_;
+};
+
+}
+#endif
@@ -2,6 +2,7 @@
 #include "http_common.hpp"
 #include "stringex.hpp"
 #include <map>
+#include <strings.h>
 
 namespace cpp_streamer
 {
@@ -34,8 +35,9 @@ HttpSession::HttpSession(uv_loop_t* loop, uv_stream_t* handle, HttpCallbackI* ca
                                                                                                           , logger_(logger)
 {
     request_ = new HttpRequest(this);
-    session_ptr_ = std::make_shared<TcpSession>(loop, handle, this);
+    session_ptr_ = std::make_shared<TcpSession>(loop, handle, this, logger_);
     remote_address_ = session_ptr_->GetRemoteEndpoint();
+    local_address_  = session_ptr_->GetLocalEndpoint();
 
     TryRead();
 }
@@ -45,8 +47,9 @@ HttpSession::HttpSession(uv_loop_t* loop, uv_stream_t* handle, HttpCallbackI* ca
                                                                                              , logger_(logger)
 {
     request_ = new HttpRequest(this);
-    session_ptr_ = std::make_shared<TcpSession>(loop, handle, this, key_file, cert_file);
+    session_ptr_ = std::make_shared<TcpSession>(loop, handle, this, key_file, cert_file, logger_);
     remote_address_ = session_ptr_->GetRemoteEndpoint();
+    local_address_  = session_ptr_->GetLocalEndpoint();
 
     TryRead();
 }
@@ -63,6 +66,18 @@ void HttpSession::Write(const char* data, size_t len) {
     session_ptr_->AsyncWrite(data, len);
 }
 
+void HttpSession::Write(std::shared_ptr<DataBuffer> buffer_ptr) {
+    session_ptr_->AsyncWrite(buffer_ptr);
+}
+
+void HttpSession::Write(const std::vector<std::shared_ptr<DataBuffer>>& buffers) {
+    session_ptr_->AsyncWrite(buffers);
+}
+
+int HttpSession::SendFile(int file_fd, int64_t offset, size_t len) {
+    return session_ptr_->SendFile(file_fd, offset, len);
+}
+
 void HttpSession::Close() {
     if (is_closed_) {
         return;
@@ -85,6 +100,7 @@ void HttpSession::OnWrite(int ret_code, size_t sent_size) {
     if (ret_code != 0) {
         LogWarnf(logger_, "http session write callback return code:%d", ret_code);
         Close();
+        return;
     }
     KeepAlive();
     if (!response_ptr_) {
@@ -93,44 +109,95 @@ void HttpSession::OnWrite(int ret_code, size_t sent_size) {
 
     response_ptr_->remain_bytes_ -= sent_size;
     continue_flag_ = response_ptr_->continue_flag_;
-    if (!continue_flag_) {
-        if (!response_ptr_) {
-            return;
-        }    
-        if (response_ptr_->remain_bytes_ <= 0) {
-            Close();
-        }
+
+    if (FinishResponse()) {
+        //the pipelined requests
+        HandleRequests();
     }
-    
     return;
 }
 
-int HttpSession::HandleRequest(const char* data, size_t data_size, bool& continue_flag) {
+void HttpSession::OnRead(int ret_code, const char* data, size_t data_size) {
+    if (ret_code != 0) {
+        Close();
+        return;
+    }
     KeepAlive();
 
-    continue_flag = true;
-    if (!header_is_ready_) {
-        header_data_.AppendData(data, data_size);
-        int ret = AnalyzeHeader();
-        if (ret != 0) {
-            return -1;
+    recv_buffer_.AppendData(data, data_size);
+    if (busy_ && recv_buffer_.DataLen() > HTTP_PIPELINE_MAX_BYTES) {
+        LogWarnf(logger_, "http session %s pipelines too many requests, bytes:%lu",
+                remote_address_.c_str(), recv_buffer_.DataLen());
+        Close();
+        return;
+    }
+    HandleRequests();
+    return;
+}
+
+void HttpSession::HandleRequests() {
+    while (!is_closed_ && !busy_) {
+        int ret = ParseRequest();
+        if (ret < 0) {
+            Close();
+            return;
         }
+        if (ret == 0) {
+            return;
+        }
+        HandleRequest();
+        if (is_closed_ || !FinishResponse()) {
+            return;
+        }
+    }
+}
 
-        if (!header_is_ready_) {
+//return 1 when the header and the body of request_ are received
+int HttpSession::ParseRequest() {
+    if (!header_is_ready_) {
+        std::string info(recv_buffer_.Data(), recv_buffer_.DataLen());
+        size_t pos = info.find("\r\n\r\n");
+        if (pos == info.npos) {
+            if (info.length() > HTTP_PIPELINE_MAX_BYTES) {
+                LogErrorf(logger_, "http session %s header is too large", remote_address_.c_str());
+                return -1;
+            }
             return 0;
         }
+        if (AnalyzeHeader(info.substr(0, pos)) < 0) {
+            return -1;
+        }
+        header_is_ready_ = true;
+        recv_buffer_.ConsumeData((int)pos + 4);
+    }
 
-        char* start = header_data_.Data() + content_start_;
-        int len     = header_data_.DataLen() - content_start_;
-        content_data_.AppendData(start, len);
-    } else {
-        content_data_.AppendData(data, data_size);
+    if (request_->content_length_ < 0) {
+        return -1;
+    }
+    if ((int)recv_buffer_.DataLen() < request_->content_length_) {
+        return 0;
+    }
+    if (request_->content_length_ > 0) {
+        content_data_.AppendData(recv_buffer_.Data(), request_->content_length_);
+        recv_buffer_.ConsumeData(request_->content_length_);
+        request_->content_body_ = content_data_.Data();
+    }
+    return 1;
+}
+
+void HttpSession::HandleRequest() {
+    busy_       = true;
+    keep_alive_ = IsKeepAlive();
+    request_count_++;
+
+    response_ptr_ = std::make_shared<HttpResponse>(this);
+    if (!keep_alive_) {
+        response_ptr_->AddHeader("Connection", "close");
+    } else if (request_->version_ != "1.1") {
+        response_ptr_->AddHeader("Connection", "keep-alive");
     }
 
     if (request_->method_ == "OPTIONS") {
-        if (!response_ptr_) {
-            response_ptr_ = std::make_shared<HttpResponse>(this);
-        }
         /*
         HTTP/1.1 200
         Date: Fri, 22 Apr 2022 11:29:50 GMT
@@ -151,83 +218,80 @@ int HttpSession::HandleRequest(const char* data, size_t data_size, bool& continu
         response_ptr_->AddHeader("Access-Control-Allow-Private-Network", "true");
         response_ptr_->AddHeader("Allow", "GET, HEAD, POST, PUT, DELETE, TRACE, OPTIONS, PATCH");
         response_ptr_->Write(nullptr, 0);
-        header_is_ready_ = false;
-        continue_flag = true;
-        header_data_.Reset();
-        return 0;
+        return;
     }
 
-    if (request_->method_ == "GET") {
-        HTTP_HANDLE_PTR handle_ptr = callback_->GetHandle(request_);
-        if (!handle_ptr) {
-            return -1;
-        }
-        //call handle
-        response_ptr_ = std::make_shared<HttpResponse>(this);
-        try {
-            handle_ptr(request_, response_ptr_);
-        } catch(const std::exception& e) {
-            std::cout << "http get exception:" << e.what() << "\r\n";
-        }
-        continue_flag = response_ptr_->continue_flag_;
-        return 0;
+    HTTP_HANDLE_PTR handle_ptr = callback_->GetHandle(request_);
+    if (!handle_ptr) {
+        LogWarnf(logger_, "http session %s has no handle for %s %s",
+                remote_address_.c_str(), request_->method_.c_str(), request_->uri_.c_str());
+        response_ptr_->SetStatusCode(404);
+        response_ptr_->SetStatus("Not Found");
+        response_ptr_->Write(nullptr, 0);
+        return;
     }
-
-    if ((int)content_data_.DataLen() >= request_->content_length_) {
-        HTTP_HANDLE_PTR handle_ptr = callback_->GetHandle(request_);
-        if (!handle_ptr) {
-            return -1;
-        }
-        //call handle
-        if (!response_ptr_) {
-            response_ptr_ = std::make_shared<HttpResponse>(this);
-        }
-        request_->content_body_ = content_data_.Data();
-        try {
-            handle_ptr(request_, response_ptr_);
-        } catch(const std::exception& e) {
-            std::cout << "http post exception:" << e.what() << "\r\n";
-        }
-        continue_flag = response_ptr_->continue_flag_;
-
-        if (!continue_flag) {
-            UpdateMax(0);
-        }
-        return 0;
+    //call handle
+    try {
+        handle_ptr(request_, response_ptr_);
+    } catch(const std::exception& e) {
+        LogErrorf(logger_, "http %s %s exception:%s",
+                request_->method_.c_str(), request_->uri_.c_str(), e.what());
     }
+    continue_flag_ = response_ptr_->continue_flag_;
 
-    return 0;
+    if (!continue_flag_ && !keep_alive_) {
+        UpdateMax(0);
+    }
 }
 
-void HttpSession::OnRead(int ret_code, const char* data, size_t data_size) {
-    if (ret_code != 0) {
-        Close();
-        return;
+//the response is sent completely: close the connection or get ready for the next request
+bool HttpSession::FinishResponse() {
+    if (!busy_ || !response_ptr_) {
+        return false;
     }
-
-    int ret = HandleRequest(data, data_size, continue_flag_);
-    if (ret < 0) {
-        Close();
-        return;
+    if (!response_ptr_->IsHeaderWritten() || response_ptr_->continue_flag_) {
+        return false;
     }
-    if (continue_flag_) {
-        TryRead();
+    if (session_ptr_->GetWriteQueueSize() > 0) {
+        return false;
     }
-    return;
+    if (!keep_alive_ || !response_ptr_->HasContentLength()) {
+        Close();
+        return false;
+    }
+    //the writes after the response is done are dropped
+    response_ptr_->SetClose(true);
+    response_ptr_ = nullptr;
+
+    delete request_;
+    request_ = new HttpRequest(this);
+    content_data_.Reset();
+    header_is_ready_ = false;
+    continue_flag_   = false;
+    busy_            = false;
+    return true;
 }
 
-int HttpSession::AnalyzeHeader() {
-    std::string info(header_data_.Data(), header_data_.DataLen());
-    size_t pos = info.find("\r\n\r\n");
-    if (pos == info.npos) {
-        header_is_ready_ = false;
-        return 0;
+bool HttpSession::IsKeepAlive() {
+    std::string connection;
+
+    for (const auto& header : request_->headers_) {
+        if (strcasecmp(header.first.c_str(), "Connection") == 0) {
+            connection = header.second;
+        }
+    }
+    if (strcasecmp(connection.c_str(), "close") == 0) {
+        return false;
     }
+    if (request_->version_ == "1.1") {
+        return true;
+    }
+    return strcasecmp(connection.c_str(), "keep-alive") == 0;
+}
 
-    content_start_ = (int)pos + 4;
-    header_is_ready_ = true;
-    std::string header_str(header_data_.Data(), pos);
+int HttpSession::AnalyzeHeader(const std::string& header_str) {
     std::vector<std::string> header_vec;
+    size_t pos = 0;
 
     StringSplit(header_str, "\r\n", header_vec);
     if (header_vec.empty()) {
@@ -266,7 +330,7 @@ int HttpSession::AnalyzeHeader() {
         }
         std::string key = info_line.substr(0, pos);
         std::string value = info_line.substr(pos+2);
-        if (key == "Content-Length") {
+        if (strcasecmp(key.c_str(), "Content-Length") == 0) {
             request_->content_length_ = atoi(value.c_str());
         }
         request_->headers_.insert(std::make_pair(key, value));
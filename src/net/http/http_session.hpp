@@ -16,10 +16,19 @@
 
 namespace cpp_streamer
 {
+#define HTTP_PIPELINE_MAX_BYTES (64*1024) //the requests received while a response is being sent
+
 class HttpCallbackI;
 class HttpRequest;
 class HttpResponse;
 
+/*
+ * http/1.x server session:
+ * the connection is kept alive for http/1.1(without "Connection: close") and for
+ * http/1.0 with "Connection: keep-alive". the pipelined requests are buffered and
+ * handled one by one, the next one starts when the response before is sent completely.
+ * a response without Content-Length(continue_flag) ends the connection.
+ */
 class HttpSession : public TcpSessionCallbackI, public SessionAliver
 {
 friend class HttpResponse;
@@ -33,33 +42,46 @@ public:
 public:
     void TryRead();
     void Write(const char* data, size_t len);
+    void Write(std::shared_ptr<DataBuffer> buffer_ptr);
+    void Write(const std::vector<std::shared_ptr<DataBuffer>>& buffers);
+    int SendFile(int file_fd, int64_t offset, size_t len);
+    bool IsWriteBlocked() { return session_ptr_->IsWriteBlocked(); }
+    size_t GetWriteQueueSize() { return session_ptr_->GetWriteQueueSize(); }
     void Close();
     bool IsContinue() { return continue_flag_; }
     std::string RemoteEndpoint() { return remote_address_; }
+    std::string LocalEndpoint() { return local_address_; }
 
 protected://TcpSessionCallbackI
     virtual void OnWrite(int ret_code, size_t sent_size) override;
     virtual void OnRead(int ret_code, const char* data, size_t data_size) override;
 
 private:
-    int HandleRequest(const char* data, size_t data_size, bool& continue_flag);
-    int AnalyzeHeader();
+    void HandleRequests();
+    int ParseRequest();
+    void HandleRequest();
+    bool FinishResponse();
+    bool IsKeepAlive();
+    int AnalyzeHeader(const std::string& header_str);
 
 private:
     HttpCallbackI* callback_;
     Logger* logger_ = nullptr;
     std::shared_ptr<TcpBaseSession> session_ptr_;
     std::shared_ptr<HttpResponse> response_ptr_;
-    DataBuffer header_data_;
+    DataBuffer recv_buffer_;
     DataBuffer content_data_;
     HttpRequest* request_;
-    int content_start_ = -1;
 
 private:
     bool header_is_ready_ = false;
     bool is_closed_ = false;
     bool continue_flag_ = false;
+    bool busy_ = false;//the response of request_ is not sent completely
+    bool keep_alive_ = false;
+    int64_t request_count_ = 0;
     std::string remote_address_;
+    std::string local_address_;
 };
 
 }
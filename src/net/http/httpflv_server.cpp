@@ -0,0 +1,621 @@
+#include "httpflv_server.hpp"
+#include "flv_pub.hpp"
+#include "uuid.hpp"
+#include "timeex.hpp"
+#include "stringex.hpp"
+
+#include <sstream>
+#include <stdio.h>
+
+void* make_httpflv_streamer() {
+    cpp_streamer::HttpFlvServer* server = new cpp_streamer::HttpFlvServer();
+
+    return server;
+}
+
+void destroy_httpflv_streamer(void* streamer) {
+    cpp_streamer::HttpFlvServer* server = (cpp_streamer::HttpFlvServer*)streamer;
+
+    delete server;
+}
+
+namespace cpp_streamer
+{
+#define HTTPFLV_NAME        "httpflv"
+#define FLV_FILE_HEADER_LEN 13  //flv header and the first previous tag size
+#define FLV_TAG_MIN_LEN     15  //tag header and the previous tag size
+
+//the streams on one port share the http server
+typedef struct {
+    HttpServer* server;
+    uv_loop_t* loop;
+    std::map<std::string, HttpFlvServer*> streams;
+    std::map<std::string, MetricsRegistry*> metrics;
+} HttpFlvListener;
+
+static std::mutex s_listener_mutex;
+static std::map<uint16_t, HttpFlvListener> s_listeners;
+
+static std::shared_ptr<DataBuffer> MakeHttpChunk(const uint8_t* data, size_t len) {
+    char chunk_header[32];
+    int header_len = snprintf(chunk_header, sizeof(chunk_header), "%lx\r\n", (unsigned long)len);
+    std::shared_ptr<DataBuffer> chunk_ptr = std::make_shared<DataBuffer>(header_len + len + 2);
+
+    chunk_ptr->AppendData(chunk_header, header_len);
+    chunk_ptr->AppendData((char*)data, len);
+    chunk_ptr->AppendData("\r\n", 2);
+    return chunk_ptr;
+}
+
+static void ResetTag(HttpFlvTag& tag) {
+    tag.raw_ptr   = nullptr;
+    tag.chunk_ptr = nullptr;
+    tag.type      = 0;
+    tag.is_seq    = false;
+    tag.is_key    = false;
+}
+
+std::map<std::string, std::string> HttpFlvServer::def_options_ = {
+    {"key_file", ""},
+    {"cert_file", ""},
+    {"gop_cache", "true"},
+    {"slow_timeout_ms", "10000"},
+    {"metrics_path", ""}
+};
+
+HttpFlvServer::HttpFlvServer()
+{
+    name_ = HTTPFLV_NAME;
+    name_ += "_";
+    name_ += UUID::MakeUUID();
+    options_ = def_options_;
+
+    ResetTag(flv_header_);
+    ResetTag(metadata_);
+    ResetTag(video_seq_);
+    ResetTag(audio_seq_);
+
+    //the default header before the muxer output arrives: audio and video
+    const uint8_t header_data[FLV_FILE_HEADER_LEN] = {0x46, 0x4c, 0x56, 0x01, 0x05, 0x00, 0x00, 0x00, 0x09, 0, 0, 0, 0};
+    flv_header_.raw_ptr = std::make_shared<DataBuffer>(sizeof(header_data));
+    flv_header_.raw_ptr->AppendData((char*)header_data, sizeof(header_data));
+    flv_header_.chunk_ptr = MakeHttpChunk(header_data, sizeof(header_data));
+}
+
+HttpFlvServer::~HttpFlvServer()
+{
+    Unregister();
+    if (timer_) {
+        uv_timer_stop(timer_);
+        timer_->data = nullptr;
+        uv_close(reinterpret_cast<uv_handle_t*>(timer_), OnHttpFlvHandleClose);
+        timer_ = nullptr;
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (async_) {
+        async_->data = nullptr;
+        uv_close(reinterpret_cast<uv_handle_t*>(async_), OnHttpFlvHandleClose);
+        async_ = nullptr;
+    }
+}
+
+std::string HttpFlvServer::StreamerName() {
+    return name_;
+}
+
+void HttpFlvServer::SetLogger(Logger* logger) {
+    logger_ = logger;
+}
+
+int HttpFlvServer::AddSinker(CppStreamerInterface* sinker) {
+    if (!sinker) {
+        return sinkers_.size();
+    }
+    sinkers_[sinker->StreamerName()] = sinker;
+    return sinkers_.size();
+}
+
+int HttpFlvServer::RemoveSinker(const std::string& name) {
+    return sinkers_.erase(name);
+}
+
+void HttpFlvServer::SetReporter(StreamerReport* reporter) {
+    report_ = reporter;
+}
+
+void HttpFlvServer::Report(const std::string& type, const std::string& value) {
+    if (report_) {
+        report_->OnReport(name_, type, value);
+    }
+}
+
+//the flv tags of FlvMuxer, the buffers are not copied and must not be modified after
+int HttpFlvServer::SourceData(Media_Packet_Ptr pkt_ptr) {
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    if (!pkt_ptr || pkt_ptr->fmt_type_ != MEDIA_FORMAT_FLV) {
+        return -1;
+    }
+    packet_queue_.push(pkt_ptr);
+    metrics_.OnPacket(pkt_ptr->buffer_ptr_->DataLen());
+    metrics_.SetQueueDepth(packet_queue_.size());
+    metrics_.OnIngress(pkt_ptr->ingress_us_);
+    if (async_) {
+        uv_async_send(async_);
+    }
+    return (int)packet_queue_.size();
+}
+
+void HttpFlvServer::StartNetwork(const std::string& url, void* loop_handle) {
+    if (!loop_handle) {
+        CSM_THROW_ERROR("httpflv needs the loop handle, url:%s", url.c_str());
+    }
+    if (!GetHostInfoByUrl(url, port_, path_)) {
+        CSM_THROW_ERROR("fail to get httpflv url by:%s", url.c_str());
+    }
+    loop_ = (uv_loop_t*)loop_handle;
+
+    if (Register() < 0) {
+        CSM_THROW_ERROR("fail to listen httpflv url:%s", url.c_str());
+    }
+    timer_ = (uv_timer_t*)malloc(sizeof(uv_timer_t));
+    uv_timer_init(loop_, timer_);
+    timer_->data = this;
+    uv_timer_start(timer_, OnHttpFlvTimer, HTTPFLV_CHECK_MS, HTTPFLV_CHECK_MS);
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    async_ = (uv_async_t*)malloc(sizeof(uv_async_t));
+    uv_async_init(loop_, async_, SourceHttpFlvData);
+    async_->data = this;
+    if (!packet_queue_.empty()) {
+        uv_async_send(async_);
+    }
+    LogInfof(logger_, "httpflv server starts, port:%d, path:%s", port_, path_.c_str());
+}
+
+void HttpFlvServer::AddOption(const std::string& key, const std::string& value) {
+    auto iter = options_.find(key);
+    if (iter == options_.end()) {
+        std::stringstream ss;
+        ss << "the option key:" << key << " does not exist";
+        throw CppStreamException(ss.str().c_str());
+    }
+    options_[key] = value;
+    LogInfof(logger_, "set httpflv options key:%s, value:%s", key.c_str(), value.c_str());
+
+    gop_enable_ = (options_["gop_cache"] == "true");
+    slow_timeout_ms_ = atoi(options_["slow_timeout_ms"].c_str());
+    if (slow_timeout_ms_ <= 0) {
+        slow_timeout_ms_ = HTTPFLV_SLOW_TIMEOUT_MS;
+    }
+}
+
+//httpflv://0.0.0.0:8080/live/stream.flv, or http://...
+bool HttpFlvServer::GetHostInfoByUrl(const std::string& url, uint16_t& port, std::string& path) {
+    std::string flv_url(url);
+
+    size_t pos = flv_url.find("://");
+    if (pos == flv_url.npos) {
+        LogErrorf(logger_, "fail to find scheme, url:%s", url.c_str());
+        return false;
+    }
+    flv_url = flv_url.substr(pos + 3);
+
+    pos = flv_url.find("/");
+    if (pos == flv_url.npos || pos + 1 >= flv_url.length()) {
+        LogErrorf(logger_, "fail to get path, url:%s", url.c_str());
+        return false;
+    }
+    std::string host = flv_url.substr(0, pos);
+    path = flv_url.substr(pos);
+
+    pos = host.find(":");
+    if (pos == host.npos) {
+        port = 80;
+    } else {
+        port = atoi(host.substr(pos + 1).c_str());
+    }
+    return port > 0;
+}
+
+int HttpFlvServer::Register() {
+    std::lock_guard<std::mutex> lock(s_listener_mutex);
+
+    auto iter = s_listeners.find(port_);
+    if (iter == s_listeners.end()) {
+        HttpFlvListener listener;
+
+        if (options_["key_file"].empty() || options_["cert_file"].empty()) {
+            listener.server = new HttpServer(port_, loop_, logger_);
+        } else {
+            listener.server = new HttpServer(port_, loop_, options_["key_file"], options_["cert_file"], logger_);
+        }
+        listener.loop = loop_;
+        iter = s_listeners.insert(std::make_pair(port_, listener)).first;
+    } else if (iter->second.loop != loop_) {
+        LogErrorf(logger_, "httpflv port:%d is listened on another loop", port_);
+        return -1;
+    }
+    if (iter->second.streams.find(path_) != iter->second.streams.end()) {
+        LogErrorf(logger_, "httpflv port:%d path:%s exists", port_, path_.c_str());
+        return -1;
+    }
+    iter->second.streams[path_] = this;
+    iter->second.server->AddHandle(path_, HttpFlvServer::OnHttpFlvPlay);
+
+    std::string metrics_path = options_["metrics_path"];
+    if (!metrics_path.empty() && metrics_.GetRegistry()
+        && iter->second.metrics.find(metrics_path) == iter->second.metrics.end()
+        && iter->second.streams.find(metrics_path) == iter->second.streams.end()) {
+        metrics_path_ = metrics_path;
+        iter->second.metrics[metrics_path_] = metrics_.GetRegistry();
+        iter->second.server->AddHandle(metrics_path_, HttpFlvServer::OnHttpFlvMetrics);
+        LogInfof(logger_, "httpflv port:%d serves the metrics on %s", port_, metrics_path_.c_str());
+    }
+    registered_ = true;
+    return 0;
+}
+
+void HttpFlvServer::Unregister() {
+    if (!registered_) {
+        return;
+    }
+    registered_ = false;
+    CloseViewers();
+
+    std::lock_guard<std::mutex> lock(s_listener_mutex);
+    auto iter = s_listeners.find(port_);
+    if (iter == s_listeners.end()) {
+        return;
+    }
+    iter->second.streams.erase(path_);
+    iter->second.server->RemoveHandle(path_);
+    if (!metrics_path_.empty()) {
+        iter->second.metrics.erase(metrics_path_);
+        iter->second.server->RemoveHandle(metrics_path_);
+        metrics_path_.clear();
+    }
+    if (iter->second.streams.empty()) {
+        delete iter->second.server;
+        s_listeners.erase(iter);
+    }
+}
+
+//in the loop of the listener, which is the loop of the stream
+void HttpFlvServer::OnHttpFlvPlay(const HttpRequest* request, std::shared_ptr<HttpResponse> response_ptr) {
+    std::string local_address = request->local_address();
+    HttpFlvServer* server = nullptr;
+    uint16_t port = 0;
+
+    size_t pos = local_address.rfind(":");
+    if (pos != local_address.npos) {
+        port = atoi(local_address.substr(pos + 1).c_str());
+    }
+    {
+        std::lock_guard<std::mutex> lock(s_listener_mutex);
+        auto iter = s_listeners.find(port);
+        if (iter != s_listeners.end()) {
+            auto stream_iter = iter->second.streams.find(request->uri_);
+            if (stream_iter != iter->second.streams.end()) {
+                server = stream_iter->second;
+            }
+        }
+    }
+    if (!server) {
+        response_ptr->SetStatusCode(404);
+        response_ptr->SetStatus("Not Found");
+        response_ptr->Write(nullptr, 0);
+        return;
+    }
+    server->AddViewer(request, response_ptr);
+}
+
+void HttpFlvServer::OnHttpFlvMetrics(const HttpRequest* request, std::shared_ptr<HttpResponse> response_ptr) {
+    std::string local_address = request->local_address();
+    std::string body;
+    bool found = false;
+    uint16_t port = 0;
+
+    size_t pos = local_address.rfind(":");
+    if (pos != local_address.npos) {
+        port = atoi(local_address.substr(pos + 1).c_str());
+    }
+    {
+        std::lock_guard<std::mutex> lock(s_listener_mutex);
+        auto iter = s_listeners.find(port);
+        if (iter != s_listeners.end()) {
+            auto metrics_iter = iter->second.metrics.find(request->uri_);
+            if (metrics_iter != iter->second.metrics.end()) {
+                body = metrics_iter->second->DumpPrometheus();
+                found = true;
+            }
+        }
+    }
+    if (!found) {
+        response_ptr->SetStatusCode(404);
+        response_ptr->SetStatus("Not Found");
+        response_ptr->Write(nullptr, 0);
+        return;
+    }
+    response_ptr->AddHeader("Content-Type", "text/plain; version=0.0.4");
+    response_ptr->AddHeader("Cache-Control", "no-cache");
+    response_ptr->Write(body.c_str(), body.length());
+}
+
+void HttpFlvServer::AddViewer(const HttpRequest* request, std::shared_ptr<HttpResponse> response_ptr) {
+    HttpFlvViewer viewer;
+
+    viewer.response_ptr   = response_ptr;
+    viewer.remote_address = request->remote_address();
+    viewer.chunked        = (request->version_ == "1.1");
+    viewer.wait_keyframe  = true;
+    viewer.dropped        = false;
+    viewer.slow_since_ms  = -1;
+    viewer.drop_count     = 0;
+    viewer.join_ms        = now_millisec();
+
+    response_ptr->AddHeader("Content-Type", "video/x-flv");
+    response_ptr->AddHeader("Cache-Control", "no-cache");
+    response_ptr->AddHeader("Access-Control-Allow-Origin", "*");
+    if (viewer.chunked) {
+        response_ptr->AddHeader("Transfer-Encoding", "chunked");
+    }
+    std::vector<std::shared_ptr<DataBuffer>> buffers;
+
+    AppendTag(viewer, flv_header_, buffers);
+    if (metadata_.raw_ptr) {
+        AppendTag(viewer, metadata_, buffers);
+    }
+    AppendSeqHeaders(viewer, buffers);
+
+    //the cached gop starts from a key frame
+    for (const auto& tag : gop_cache_) {
+        AppendTag(viewer, tag, buffers);
+        viewer.wait_keyframe = false;
+    }
+    response_ptr->WriteChain(buffers, true);
+    viewers_.push_back(viewer);
+    join_count_++;
+
+    LogInfof(logger_, "httpflv viewer:%s joins %s, chunked:%s, gop tags:%lu, viewers:%lu",
+            viewer.remote_address.c_str(), path_.c_str(), viewer.chunked ? "true" : "false",
+            gop_cache_.size(), viewers_.size());
+}
+
+void HttpFlvServer::CloseViewers() {
+    for (auto& viewer : viewers_) {
+        if (viewer.response_ptr->IsClosed()) {
+            continue;
+        }
+        if (viewer.chunked) {
+            //the last chunk, the connection is closed when it is sent
+            viewer.response_ptr->Write("0\r\n\r\n", 5, false);
+        } else {
+            viewer.response_ptr->Close();
+        }
+    }
+    viewers_.clear();
+}
+
+void HttpFlvServer::AppendTag(HttpFlvViewer& viewer, const HttpFlvTag& tag,
+        std::vector<std::shared_ptr<DataBuffer>>& buffers) {
+    buffers.push_back(viewer.chunked ? tag.chunk_ptr : tag.raw_ptr);
+}
+
+void HttpFlvServer::AppendSeqHeaders(HttpFlvViewer& viewer, std::vector<std::shared_ptr<DataBuffer>>& buffers) {
+    if (video_seq_.raw_ptr) {
+        AppendTag(viewer, video_seq_, buffers);
+    }
+    if (audio_seq_.raw_ptr) {
+        AppendTag(viewer, audio_seq_, buffers);
+    }
+}
+
+//the packets queued after the swap wait for the next async callback,
+//so a fast source can not hold the loop
+void HttpFlvServer::HandleMediaData() {
+    std::queue<Media_Packet_Ptr> packets;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        packets.swap(packet_queue_);
+        metrics_.SetQueueDepth(0);
+    }
+    std::vector<HttpFlvTag> tags;
+
+    metrics_.BeginStage();
+    while (!packets.empty()) {
+        HandleFlvTag(packets.front(), tags);
+        metrics_.OnOutput(packets.front()->ingress_us_);
+        packets.pop();
+    }
+    if (!tags.empty()) {
+        Broadcast(tags);
+    }
+    metrics_.EndStage();
+}
+
+int HttpFlvServer::HandleFlvTag(Media_Packet_Ptr pkt_ptr, std::vector<HttpFlvTag>& tags) {
+    std::shared_ptr<DataBuffer> raw_ptr = pkt_ptr->buffer_ptr_;
+    uint8_t* p = (uint8_t*)raw_ptr->Data();
+    size_t len = raw_ptr->DataLen();
+
+    //the first output of FlvMuxer starts with the flv header
+    if (len >= FLV_FILE_HEADER_LEN && p[0] == 'F' && p[1] == 'L' && p[2] == 'V') {
+        flv_header_.raw_ptr = std::make_shared<DataBuffer>(FLV_FILE_HEADER_LEN);
+        flv_header_.raw_ptr->AppendData((char*)p, FLV_FILE_HEADER_LEN);
+        flv_header_.chunk_ptr = MakeHttpChunk(p, FLV_FILE_HEADER_LEN);
+
+        p   += FLV_FILE_HEADER_LEN;
+        len -= FLV_FILE_HEADER_LEN;
+        if (len == 0) {
+            return 0;
+        }
+        raw_ptr = std::make_shared<DataBuffer>(len);
+        raw_ptr->AppendData((char*)p, len);
+        p = (uint8_t*)raw_ptr->Data();
+    }
+    if (len < FLV_TAG_MIN_LEN) {
+        LogErrorf(logger_, "httpflv tag length:%lu error", len);
+        Report("error", "flv tag length error");
+        return -1;
+    }
+    HttpFlvTag tag;
+
+    tag.raw_ptr   = raw_ptr;
+    tag.chunk_ptr = MakeHttpChunk(p, len);
+    tag.type      = p[0] & 0x1f;
+    tag.is_seq    = false;
+    tag.is_key    = false;
+
+    if (tag.type == FLV_TAG_VIDEO) {
+        has_video_ = true;
+        if (len > 12 + 4) {
+            tag.is_key = (p[11] & 0xf0) == FLV_VIDEO_KEY_FLAG;
+            tag.is_seq = tag.is_key && (p[12] == FLV_VIDEO_AVC_SEQHDR);
+        }
+    } else if (tag.type == FLV_TAG_AUDIO) {
+        uint8_t codec = p[11] & 0xf0;
+        if (len > 12 + 4 && (codec == FLV_AUDIO_AAC_CODEC || codec == FLV_AUDIO_OPUS_CODEC)) {
+            tag.is_seq = (p[12] == 0x00);
+        }
+    } else if (tag.type != FLV_TAG_TYPE_META) {
+        LogWarnf(logger_, "httpflv does not support the tag type:%d", tag.type);
+        return -1;
+    }
+    tag_count_++;
+
+    CacheTag(tag);
+    tags.push_back(tag);
+    return 0;
+}
+
+void HttpFlvServer::CacheTag(const HttpFlvTag& tag) {
+    if (tag.type == FLV_TAG_TYPE_META) {
+        metadata_ = tag;
+        return;
+    }
+    if (tag.is_seq) {
+        if (tag.type == FLV_TAG_VIDEO) {
+            video_seq_ = tag;
+        } else {
+            audio_seq_ = tag;
+        }
+        return;
+    }
+    if (!gop_enable_) {
+        return;
+    }
+    if (tag.type == FLV_TAG_VIDEO && tag.is_key) {
+        gop_cache_.clear();
+        gop_bytes_ = 0;
+    } else if (gop_cache_.empty()) {
+        return;
+    }
+    if (gop_bytes_ + tag.raw_ptr->DataLen() > HTTPFLV_GOP_CACHE_MAX) {
+        LogWarnf(logger_, "httpflv gop cache of %s is over %d bytes, drop it", path_.c_str(), HTTPFLV_GOP_CACHE_MAX);
+        gop_cache_.clear();
+        gop_bytes_ = 0;
+        return;
+    }
+    gop_cache_.push_back(tag);
+    gop_bytes_ += tag.raw_ptr->DataLen();
+}
+
+void HttpFlvServer::Broadcast(const std::vector<HttpFlvTag>& tags) {
+    int64_t now_ms = now_millisec();
+    auto iter = viewers_.begin();
+
+    while (iter != viewers_.end()) {
+        HttpFlvViewer& viewer = *iter;
+
+        if (viewer.response_ptr->IsClosed()) {
+            LogInfof(logger_, "httpflv viewer:%s leaves %s, dropped:%ld",
+                    viewer.remote_address.c_str(), path_.c_str(), viewer.drop_count);
+            iter = viewers_.erase(iter);
+            continue;
+        }
+        if (viewer.response_ptr->IsWriteBlocked()) {
+            //slow viewer: the write queue is over the high watermark, drop till the next key frame
+            viewer.drop_count   += tags.size();
+            metrics_.OnDrop(tags.size());
+            viewer.wait_keyframe = true;
+            viewer.dropped       = true;
+            if (viewer.slow_since_ms < 0) {
+                viewer.slow_since_ms = now_ms;
+            } else if (now_ms - viewer.slow_since_ms > slow_timeout_ms_) {
+                LogInfof(logger_, "httpflv viewer:%s of %s is too slow, dropped:%ld, evict it",
+                        viewer.remote_address.c_str(), path_.c_str(), viewer.drop_count);
+                evict_count_++;
+                viewer.response_ptr->Close();
+                iter = viewers_.erase(iter);
+                continue;
+            }
+            iter++;
+            continue;
+        }
+        viewer.slow_since_ms = -1;
+
+        std::vector<std::shared_ptr<DataBuffer>> buffers;
+        for (const auto& tag : tags) {
+            if (viewer.wait_keyframe) {
+                if (tag.type == FLV_TAG_VIDEO && tag.is_key && !tag.is_seq) {
+                    viewer.wait_keyframe = false;
+                    if (viewer.dropped) {
+                        viewer.dropped = false;
+                        AppendSeqHeaders(viewer, buffers);
+                    }
+                } else if (!tag.is_seq && tag.type != FLV_TAG_TYPE_META
+                        && (tag.type == FLV_TAG_VIDEO || has_video_)) {
+                    viewer.drop_count++;
+                    metrics_.OnDrop();
+                    continue;
+                }
+            }
+            AppendTag(viewer, tag, buffers);
+        }
+        if (!buffers.empty()) {
+            viewer.response_ptr->WriteChain(buffers, true);
+        }
+        iter++;
+    }
+}
+
+void HttpFlvServer::OnTimer() {
+    int64_t now_ms = now_millisec();
+    auto iter = viewers_.begin();
+
+    while (iter != viewers_.end()) {
+        HttpFlvViewer& viewer = *iter;
+
+        if (viewer.response_ptr->IsClosed()) {
+            LogInfof(logger_, "httpflv viewer:%s leaves %s, dropped:%ld",
+                    viewer.remote_address.c_str(), path_.c_str(), viewer.drop_count);
+            iter = viewers_.erase(iter);
+            continue;
+        }
+        //no tags come to check it
+        if (viewer.slow_since_ms >= 0 && viewer.response_ptr->IsWriteBlocked()
+            && now_ms - viewer.slow_since_ms > slow_timeout_ms_) {
+            LogInfof(logger_, "httpflv viewer:%s of %s is too slow, dropped:%ld, evict it",
+                    viewer.remote_address.c_str(), path_.c_str(), viewer.drop_count);
+            evict_count_++;
+            viewer.response_ptr->Close();
+            iter = viewers_.erase(iter);
+            continue;
+        }
+        iter++;
+    }
+
+    std::stringstream ss;
+
+    ss << "{";
+    ss << "\"viewers\":" << viewers_.size() << ",";
+    ss << "\"joins\":" << join_count_ << ",";
+    ss << "\"evicts\":" << evict_count_ << ",";
+    ss << "\"tags\":" << tag_count_ << ",";
+    ss << "\"gop_bytes\":" << gop_bytes_;
+    ss << "}";
+    Report("statics", ss.str());
+}
+
+}
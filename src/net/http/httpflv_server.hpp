@@ -0,0 +1,163 @@
+#ifndef HTTPFLV_SERVER_HPP
+#define HTTPFLV_SERVER_HPP
+#include "cpp_streamer_interface.hpp"
+#include "http_server.hpp"
+#include "http_common.hpp"
+#include "data_buffer.hpp"
+#include "logger.hpp"
+
+#include <uv.h>
+#include <string>
+#include <memory>
+#include <vector>
+#include <list>
+#include <queue>
+#include <map>
+#include <mutex>
+#include <stdint.h>
+#include <stddef.h>
+#include <stdlib.h>
+
+extern "C" {
+void* make_httpflv_streamer();
+void destroy_httpflv_streamer(void* streamer);
+}
+
+namespace cpp_streamer
+{
+#define HTTPFLV_CHECK_MS          1000
+#define HTTPFLV_GOP_CACHE_MAX     (8*1024*1024)//over it the gop is not cached, the new viewers wait for the next key frame
+#define HTTPFLV_SLOW_TIMEOUT_MS   (10*1000)    //a viewer keeps dropping for so long is evicted
+
+inline void SourceHttpFlvData(uv_async_t* handle);
+inline void OnHttpFlvTimer(uv_timer_t* handle);
+inline void OnHttpFlvHandleClose(uv_handle_t* handle);
+
+//one muxed flv tag, shared by the write queues of all the viewers
+typedef struct {
+    std::shared_ptr<DataBuffer> raw_ptr;  //tag header, body and the previous tag size
+    std::shared_ptr<DataBuffer> chunk_ptr;//the same in a http chunk
+    uint8_t type;
+    bool is_seq;
+    bool is_key;
+} HttpFlvTag;
+
+typedef struct {
+    std::shared_ptr<HttpResponse> response_ptr;
+    std::string remote_address;
+    bool chunked;
+    bool wait_keyframe;   //the video starts from a key frame, after joining or dropping
+    bool dropped;         //the sequence headers are sent again when it is resumed
+    int64_t slow_since_ms;//the write queue is over the high watermark since, -1: not slow
+    int64_t drop_count;
+    int64_t join_ms;
+} HttpFlvViewer;
+
+/*
+ * http-flv live server streamer:
+ * it takes the flv tags from FlvMuxer, and sends them to the viewers of http://host:port/path,
+ * a tag is copied once into the chunked encoding and referenced by every viewer's write queue,
+ * the tags queued in one loop iteration go to a viewer by one gathered write.
+ * the new viewers get the flv header, the metadata, the sequence headers and the cached gop
+ * from the last key frame. a viewer over the write queue high watermark drops the tags till
+ * the next key frame, and is evicted when it keeps slow for slow_timeout_ms.
+ * the streamers on the same port share one HttpServer, and must run on the same loop.
+ * with the option metrics_path, the same HttpServer serves the metrics registry in the
+ * prometheus text format.
+ */
+class HttpFlvServer : public CppStreamerInterface
+{
+friend void SourceHttpFlvData(uv_async_t* handle);
+friend void OnHttpFlvTimer(uv_timer_t* handle);
+
+public:
+    HttpFlvServer();
+    virtual ~HttpFlvServer();
+
+public:
+    virtual std::string StreamerName() override;
+    virtual void SetLogger(Logger* logger) override;
+    virtual int AddSinker(CppStreamerInterface* sinker) override;
+    virtual int RemoveSinker(const std::string& name) override;
+    virtual int SourceData(Media_Packet_Ptr pkt_ptr) override;
+    //url: httpflv://0.0.0.0:8080/live/stream.flv, loop_handle is required
+    virtual void StartNetwork(const std::string& url, void* loop_handle) override;
+    virtual void AddOption(const std::string& key, const std::string& value) override;
+    virtual void SetReporter(StreamerReport* reporter) override;
+
+public:
+    static void OnHttpFlvPlay(const HttpRequest* request, std::shared_ptr<HttpResponse> response_ptr);
+    static void OnHttpFlvMetrics(const HttpRequest* request, std::shared_ptr<HttpResponse> response_ptr);
+    size_t GetViewerCount() { return viewers_.size(); }
+
+private:
+    bool GetHostInfoByUrl(const std::string& url, uint16_t& port, std::string& path);
+    int Register();
+    void Unregister();
+    void AddViewer(const HttpRequest* request, std::shared_ptr<HttpResponse> response_ptr);
+    void CloseViewers();
+    void OnTimer();
+
+    void HandleMediaData();
+    int HandleFlvTag(Media_Packet_Ptr pkt_ptr, std::vector<HttpFlvTag>& tags);
+    void CacheTag(const HttpFlvTag& tag);
+    void Broadcast(const std::vector<HttpFlvTag>& tags);
+    void AppendTag(HttpFlvViewer& viewer, const HttpFlvTag& tag, std::vector<std::shared_ptr<DataBuffer>>& buffers);
+    void AppendSeqHeaders(HttpFlvViewer& viewer, std::vector<std::shared_ptr<DataBuffer>>& buffers);
+    void Report(const std::string& type, const std::string& value);
+
+private:
+    uv_loop_t* loop_    = nullptr;
+    uv_async_t* async_  = nullptr;
+    uv_timer_t* timer_  = nullptr;
+    uint16_t port_      = 0;
+    std::string path_;
+    std::string metrics_path_;//the prometheus metrics of the registry, set by SetMetrics
+    bool registered_    = false;
+
+private:
+    std::queue<Media_Packet_Ptr> packet_queue_;
+    std::mutex mutex_;
+
+private:
+    HttpFlvTag flv_header_;
+    HttpFlvTag metadata_;
+    HttpFlvTag video_seq_;
+    HttpFlvTag audio_seq_;
+    std::vector<HttpFlvTag> gop_cache_;
+    size_t gop_bytes_  = 0;
+    bool has_video_    = false;
+    bool gop_enable_   = true;
+    int64_t slow_timeout_ms_ = HTTPFLV_SLOW_TIMEOUT_MS;
+
+private:
+    std::list<HttpFlvViewer> viewers_;
+    int64_t join_count_    = 0;
+    int64_t evict_count_   = 0;
+    int64_t tag_count_     = 0;
+
+private:
+    static std::map<std::string, std::string> def_options_;
+};
+
+inline void SourceHttpFlvData(uv_async_t* handle) {
+    HttpFlvServer* server = (HttpFlvServer*)handle->data;
+    if (server) {
+        server->HandleMediaData();
+    }
+}
+
+inline void OnHttpFlvTimer(uv_timer_t* handle) {
+    HttpFlvServer* server = (HttpFlvServer*)handle->data;
+    if (server) {
+        server->OnTimer();
+    }
+}
+
+inline void OnHttpFlvHandleClose(uv_handle_t* handle) {
+    free(handle);
+}
+
+}
+
+#endif
@@ -97,28 +97,14 @@ void WebSocketClient::SendWsFrame(const uint8_t* data, size_t len, uint8_t op_co
     masking_key[2] = ByteCrypto::GetRandomUint(1, 0xff);
     masking_key[3] = ByteCrypto::GetRandomUint(1, 0xff);
     
-    std::vector<uint8_t> data_vec(len);
-    uint8_t* p = &data_vec[0];
-    
-    memcpy(p, data, len);
-
-    size_t temp_len = len & ~3;
-    for (size_t i = 0; i < temp_len; i += 4) {
-        p[i + 0] ^= masking_key[0];
-        p[i + 1] ^= masking_key[1];
-        p[i + 2] ^= masking_key[2];
-        p[i + 3] ^= masking_key[3];
-    }
-    for (size_t i = temp_len; i < len; ++i) {
-        p[i] ^= masking_key[i % 4];
-    }
+    //mask straight into the frame buffer
     size_t total = header_len + sizeof(masking_key) + len;
     std::vector<uint8_t> data_buffer(total);
     uint8_t* buffer_p = (uint8_t*)&data_buffer[0];
 
     memcpy(buffer_p, header_start, header_len);
     memcpy(buffer_p + header_len, masking_key, sizeof(masking_key));
-    memcpy(buffer_p + header_len + sizeof(masking_key), p, len);
+    WebSocketMask(buffer_p + header_len + sizeof(masking_key), data, len, masking_key, 0);
 
     client_ptr_->GetTcpClient()->Send((char*)buffer_p, total);
 }
@@ -156,7 +142,7 @@ void WebSocketClient::OnHttpRead(int ret, std::shared_ptr<HttpClientResponse> re
     if (!http_ready_) {
         HandleHttpRespone(resp_ptr);
     } else {
-        HandleFrame(resp_ptr->data_);
+        HandleFrame((uint8_t*)resp_ptr->data_.Data(), resp_ptr->data_.DataLen());
         resp_ptr->data_.Reset();
     }
 }
@@ -232,6 +218,12 @@ void WebSocketClient::HandleWsData(uint8_t* data, size_t len, int op_code) {
     }
 }
 
+void WebSocketClient::HandleWsDataPiece(uint8_t* data, size_t len, bool last) {
+    if (conn_cb_) {
+        conn_cb_->OnReadDataPiece(0, data, len, last);
+    }
+}
+
 void WebSocketClient::HandleWsClose(uint8_t* data, size_t len) {
     if (close_) {
         return;
@@ -269,4 +261,11 @@ void WebSocketClient::HandleWsClose(uint8_t* data, size_t len) {
     client_ptr_->GetTcpClient()->Close();
 }
 
+void WebSocketClient::HandleWsFail(uint16_t code, const char* reason) {
+    close_ = true;
+    is_connected_ = false;
+    client_ptr_->GetTcpClient()->Close();
+    conn_cb_->OnClose(-1, reason);
+}
+
 }
\ No newline at end of file
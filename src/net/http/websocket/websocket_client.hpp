@@ -31,6 +31,8 @@ protected:
     virtual void HandleWsData(uint8_t* data, size_t len, int op_code) override;
     virtual void SendWsFrame(const uint8_t* data, size_t len, uint8_t op_code) override;
     virtual void HandleWsClose(uint8_t* data, size_t len) override;
+    virtual void HandleWsDataPiece(uint8_t* data, size_t len, bool last) override;
+    virtual void HandleWsFail(uint16_t code, const char* reason) override;
 
 private:
     void HandleHttpRespone(std::shared_ptr<HttpClientResponse> resp_ptr);
@@ -1,4 +1,5 @@
 #include "websocket_frame.hpp"
+#include <cstring>
 
 namespace cpp_streamer
 {
@@ -10,116 +11,97 @@ WebSocketFrame::~WebSocketFrame()
 {
 }
 
-int WebSocketFrame::Parse(const uint8_t* data, size_t len) {
-    if (data != nullptr && len > 0) {
-        buffer_.AppendData((char *)data, len);
-    }
+int WebSocketFrame::ParseHeader(const uint8_t* data, size_t len) {
+    size_t consumed = 0;
 
-    if (buffer_.DataLen() < 2) {
-        return 1;
+    if (header_ready_) {
+        return 0;
     }
 
-    if (!header_ready_) {
-        WS_PACKET_HEADER *header = (WS_PACKET_HEADER *)buffer_.Data();
-        payload_len_ = header->payload_len;
-        payload_start_ = 2;
-
-        fin_    = header->fin;
-        opcode_ = header->opcode;
-        if (header->payload_len == 126 || header->payload_len == 127) {
-            if (header->payload_len == 127) {
-                int64_t ext_len = 0;
-
-                if (buffer_.DataLen() < 10) {
-                    return 1;
-                }
-
-                uint8_t* p = (uint8_t*)(header + 1);
-                ext_len |= ((uint64_t)(*p++)) << 56;
-                ext_len |= ((uint64_t)(*p++)) << 48;
-                ext_len |= ((uint64_t)(*p++)) << 40;
-                ext_len |= ((uint64_t)(*p++)) << 32;
-                ext_len |= ((uint64_t)(*p++)) << 24;
-                ext_len |= ((uint64_t)(*p++)) << 16;
-                ext_len |= ((uint64_t)(*p++)) << 8;
-                ext_len |= *p;
-
-                payload_len_ = ext_len;
-                payload_start_ += 8;
+    //the fixed 2 bytes decide the rest of the header
+    size_t need = 2;
+    while (true) {
+        if (header_len_ < need) {
+            size_t copy_len = need - header_len_;
+            if (copy_len > len - consumed) {
+                copy_len = len - consumed;
             }
-            else {
-                if (buffer_.DataLen() < 4) {
-                    return 1;
-                }
-                uint8_t *p = (uint8_t *)(buffer_.Data() + payload_start_);
-                payload_len_ = 0;
-                payload_len_ |= ((uint16_t)*p) << 8;
-                p++;
-                payload_len_ |= *p;
-                payload_start_ += 2;
+            if (copy_len > 0) {
+                memcpy(header_ + header_len_, data + consumed, copy_len);
             }
-        }
-        mask_enable_ = header->mask;
-        if (mask_enable_) {
-            if ((int)buffer_.DataLen() < (payload_start_ + 4)) {
-                return 1;
+            header_len_ += copy_len;
+            consumed    += copy_len;
+            if (header_len_ < need) {
+                return (int)consumed;
             }
-            uint8_t *p = (uint8_t*)buffer_.Data() + payload_start_;
-            payload_start_ += 4;
-            masking_key_[0] = p[0];
-            masking_key_[1] = p[1];
-            masking_key_[2] = p[2];
-            masking_key_[3] = p[3];
         }
-        header_ready_ = true;
-    }
+        WS_PACKET_HEADER* header = (WS_PACKET_HEADER*)header_;
+        size_t full_len = 2;
 
-    if ((int)buffer_.DataLen() < (payload_start_ + payload_len_)) {
-        return 1;
+        if (header->payload_len == 126) {
+            full_len += 2;
+        } else if (header->payload_len == 127) {
+            full_len += 8;
+        }
+        if (header->mask) {
+            full_len += 4;
+        }
+        if (need == full_len) {
+            break;
+        }
+        need = full_len;
     }
 
-    if (mask_enable_) {
-        size_t frame_length = payload_len_;
-        uint8_t *p = (uint8_t *)buffer_.Data() + payload_start_;
-
-        size_t temp_len = frame_length & ~3;
-        for (size_t i = 0; i < temp_len; i += 4) {
-            p[i + 0] ^= masking_key_[0];
-            p[i + 1] ^= masking_key_[1];
-            p[i + 2] ^= masking_key_[2];
-            p[i + 3] ^= masking_key_[3];
-        }
+    WS_PACKET_HEADER* header = (WS_PACKET_HEADER*)header_;
+    uint8_t* p = header_ + 2;
+
+    fin_    = header->fin;
+    opcode_ = header->opcode;
+    payload_len_ = header->payload_len;
 
-        for (size_t i = temp_len; i < frame_length; ++i) {
-            p[i] ^= masking_key_[i % 4];
+    if (header->payload_len == 127) {
+        //the most significant bit must be 0, or the length goes negative
+        if (p[0] & 0x80) {
+            return -1;
         }
+        int64_t ext_len = 0;
+        for (int i = 0; i < 8; i++) {
+            ext_len = (ext_len << 8) | *p++;
+        }
+        payload_len_ = ext_len;
+    } else if (header->payload_len == 126) {
+        payload_len_ = ((int64_t)p[0] << 8) | p[1];
+        p += 2;
     }
 
-    return 0;
-}
+    //control frames are not fragmented and carry at most 125 bytes
+    if ((opcode_ & 0x08) && (!fin_ || payload_len_ > 125)) {
+        return -1;
+    }
 
-int WebSocketFrame::GetPayloadStart() {
-    return payload_start_;
-}
+    mask_enable_ = header->mask;
+    if (mask_enable_) {
+        memcpy(masking_key_, p, sizeof(masking_key_));
+    }
+    payload_pos_  = 0;
+    header_ready_ = true;
 
-int64_t WebSocketFrame::GetPayloadLen() {
-    return payload_len_;
+    return (int)consumed;
 }
 
-uint8_t* WebSocketFrame::GetPayloadData() {
-    return (uint8_t*)buffer_.Data() + payload_start_;
+void WebSocketFrame::ReadPayload(uint8_t* data, size_t len) {
+    if (mask_enable_) {
+        WebSocketMask(data, data, len, masking_key_, (size_t)payload_pos_);
+    }
+    payload_pos_ += len;
 }
 
-size_t WebSocketFrame::GetBufferLen() {
-    return buffer_.DataLen();
+int64_t WebSocketFrame::GetPayloadLen() {
+    return payload_len_;
 }
 
-bool WebSocketFrame::PayloadIsReady() {
-    return (int)payload_len_ <= (int)buffer_.DataLen() - payload_start_;
-}
-    
-uint8_t* WebSocketFrame::Consume(size_t len) {
-    return (uint8_t*)buffer_.ConsumeData(len);
+int64_t WebSocketFrame::GetPayloadLeft() {
+    return payload_len_ - payload_pos_;
 }
 
 uint8_t WebSocketFrame::GetOperCode() {
@@ -130,13 +112,22 @@ bool WebSocketFrame::GetFin() {
     return fin_;
 }
 
+bool WebSocketFrame::IsControl() {
+    return (opcode_ & 0x08) != 0;
+}
+
 bool WebSocketFrame::IsHeaderReady() {
     return header_ready_;
 }
 
+bool WebSocketFrame::IsPayloadReady() {
+    return header_ready_ && (payload_pos_ >= payload_len_);
+}
+
 void WebSocketFrame::Reset() {
-    payload_start_ = 0;
-    payload_len_   = 0;
-    header_ready_  = false;
+    header_len_   = 0;
+    payload_len_  = 0;
+    payload_pos_  = 0;
+    header_ready_ = false;
+}
 }
-}
\ No newline at end of file
@@ -1,11 +1,16 @@
 #ifndef WEBSOCKET_FRAME_HPP
 #define WEBSOCKET_FRAME_HPP
 #include "websocket_pub.hpp"
-#include "utils/data_buffer.hpp"
 #include <stdint.h>
+#include <stddef.h>
 
 namespace cpp_streamer
 {
+/*
+ * streaming frame parser: only the header(at most 14 bytes) is copied,
+ * the payload is unmasked in place in the caller's read buffer and may
+ * arrive over several reads.
+ */
 class WebSocketFrame
 {
 public:
@@ -13,22 +18,24 @@ public:
     ~WebSocketFrame();
 
 public:
-    int Parse(const uint8_t* data, size_t len);
-    int GetPayloadStart();
+    //return the bytes consumed from data, the header may span several reads
+    int ParseHeader(const uint8_t* data, size_t len);
+    //unmask the next len bytes of the payload in place
+    void ReadPayload(uint8_t* data, size_t len);
     int64_t GetPayloadLen();
-    uint8_t* GetPayloadData();
-    size_t GetBufferLen();
-    bool PayloadIsReady();
-    uint8_t* Consume(size_t len);
+    int64_t GetPayloadLeft();
     uint8_t GetOperCode();
     bool GetFin();
+    bool IsControl();
     bool IsHeaderReady();
+    bool IsPayloadReady();
     void Reset();
 
 private:
-    DataBuffer buffer_;
-    int payload_start_   = 0;
+    uint8_t header_[WS_MAX_HEADER_LEN + 4];
+    size_t header_len_   = 0;
     int64_t payload_len_ = 0;
+    int64_t payload_pos_ = 0;
     uint8_t opcode_      = 0;
     bool mask_enable_    = false;
     bool fin_            = false;
@@ -37,4 +44,4 @@ private:
 };
 }
 
-#endif
\ No newline at end of file
+#endif
@@ -2,7 +2,13 @@
 #include "utils/base64.hpp"
 #include <stdint.h>
 #include <string>
+#include <cstring>
 #include <openssl/sha.h>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
 
 namespace cpp_streamer
 {
@@ -19,4 +25,39 @@ std::string  GenWebSocketHashcode(const std::string& key) {
 	return Base64Encode(hash, sizeof(hash));
 }
 
-}
\ No newline at end of file
+void WebSocketMask(uint8_t* dst, const uint8_t* src, size_t len, const uint8_t* masking_key, size_t offset) {
+    uint8_t key[4];
+    uint32_t key32 = 0;
+    size_t i = 0;
+
+    //rotate the key to the payload position, the vector loops keep i aligned to 4
+    for (int k = 0; k < 4; k++) {
+        key[k] = masking_key[(offset + k) & 3];
+    }
+    memcpy(&key32, key, sizeof(key32));
+
+#if defined(__SSE2__)
+    __m128i mask128 = _mm_set1_epi32((int)key32);
+    for (; i + 16 <= len; i += 16) {
+        __m128i value = _mm_loadu_si128((const __m128i*)(src + i));
+        _mm_storeu_si128((__m128i*)(dst + i), _mm_xor_si128(value, mask128));
+    }
+#elif defined(__ARM_NEON)
+    uint8x16_t mask128 = vreinterpretq_u8_u32(vdupq_n_u32(key32));
+    for (; i + 16 <= len; i += 16) {
+        vst1q_u8(dst + i, veorq_u8(vld1q_u8(src + i), mask128));
+    }
+#endif
+    uint64_t key64 = ((uint64_t)key32 << 32) | key32;
+    for (; i + 8 <= len; i += 8) {
+        uint64_t value;
+        memcpy(&value, src + i, sizeof(value));
+        value ^= key64;
+        memcpy(dst + i, &value, sizeof(value));
+    }
+    for (; i < len; i++) {
+        dst[i] = src[i] ^ key[i & 3];
+    }
+}
+
+}
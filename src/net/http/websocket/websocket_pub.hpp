@@ -1,12 +1,23 @@
 #ifndef WEBSOCKET_PUB_HPP
 #define WEBSOCKET_PUB_HPP
 #include <stdint.h>
+#include <stddef.h>
 #include <string>
 
 namespace cpp_streamer
 {
 #define WS_MAX_HEADER_LEN 10
 
+//binary frames larger than it are delivered in pieces when the stream is enabled
+#define WS_STREAM_THRESHOLD (64*1024)
+
+//frames or buffered messages larger than them close the connection with 1009
+#define WS_MAX_FRAME_LEN   (64*1024*1024)
+#define WS_MAX_MESSAGE_LEN (16*1024*1024)
+
+#define WS_CLOSE_PROTOCOL_ERROR 1002
+#define WS_CLOSE_TOO_BIG        1009
+
 #define WS_OP_CONTINUE_TYPE        0x00
 #define WS_OP_TEXT_TYPE            0x01
 #define WS_OP_BIN_TYPE             0x02
@@ -30,11 +41,16 @@ typedef struct S_WS_PACKET_HEADER
 
 std::string  GenWebSocketHashcode(const std::string& key);
 
+//xor src with the masking key into dst(may be src), offset is the position of src in the payload
+void WebSocketMask(uint8_t* dst, const uint8_t* src, size_t len, const uint8_t* masking_key, size_t offset);
+
 class WebSocketSessionCallBackI
 {
 public:
     virtual void OnReadData(int code, const uint8_t* data, size_t len) = 0;
     virtual void OnReadText(int code, const std::string& text) = 0;
+    //the pieces of a large binary message, only when the session stream is enabled
+    virtual void OnReadDataPiece(int code, const uint8_t* data, size_t len, bool last) {}
 };
 
 class WebSocketConnectionCallBackI : public WebSocketSessionCallBackI
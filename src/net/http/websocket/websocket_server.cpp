@@ -1,9 +1,10 @@
 #include "websocket_server.hpp"
 #include "websocket_session.hpp"
+#include "utils/timeex.hpp"
 
 namespace cpp_streamer
 {
-WebSocketServer::WebSocketServer(uint16_t port, uv_loop_t* loop, Logger* logger):TimerInterface(loop, 5*1000)
+WebSocketServer::WebSocketServer(uint16_t port, uv_loop_t* loop, Logger* logger):TimerInterface(loop, 5*1000, true)
                                                                             , port_(port)
                                                                             , loop_(loop)
                                                                             , logger_(logger)
@@ -17,7 +18,7 @@ WebSocketServer::WebSocketServer(uint16_t port,
                             uv_loop_t* loop, 
                             const std::string& key_file, 
                             const std::string& cert_file, 
-                            Logger* logger):TimerInterface(loop, 5*1000)
+                            Logger* logger):TimerInterface(loop, 5*1000, true)
                                         , port_(port)
                                         , loop_(loop)
                                         , logger_(logger)
@@ -29,6 +30,19 @@ WebSocketServer::WebSocketServer(uint16_t port,
     LogInfof(logger_, "WebSocketServer construct, port:%d, key file:%s, cert file:%s", port, key_file_.c_str(), cert_file_.c_str());
 }
 
+WebSocketServer::WebSocketServer(uv_loop_t* loop,
+                            const std::string& key_file, 
+                            const std::string& cert_file, 
+                            Logger* logger):TimerInterface(loop, 5*1000, true)
+                                        , loop_(loop)
+                                        , logger_(logger)
+                                        , key_file_(key_file)
+                                        , cert_file_(cert_file)
+{
+    StartTimer();
+    LogInfof(logger_, "WebSocketServer construct without listener, key file:%s, cert file:%s", key_file_.c_str(), cert_file_.c_str());
+}
+
 WebSocketServer::~WebSocketServer()
 {
 }
@@ -77,4 +91,66 @@ HandleWebSocketPtr WebSocketServer::GetHandle(const std::string& uri) {
     return func_ptr;
 }
 
-}
\ No newline at end of file
+int WebSocketServer::Broadcast(const uint8_t* data, size_t len, uint8_t op_code, const std::string& path) {
+    uint8_t header[WS_MAX_HEADER_LEN];
+    size_t header_len = 2;
+
+    //server to client frame is not masked, so it is built once for all the sessions
+    header[0] = 0x80 | (op_code & 0x0f);
+    if (len > UINT16_MAX) {
+        header[1] = 127;
+        for (size_t i = 0; i < 8; i++) {
+            header[2 + i] = (uint8_t)((len >> (56 - 8 * i)) & 0xff);
+        }
+        header_len = 10;
+    } else if (len >= 126) {
+        header[1] = 126;
+        header[2] = (uint8_t)((len >> 8) & 0xff);
+        header[3] = (uint8_t)(len & 0xff);
+        header_len = 4;
+    } else {
+        header[1] = (uint8_t)len;
+    }
+    std::shared_ptr<DataBuffer> frame_ptr = std::make_shared<DataBuffer>(header_len + len);
+    frame_ptr->AppendData((char*)header, header_len);
+    frame_ptr->AppendData((char*)data, len);
+
+    int64_t now_ms = now_millisec();
+    int count = 0;
+    auto iter = sessions_.begin();
+
+    while (iter != sessions_.end()) {
+        std::shared_ptr<WebSocketSession> session_ptr = iter->second;
+
+        if (!session_ptr->IsReady() || (!path.empty() && session_ptr->GetPath() != path)) {
+            iter++;
+            continue;
+        }
+        if (session_ptr->IsWriteBlocked()) {
+            //slow client: the write queue is over the high watermark, drop the message
+            session_ptr->IncDropCount();
+            if (session_ptr->GetSlowSinceMs() < 0) {
+                session_ptr->SetSlowSinceMs(now_ms);
+            } else if (now_ms - session_ptr->GetSlowSinceMs() > WS_SLOW_CLIENT_TIMEOUT_MS) {
+                LogInfof(logger_, "ws session:%s is too slow, dropped:%ld, remove it",
+                        iter->first.c_str(), session_ptr->GetDropCount());
+                session_ptr->Close();
+                iter = sessions_.erase(iter);
+                continue;
+            }
+            iter++;
+            continue;
+        }
+        session_ptr->SetSlowSinceMs(-1);
+        try {
+            session_ptr->AsyncWriteFrame(frame_ptr);
+            count++;
+        } catch(const std::exception& e) {
+            LogErrorf(logger_, "ws session:%s broadcast exception:%s", iter->first.c_str(), e.what());
+        }
+        iter++;
+    }
+    return count;
+}
+
+}
@@ -13,17 +13,25 @@
 
 namespace cpp_streamer
 {
+#define WS_SLOW_CLIENT_TIMEOUT_MS  (10*1000)//a session keeps dropping for so long is closed
+
 class WebSocketSession;
 class WebSocketServer : public TimerInterface, public TcpServerCallbackI
 {
 public:
     WebSocketServer(uint16_t port, uv_loop_t* loop, Logger* logger);
     WebSocketServer(uint16_t port, uv_loop_t* loop, const std::string& key_file, const std::string& cert_file, Logger* logger);
+    //no listener: the connections are accepted by a TcpShardServer shard on the loop,
+    //tls is enabled when the key and cert files are given
+    WebSocketServer(uv_loop_t* loop, const std::string& key_file, const std::string& cert_file, Logger* logger);
     virtual ~WebSocketServer();
 
 public:
     void AddHandle(const std::string& uri, HandleWebSocketPtr handle_ptr);
     HandleWebSocketPtr GetHandle(const std::string& uri);
+    size_t GetSessionCount() { return sessions_.size(); }
+    //send one message to all the sessions(or those on the path), return the number of sessions sent
+    int Broadcast(const uint8_t* data, size_t len, uint8_t op_code = WS_OP_BIN_TYPE, const std::string& path = "");
 
 protected:
     virtual void OnAccept(int ret_code, uv_loop_t* loop, uv_stream_t* handle) override;
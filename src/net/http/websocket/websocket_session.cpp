@@ -12,7 +12,7 @@ WebSocketSession::WebSocketSession(uv_loop_t* loop,
                                 uv_stream_t* handle, 
                                 WebSocketServer* server,
                                 Logger* logger):WebSocketSessionBase(logger)
-                                            , TimerInterface(loop, 200)
+                                            , TimerInterface(loop, 200, true)
                                             , server_(server)
                                             , logger_(logger)
 {
@@ -26,7 +26,7 @@ WebSocketSession::WebSocketSession(uv_loop_t* loop,
                                 const std::string& key_file, 
                                 const std::string& cert_file, 
                                 Logger* logger):WebSocketSessionBase(logger)
-                                            , TimerInterface(loop, 200)
+                                            , TimerInterface(loop, 200, true)
                                             , server_(server)
                                             , logger_(logger)
 {
@@ -69,6 +69,30 @@ void WebSocketSession::SetSessionCallback(WebSocketSessionCallBackI* cb) {
     cb_ = cb;
 }
 
+void WebSocketSession::AsyncWriteFrame(std::shared_ptr<DataBuffer> frame_ptr) {
+    if (!IsReady()) {
+        return;
+    }
+    session_->AsyncWrite(frame_ptr);
+}
+
+size_t WebSocketSession::GetWriteQueueSize() {
+    return session_->GetWriteQueueSize();
+}
+
+bool WebSocketSession::IsWriteBlocked() {
+    return session_->IsWriteBlocked();
+}
+
+void WebSocketSession::Close() {
+    if (close_) {
+        return;
+    }
+    close_ = true;
+    is_connected_ = false;
+    session_->Close();
+}
+
 void WebSocketSession::OnWrite(int ret_code, size_t sent_size) {
     if (ret_code < 0) {
         is_connected_ = false;
@@ -104,9 +128,10 @@ void WebSocketSession::OnRead(int ret_code, const char* data, size_t data_size)
             return;
         }
     }
-    DataBuffer recv_data(data_size);
-    recv_data.AppendData(data, data_size);
-    HandleFrame(recv_data);
+    //parse and unmask in the tcp read buffer, it is reused by the next read
+    if (HandleFrame((uint8_t*)data, data_size) < 0) {
+        return;
+    }
     session_->AsyncRead();
 }
 
@@ -302,25 +327,22 @@ void WebSocketSession::SendWsFrame(const uint8_t* data, size_t len, uint8_t op_c
     masking_key[2] = ByteCrypto::GetRandomUint(1, 0xff);
     masking_key[3] = ByteCrypto::GetRandomUint(1, 0xff);
     
-    std::vector<uint8_t> data_vec(len);
-    uint8_t* p = &data_vec[0];
-    
-    memcpy(p, data, len);
-
-    size_t temp_len = len & ~3;
-    for (size_t i = 0; i < temp_len; i += 4) {
-        p[i + 0] ^= masking_key[0];
-        p[i + 1] ^= masking_key[1];
-        p[i + 2] ^= masking_key[2];
-        p[i + 3] ^= masking_key[3];
-    }
-    for (size_t i = temp_len; i < len; ++i) {
-        p[i] ^= masking_key[i % 4];
-    }
+    //mask straight into the frame buffer, one write for the whole frame
+    size_t total = header_len + sizeof(masking_key) + len;
+    std::vector<uint8_t> data_buffer(total);
+    uint8_t* buffer_p = (uint8_t*)&data_buffer[0];
+
+    memcpy(buffer_p, header_start, header_len);
+    memcpy(buffer_p + header_len, masking_key, sizeof(masking_key));
+    WebSocketMask(buffer_p + header_len + sizeof(masking_key), data, len, masking_key, 0);
+
+    session_->AsyncWrite((char*)buffer_p, total);
+}
 
-    session_->AsyncWrite((char*)header_start, header_len);
-    session_->AsyncWrite((char*)masking_key, sizeof(masking_key));
-    session_->AsyncWrite((char*)p, len);
+void WebSocketSession::HandleWsDataPiece(uint8_t* data, size_t len, bool last) {
+    if (cb_) {
+        cb_->OnReadDataPiece(0, data, len, last);
+    }
 }
 
 void WebSocketSession::HandleWsClose(uint8_t* data, size_t len) {
@@ -357,4 +379,10 @@ void WebSocketSession::HandleWsClose(uint8_t* data, size_t len) {
     session_->Close();
 }
 
+void WebSocketSession::HandleWsFail(uint16_t code, const char* reason) {
+    close_ = true;
+    is_connected_ = false;
+    session_->Close();
+}
+
 }
\ No newline at end of file
@@ -30,6 +30,18 @@ public:
     std::string GetRemoteAddress();
     void SetSessionCallback(WebSocketSessionCallBackI* cb);
     int64_t GetLastPongMs();
+    std::string GetPath() { return path_; }
+    bool IsReady() { return http_request_ready_ && is_connected_ && !close_; }
+    void Close();
+
+public://broadcast, the frame is encoded by the server and shared by the sessions
+    void AsyncWriteFrame(std::shared_ptr<DataBuffer> frame_ptr);
+    size_t GetWriteQueueSize();
+    bool IsWriteBlocked();
+    int64_t GetSlowSinceMs() { return slow_since_ms_; }
+    void SetSlowSinceMs(int64_t ms) { slow_since_ms_ = ms; }
+    void IncDropCount() { drop_count_++; }
+    int64_t GetDropCount() { return drop_count_; }
 
 protected:
     virtual void OnTimer() override;
@@ -42,13 +54,14 @@ protected:
     virtual void HandleWsData(uint8_t* data, size_t len, int op_code) override;
     virtual void SendWsFrame(const uint8_t* data, size_t len, uint8_t op_code) override;
     virtual void HandleWsClose(uint8_t* data, size_t len) override;
+    virtual void HandleWsDataPiece(uint8_t* data, size_t len, bool last) override;
+    virtual void HandleWsFail(uint16_t code, const char* reason) override;
 
 private:
     void Init();
     int OnHandleHttpRequest();
     void SendHttpResponse();
     void SendErrorResponse();
-    void OnHandleFrame(const uint8_t* data, size_t data_size);
     std::string GenHashcode();
 
 private:
@@ -72,12 +85,11 @@ private:
     std::string hash_code_;
 
 private:
-    WebSocketFrame frame_;
-    std::vector<std::shared_ptr<DataBuffer>> recv_buffer_vec_;
-    int die_count_ = 0;
+    WebSocketSessionCallBackI* cb_ = nullptr;
 
 private:
-    WebSocketSessionCallBackI* cb_ = nullptr;
+    int64_t slow_since_ms_ = -1;
+    int64_t drop_count_    = 0;
 };
 }
 
@@ -1,6 +1,7 @@
 #include "ws_session_base.hpp"
 #include "utils/stringex.hpp"
 #include "utils/byte_stream.hpp"
+#include <cstring>
 
 namespace cpp_streamer
 {
@@ -25,95 +26,176 @@ Logger* WebSocketSessionBase::GetLogger() {
     return logger_;
 }
 
-int WebSocketSessionBase::HandleFrame(DataBuffer& data) {
-    int ret = 0;
-    int i   = 0;
-
-    do {
-        if (i == 0) {
-            ret = frame_->Parse((uint8_t*)data.Data(), data.DataLen());
-            if (ret != 0) {
-                return ret;
+int WebSocketSessionBase::HandleFrame(uint8_t* data, size_t len) {
+    while (len > 0 && !close_) {
+        if (!frame_->IsHeaderReady()) {
+            int ret = frame_->ParseHeader(data, len);
+            if (ret < 0) {
+                FailConnection(WS_CLOSE_PROTOCOL_ERROR, "invalid frame header");
+                return -1;
             }
-        } else {
-            ret = frame_->Parse(nullptr, 0);
-            if (ret != 0) {
-                return ret;
+            data += ret;
+            len  -= ret;
+            if (!frame_->IsHeaderReady()) {
+                return 1;
+            }
+            if (OnFrameHeader() < 0) {
+                return -1;
+            }
+            if (frame_->GetPayloadLen() == 0) {
+                OnFramePayload(data, 0, true);
+                frame_->Reset();
+                continue;
             }
         }
-        i++;
-        if (frame_->GetOperCode() == WS_OP_TEXT_TYPE || frame_->GetOperCode() == WS_OP_BIN_TYPE) {
-            last_op_code_ = frame_->GetOperCode();
-        }
-        
-        if (!frame_->PayloadIsReady()) {
-            return 1;
+
+        size_t payload_len = len;
+        if ((int64_t)payload_len > frame_->GetPayloadLeft()) {
+            payload_len = (size_t)frame_->GetPayloadLeft();
         }
-        std::shared_ptr<DataBuffer> buffer_ptr = std::make_shared<DataBuffer>(frame_->GetPayloadLen() + 1024);
-        buffer_ptr->AppendData((char*)frame_->GetPayloadData(), frame_->GetPayloadLen());
-        recv_buffer_vec_.emplace_back(std::move(buffer_ptr));
+        bool whole = ((int64_t)payload_len == frame_->GetPayloadLen());
 
-        frame_->Consume(frame_->GetPayloadStart() + frame_->GetPayloadLen());
-        frame_->Reset();
+        frame_->ReadPayload(data, payload_len);
+        OnFramePayload(data, payload_len, whole);
+        data += payload_len;
+        len  -= payload_len;
 
-        if (!frame_->GetFin()) {
-            continue;
+        if (frame_->IsPayloadReady()) {
+            frame_->Reset();
         }
-        die_count_ = 0;
-        
-        switch (frame_->GetOperCode())
-        {
-            case WS_OP_PING_TYPE:
-            {
-                HandleWsPing();
-                break;
-            }
-            case WS_OP_PONG_TYPE:
-            {
-                LogDebugf(logger_, "receive ws pong");
-                last_recv_pong_ms_ = now_millisec();
-                break;
-            }
-            case WS_OP_CLOSE_TYPE:
-            {
-                for (auto item : recv_buffer_vec_) {
-                    HandleWsClose((uint8_t*)item->Data(), item->DataLen());
-                }
-                break;
-            }
-            case WS_OP_CONTINUE_TYPE:
-            {
-                for (auto item : recv_buffer_vec_) {
-                    HandleWsData((uint8_t*)item->Data(), item->DataLen(), last_op_code_);
-                }
-                break;
-            }
-            case WS_OP_TEXT_TYPE:
-            case WS_OP_BIN_TYPE:
-            {
-                for (auto item : recv_buffer_vec_) {
-                    HandleWsData((uint8_t*)item->Data(), item->DataLen(), frame_->GetOperCode());
-                }
-                break;
-            }
-            default:
-                LogErrorf(logger_, "websocket opcode:%d not handle", frame_->GetOperCode());
-                break;
+    }
+    return frame_->IsHeaderReady() ? 1 : 0;
+}
+
+int WebSocketSessionBase::OnFrameHeader() {
+    if (frame_->IsControl()) {
+        control_buffer_.Reset();
+        return 0;
+    }
+    if (frame_->GetPayloadLen() > WS_MAX_FRAME_LEN) {
+        FailConnection(WS_CLOSE_TOO_BIG, "frame too big");
+        return -1;
+    }
+    if (frame_->GetOperCode() != WS_OP_CONTINUE_TYPE) {
+        last_op_code_ = frame_->GetOperCode();
+        streaming_    = false;
+        message_buffer_.Reset();
+    }
+    if (streaming_) {
+        return 0;
+    }
+    if (!stream_enable_ || last_op_code_ != WS_OP_BIN_TYPE
+        || frame_->GetPayloadLen() <= WS_STREAM_THRESHOLD) {
+        //the frame goes to message_buffer_ unless it is read whole
+        if ((int64_t)message_buffer_.DataLen() + frame_->GetPayloadLen() > WS_MAX_MESSAGE_LEN) {
+            FailConnection(WS_CLOSE_TOO_BIG, "message too big");
+            return -1;
         }
-        recv_buffer_vec_.clear();
-    } while(frame_->GetBufferLen() > 0);
+        return 0;
+    }
+    //switch the message to pieces, flush what has been buffered
+    streaming_ = true;
+    if (message_buffer_.DataLen() > 0) {
+        HandleWsDataPiece((uint8_t*)message_buffer_.Data(), message_buffer_.DataLen(), false);
+        message_buffer_.Reset();
+    }
     return 0;
 }
 
-void WebSocketSessionBase::HandleWsPing() {
-    for (auto item : recv_buffer_vec_) {
-        SendWsFrame((uint8_t*)item->Data(), item->DataLen(), WS_OP_PONG_TYPE);
+void WebSocketSessionBase::OnFramePayload(uint8_t* data, size_t len, bool whole) {
+    bool frame_end = (frame_->GetPayloadLeft() == 0);
+    bool fin       = frame_->GetFin();
+
+    if (frame_end && fin) {
+        die_count_ = 0;
+    }
+
+    if (frame_->IsControl()) {
+        if (whole) {
+            HandleControlFrame(data, len);
+            return;
+        }
+        control_buffer_.AppendData((char*)data, len);
+        if (frame_end) {
+            HandleControlFrame((uint8_t*)control_buffer_.Data(), control_buffer_.DataLen());
+            control_buffer_.Reset();
+        }
+        return;
+    }
+
+    if (last_op_code_ != WS_OP_TEXT_TYPE && last_op_code_ != WS_OP_BIN_TYPE) {
+        LogErrorf(logger_, "websocket opcode:%d not handle", last_op_code_);
+        return;
+    }
+
+    if (streaming_) {
+        HandleWsDataPiece(data, len, frame_end && fin);
+        if (frame_end && fin) {
+            streaming_ = false;
+        }
+        return;
+    }
+
+    //the whole message is in the read buffer, no copy
+    if (whole && fin && message_buffer_.DataLen() == 0) {
+        HandleWsData(data, len, last_op_code_);
+        return;
+    }
+    message_buffer_.AppendData((char*)data, len);
+    if (frame_end && fin) {
+        HandleWsData((uint8_t*)message_buffer_.Data(), message_buffer_.DataLen(), last_op_code_);
+        message_buffer_.Reset();
+    }
+}
+
+void WebSocketSessionBase::HandleControlFrame(uint8_t* data, size_t len) {
+    switch (frame_->GetOperCode())
+    {
+        case WS_OP_PING_TYPE:
+        {
+            SendWsFrame(data, len, WS_OP_PONG_TYPE);
+            break;
+        }
+        case WS_OP_PONG_TYPE:
+        {
+            LogDebugf(logger_, "receive ws pong");
+            last_recv_pong_ms_ = now_millisec();
+            break;
+        }
+        case WS_OP_CLOSE_TYPE:
+        {
+            HandleWsClose(data, len);
+            break;
+        }
+        default:
+            LogErrorf(logger_, "websocket opcode:%d not handle", frame_->GetOperCode());
+            break;
     }
 }
 
 void WebSocketSessionBase::SendClose(uint16_t code, const char *reason) {
+    uint8_t payload[125];
     size_t reason_len = strlen(reason);
-    SendWsFrame((uint8_t*)reason, reason_len, WS_OP_CLOSE_TYPE);
+
+    if (reason_len > sizeof(payload) - 2) {
+        reason_len = sizeof(payload) - 2;
+    }
+    ByteStream::Write2Bytes(payload, code);
+    memcpy(payload + 2, reason, reason_len);
+    SendWsFrame(payload, reason_len + 2, WS_OP_CLOSE_TYPE);
+}
+
+void WebSocketSessionBase::FailConnection(uint16_t code, const char *reason) {
+    if (close_) {
+        return;
+    }
+    LogErrorf(logger_, "websocket fail connection, code:%d, reason:%s", code, reason);
+    SendClose(code, reason);
+    frame_->Reset();
+    message_buffer_.Reset();
+    control_buffer_.Reset();
+    streaming_ = false;
+    HandleWsFail(code, reason);
 }
 
 void WebSocketSessionBase::SendPingFrame(int64_t now_ms) {
@@ -20,23 +20,33 @@ public:
     void AsyncWriteText(const std::string& text);
     void AsyncWriteData(const uint8_t* data, size_t len);
     Logger* GetLogger();
+    void SetStreamEnable(bool enable) { stream_enable_ = enable; }
 
 protected:
-    int HandleFrame(DataBuffer& data);
+    //the payload is unmasked in place, data must be writable
+    int HandleFrame(uint8_t* data, size_t len);
     void SendClose(uint16_t code, const char *reason);
+    void FailConnection(uint16_t code, const char *reason);
     void SendPingFrame(int64_t now_ms);
 
 protected:
     virtual void HandleWsData(uint8_t* data, size_t len, int op_code) = 0;
     virtual void SendWsFrame(const uint8_t* data, size_t len, uint8_t op_code) = 0;
     virtual void HandleWsClose(uint8_t* data, size_t len) = 0;
+    virtual void HandleWsFail(uint16_t code, const char* reason) = 0;
+    virtual void HandleWsDataPiece(uint8_t* data, size_t len, bool last) {}
 
 private:
-    void HandleWsPing();
+    int OnFrameHeader();
+    void OnFramePayload(uint8_t* data, size_t len, bool whole);
+    void HandleControlFrame(uint8_t* data, size_t len);
 
 protected:
     std::unique_ptr<WebSocketFrame> frame_;
-    std::vector<std::shared_ptr<DataBuffer>> recv_buffer_vec_;
+    DataBuffer message_buffer_;//fragmented or partly received message
+    DataBuffer control_buffer_;//partly received control frame
+    bool stream_enable_         = false;
+    bool streaming_             = false;
     Logger* logger_             = nullptr;
     int last_op_code_           = 1;
     int die_count_              = 0;
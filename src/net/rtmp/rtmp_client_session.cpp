@@ -109,6 +109,14 @@ bool RtmpClientSession::IsReady() {
     return client_phase_ == client_media_handle_phase;
 }
 
+bool RtmpClientSession::IsWriteBlocked() {
+    return conn_.IsWriteBlocked();
+}
+
+size_t RtmpClientSession::GetWriteQueueSize() {
+    return conn_.GetWriteQueueSize();
+}
+
 void RtmpClientSession::TryRead() {
     conn_.AsyncRead();
     return;
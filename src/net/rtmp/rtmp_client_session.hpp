@@ -98,6 +98,8 @@ public:
     void TryRead();
     void Close();
     bool IsReady();
+    bool IsWriteBlocked();
+    size_t GetWriteQueueSize();
 
 public:
     int Start(const std::string& url, bool is_publish);
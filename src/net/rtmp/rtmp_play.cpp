@@ -77,6 +77,8 @@ void RtmpPlay::OnMessage(int ret_code, Media_Packet_Ptr pkt_ptr) {
         return;
     }
     statics_.InputPacket(pkt_ptr);
+    metrics_.OnPacket(pkt_ptr->buffer_ptr_->DataLen());
+    metrics_.OnIngress(pkt_ptr->ingress_us_);
 
     if ((now_ts - rpt_ts_) > 2000) {
         ReportStatics();
@@ -50,6 +50,7 @@ Media_Packet_Ptr RtmpPublish::GetMediaPacket() {
         
     pkt_ptr = packet_queue_.front();
     packet_queue_.pop();
+    metrics_.SetQueueDepth(packet_queue_.size());
 
     return pkt_ptr;
 }
@@ -216,9 +217,12 @@ void RtmpPublish::HandleMediaData() {
         if (!pkt_ptr) {
             break;
         }
+        metrics_.BeginStage();
         
         if (pkt_ptr->fmt_type_ == MEDIA_FORMAT_FLV) {
             SendRtmp(pkt_ptr);
+            metrics_.EndStage();
+            metrics_.OnOutput(pkt_ptr->ingress_us_);
             return;
         }
 
@@ -234,7 +238,8 @@ void RtmpPublish::HandleMediaData() {
         } else {
             LogErrorf(logger_, "not suport format:%d", pkt_ptr->fmt_type_);
         }
-
+        metrics_.EndStage();
+        metrics_.OnOutput(pkt_ptr->ingress_us_);
     }
     return;
 }
@@ -250,6 +255,26 @@ void RtmpPublish::SendRtmp(Media_Packet_Ptr pkt_ptr) {
         LogErrorf(logger_, "rtmp session is not ready");
         return;
     }
+    if (pkt_ptr->av_type_ == MEDIA_VIDEO_TYPE && !pkt_ptr->is_seq_hdr_) {
+        if (client_session_->IsWriteBlocked()) {
+            if (!wait_keyframe_) {
+                LogWarnf(logger_, "rtmp write queue is blocked, queue bytes:%lu, drop video till the next key frame",
+                        client_session_->GetWriteQueueSize());
+                ReportEvent("drop", "write queue blocked");
+            }
+            wait_keyframe_ = true;
+            drop_video_count_++;
+            return;
+        }
+        if (wait_keyframe_) {
+            if (!pkt_ptr->is_key_frame_) {
+                drop_video_count_++;
+                return;
+            }
+            LogInfof(logger_, "rtmp write queue is drained, resume video, dropped:%ld", drop_video_count_);
+            wait_keyframe_ = false;
+        }
+    }
     int64_t now_ts = now_millisec();
 
     statics_.InputPacket(pkt_ptr);
@@ -288,6 +313,9 @@ int RtmpPublish::SourceData(Media_Packet_Ptr pkt_ptr) {
 
     // LogInfof(logger_, "rtmppublish input packet:%s", pkt_ptr->Dump(true).c_str());
     packet_queue_.push(pkt_ptr);
+    metrics_.OnPacket(pkt_ptr->buffer_ptr_->DataLen());
+    metrics_.SetQueueDepth(packet_queue_.size());
+    metrics_.OnIngress(pkt_ptr->ingress_us_);
 
     async_.data = (void*)this;
     uv_async_send(&async_);
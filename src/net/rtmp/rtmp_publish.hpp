@@ -120,6 +120,10 @@ private:
     MediaStatics statics_;
     int64_t rpt_ts_ = -1;
 
+private://the tcp write queue is over the high watermark, video is dropped till the next key frame
+    bool wait_keyframe_ = false;
+    int64_t drop_video_count_ = 0;
+
 private:
     Logger* logger_ = nullptr;
 
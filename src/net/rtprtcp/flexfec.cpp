@@ -0,0 +1,485 @@
+#include "flexfec.hpp"
+#include "byte_stream.hpp"
+
+#include <cstring>
+
+namespace cpp_streamer
+{
+
+/*
+ rfc8627 fec header with the flexible mask, R=0 and F=0:
+  0                   1                   2                   3
+  0 1 2 3 4 5 6 7 8 9 0 1 2 3 4 5 6 7 8 9 0 1 2 3 4 5 6 7 8 9 0 1
+ +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+ |0|0|P|X|  CC   |M| PT recovery |        length recovery        |
+ +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+ |                          TS recovery                          |
+ +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+ |           SN base_i           |k|          Mask [0-14]        |
+ +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+ |k|                   Mask [15-45] (optional)                   |
+ +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+ |k|                                                             |
+ +-+                   Mask [46-108] (optional)                  |
+ |                                                               |
+ +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+ the protected ssrc is the csrc of the fec rtp header.
+ */
+static const size_t kFecMaskOffset = 10;
+
+static size_t GetFecHeaderSize(size_t max_offset) {
+    if (max_offset < 15) {
+        return FEC_HEADER_MIN_SIZE;
+    }
+    if (max_offset < 46) {
+        return FEC_HEADER_MIN_SIZE + 4;
+    }
+    return FEC_HEADER_MIN_SIZE + 12;
+}
+
+//the bit position of the mask offset in the masks, the k bits are skipped
+static size_t GetMaskBitPos(size_t offset) {
+    if (offset < 15) {
+        return 1 + offset;
+    }
+    if (offset < 46) {
+        return 16 + 1 + (offset - 15);
+    }
+    return 48 + 1 + (offset - 46);
+}
+
+static void XorData(uint8_t* dst, const uint8_t* src, size_t len) {
+    for (size_t index = 0; index < len; index++) {
+        dst[index] ^= src[index];
+    }
+}
+
+static size_t GetRtpHeaderLen(const uint8_t* data, size_t len) {
+    RtpCommonHeader* header = (RtpCommonHeader*)data;
+    size_t header_len = sizeof(RtpCommonHeader) + 4 * header->csrc_count;
+
+    if (header->extension) {
+        if (header_len + 4 > len) {
+            return 0;
+        }
+        header_len += 4 + 4 * ByteStream::Read2Bytes(data + header_len + 2);
+    }
+    return header_len >= len ? 0 : header_len;
+}
+
+FlexFecEncoder::FlexFecEncoder(FlexFecSinkI* sink, Logger* logger):sink_(sink)
+                                                                , logger_(logger)
+{
+    group_slab_.resize(FEC_MAX_GROUP_PACKETS * RTP_PACKET_MAX_SIZE);
+    LogInfof(logger_, "FlexFecEncoder construct");
+}
+
+FlexFecEncoder::~FlexFecEncoder()
+{
+    LogInfof(logger_, "FlexFecEncoder destruct, media packets:%ld, fec packets:%ld",
+            media_count_, fec_count_);
+}
+
+void FlexFecEncoder::SetHeader(uint8_t payload_type, uint32_t ssrc, uint32_t media_ssrc, HeaderExtension* ext) {
+    payload_type_ = payload_type;
+    ssrc_         = ssrc;
+    media_ssrc_   = media_ssrc;
+    ext_          = ext;
+}
+
+void FlexFecEncoder::SetProtectionRate(int key_rate, int delta_rate) {
+    key_rate_   = key_rate < 0 ? 0 : (key_rate > 100 ? 100 : key_rate);
+    delta_rate_ = delta_rate < 0 ? 0 : (delta_rate > 100 ? 100 : delta_rate);
+    LogInfof(logger_, "FlexFecEncoder set protection rate, keyframe:%d%%, delta frame:%d%%",
+            key_rate_, delta_rate_);
+}
+
+void FlexFecEncoder::BeginFrame(bool key_frame) {
+    frame_key_ = key_frame;
+    //the delta packets waiting in the group are protected with the keyframe
+    group_key_ = group_key_ || key_frame;
+}
+
+void FlexFecEncoder::AddPacket(const uint8_t* data, size_t len) {
+    if (len <= sizeof(RtpCommonHeader) || len > RTP_PACKET_MAX_SIZE) {
+        return;
+    }
+    uint16_t seq = ByteStream::Read2Bytes(data + 2);
+
+    if (group_count_ > 0) {
+        uint16_t offset = seq - group_seqs_[0];
+        if (group_count_ >= FEC_MAX_GROUP_PACKETS || offset >= FEC_MASK_MAX_BITS) {
+            //the large frame is protected in more groups
+            EncodeGroup(GetFecPacketCount(true));
+            group_key_ = frame_key_;
+        }
+    }
+    memcpy(GetGroupData(group_count_), data, len);
+    group_lens_[group_count_] = len;
+    group_seqs_[group_count_] = seq;
+    group_ts_ = ByteStream::Read4Bytes(data + 4);
+    group_count_++;
+    media_count_++;
+}
+
+void FlexFecEncoder::EndFrame() {
+    if (group_count_ == 0) {
+        return;
+    }
+    group_frames_++;
+
+    bool flush = group_frames_ >= FEC_MAX_GROUP_FRAMES;
+    size_t fec_packets = GetFecPacketCount(flush);
+    if (fec_packets == 0 && !flush && (group_key_ ? key_rate_ : delta_rate_) > 0) {
+        //the small delta frames are protected together
+        return;
+    }
+    EncodeGroup(fec_packets);
+    group_key_ = false;
+}
+
+/*
+ * keyframe: ceil(packets * rate), at least one fec packet for every keyframe.
+ * delta frame: round(packets * rate), it may be 0 until more frames are in the group.
+ */
+size_t FlexFecEncoder::GetFecPacketCount(bool flush) {
+    int rate = group_key_ ? key_rate_ : delta_rate_;
+    if (rate <= 0 || group_count_ == 0) {
+        return 0;
+    }
+    size_t count = 0;
+    if (group_key_) {
+        count = (group_count_ * rate + 99) / 100;
+    } else {
+        count = (group_count_ * rate + 50) / 100;
+    }
+    if (count == 0 && flush) {
+        count = 1;
+    }
+    return count > group_count_ ? group_count_ : count;
+}
+
+void FlexFecEncoder::EncodeGroup(size_t fec_packets) {
+    for (size_t index = 0; index < fec_packets; index++) {
+        size_t len = MakeFecPacket(index, fec_packets);
+        if (len == 0) {
+            continue;
+        }
+        fec_count_++;
+        sink_->OnFecPacket(fec_buffer_, len, sizeof(fec_buffer_));
+    }
+    ResetGroup();
+}
+
+size_t FlexFecEncoder::MakeFecPacket(size_t fec_index, size_t fec_packets) {
+    size_t max_offset  = 0;
+    size_t payload_len = 0;
+
+    for (size_t index = fec_index; index < group_count_; index += fec_packets) {
+        size_t offset = (uint16_t)(group_seqs_[index] - group_seqs_[0]);
+        size_t media_payload = group_lens_[index] - sizeof(RtpCommonHeader);
+
+        max_offset  = offset > max_offset ? offset : max_offset;
+        payload_len = media_payload > payload_len ? media_payload : payload_len;
+    }
+
+    //rtp header with the media ssrc in the csrc, the extensions, the fec header and the repair payload
+    size_t rtp_header_len = sizeof(RtpCommonHeader) + 4;
+    size_t ext_len = 0;
+    if (ext_) {
+        ext_len = 4 + 4 * ByteStream::Read2Bytes((uint8_t*)ext_ + 2);
+    }
+    size_t fec_header_len = GetFecHeaderSize(max_offset);
+    size_t total = rtp_header_len + ext_len + fec_header_len + payload_len;
+    if (total > RTP_PACKET_MAX_SIZE) {
+        LogErrorf(logger_, "fec packet len:%lu is too large", total);
+        return 0;
+    }
+
+    RtpCommonHeader* header = (RtpCommonHeader*)fec_buffer_;
+    memset(header, 0, sizeof(RtpCommonHeader));
+    header->version      = RTP_VERSION;
+    header->csrc_count   = 1;
+    header->payload_type = payload_type_;
+    header->sequence     = htons(seq_++);
+    header->timestamp    = htonl(group_ts_);
+    header->ssrc         = htonl(ssrc_);
+    ByteStream::Write4Bytes(fec_buffer_ + sizeof(RtpCommonHeader), media_ssrc_);
+    if (ext_) {
+        header->extension = 1;
+        memcpy(fec_buffer_ + rtp_header_len, ext_, ext_len);
+    }
+
+    uint8_t* fec_header = fec_buffer_ + rtp_header_len + ext_len;
+    uint8_t* repair     = fec_header + fec_header_len;
+    memset(fec_header, 0, fec_header_len + payload_len);
+
+    uint16_t length_recovery = 0;
+    uint32_t ts_recovery     = 0;
+    for (size_t index = fec_index; index < group_count_; index += fec_packets) {
+        uint8_t* data = GetGroupData(index);
+        size_t len    = group_lens_[index];
+        size_t offset = (uint16_t)(group_seqs_[index] - group_seqs_[0]);
+        size_t bit_pos = GetMaskBitPos(offset);
+
+        fec_header[0]   ^= data[0];
+        fec_header[1]   ^= data[1];
+        length_recovery ^= (uint16_t)(len - sizeof(RtpCommonHeader));
+        ts_recovery     ^= ByteStream::Read4Bytes(data + 4);
+        XorData(repair, data + sizeof(RtpCommonHeader), len - sizeof(RtpCommonHeader));
+
+        fec_header[kFecMaskOffset + bit_pos / 8] |= (uint8_t)(0x80 >> (bit_pos % 8));
+    }
+    //R=0, F=0 instead of the version
+    fec_header[0] &= 0x3f;
+    ByteStream::Write2Bytes(fec_header + 2, length_recovery);
+    ByteStream::Write4Bytes(fec_header + 4, ts_recovery);
+    ByteStream::Write2Bytes(fec_header + 8, group_seqs_[0]);
+
+    //the k bit of the last mask
+    if (fec_header_len == FEC_HEADER_MIN_SIZE) {
+        fec_header[kFecMaskOffset] |= 0x80;
+    } else if (fec_header_len == FEC_HEADER_MIN_SIZE + 4) {
+        fec_header[kFecMaskOffset + 2] |= 0x80;
+    } else {
+        fec_header[kFecMaskOffset + 6] |= 0x80;
+    }
+    return total;
+}
+
+void FlexFecEncoder::ResetGroup() {
+    group_count_  = 0;
+    group_frames_ = 0;
+}
+
+FlexFecDecoder::FlexFecDecoder(uint32_t media_ssrc,
+        FlexFecRecoverSinkI* sink,
+        Logger* logger):media_ssrc_(media_ssrc)
+                        , sink_(sink)
+                        , logger_(logger)
+{
+    media_slab_.resize(FEC_RECV_MEDIA_SLOTS * RTP_PACKET_MAX_SIZE);
+    media_slots_.resize(FEC_RECV_MEDIA_SLOTS);
+    for (auto& slot : media_slots_) {
+        memset(&slot, 0, sizeof(slot));
+    }
+    repair_slots_.resize(FEC_RECV_MAX_PACKETS);
+    for (auto& slot : repair_slots_) {
+        slot.len   = 0;
+        slot.valid = false;
+    }
+    LogInfof(logger_, "FlexFecDecoder construct, media ssrc:%u", media_ssrc_);
+}
+
+FlexFecDecoder::~FlexFecDecoder()
+{
+    LogInfof(logger_, "FlexFecDecoder destruct, fec packets:%ld, recovered packets:%ld",
+            fec_count_, recovered_count_);
+}
+
+void FlexFecDecoder::OnMediaPacket(const uint8_t* data, size_t len) {
+    if (len <= sizeof(RtpCommonHeader) || len > RTP_PACKET_MAX_SIZE) {
+        return;
+    }
+    uint16_t seq = ByteStream::Read2Bytes(data + 2);
+    if (HasMedia(seq)) {
+        return;
+    }
+    SaveMedia(data, len);
+    if (repair_pending_ > 0) {
+        RecoverBySeq(seq);
+    }
+}
+
+void FlexFecDecoder::OnFecPacket(const uint8_t* data, size_t len) {
+    RtpCommonHeader* header = (RtpCommonHeader*)data;
+    if (len <= sizeof(RtpCommonHeader) || header->csrc_count < 1) {
+        return;
+    }
+    size_t header_len = GetRtpHeaderLen(data, len);
+    if (header_len == 0 || header_len + FEC_HEADER_MIN_SIZE > len) {
+        return;
+    }
+    uint32_t protected_ssrc = ByteStream::Read4Bytes(data + sizeof(RtpCommonHeader));
+    const uint8_t* fec_header = data + header_len;
+
+    if (protected_ssrc != media_ssrc_ || (fec_header[0] & 0xc0) != 0) {
+        //the other ssrc, the retransmission(R=1) or the fixed mask(F=1) is not supported
+        return;
+    }
+    fec_count_++;
+    ExpireRepairs();
+
+    size_t repair_index = repair_next_;
+    repair_next_ = (repair_next_ + 1) % repair_slots_.size();
+    FecRepairSlot& repair = repair_slots_[repair_index];
+    if (repair.valid) {
+        repair.valid = false;
+        repair_pending_--;
+    }
+
+    //the masks end at the k bit
+    const uint8_t* mask = fec_header + kFecMaskOffset;
+    size_t fec_header_len = FEC_HEADER_MIN_SIZE;
+    size_t mask_bits = 15;
+    if ((mask[0] & 0x80) == 0) {
+        fec_header_len += 4;
+        mask_bits = 46;
+        if (header_len + fec_header_len <= len && (mask[2] & 0x80) == 0) {
+            fec_header_len += 8;
+            mask_bits = FEC_MASK_MAX_BITS;
+        }
+    }
+    if (header_len + fec_header_len > len) {
+        return;
+    }
+    uint16_t seq_base = ByteStream::Read2Bytes(fec_header + 8);
+
+    repair.seq_count = 0;
+    for (size_t offset = 0; offset < mask_bits; offset++) {
+        size_t bit_pos = GetMaskBitPos(offset);
+        if (mask[bit_pos / 8] & (0x80 >> (bit_pos % 8))) {
+            repair.seqs[repair.seq_count++] = seq_base + offset;
+        }
+    }
+    if (repair.seq_count == 0) {
+        return;
+    }
+    repair.len        = len - header_len;
+    repair.header_len = fec_header_len;
+    memcpy(repair.data, fec_header, repair.len);
+    repair.valid = true;
+    repair_pending_++;
+
+    TryRecover(repair_index);
+}
+
+void FlexFecDecoder::SaveMedia(const uint8_t* data, size_t len) {
+    uint16_t seq = ByteStream::Read2Bytes(data + 2);
+    size_t index = seq % media_slots_.size();
+    FecMediaSlot& slot = media_slots_[index];
+
+    memcpy(GetMediaData(index), data, len);
+    slot.seq   = seq;
+    slot.len   = len;
+    slot.valid = true;
+
+    if (!has_media_ || (int16_t)(seq - newest_seq_) > 0) {
+        newest_seq_ = seq;
+        has_media_  = true;
+    }
+}
+
+bool FlexFecDecoder::HasMedia(uint16_t seq) {
+    FecMediaSlot& slot = media_slots_[seq % media_slots_.size()];
+    return slot.valid && slot.seq == seq;
+}
+
+void FlexFecDecoder::TryRecover(size_t repair_index) {
+    FecRepairSlot& repair = repair_slots_[repair_index];
+    size_t missing_count = 0;
+    uint16_t missing_seq = 0;
+
+    for (size_t index = 0; index < repair.seq_count; index++) {
+        if (!HasMedia(repair.seqs[index])) {
+            missing_count++;
+            missing_seq = repair.seqs[index];
+        }
+    }
+    if (missing_count > 1) {
+        return;
+    }
+    repair.valid = false;
+    repair_pending_--;
+    if (missing_count == 0 || !Recover(repair, missing_seq)) {
+        return;
+    }
+    //the recovered packet may be the last missing one of the other fec packets
+    RecoverBySeq(missing_seq);
+}
+
+void FlexFecDecoder::RecoverBySeq(uint16_t seq) {
+    for (size_t index = 0; index < repair_slots_.size() && repair_pending_ > 0; index++) {
+        FecRepairSlot& repair = repair_slots_[index];
+        if (!repair.valid || (uint16_t)(seq - repair.seqs[0]) >= FEC_MASK_MAX_BITS) {
+            continue;
+        }
+        TryRecover(index);
+    }
+}
+
+/*
+ * the missing packet is the xor of the fec packet and the other protected packets:
+ * the first 2 bytes, the length, the timestamp and the bytes after the fixed rtp header.
+ * the header extensions are recovered as sent, the transport-wide seq included, it is
+ * stamped by the sender before the packet is protected.
+ */
+bool FlexFecDecoder::Recover(FecRepairSlot& repair, uint16_t missing_seq) {
+    uint8_t* fec_header  = repair.data;
+    size_t repair_len    = repair.len - repair.header_len;
+    uint8_t byte0        = fec_header[0];
+    uint8_t byte1        = fec_header[1];
+    uint16_t length      = ByteStream::Read2Bytes(fec_header + 2);
+    uint32_t ts          = ByteStream::Read4Bytes(fec_header + 4);
+    uint8_t* payload     = recover_buffer_ + sizeof(RtpCommonHeader);
+
+    if (sizeof(RtpCommonHeader) + repair_len > RTP_PACKET_MAX_SIZE) {
+        return false;
+    }
+    memcpy(payload, fec_header + repair.header_len, repair_len);
+    for (size_t index = 0; index < repair.seq_count; index++) {
+        uint16_t seq = repair.seqs[index];
+        if (seq == missing_seq) {
+            continue;
+        }
+        size_t slot_index = seq % media_slots_.size();
+        uint8_t* data = GetMediaData(slot_index);
+        size_t len    = media_slots_[slot_index].len;
+        if (len - sizeof(RtpCommonHeader) > repair_len) {
+            LogWarnf(logger_, "fec repair len:%lu is less than the media packet len:%lu, seq:%d",
+                    repair_len, len, seq);
+            return false;
+        }
+        byte0  ^= data[0];
+        byte1  ^= data[1];
+        length ^= (uint16_t)(len - sizeof(RtpCommonHeader));
+        ts     ^= ByteStream::Read4Bytes(data + 4);
+        XorData(payload, data + sizeof(RtpCommonHeader), len - sizeof(RtpCommonHeader));
+    }
+    if (length == 0 || length > repair_len) {
+        LogWarnf(logger_, "fec recover length:%d error, repair len:%lu, seq:%d",
+                length, repair_len, missing_seq);
+        return false;
+    }
+    recover_buffer_[0] = (uint8_t)((RTP_VERSION << 6) | (byte0 & 0x3f));
+    recover_buffer_[1] = byte1;
+    ByteStream::Write2Bytes(recover_buffer_ + 2, missing_seq);
+    ByteStream::Write4Bytes(recover_buffer_ + 4, ts);
+    ByteStream::Write4Bytes(recover_buffer_ + 8, media_ssrc_);
+
+    size_t len = sizeof(RtpCommonHeader) + length;
+    SaveMedia(recover_buffer_, len);
+    recovered_count_++;
+
+    LogDebugf(logger_, "fec recover packet seq:%d, len:%lu", missing_seq, len);
+    sink_->OnRecoveredPacket(recover_buffer_, len);
+    return true;
+}
+
+//the fec packets which protect the packets out of the media slots are useless
+void FlexFecDecoder::ExpireRepairs() {
+    if (repair_pending_ == 0 || !has_media_) {
+        return;
+    }
+    for (auto& repair : repair_slots_) {
+        if (!repair.valid) {
+            continue;
+        }
+        if ((int16_t)(newest_seq_ - repair.seqs[0]) >= (int16_t)(media_slots_.size() / 2)) {
+            repair.valid = false;
+            repair_pending_--;
+        }
+    }
+}
+
+}
@@ -0,0 +1,162 @@
+#ifndef FLEXFEC_HPP
+#define FLEXFEC_HPP
+#include "net/rtprtcp/rtprtcp_pub.hpp"
+#include "net/rtprtcp/rtp_packet.hpp"
+#include "logger.hpp"
+
+#include <stdint.h>
+#include <stddef.h>
+#include <vector>
+
+namespace cpp_streamer
+{
+
+#define FEC_HEADER_MIN_SIZE    12  //R|F|P|X|CC|M|PT, length, ts recovery, sn base and the first mask
+#define FEC_MASK_MAX_BITS      109 //the masks of 15 + 31 + 63 bits
+#define FEC_MAX_GROUP_PACKETS  FEC_MASK_MAX_BITS
+#define FEC_MAX_GROUP_FRAMES   4
+#define FEC_RECV_MEDIA_SLOTS   256
+#define FEC_RECV_MAX_PACKETS   64
+#define FEC_DEF_KEY_RATE       30
+#define FEC_DEF_DELTA_RATE     10
+
+class FlexFecSinkI
+{
+public:
+    virtual void OnFecPacket(uint8_t* data, size_t len, size_t capacity) = 0;
+};
+
+class FlexFecRecoverSinkI
+{
+public:
+    virtual void OnRecoveredPacket(uint8_t* data, size_t len) = 0;
+};
+
+/*
+ * rfc8627 flexible fec with the flexible mask(R=0, F=0) for one media ssrc:
+ * the media packets of one or more frames are a group, the fec packet j of
+ * the group protects the packets i which i % fec count == j, so the burst
+ * loss of the continuous packets is spread over the fec packets.
+ * the rates are the fec packets percent of the media packets in the group.
+ */
+class FlexFecEncoder
+{
+public:
+    FlexFecEncoder(FlexFecSinkI* sink, Logger* logger);
+    ~FlexFecEncoder();
+
+public:
+    void SetHeader(uint8_t payload_type, uint32_t ssrc, uint32_t media_ssrc, HeaderExtension* ext);
+    void SetProtectionRate(int key_rate, int delta_rate);
+
+    //the packets between BeginFrame and EndFrame are the rtp packets of one frame
+    void BeginFrame(bool key_frame);
+    void AddPacket(const uint8_t* data, size_t len);
+    void EndFrame();
+
+public:
+    int64_t GetMediaCount() { return media_count_; }
+    int64_t GetFecCount() { return fec_count_; }
+
+private:
+    size_t GetFecPacketCount(bool flush);
+    void EncodeGroup(size_t fec_packets);
+    size_t MakeFecPacket(size_t fec_index, size_t fec_packets);
+    void ResetGroup();
+    uint8_t* GetGroupData(size_t index) { return &group_slab_[index * RTP_PACKET_MAX_SIZE]; }
+
+private:
+    FlexFecSinkI* sink_ = nullptr;
+    Logger* logger_     = nullptr;
+
+private:
+    uint8_t payload_type_ = 0;
+    uint32_t ssrc_        = 0;
+    uint32_t media_ssrc_  = 0;
+    uint16_t seq_         = 0;
+    HeaderExtension* ext_ = nullptr;
+    int key_rate_         = FEC_DEF_KEY_RATE;
+    int delta_rate_       = FEC_DEF_DELTA_RATE;
+
+private://the media packets of the group are copied before srtp
+    std::vector<uint8_t> group_slab_;
+    size_t group_lens_[FEC_MAX_GROUP_PACKETS];
+    uint16_t group_seqs_[FEC_MAX_GROUP_PACKETS];
+    size_t group_count_ = 0;
+    size_t group_frames_ = 0;
+    bool group_key_ = false;
+    bool frame_key_ = false;
+    uint32_t group_ts_ = 0;
+    uint8_t fec_buffer_[RTP_PACKET_BUFFER_SIZE];
+
+private:
+    int64_t media_count_ = 0;
+    int64_t fec_count_   = 0;
+};
+
+typedef struct {
+    uint16_t seq;
+    size_t len;
+    bool valid;
+} FecMediaSlot;
+
+typedef struct {
+    uint8_t data[RTP_PACKET_MAX_SIZE];//the fec header and the repair payload
+    size_t len;
+    size_t header_len;
+    uint16_t seqs[FEC_MASK_MAX_BITS];
+    size_t seq_count;
+    bool valid;
+} FecRepairSlot;
+
+/*
+ * the received media packets are kept in the slots indexed by seq, a fec packet
+ * recovers the only one missing packet of the ones it protects, the fec packets
+ * with more missing ones wait for the retransmissions or the other recoveries.
+ */
+class FlexFecDecoder
+{
+public:
+    FlexFecDecoder(uint32_t media_ssrc, FlexFecRecoverSinkI* sink, Logger* logger);
+    ~FlexFecDecoder();
+
+public:
+    void OnMediaPacket(const uint8_t* data, size_t len);
+    void OnFecPacket(const uint8_t* data, size_t len);
+
+public:
+    int64_t GetFecCount() { return fec_count_; }
+    int64_t GetRecoveredCount() { return recovered_count_; }
+
+private:
+    void SaveMedia(const uint8_t* data, size_t len);
+    bool HasMedia(uint16_t seq);
+    void TryRecover(size_t repair_index);
+    void RecoverBySeq(uint16_t seq);
+    bool Recover(FecRepairSlot& repair, uint16_t missing_seq);
+    void ExpireRepairs();
+    uint8_t* GetMediaData(size_t index) { return &media_slab_[index * RTP_PACKET_MAX_SIZE]; }
+
+private:
+    uint32_t media_ssrc_ = 0;
+    FlexFecRecoverSinkI* sink_ = nullptr;
+    Logger* logger_ = nullptr;
+
+private:
+    std::vector<uint8_t> media_slab_;
+    std::vector<FecMediaSlot> media_slots_;
+    std::vector<FecRepairSlot> repair_slots_;
+    size_t repair_pending_ = 0;
+    size_t repair_next_    = 0;
+    uint16_t newest_seq_   = 0;
+    bool has_media_        = false;
+    uint8_t recover_buffer_[RTP_PACKET_BUFFER_SIZE];
+
+private:
+    int64_t fec_count_       = 0;
+    int64_t recovered_count_ = 0;
+};
+
+}
+
+#endif
@@ -0,0 +1,236 @@
+#ifndef RTCP_FEEDBACK_TCC_HPP
+#define RTCP_FEEDBACK_TCC_HPP
+#include "rtcp_fb_pub.hpp"
+#include "rtprtcp_pub.hpp"
+#include "logger.hpp"
+#include <stdint.h>
+#include <stddef.h>
+#include <string>
+#include <cstring>
+#include <sstream>
+#include <stdio.h>
+#include <arpa/inet.h>  // htonl(), htons(), ntohl(), ntohs()
+#include <vector>
+
+namespace cpp_streamer
+{
+/*
+ draft-holmer-rmcat-transport-wide-cc-extensions-01
+        0                   1                   2                   3
+        0 1 2 3 4 5 6 7 8 9 0 1 2 3 4 5 6 7 8 9 0 1 2 3 4 5 6 7 8 9 0 1
+       +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+header |V=2|P|  FMT=15 |   PT=205      |             length            |
+       +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+       |                          sender ssrc                          |
+       +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+       |                           media ssrc                          |
+       +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+       |      base sequence number     |      packet status count      |
+       +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+       |                 reference time                | fb pkt. count |
+       +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+       |          packet chunk         |         packet chunk          |
+       +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+       .                                                               .
+       +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+       |         packet chunk          |  recv delta   |  recv delta   |
+       +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+       .                                                               .
+       +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+       |           recv delta          |  recv delta   | zero padding  |
+       +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+
+run length chunk:
+        0                   1
+        0 1 2 3 4 5 6 7 8 9 0 1 2 3 4 5
+       +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+       |T| S |       Run Length        |
+       +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+status vector chunk:
+       +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+       |T|S|       symbol list         |
+       +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+ reference time is in 64ms, recv delta is in 250us.
+ */
+
+#define TCC_REF_TIME_UNIT_US   64000
+#define TCC_DELTA_UNIT_US      250
+
+typedef enum {
+    TCC_NOT_RECEIVED   = 0,
+    TCC_SMALL_DELTA    = 1,
+    TCC_LARGE_DELTA    = 2,
+    TCC_RESERVED       = 3
+} TCC_STATUS_SYMBOL;
+
+typedef struct
+{
+    uint16_t base_seq;
+    uint16_t status_count;
+    uint8_t  ref_time[3];
+    uint8_t  fb_pkt_count;
+} RtcpTccHeader;
+
+typedef struct
+{
+    uint16_t seq;
+    bool received;
+    int64_t recv_us;//reference time + recv deltas, only valid when received
+} TccPacketResult;
+
+class RtcpFbTcc
+{
+public:
+    RtcpFbTcc()
+    {
+    }
+
+    ~RtcpFbTcc()
+    {
+    }
+
+public:
+    static RtcpFbTcc* Parse(uint8_t* data, size_t len) {
+        if (len < sizeof(RtcpFbCommonHeader) + sizeof(RtcpFbHeader) + sizeof(RtcpTccHeader)) {
+            return nullptr;
+        }
+        if (len > sizeof(RtcpFbTcc::data)) {
+            return nullptr;
+        }
+
+        RtcpFbTcc* pkt = new RtcpFbTcc();
+        if (!pkt->UpdateData(data, len)) {
+            delete pkt;
+            CSM_THROW_ERROR("rtcp feedback tcc len:%lu is malformed", len);
+        }
+        return pkt;
+    }
+
+public:
+    uint32_t GetSenderSsrc() {return (uint32_t)ntohl(tcc_fb_header_->sender_ssrc);}
+    uint32_t GetMediaSsrc() {return (uint32_t)ntohl(tcc_fb_header_->media_ssrc);}
+    uint16_t GetBaseSeq() {return ntohs(tcc_header_->base_seq);}
+    uint16_t GetStatusCount() {return ntohs(tcc_header_->status_count);}
+    int32_t GetReferenceTime() {
+        //24bits signed
+        int32_t ref_time = ((int32_t)tcc_header_->ref_time[0] << 16)
+                         | ((int32_t)tcc_header_->ref_time[1] << 8)
+                         | (int32_t)tcc_header_->ref_time[2];
+        if (ref_time & 0x800000) {
+            ref_time -= 0x1000000;
+        }
+        return ref_time;
+    }
+    uint8_t GetFbPktCount() {return tcc_header_->fb_pkt_count;}
+    uint8_t* GetData() {return this->data;}
+    size_t GetLen() {return this->data_len;}
+
+    const std::vector<TccPacketResult>& GetResults() {return results_;}
+
+    std::string Dump() {
+        std::stringstream ss;
+        size_t recv_count = 0;
+
+        for (auto& result : results_) {
+            if (result.received) {
+                recv_count++;
+            }
+        }
+        ss << "rtcp fb tcc: sender ssrc=" << GetSenderSsrc() << ", media ssrc=" << GetMediaSsrc();
+        ss << ", base seq:" << GetBaseSeq() << ", status count:" << GetStatusCount();
+        ss << ", reference time:" << GetReferenceTime() << ", fb count:" << (int)GetFbPktCount();
+        ss << ", received:" << recv_count << "\r\n";
+
+        return ss.str();
+    }
+
+private:
+    bool UpdateData(uint8_t* data, size_t len) {
+        memcpy(this->data, data, len);
+        this->data_len = len;
+
+        fb_common_header_ = (RtcpFbCommonHeader*)(this->data);
+        tcc_fb_header_    = (RtcpFbHeader*)(fb_common_header_ + 1);
+        tcc_header_       = (RtcpTccHeader*)(tcc_fb_header_ + 1);
+
+        uint8_t* p   = (uint8_t*)(tcc_header_ + 1);
+        uint8_t* end = this->data + this->data_len;
+        uint16_t status_count = GetStatusCount();
+        std::vector<uint8_t> symbols;
+
+        symbols.reserve(status_count);
+
+        //packet chunks
+        while (symbols.size() < status_count) {
+            if (p + 2 > end) {
+                return false;
+            }
+            uint16_t chunk = ((uint16_t)p[0] << 8) | p[1];
+            p += 2;
+
+            size_t left = status_count - symbols.size();
+            if ((chunk & 0x8000) == 0) {
+                uint8_t symbol = (chunk >> 13) & 0x03;
+                size_t run_len = chunk & 0x1fff;
+                for (size_t i = 0; i < run_len && i < left; i++) {
+                    symbols.push_back(symbol);
+                }
+            } else if ((chunk & 0x4000) == 0) {
+                for (size_t i = 0; i < 14 && i < left; i++) {
+                    symbols.push_back((chunk >> (13 - i)) & 0x01);
+                }
+            } else {
+                for (size_t i = 0; i < 7 && i < left; i++) {
+                    symbols.push_back((chunk >> (12 - 2 * i)) & 0x03);
+                }
+            }
+        }
+
+        //recv deltas
+        uint16_t seq    = GetBaseSeq();
+        int64_t recv_us = (int64_t)GetReferenceTime() * TCC_REF_TIME_UNIT_US;
+
+        results_.clear();
+        results_.reserve(status_count);
+        for (uint8_t symbol : symbols) {
+            TccPacketResult result = {
+                .seq      = seq++,
+                .received = false,
+                .recv_us  = 0
+            };
+            if (symbol == TCC_SMALL_DELTA) {
+                if (p + 1 > end) {
+                    return false;
+                }
+                recv_us += (int64_t)p[0] * TCC_DELTA_UNIT_US;
+                p += 1;
+                result.received = true;
+                result.recv_us  = recv_us;
+            } else if (symbol == TCC_LARGE_DELTA) {
+                if (p + 2 > end) {
+                    return false;
+                }
+                int16_t delta = (int16_t)(((uint16_t)p[0] << 8) | p[1]);
+                recv_us += (int64_t)delta * TCC_DELTA_UNIT_US;
+                p += 2;
+                result.received = true;
+                result.recv_us  = recv_us;
+            }
+            results_.push_back(result);
+        }
+        return true;
+    }
+
+public:
+    uint8_t data[RTP_PACKET_MAX_SIZE];
+    size_t  data_len = 0;
+    RtcpFbCommonHeader* fb_common_header_ = nullptr;
+    RtcpFbHeader* tcc_fb_header_          = nullptr;
+    RtcpTccHeader* tcc_header_            = nullptr;
+
+private:
+    std::vector<TccPacketResult> results_;
+};
+
+}
+#endif
@@ -9,7 +9,7 @@ namespace cpp_streamer
 {
 
 inline RtpPacket* MakeRtpPacket(HeaderExtension* ext, size_t payload_len) {
-    uint8_t* data = new uint8_t[RTP_PACKET_MAX_SIZE];
+    uint8_t* data = new uint8_t[RTP_PACKET_BUFFER_SIZE];
     size_t ext_len = 0;
     RtpCommonHeader* header = (RtpCommonHeader*)data;
 
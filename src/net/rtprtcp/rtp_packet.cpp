@@ -11,19 +11,23 @@
 namespace cpp_streamer
 {
 
-RtpPacket* RtpPacket::Parse(uint8_t* data, size_t len) {
+void RtpPacket::ParseLayout(uint8_t* data, size_t len, HeaderExtension*& ext,
+        uint8_t*& payload, size_t& payload_len, uint8_t& pad_len) {
     RtpCommonHeader* header = (RtpCommonHeader*)data;
-    HeaderExtension* ext = nullptr;
     uint8_t* p = (uint8_t*)(header + 1);
 
     if (len > RTP_PACKET_MAX_SIZE) {
         CSM_THROW_ERROR("rtp len(%lu) is to large", len);
     }
+    if (len < sizeof(RtpCommonHeader)) {
+        CSM_THROW_ERROR("rtp len(%lu) is to small", len);
+    }
 
     if (header->csrc_count > 0) {
         p += 4 * header->csrc_count;
     }
 
+    ext = nullptr;
     if (header->extension) {
         if (len < (size_t)(p - data + 4)) {
             CSM_THROW_ERROR("rtp len(%lu) is to small", len);
@@ -39,9 +43,9 @@ RtpPacket* RtpPacket::Parse(uint8_t* data, size_t len) {
     if (len <= (size_t)(p - data)) {
         CSM_THROW_ERROR("rtp len(%lu) is to small, has no payload", len);
     }
-    uint8_t* payload = p;
-    size_t payload_len = len - (size_t)(p - data);
-    uint8_t pad_len = 0;
+    payload     = p;
+    payload_len = len - (size_t)(p - data);
+    pad_len     = 0;
 
     if (header->padding) {
         pad_len = data[len - 1];
@@ -53,15 +57,90 @@ RtpPacket* RtpPacket::Parse(uint8_t* data, size_t len) {
             payload_len -= pad_len;
         }
     }
+}
+
+RtpPacket* RtpPacket::Parse(uint8_t* data, size_t len) {
+    HeaderExtension* ext = nullptr;
+    uint8_t* payload     = nullptr;
+    size_t payload_len   = 0;
+    uint8_t pad_len      = 0;
 
-    RtpPacket* pkt = new RtpPacket(header, ext, payload, payload_len, pad_len, len);
+    ParseLayout(data, len, ext, payload, payload_len, pad_len);
+
+    RtpPacket* pkt = new RtpPacket((RtpCommonHeader*)data, ext, payload, payload_len, pad_len, len);
 
     return pkt;
 }
 
+void RtpPacket::Reset(uint8_t* data, size_t len) {
+    HeaderExtension* ext = nullptr;
+    uint8_t* payload     = nullptr;
+    size_t payload_len   = 0;
+    uint8_t pad_len      = 0;
+
+    if (this->need_delete && this->header) {
+        delete[] (uint8_t*)this->header;
+    }
+    this->header      = nullptr;
+    this->need_delete = false;
+
+    ParseLayout(data, len, ext, payload, payload_len, pad_len);
+    Init((RtpCommonHeader*)data, ext, payload, payload_len, pad_len, len);
+}
+
+uint8_t* RtpPacket::FindOnebyteExtension(uint8_t* data, size_t len, uint8_t id, uint8_t& ext_len) {
+    RtpCommonHeader* header = (RtpCommonHeader*)data;
+    uint8_t* p = (uint8_t*)(header + 1);
+
+    if (len < sizeof(RtpCommonHeader) || !header->extension) {
+        return nullptr;
+    }
+    p += 4 * header->csrc_count;
+    if (len < (size_t)(p - data + 4)) {
+        return nullptr;
+    }
+    HeaderExtension* ext = (HeaderExtension*)p;
+    if (ntohs(ext->id) != 0xBEDE) {
+        return nullptr;
+    }
+    uint8_t* ext_end = p + 4 + ntohs(ext->length) * 4;
+    if (ext_end > data + len) {
+        return nullptr;
+    }
+    p += 4;
+
+    while (p < ext_end) {
+        uint8_t ext_id = (*p & 0xF0) >> 4;
+        uint8_t value_len = (*p & 0x0F) + 1;
+
+        if (ext_id == 0) {//padding
+            p++;
+            continue;
+        }
+        if (ext_id == 0x0f || p + 1 + value_len > ext_end) {
+            break;
+        }
+        if (ext_id == id) {
+            ext_len = value_len;
+            return p + 1;
+        }
+        p += 1 + value_len;
+    }
+    return nullptr;
+}
+
+RtpPacket::RtpPacket() {
+}
+
 RtpPacket::RtpPacket(RtpCommonHeader* header, HeaderExtension* ext,
                 uint8_t* payload, size_t payload_len,
                 uint8_t pad_len, size_t data_len) {
+    Init(header, ext, payload, payload_len, pad_len, data_len);
+}
+
+void RtpPacket::Init(RtpCommonHeader* header, HeaderExtension* ext,
+                uint8_t* payload, size_t payload_len,
+                uint8_t pad_len, size_t data_len) {
     if (data_len > RTP_PACKET_MAX_SIZE) {
         CSM_THROW_ERROR("rtp len(%lu) is to large", data_len);
     }
@@ -75,6 +154,7 @@ RtpPacket::RtpPacket(RtpCommonHeader* header, HeaderExtension* ext,
 
     this->local_ms    = (int64_t)now_millisec();
 
+    this->ext_count_  = 0;
     this->ParseExt();
     this->need_delete = false;
 }
@@ -133,16 +213,17 @@ std::string RtpPacket::Dump() {
         ss << "  padding len:" << media_data[this->data_len - 1] << "\r\n";
     }
 
-    if (this->HasExtension()) {
-        if (!this->onebyte_ext_map_.empty()) {
+    if (this->HasExtension() && (this->ext_count_ > 0)) {
+        if (HasOnebyteExt(this->ext)) {
             ss <<  "  rtp onebyte extension:" << "\r\n";
-            for (auto item : this->onebyte_ext_map_) {
-                OnebyteExtension* item_ext = item.second;
-                ss << "    id:" << (int)item.first << ", length:" << (int)(item_ext->len) << "\r\n";
-                if (item.first == mid_extension_id_) {
+            for (size_t i = 0; i < this->ext_count_; i++) {
+                RtpExtItem& item = this->ext_items_[i];
+                OnebyteExtension* item_ext = (OnebyteExtension*)item.item;
+                ss << "    id:" << (int)item.id << ", length:" << (int)(item_ext->len) << "\r\n";
+                if (item.id == mid_extension_id_) {
                     std::string mid_str((char*)(item_ext->value), (int)item_ext->len + 1);
                     ss << "      mid:" << mid_str << "\r\n";
-                } else if (item.first == abs_time_extension_id_) {
+                } else if (item.id == abs_time_extension_id_) {
                     uint32_t abs_time_24bits = ByteStream::Read3Bytes(item_ext->value);
                     double send_ms = abs_time_to_ms(abs_time_24bits);
                     ss << "      abs time:" << send_ms << "\r\n";
@@ -150,12 +231,13 @@ std::string RtpPacket::Dump() {
             }
         }
 
-        if (!this->twobytes_ext_map_.empty()) {
+        if (HasTwobytesExt(this->ext)) {
             ss << "  rtp twobytes extension:" << "\r\n";
-            for ( auto item : this->twobytes_ext_map_) {
-                TwobytesExtension* item_ext = item.second;
-                ss << "    id:" << (int)item.first << ", length:" << (int)item_ext->len << "\r\n";
-                if (item.first == mid_extension_id_) {
+            for (size_t i = 0; i < this->ext_count_; i++) {
+                RtpExtItem& item = this->ext_items_[i];
+                TwobytesExtension* item_ext = (TwobytesExtension*)item.item;
+                ss << "    id:" << (int)item.id << ", length:" << (int)item_ext->len << "\r\n";
+                if (item.id == mid_extension_id_) {
                     std::string mid_str((char*)(item_ext->value), (int)item_ext->len + 1);
                     ss << "      mid:" << mid_str << "\r\n";
                 }
@@ -189,6 +271,30 @@ uint8_t* RtpPacket::GetExtValue(HeaderExtension* rtp_ext) {
     return rtp_ext->value;
 }
 
+void RtpPacket::AddExtItem(uint8_t id, uint8_t* item) {
+    for (size_t i = 0; i < this->ext_count_; i++) {
+        if (this->ext_items_[i].id == id) {
+            this->ext_items_[i].item = item;
+            return;
+        }
+    }
+    if (this->ext_count_ >= RTP_EXT_ITEM_MAX) {
+        CSM_THROW_ERROR("rtp extension elements are over %d", RTP_EXT_ITEM_MAX);
+    }
+    this->ext_items_[this->ext_count_].id   = id;
+    this->ext_items_[this->ext_count_].item = item;
+    this->ext_count_++;
+}
+
+uint8_t* RtpPacket::FindExtItem(uint8_t id) {
+    for (size_t i = 0; i < this->ext_count_; i++) {
+        if (this->ext_items_[i].id == id) {
+            return this->ext_items_[i].item;
+        }
+    }
+    return nullptr;
+}
+
 void RtpPacket::ParseExt() {
     if ((this->header->extension == 0) || (this->ext == nullptr)) {
         return;
@@ -205,7 +311,7 @@ void RtpPacket::ParseExt() {
 }
 
 void RtpPacket::ParseOnebyteExt() {
-    onebyte_ext_map_.clear();
+    this->ext_count_ = 0;
 
     uint8_t* ext_start = (uint8_t*)(this->ext) + 4;//skip id(16bits) + length(16bits)
     uint8_t* ext_end   = ext_start + GetExtLength(this->ext);
@@ -238,7 +344,7 @@ void RtpPacket::ParseOnebyteExt() {
                 break;
             }
 
-            onebyte_ext_map_[id] = (OnebyteExtension*)p;
+            AddExtItem(id, p);
             p += (1 + len);
         }
         else {
@@ -253,7 +359,7 @@ void RtpPacket::ParseOnebyteExt() {
 }
 
 void RtpPacket::ParseTwobytesExt() {
-    twobytes_ext_map_.clear();
+    this->ext_count_ = 0;
 
     uint8_t* ext_start = (uint8_t*)(this->ext) + 4;//skip id(16bits) + length(16bits)
     uint8_t* ext_end   = ext_start + GetExtLength(this->ext);
@@ -286,8 +392,8 @@ void RtpPacket::ParseTwobytesExt() {
                 break;
             }
 
-            // Store the Two-Bytes extension element in the map.
-            twobytes_ext_map_[id] = (TwobytesExtension*)p;
+            // Store the Two-Bytes extension element.
+            AddExtItem(id, p);
 
             p += (2 + len);
         } else {
@@ -317,20 +423,18 @@ bool RtpPacket::HasTwobytesExt(HeaderExtension* rtp_ext) {
 
 uint8_t* RtpPacket::GetExtension(uint8_t id, uint8_t& len) {
     if (HasOnebyteExt(this->ext)) {
-        auto iter = onebyte_ext_map_.find(id);
-        if (iter == onebyte_ext_map_.end()) {
+        OnebyteExtension* ext_data = (OnebyteExtension*)FindExtItem(id);
+        if (ext_data == nullptr) {
             return nullptr;
         }
 
-        OnebyteExtension* ext_data = iter->second;
         len = ext_data->len + 1;
         return ext_data->value;
     } else if (HasTwobytesExt(this->ext)) {
-        auto iter = twobytes_ext_map_.find(id);
-        if (iter == twobytes_ext_map_.end()) {
+        TwobytesExtension* ext_data = (TwobytesExtension*)FindExtItem(id);
+        if (ext_data == nullptr) {
             return nullptr;
         }
-        TwobytesExtension* ext_data = iter->second;
         len = ext_data->len;
         if (len == 0) {
             return nullptr;
@@ -414,24 +518,22 @@ bool RtpPacket::UpdateExtensionLength(uint8_t id, uint8_t len) {
         return false;
     }
     if (HasOnebyteExt(this->ext)) {
-        auto iter = this->onebyte_ext_map_.find(id);
-        if (iter == this->onebyte_ext_map_.end()) {
-            LogErrorf(logger_, "fail to get id:%d from the onebyte ext map.", id);
+        OnebyteExtension* extension = (OnebyteExtension*)FindExtItem(id);
+        if (extension == nullptr) {
+            LogErrorf(logger_, "fail to get id:%d from the onebyte extensions.", id);
             return false;
         }
-        auto* extension = iter->second;
         uint8_t current_len = extension->len + 1;
         if (len < current_len) {
             memset(extension->value + len, 0, current_len - len);
         }
         extension->len = len - 1;
     } else if (HasTwobytesExt(this->ext)) {
-        auto iter = this->twobytes_ext_map_.find(id);
-        if (iter == this->twobytes_ext_map_.end()) {
-            LogErrorf(logger_, "fail to get id:%d from the twobytes ext map.", id);
+        TwobytesExtension* extension = (TwobytesExtension*)FindExtItem(id);
+        if (extension == nullptr) {
+            LogErrorf(logger_, "fail to get id:%d from the twobytes extensions.", id);
             return false;
         }
-        auto* extension = iter->second;
         uint8_t current_len = extension->len;
         if (len < current_len) {
             memset(extension->value + len, 0, current_len - len);
@@ -12,6 +12,7 @@ namespace cpp_streamer
 class Logger;
 
 #define RTP_SEQ_MOD (1<<16)
+#define RTP_EXT_ITEM_MAX 32 //the extension elements kept in one packet
 
 typedef struct HeaderExtensionS
 {
@@ -55,14 +56,24 @@ typedef struct TwobytesExtensionS {
    |                             ....                              |
  */
 
+typedef struct {
+    uint8_t id;
+    uint8_t* item;//OnebyteExtension or TwobytesExtension
+} RtpExtItem;
+
 class RtpPacket
 {
 public:
+    RtpPacket();
     RtpPacket(RtpCommonHeader* header, HeaderExtension* ext,
             uint8_t* payload, size_t payload_len,
             uint8_t pad_len, size_t data_len);
     ~RtpPacket();
 
+public:
+    //parse the data as a view of it, the data is not owned, throw when it is not rtp
+    void Reset(uint8_t* data, size_t len);
+
 public:
     uint8_t Version() {return this->header->version;}
     bool HasPadding() {return (this->header->padding == 1) ? true : false;}
@@ -119,9 +130,18 @@ public:
 
 public:
     static RtpPacket* Parse(uint8_t* data, size_t len);
+    //find the one byte extension in the raw rtp data without parsing the packet
+    static uint8_t* FindOnebyteExtension(uint8_t* data, size_t len, uint8_t id, uint8_t& ext_len);
     RtpPacket* Clone(uint8_t* buffer = nullptr);
 
 private:
+    static void ParseLayout(uint8_t* data, size_t len, HeaderExtension*& ext,
+            uint8_t*& payload, size_t& payload_len, uint8_t& pad_len);
+    void Init(RtpCommonHeader* header, HeaderExtension* ext,
+            uint8_t* payload, size_t payload_len,
+            uint8_t pad_len, size_t data_len);
+    void AddExtItem(uint8_t id, uint8_t* item);
+    uint8_t* FindExtItem(uint8_t id);
     void ParseExt();
     void ParseOnebyteExt();
     void ParseTwobytesExt();
@@ -150,9 +170,9 @@ private:
     uint8_t mid_extension_id_      = 0;
     uint8_t abs_time_extension_id_ = 0;
 
-private:
-    std::map<uint8_t, OnebyteExtension*>  onebyte_ext_map_;
-    std::map<uint8_t, TwobytesExtension*> twobytes_ext_map_;
+private://the parsed extension elements, no allocation for each packet
+    RtpExtItem ext_items_[RTP_EXT_ITEM_MAX];
+    size_t ext_count_ = 0;
 
 private:
     Logger* logger_ = nullptr;
@@ -0,0 +1,255 @@
+#include "rtp_packetizer.hpp"
+#include "rtp_h264_pack.hpp"
+#include "byte_stream.hpp"
+
+#include <cstring>
+
+namespace cpp_streamer
+{
+
+/*
+ * the fragments of one nalu are in the same size, instead of the full
+ * fragments and a small tail one.
+ */
+static size_t GetFragmentCount(size_t payload_len, size_t max_fragment) {
+    return (payload_len + max_fragment - 1) / max_fragment;
+}
+
+static size_t GetFragmentSize(size_t payload_len, size_t count, size_t index) {
+    size_t size = payload_len / count;
+    if (index < payload_len % count) {
+        size++;
+    }
+    return size;
+}
+
+RtpPacketizer::RtpPacketizer(RtpPacketSinkI* sink):sink_(sink)
+{
+}
+
+RtpPacketizer::~RtpPacketizer()
+{
+}
+
+void RtpPacketizer::SetHeader(uint8_t payload_type, uint32_t ssrc, HeaderExtension* ext) {
+    payload_type_ = payload_type;
+    ssrc_         = ssrc;
+    ext_          = ext;
+}
+
+uint8_t* RtpPacketizer::BeginPacket(uint32_t ts) {
+    packet_data_ = sink_->NewRtpPacket(packet_seq_);
+
+    RtpCommonHeader* header = (RtpCommonHeader*)packet_data_;
+    memset(header, 0, sizeof(RtpCommonHeader));
+    header->version      = RTP_VERSION;
+    header->payload_type = payload_type_;
+    header->sequence     = htons(packet_seq_);
+    header->timestamp    = htonl(ts);
+    header->ssrc         = htonl(ssrc_);
+    header_len_ = sizeof(RtpCommonHeader);
+
+    if (ext_) {
+        size_t ext_len = 4 + 4 * ByteStream::Read2Bytes((uint8_t*)ext_ + 2);
+        header->extension = 1;
+        memcpy(packet_data_ + header_len_, ext_, ext_len);
+        header_len_ += ext_len;
+    }
+    return packet_data_ + header_len_;
+}
+
+void RtpPacketizer::EndPacket(size_t payload_len, bool marker) {
+    RtpCommonHeader* header = (RtpCommonHeader*)packet_data_;
+
+    header->marker = marker ? 1 : 0;
+    sink_->OnRtpPacket(packet_data_, header_len_ + payload_len, packet_seq_);
+    packet_data_ = nullptr;
+}
+
+size_t RtpPacketizer::PacketizeSingle(uint8_t* data, size_t len, uint32_t ts, bool marker) {
+    uint8_t* payload = BeginPacket(ts);
+
+    memcpy(payload, data, len);
+    EndPacket(len, marker);
+    return 1;
+}
+
+RtpH264Packetizer::RtpH264Packetizer(RtpPacketSinkI* sink):RtpPacketizer(sink)
+{
+}
+
+RtpH264Packetizer::~RtpH264Packetizer()
+{
+}
+
+size_t RtpH264Packetizer::Packetize(uint8_t* data, size_t len, uint32_t ts, bool marker) {
+    if (len <= kNalHeaderSize) {
+        return 0;
+    }
+    if (len <= RTP_PAYLOAD_MAX_SIZE) {
+        return PacketizeSingle(data, len, ts, marker);
+    }
+
+    //fu-a: the nalu header is carried by the fu indicator and fu header
+    uint8_t nalu_header  = data[0];
+    uint8_t fu_indicator = (nalu_header & (kFBit | kNriMask)) | NaluType::kFuA;
+    uint8_t* fragment    = data + kNalHeaderSize;
+    size_t payload_left  = len - kNalHeaderSize;
+    size_t count = GetFragmentCount(payload_left, RTP_PAYLOAD_MAX_SIZE - kFuAHeaderSize);
+
+    for (size_t index = 0; index < count; index++) {
+        size_t fragment_size = GetFragmentSize(payload_left, count, index);
+        bool last = (index == count - 1);
+        uint8_t* payload = BeginPacket(ts);
+
+        payload[0] = fu_indicator;
+        payload[1] = (nalu_header & kTypeMask) | (index == 0 ? kSBit : 0) | (last ? kEBit : 0);
+        memcpy(payload + kFuAHeaderSize, fragment, fragment_size);
+        fragment += fragment_size;
+
+        EndPacket(kFuAHeaderSize + fragment_size, last && marker);
+    }
+    return count;
+}
+
+size_t RtpH264Packetizer::PacketizeAggregate(const RtpNaluItem* nalus, size_t count, uint32_t ts) {
+    size_t payload_len = kNalHeaderSize;
+    uint8_t nri = 0;
+
+    if (count == 0) {
+        return 0;
+    }
+    for (size_t index = 0; index < count; index++) {
+        uint8_t nalu_nri = nalus[index].data[0] & kNriMask;
+
+        payload_len += kLengthFieldSize + nalus[index].len;
+        nri = nalu_nri > nri ? nalu_nri : nri;
+    }
+    if (count == 1 || payload_len > RTP_PAYLOAD_MAX_SIZE) {
+        size_t packets = 0;
+        for (size_t index = 0; index < count; index++) {
+            packets += Packetize(nalus[index].data, nalus[index].len, ts, false);
+        }
+        return packets;
+    }
+
+    //stap-a: the nri is the max one of the nalus
+    uint8_t* payload = BeginPacket(ts);
+    size_t pos = kNalHeaderSize;
+
+    payload[0] = nri | NaluType::kStapA;
+    for (size_t index = 0; index < count; index++) {
+        ByteStream::Write2Bytes(payload + pos, (uint16_t)nalus[index].len);
+        pos += kLengthFieldSize;
+        memcpy(payload + pos, nalus[index].data, nalus[index].len);
+        pos += nalus[index].len;
+    }
+    EndPacket(pos, false);
+    return 1;
+}
+
+RtpH265Packetizer::RtpH265Packetizer(RtpPacketSinkI* sink):RtpPacketizer(sink)
+{
+}
+
+RtpH265Packetizer::~RtpH265Packetizer()
+{
+}
+
+/*
+ * the payload header of fu and ap is the nalu header with the type replaced:
+ *  F(1) | Type(6) | LayerId(6) | TID(3)
+ * fu header:
+ *  S(1) | E(1) | FuType(6)
+ */
+size_t RtpH265Packetizer::Packetize(uint8_t* data, size_t len, uint32_t ts, bool marker) {
+    if (len <= kH265NalHeaderSize) {
+        return 0;
+    }
+    if (len <= RTP_PAYLOAD_MAX_SIZE) {
+        return PacketizeSingle(data, len, ts, marker);
+    }
+
+    uint8_t nalu_type   = (data[0] >> 1) & 0x3f;
+    uint8_t header0     = (data[0] & 0x81) | (kH265FuType << 1);
+    uint8_t header1     = data[1];
+    uint8_t* fragment   = data + kH265NalHeaderSize;
+    size_t payload_left = len - kH265NalHeaderSize;
+    size_t count = GetFragmentCount(payload_left,
+            RTP_PAYLOAD_MAX_SIZE - kH265NalHeaderSize - kH265FuHeaderSize);
+
+    for (size_t index = 0; index < count; index++) {
+        size_t fragment_size = GetFragmentSize(payload_left, count, index);
+        bool last = (index == count - 1);
+        uint8_t* payload = BeginPacket(ts);
+
+        payload[0] = header0;
+        payload[1] = header1;
+        payload[2] = nalu_type | (index == 0 ? kSBit : 0) | (last ? kEBit : 0);
+        memcpy(payload + kH265NalHeaderSize + kH265FuHeaderSize, fragment, fragment_size);
+        fragment += fragment_size;
+
+        EndPacket(kH265NalHeaderSize + kH265FuHeaderSize + fragment_size, last && marker);
+    }
+    return count;
+}
+
+size_t RtpH265Packetizer::PacketizeAggregate(const RtpNaluItem* nalus, size_t count, uint32_t ts) {
+    size_t payload_len = kH265NalHeaderSize;
+    uint8_t forbidden  = 0;
+    uint8_t layer_id   = 0x3f;
+    uint8_t tid        = 0x07;
+
+    if (count == 0) {
+        return 0;
+    }
+    for (size_t index = 0; index < count; index++) {
+        uint8_t* p = nalus[index].data;
+        uint8_t nalu_layer_id = ((p[0] & 0x01) << 5) | (p[1] >> 3);
+        uint8_t nalu_tid      = p[1] & 0x07;
+
+        payload_len += kLengthFieldSize + nalus[index].len;
+        forbidden |= p[0] & 0x80;
+        layer_id = nalu_layer_id < layer_id ? nalu_layer_id : layer_id;
+        tid      = nalu_tid < tid ? nalu_tid : tid;
+    }
+    if (count == 1 || payload_len > RTP_PAYLOAD_MAX_SIZE) {
+        size_t packets = 0;
+        for (size_t index = 0; index < count; index++) {
+            packets += Packetize(nalus[index].data, nalus[index].len, ts, false);
+        }
+        return packets;
+    }
+
+    //ap: the layer id and the tid are the lowest ones of the nalus
+    uint8_t* payload = BeginPacket(ts);
+    size_t pos = kH265NalHeaderSize;
+
+    payload[0] = forbidden | (kH265ApType << 1) | (layer_id >> 5);
+    payload[1] = (uint8_t)((layer_id << 3) | tid);
+    for (size_t index = 0; index < count; index++) {
+        ByteStream::Write2Bytes(payload + pos, (uint16_t)nalus[index].len);
+        pos += kLengthFieldSize;
+        memcpy(payload + pos, nalus[index].data, nalus[index].len);
+        pos += nalus[index].len;
+    }
+    EndPacket(pos, false);
+    return 1;
+}
+
+RtpOpusPacketizer::RtpOpusPacketizer(RtpPacketSinkI* sink):RtpPacketizer(sink)
+{
+}
+
+RtpOpusPacketizer::~RtpOpusPacketizer()
+{
+}
+
+size_t RtpOpusPacketizer::Packetize(uint8_t* data, size_t len, uint32_t ts, bool marker) {
+    if (len == 0 || len > RTP_PAYLOAD_MAX_SIZE) {
+        return 0;
+    }
+    return PacketizeSingle(data, len, ts, marker);
+}
+
+}
@@ -0,0 +1,105 @@
+#ifndef RTP_PACKETIZER_HPP
+#define RTP_PACKETIZER_HPP
+#include "net/rtprtcp/rtprtcp_pub.hpp"
+#include "net/rtprtcp/rtp_packet.hpp"
+
+#include <stdint.h>
+#include <stddef.h>
+
+namespace cpp_streamer
+{
+
+#define kH265NalHeaderSize 2
+#define kH265FuHeaderSize  1
+#define kH265ApType        48
+#define kH265FuType        49
+
+/*
+ * the sink gives the buffer of each rtp packet before it is written,
+ * eg. the send history slot of the seq, so the header, the extensions
+ * and the payload are written once without the temporary packets.
+ */
+class RtpPacketSinkI
+{
+public:
+    //returns the buffer of RTP_PACKET_MAX_SIZE bytes at least, and the seq of the packet
+    virtual uint8_t* NewRtpPacket(uint16_t& seq) = 0;
+    virtual void OnRtpPacket(uint8_t* data, size_t len, uint16_t seq) = 0;
+};
+
+typedef struct {
+    uint8_t* data;
+    size_t len;
+} RtpNaluItem;
+
+class RtpPacketizer
+{
+public:
+    RtpPacketizer(RtpPacketSinkI* sink);
+    virtual ~RtpPacketizer();
+
+public:
+    void SetHeader(uint8_t payload_type, uint32_t ssrc, HeaderExtension* ext);
+
+    //one nalu without the start code or one audio frame, returns the packet count
+    virtual size_t Packetize(uint8_t* data, size_t len, uint32_t ts, bool marker) = 0;
+
+    //the small nalus in one packet, eg. vps/sps/pps before the keyframe
+    virtual size_t PacketizeAggregate(const RtpNaluItem* nalus, size_t count, uint32_t ts) { return 0; }
+
+protected:
+    //writes the rtp header and extensions, returns the payload position
+    uint8_t* BeginPacket(uint32_t ts);
+    void EndPacket(size_t payload_len, bool marker);
+    size_t PacketizeSingle(uint8_t* data, size_t len, uint32_t ts, bool marker);
+
+protected:
+    RtpPacketSinkI* sink_ = nullptr;
+    uint8_t payload_type_ = 0;
+    uint32_t ssrc_        = 0;
+    HeaderExtension* ext_ = nullptr;
+
+private:
+    uint8_t* packet_data_ = nullptr;
+    size_t header_len_    = 0;
+    uint16_t packet_seq_  = 0;
+};
+
+//rfc6184: single nalu, stap-a and fu-a
+class RtpH264Packetizer : public RtpPacketizer
+{
+public:
+    RtpH264Packetizer(RtpPacketSinkI* sink);
+    virtual ~RtpH264Packetizer();
+
+public:
+    virtual size_t Packetize(uint8_t* data, size_t len, uint32_t ts, bool marker) override;
+    virtual size_t PacketizeAggregate(const RtpNaluItem* nalus, size_t count, uint32_t ts) override;
+};
+
+//rfc7798: single nalu, aggregation packet and fragmentation unit with the 2 bytes nalu header
+class RtpH265Packetizer : public RtpPacketizer
+{
+public:
+    RtpH265Packetizer(RtpPacketSinkI* sink);
+    virtual ~RtpH265Packetizer();
+
+public:
+    virtual size_t Packetize(uint8_t* data, size_t len, uint32_t ts, bool marker) override;
+    virtual size_t PacketizeAggregate(const RtpNaluItem* nalus, size_t count, uint32_t ts) override;
+};
+
+//rfc7587: one opus frame in one packet
+class RtpOpusPacketizer : public RtpPacketizer
+{
+public:
+    RtpOpusPacketizer(RtpPacketSinkI* sink);
+    virtual ~RtpOpusPacketizer();
+
+public:
+    virtual size_t Packetize(uint8_t* data, size_t len, uint32_t ts, bool marker) override;
+};
+
+}
+
+#endif
@@ -13,6 +13,8 @@ namespace cpp_streamer
 
 #define RTP_PACKET_MAX_SIZE 1500
 #define RTP_PAYLOAD_MAX_SIZE 1200
+#define RTP_PACKET_TAIL_ROOM 144 //the srtp trailer is protected in place: SRTP_MAX_TRAILER_LEN
+#define RTP_PACKET_BUFFER_SIZE (RTP_PACKET_MAX_SIZE + RTP_PACKET_TAIL_ROOM)
 
 #define SEQUENCE_MAX 65535
 
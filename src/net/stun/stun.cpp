@@ -302,6 +302,11 @@ int StunPacket::Serialize() {
     if (has_use_candidate_) {
         data_len_ += 4;
     }
+    //only ipv4 is written
+    bool has_xor_address = xor_address_ && (xor_address_->sa_family == AF_INET);
+    if (has_xor_address) {
+        data_len_ += 4 + 8;
+    }
     if (add_msg_integrity_) {
         data_len_ += 4 + 20;
     }
@@ -311,7 +316,9 @@ int StunPacket::Serialize() {
     
     uint8_t* p = data_;
 
-    uint16_t type_field = (uint16_t)STUN_METHOD_ENUM::BINDING;
+    //the class bits C1 and C0 are the 8th and 4th bits of the message type
+    uint16_t type_field = (uint16_t)stun_method_;
+    type_field |= (((uint16_t)stun_class_ & 0x02) << 7) | (((uint16_t)stun_class_ & 0x01) << 4);
 
     ByteStream::Write2Bytes(p, type_field);
     p += 2;
@@ -351,6 +358,23 @@ int StunPacket::Serialize() {
         p += 2;
     }
 
+    if (has_xor_address) {
+        struct sockaddr_in* addr = (struct sockaddr_in*)xor_address_;
+        uint16_t port = ntohs(addr->sin_port);
+        uint32_t ip   = ntohl(addr->sin_addr.s_addr);
+
+        ByteStream::Write2Bytes(p, (uint16_t)STUN_XOR_MAPPED_ADDRESS);
+        p += 2;
+        ByteStream::Write2Bytes(p, 8);
+        p += 2;
+        ByteStream::Write2Bytes(p, 0x0001);//ipv4 family
+        p += 2;
+        ByteStream::Write2Bytes(p, port ^ (uint16_t)(ByteStream::Read4Bytes(StunPacket::magic_cookie) >> 16));
+        p += 2;
+        ByteStream::Write4Bytes(p, ip ^ ByteStream::Read4Bytes(StunPacket::magic_cookie));
+        p += 4;
+    }
+
     if (add_msg_integrity_) {
         size_t pos = p - data_;
 
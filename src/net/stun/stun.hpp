@@ -75,8 +75,8 @@ public:
     static const uint8_t magic_cookie[];
 
 public:
-    STUN_CLASS_ENUM  stun_class_;
-    STUN_METHOD_ENUM stun_method_;
+    STUN_CLASS_ENUM  stun_class_  = STUN_REQUEST;
+    STUN_METHOD_ENUM stun_method_ = BINDING;
     uint8_t transaction_id_[12];
     const uint8_t* message_integrity_ = nullptr;
 
@@ -111,6 +111,8 @@ snprintf(username, sizeof(username), "%s:%s",
       dtls->remote_fragment_, rtc->local_fragment_);
 2) add_msg_integrity_, dtls->remote_pwd_ for password_;
 ByteCrypto::GetHmacSha1(password_,...
+the binding success response sets stun_class_, the transaction id of the request,
+xor_address_ of the request source and the local ice pwd for password_.
 */
     int Serialize();
     std::string Dump();
@@ -0,0 +1,281 @@
+#ifndef DNS_RESOLVER_HPP
+#define DNS_RESOLVER_HPP
+#include "logger.hpp"
+#include "timeex.hpp"
+#include <uv.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <netdb.h>
+#include <string>
+#include <map>
+#include <vector>
+#include <mutex>
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+namespace cpp_streamer
+{
+//getaddrinfo does not expose the record ttl, the answers are kept for a fixed time
+#define DNS_CACHE_TTL_MS      (60*1000)
+#define DNS_NEGATIVE_TTL_MS   (5*1000)
+#define DNS_CACHE_MAX         1024
+
+inline void OnUvDnsResolved(uv_getaddrinfo_t* req, int status, struct addrinfo* res);
+
+class DnsResolveCallbackI
+{
+public:
+    //addr is ipv4 without the port, it is nullptr when ret_code < 0
+    virtual void OnResolve(int ret_code, const struct sockaddr_in* addr) = 0;
+};
+
+class DnsResolver;
+
+typedef struct {
+    uv_getaddrinfo_t req;
+    DnsResolver* resolver;
+    std::string host;
+    std::vector<DnsResolveCallbackI*> waiters;
+} DnsQuery;
+
+typedef struct {
+    int ret_code;
+    struct sockaddr_in addr;
+    int64_t expire_ms;
+} DnsCacheItem;
+
+/*
+ * async dns resolver, one per uv loop:
+ * the answers are cached for the process, every loop looks up the same cache,
+ * a miss starts uv_getaddrinfo on the libuv thread pool, the sessions asking for
+ * the same host on the loop meanwhile wait for the same query instead of starting their own.
+ * the callbacks are called on the loop thread.
+ */
+class DnsResolver
+{
+friend void OnUvDnsResolved(uv_getaddrinfo_t* req, int status, struct addrinfo* res);
+
+public:
+    static DnsResolver* Attach(uv_loop_t* loop, Logger* logger = nullptr) {
+        std::lock_guard<std::mutex> lock(GetMutex());
+        std::map<uv_loop_t*, DnsResolver*>& resolvers = GetResolvers();
+
+        DnsResolver* resolver = nullptr;
+        auto iter = resolvers.find(loop);
+        if (iter == resolvers.end()) {
+            resolver = new DnsResolver(loop, logger);
+            resolvers[loop] = resolver;
+        } else {
+            resolver = iter->second;
+        }
+        resolver->ref_count_++;
+        return resolver;
+    }
+
+    //the resolver is released when the queries in flight are done
+    static void Detach(DnsResolver* resolver) {
+        std::lock_guard<std::mutex> lock(GetMutex());
+
+        if (--resolver->ref_count_ > 0) {
+            return;
+        }
+        GetResolvers().erase(resolver->loop_);
+        resolver->detached_ = true;
+        if (resolver->queries_.empty() && !resolver->firing_) {
+            delete resolver;
+        }
+    }
+
+    //the answer in the cache: return true and ret_code/addr are set
+    static bool Lookup(const std::string& host, int& ret_code, struct sockaddr_in* addr) {
+        std::lock_guard<std::mutex> lock(GetCacheMutex());
+        std::map<std::string, DnsCacheItem>& cache = GetCache();
+
+        auto iter = cache.find(host);
+        if (iter == cache.end()) {
+            return false;
+        }
+        if (iter->second.expire_ms <= now_millisec()) {
+            cache.erase(iter);
+            return false;
+        }
+        ret_code = iter->second.ret_code;
+        memcpy(addr, &iter->second.addr, sizeof(struct sockaddr_in));
+        return true;
+    }
+
+    static void ClearCache() {
+        std::lock_guard<std::mutex> lock(GetCacheMutex());
+        GetCache().clear();
+    }
+
+public:
+    int Resolve(const std::string& host, DnsResolveCallbackI* cb) {
+        auto iter = queries_.find(host);
+        if (iter != queries_.end()) {
+            iter->second->waiters.push_back(cb);
+            LogDebugf(logger_, "dns resolve host:%s joins the query in flight, waiters:%lu",
+                    host.c_str(), iter->second->waiters.size());
+            return 0;
+        }
+        DnsQuery* query = new DnsQuery;
+        struct addrinfo hints;
+
+        memset(&hints, 0, sizeof(hints));
+        hints.ai_family   = AF_INET;
+        hints.ai_socktype = SOCK_STREAM;
+
+        query->resolver = this;
+        query->host     = host;
+        query->waiters.push_back(cb);
+        query->req.data = query;
+
+        int ret = uv_getaddrinfo(loop_, &query->req, OnUvDnsResolved, host.c_str(), nullptr, &hints);
+        if (ret != 0) {
+            LogErrorf(logger_, "uv_getaddrinfo host:%s error:%s", host.c_str(), uv_strerror(ret));
+            delete query;
+            return ret;
+        }
+        queries_[host] = query;
+        LogInfof(logger_, "dns resolve host:%s", host.c_str());
+        return 0;
+    }
+
+    //the callback is never called after Cancel
+    void Cancel(DnsResolveCallbackI* cb) {
+        for (auto& item : queries_) {
+            for (auto& waiter : item.second->waiters) {
+                if (waiter == cb) {
+                    waiter = nullptr;
+                }
+            }
+        }
+        if (firing_) {
+            for (auto& waiter : *firing_) {
+                if (waiter == cb) {
+                    waiter = nullptr;
+                }
+            }
+        }
+    }
+
+    size_t GetQueryCount() { return queries_.size(); }
+
+private:
+    DnsResolver(uv_loop_t* loop, Logger* logger):loop_(loop)
+                                                , logger_(logger)
+    {
+    }
+
+    ~DnsResolver()
+    {
+    }
+
+    static std::mutex& GetMutex() {
+        static std::mutex s_mutex;
+        return s_mutex;
+    }
+
+    static std::map<uv_loop_t*, DnsResolver*>& GetResolvers() {
+        static std::map<uv_loop_t*, DnsResolver*> s_resolvers;
+        return s_resolvers;
+    }
+
+    static std::mutex& GetCacheMutex() {
+        static std::mutex s_mutex;
+        return s_mutex;
+    }
+
+    static std::map<std::string, DnsCacheItem>& GetCache() {
+        static std::map<std::string, DnsCacheItem> s_cache;
+        return s_cache;
+    }
+
+    static void Store(const std::string& host, int ret_code, const struct sockaddr_in* addr) {
+        std::lock_guard<std::mutex> lock(GetCacheMutex());
+        std::map<std::string, DnsCacheItem>& cache = GetCache();
+        int64_t now_ms = now_millisec();
+
+        if (cache.size() >= DNS_CACHE_MAX) {
+            for (auto iter = cache.begin(); iter != cache.end(); ) {
+                if (iter->second.expire_ms <= now_ms) {
+                    iter = cache.erase(iter);
+                } else {
+                    iter++;
+                }
+            }
+            if (cache.size() >= DNS_CACHE_MAX) {
+                cache.clear();
+            }
+        }
+        DnsCacheItem& item = cache[host];
+
+        item.ret_code = ret_code;
+        memset(&item.addr, 0, sizeof(item.addr));
+        if (addr) {
+            memcpy(&item.addr, addr, sizeof(item.addr));
+        }
+        item.expire_ms = now_ms + (ret_code < 0 ? DNS_NEGATIVE_TTL_MS : DNS_CACHE_TTL_MS);
+    }
+
+    void OnResolved(DnsQuery* query, int status, struct addrinfo* res) {
+        struct sockaddr_in addr;
+        int ret_code = status;
+
+        memset(&addr, 0, sizeof(addr));
+        if (status == 0) {
+            if (res && res->ai_family == AF_INET && res->ai_addrlen == sizeof(addr)) {
+                memcpy(&addr, res->ai_addr, sizeof(addr));
+                addr.sin_port = 0;
+            } else {
+                ret_code = UV_EAI_ADDRFAMILY;
+            }
+        }
+        if (res) {
+            uv_freeaddrinfo(res);
+        }
+        if (ret_code != UV_ECANCELED) {
+            Store(query->host, ret_code, &addr);
+        }
+        if (ret_code < 0) {
+            LogErrorf(logger_, "dns resolve host:%s error:%s", query->host.c_str(), uv_strerror(ret_code));
+        }
+
+        std::vector<DnsResolveCallbackI*> waiters;
+        waiters.swap(query->waiters);
+        queries_.erase(query->host);
+        delete query;
+
+        firing_ = &waiters;
+        for (size_t i = 0; i < waiters.size(); i++) {
+            if (waiters[i]) {
+                waiters[i]->OnResolve(ret_code, (ret_code < 0) ? nullptr : &addr);
+            }
+        }
+        firing_ = nullptr;
+
+        std::lock_guard<std::mutex> lock(GetMutex());
+        if (detached_ && queries_.empty()) {
+            delete this;
+        }
+    }
+
+private:
+    uv_loop_t* loop_ = nullptr;
+    Logger* logger_  = nullptr;
+    int ref_count_   = 0;
+    bool detached_   = false;
+    std::map<std::string, DnsQuery*> queries_;
+    std::vector<DnsResolveCallbackI*>* firing_ = nullptr;
+};
+
+inline void OnUvDnsResolved(uv_getaddrinfo_t* req, int status, struct addrinfo* res) {
+    DnsQuery* query = (DnsQuery*)req->data;
+
+    query->resolver->OnResolved(query, status, res);
+}
+
+}
+
+#endif
@@ -5,6 +5,8 @@
 
 #include <openssl/ssl.h>
 #include <string>
+#include <map>
+#include <mutex>
 #include <stdint.h>
 
 namespace cpp_streamer
@@ -15,6 +17,12 @@ inline int on_verify_callback(int preverify_ok, X509_STORE_CTX *ctx)
     return 1;
 }
 
+/*
+ * tls client on memory bios.
+ * the SSL_CTX is shared by the process, the sessions are cached by the session key(host:port),
+ * the next connection to the same server offers the cached session and the server can
+ * resume it by the abbreviated handshake(one round trip, no key exchange).
+ */
 class SslClient
 {
 public:
@@ -27,8 +35,13 @@ public:
     }
     ~SslClient()
     {
+        if (ssl_) {
+            //the bios are released with ssl
+            SSL_free(ssl_);
+            ssl_ = nullptr;
+        }
         if (plaintext_data_) {
-            delete[] plaintext_data_;
+            free(plaintext_data_);
             plaintext_data_ = nullptr;
         }
     }
@@ -38,15 +51,19 @@ public:
         return state_;
     }
 
+    //the key of the session cache, empty disables the resumption
+    void SetSessionKey(const std::string& key) {
+        session_key_ = key;
+    }
+
+    bool IsSessionReused() {
+        return ssl_ && SSL_session_reused(ssl_);
+    }
+
     int ClientHello() {
-#if (OPENSSL_VERSION_NUMBER < 0x10002000L) // v1.0.2
-        ssl_ctx_ = SSL_CTX_new(TLS_method());
-#else
-        ssl_ctx_ = SSL_CTX_new(TLSv1_2_method());
-#endif
-        SSL_CTX_set_verify(ssl_ctx_, SSL_VERIFY_PEER, on_verify_callback);
-        if (SSL_CTX_set_cipher_list(ssl_ctx_, "ALL") != 1) {
-            LogErrorf(logger_, "SSL_CTX_set_cipher_list set all error");
+        ssl_ctx_ = GetSslCtx();
+        if (!ssl_ctx_) {
+            LogErrorf(logger_, "ssl client context error");
             return -1;
         }
 
@@ -70,6 +87,7 @@ public:
 
         SSL_set_connect_state(ssl_);
         SSL_set_mode(ssl_, SSL_MODE_ENABLE_PARTIAL_WRITE);
+        LoadSession();
 
         // Send ClientHello.
         int r0 = SSL_do_handshake(ssl_); int r1 = SSL_get_error(ssl_, r0);
@@ -108,7 +126,12 @@ public:
             return -1;
         }
 
-        if ((r0 = SSL_do_handshake(ssl_)) != -1 || (r1 = SSL_get_error(ssl_, r0)) != SSL_ERROR_WANT_READ) {
+        r0 = SSL_do_handshake(ssl_);
+        if (r0 == 1) {
+            //the session is resumed: ServerHello, ChangeCipherSpec and Finished are received
+            return ResumeDone();
+        }
+        if (r0 != -1 || (r1 = SSL_get_error(ssl_, r0)) != SSL_ERROR_WANT_READ) {
             LogErrorf(logger_, "handshake r0=%d, r1=%d", r0, r1);
             return -1;
         }
@@ -153,6 +176,7 @@ public:
         if (r0 == 1 && r1 == SSL_ERROR_NONE) {
             LogInfof(logger_, "Ssl client final done");
             state_ = TLS_CLIENT_READY;
+            SaveSession();
             return 0;
         }
 
@@ -241,6 +265,95 @@ public:
     }
 
 
+private:
+    static SSL_CTX* GetSslCtx() {
+        static std::mutex s_mutex;
+        static SSL_CTX* s_ctx = nullptr;
+        std::lock_guard<std::mutex> lock(s_mutex);
+
+        if (s_ctx) {
+            return s_ctx;
+        }
+#if (OPENSSL_VERSION_NUMBER < 0x10002000L) // v1.0.2
+        s_ctx = SSL_CTX_new(TLS_method());
+#else
+        s_ctx = SSL_CTX_new(TLSv1_2_method());
+#endif
+        if (!s_ctx) {
+            return nullptr;
+        }
+        SSL_CTX_set_verify(s_ctx, SSL_VERIFY_PEER, on_verify_callback);
+        if (SSL_CTX_set_cipher_list(s_ctx, "ALL") != 1) {
+            SSL_CTX_free(s_ctx);
+            s_ctx = nullptr;
+            return nullptr;
+        }
+        return s_ctx;
+    }
+
+    static std::mutex& GetSessionMutex() {
+        static std::mutex s_mutex;
+        return s_mutex;
+    }
+
+    static std::map<std::string, SSL_SESSION*>& GetSessions() {
+        static std::map<std::string, SSL_SESSION*> s_sessions;
+        return s_sessions;
+    }
+
+    void LoadSession() {
+        if (session_key_.empty()) {
+            return;
+        }
+        std::lock_guard<std::mutex> lock(GetSessionMutex());
+        std::map<std::string, SSL_SESSION*>& sessions = GetSessions();
+
+        auto iter = sessions.find(session_key_);
+        if (iter == sessions.end()) {
+            return;
+        }
+        if (SSL_set_session(ssl_, iter->second) != 1) {
+            LogWarnf(logger_, "ssl set session error, key:%s", session_key_.c_str());
+        }
+    }
+
+    void SaveSession() {
+        if (session_key_.empty()) {
+            return;
+        }
+        SSL_SESSION* session = SSL_get1_session(ssl_);
+        if (!session) {
+            return;
+        }
+        std::lock_guard<std::mutex> lock(GetSessionMutex());
+        std::map<std::string, SSL_SESSION*>& sessions = GetSessions();
+
+        auto iter = sessions.find(session_key_);
+        if (iter != sessions.end()) {
+            SSL_SESSION_free(iter->second);
+        }
+        sessions[session_key_] = session;
+    }
+
+    int ResumeDone() {
+        int r0 = 0;
+        char* data = nullptr;
+        ssize_t size = 0;
+
+        //ChangeCipherSpec and Finished
+        if ((size = BIO_get_mem_data(bio_out_, &data)) > 0) {
+            cb_->PlaintextDataSend(data, size);
+        }
+        if ((r0 = BIO_reset(bio_out_)) != 1) {
+            LogErrorf(logger_, "BIO_reset r0=%d", r0);
+            return -1;
+        }
+        state_ = TLS_CLIENT_READY;
+        SaveSession();
+        LogInfof(logger_, "ssl client session is resumed, key:%s", session_key_.c_str());
+        return 0;
+    }
+
 private:
     SslCallbackI* cb_ = nullptr;
     SSL_CTX* ssl_ctx_ = nullptr;
@@ -248,6 +361,7 @@ private:
     BIO* bio_in_      = nullptr;
     BIO* bio_out_     = nullptr;
     TLS_CLIENT_STATE state_ = TLS_SSL_CLIENT_ZERO;
+    std::string session_key_;
 
 private:
     uint8_t* plaintext_data_    = nullptr;
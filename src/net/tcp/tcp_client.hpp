@@ -2,8 +2,11 @@
 #define TCP_CLIENT_H
 #include "logger.hpp"
 #include "tcp_pub.hpp"
+#include "tcp_write_queue.hpp"
+#include "dns_resolver.hpp"
 #include "ssl_client.hpp"
 #include "ipaddress.hpp"
+#include "timeex.hpp"
 
 #include <uv.h>
 #include <memory>
@@ -17,19 +20,23 @@ namespace cpp_streamer
 {
 
 inline void OnUVClientConnected(uv_connect_t *conn, int status);
-inline void OnUVClientWrite(uv_write_t* req, int status);
 inline void OnUVClientAlloc(uv_handle_t* handle,
                     size_t suggested_size,
                     uv_buf_t* buf);
 inline void OnUVClientRead(uv_stream_t* handle,
                     ssize_t nread,
                     const uv_buf_t* buf);
-inline void OnUVClose(uv_handle_t *handle) {}
+inline void OnUVClientClose(uv_handle_t *handle) {
+    //the connect request is released with the handle, a pending connect is canceled before
+    if (handle->data) {
+        free(handle->data);
+    }
+    free(handle);
+}
 
-class TcpClient : public SslCallbackI
+class TcpClient : public SslCallbackI, public TcpWriteQueueCallbackI, public DnsResolveCallbackI
 {
 friend void OnUVClientConnected(uv_connect_t *conn, int status);
-friend void OnUVClientWrite(uv_write_t* req, int status);
 friend void OnUVClientAlloc(uv_handle_t* handle,
                     size_t suggested_size,
                     uv_buf_t* buf);
@@ -40,14 +47,18 @@ public:
     TcpClient(uv_loop_t* loop,
         TcpClientCallback* callback,
         Logger* logger = nullptr,
-        bool ssl_enable = false) : callback_(callback)
+        bool ssl_enable = false) : loop_(loop)
+                                   , callback_(callback)
                                    , ssl_enable_(ssl_enable)
+                                   , write_queue_(loop, this, logger)
                                    , logger_(logger)
     {   
         client_  = (uv_tcp_t*)malloc(sizeof(uv_tcp_t));
         connect_ = (uv_connect_t*)malloc(sizeof(uv_connect_t));
 
         uv_tcp_init(loop, client_);
+        client_->data = this;
+        write_queue_.SetStream(reinterpret_cast<uv_stream_t*>(client_));
 
         buffer_ = (char*)malloc(buffer_size_);
         if (ssl_enable) {
@@ -56,7 +67,13 @@ public:
     }
 
     virtual ~TcpClient() {
+        if (resolver_) {
+            resolver_->Cancel(this);
+            DnsResolver::Detach(resolver_);
+            resolver_ = nullptr;
+        }
         Close();
+        write_queue_.Close();
         if (buffer_) {
             free(buffer_);
             buffer_ = nullptr;
@@ -65,33 +82,22 @@ public:
             delete ssl_client_;
             ssl_client_ = nullptr;
         }
-        if (connect_) {
-            uv_read_stop(connect_->handle);
-            free(connect_);
-            connect_ = nullptr;
-        }
         if (client_) {
-            uv_tcp_close_reset(client_, OnUVClose);
-            free(client_);
-            client_ = nullptr;
+            uv_read_stop(reinterpret_cast<uv_stream_t*>(client_));
+            connect_->data = nullptr;
+            client_->data  = connect_;
+            if (uv_tcp_close_reset(client_, OnUVClientClose) != 0) {
+                //not connected
+                uv_close(reinterpret_cast<uv_handle_t*>(client_), OnUVClientClose);
+            }
+            client_  = nullptr;
+            connect_ = nullptr;
         }
     }
 
 public:
     virtual void PlaintextDataSend(const char* data, size_t len) {
-        char* new_data = (char*)malloc(len);
-        memcpy(new_data, data, len);
-
-        write_req_t *req = (write_req_t*) malloc(sizeof(write_req_t));
-        req->buf = uv_buf_init(new_data, len);
-
-        connect_->handle->data = this;
-        if (uv_write((uv_write_t*)req, connect_->handle, &req->buf, 1, OnUVClientWrite)) {
-            free(new_data);
-            throw CppStreamException("PlaintextDataSend uv_write error");
-        }
-        return;
- 
+        write_queue_.Write(data, len);
     }
 
     virtual void PlaintextDataRecv(const char* data, size_t len) {
@@ -99,44 +105,39 @@ public:
     }
 
 public:
+    //the host name is resolved asynchronously, a failure after Connect returns
+    //is reported by OnConnect
     void Connect(const std::string& host, uint16_t dst_port) {
-        int r = 0;
-        char port_sz[80];
-        std::string dst_ip;
-
-        if (!IsIPv4(host)) {
-            snprintf(port_sz, sizeof(port_sz), "%d", dst_port);
-            addrinfo hints;
-            memset(&hints, 0, sizeof(hints));
-            hints.ai_family = AF_UNSPEC;
-            hints.ai_socktype = SOCK_STREAM;
-
-            addrinfo* ai  = NULL;
-            LogInfof(logger_, "getaddrinfo host:%s, port:%s, ssl:%s", 
-                    host.c_str(), port_sz, ssl_enable_ ? "true" : "false");
-            if(getaddrinfo(host.c_str(), port_sz, (const addrinfo*)&hints, &ai)) {
-                throw CppStreamException("get address info error");
-            }
-            assert(sizeof(dst_addr_) == ai->ai_addrlen);
+        connect_start_ms_ = now_millisec();
+        dns_ms_     = 0;
+        connect_ms_ = 0;
+        dst_port_   = dst_port;
+        if (ssl_client_) {
+            ssl_client_->SetSessionKey(host + ":" + std::to_string(dst_port));
+        }
 
-            memcpy((void*)&dst_addr_, ai->ai_addr, sizeof(dst_addr_));
-            dst_ip = GetIpStr(ai->ai_addr, dst_port);
-            freeaddrinfo(ai);
-        } else {
+        if (IsIPv4(host)) {
             GetIpv4Sockaddr(host, htons(dst_port), (struct sockaddr*)&dst_addr_);
-            dst_ip = GetIpStr((sockaddr*)&dst_addr_, dst_port);
+            StartConnect();
+            return;
         }
 
-        //if ((r = uv_ip4_addr(host.c_str(), dst_port, &dst_addr_)) != 0) {
-        //    throw CppStreamException("connect address error");
-        //}
-        connect_->data = this;
-        LogInfof(logger_, "start connect host:%s:%d", dst_ip.c_str(), htons(dst_port));
-
-        if ((r = uv_tcp_connect(connect_, client_,
-                            (const struct sockaddr*)&dst_addr_,
-                            OnUVClientConnected)) != 0) {
-            throw CppStreamException("connect address error");
+        int ret_code = 0;
+        if (DnsResolver::Lookup(host, ret_code, &dst_addr_)) {
+            if (ret_code < 0) {
+                throw CppStreamException("get address info error");
+            }
+            dst_addr_.sin_port = htons(dst_port);
+            StartConnect();
+            return;
+        }
+        LogInfof(logger_, "resolve host:%s, port:%d, ssl:%s",
+                host.c_str(), dst_port, ssl_enable_ ? "true" : "false");
+        if (!resolver_) {
+            resolver_ = DnsResolver::Attach(loop_, logger_);
+        }
+        if (resolver_->Resolve(host, this) != 0) {
+            throw CppStreamException("get address info error");
         }
         return;
     }
@@ -146,18 +147,30 @@ public:
             ssl_client_->SslWrite((uint8_t*)data, len);
             return;
         }
-        char* new_data = (char*)malloc(len);
-        memcpy(new_data, data, len);
-
-        write_req_t *req = (write_req_t*) malloc(sizeof(write_req_t));
-        req->buf = uv_buf_init(new_data, len);
+        write_queue_.Write(data, len);
+    }
 
-        connect_->handle->data = this;
-        if (uv_write((uv_write_t*)req, connect_->handle, &req->buf, 1, OnUVClientWrite)) {
-            free(new_data);
-            throw CppStreamException("uv_write error");
+    //no copy, the queue keeps a reference of the buffer until it is written
+    void Send(std::shared_ptr<DataBuffer> buffer_ptr) {
+        if (ssl_enable_) {
+            ssl_client_->SslWrite((uint8_t*)buffer_ptr->Data(), buffer_ptr->DataLen());
+            return;
         }
-        return;
+        write_queue_.Write(buffer_ptr);
+    }
+
+    //the bytes accepted and not written to the socket yet
+    size_t GetWriteQueueSize() {
+        return write_queue_.GetQueueBytes();
+    }
+
+    //over the high watermark till the queue drops under the low watermark
+    bool IsWriteBlocked() {
+        return write_queue_.IsBlocked();
+    }
+
+    void SetWriteWatermarks(size_t high, size_t low) {
+        write_queue_.SetWatermarks(high, low);
     }
 
     void AsyncRead() {
@@ -193,10 +206,52 @@ public:
         return is_connect_;
     }
 
+    //the time of the last Connect: dns resolving and tcp connecting(tls is not included)
+    int64_t GetConnectMs() { return connect_ms_; }
+    int64_t GetDnsMs() { return dns_ms_; }
+
+protected:
+    virtual void OnResolve(int ret_code, const struct sockaddr_in* addr) override {
+        dns_ms_ = now_millisec() - connect_start_ms_;
+        if (ret_code < 0) {
+            if (callback_) {
+                callback_->OnConnect(ret_code);
+            }
+            return;
+        }
+        memcpy(&dst_addr_, addr, sizeof(dst_addr_));
+        dst_addr_.sin_port = htons(dst_port_);
+
+        try {
+            StartConnect();
+        } catch(const std::exception& e) {
+            LogErrorf(logger_, "tcp connect exception:%s", e.what());
+            if (callback_) {
+                callback_->OnConnect(-1);
+            }
+        }
+    }
+
 private:
+    void StartConnect() {
+        int r = 0;
+        uint16_t port = 0;
+        std::string dst_ip = GetIpStr((sockaddr*)&dst_addr_, port);
+
+        connect_->data = this;
+        LogInfof(logger_, "start connect host:%s:%d", dst_ip.c_str(), ntohs(port));
+
+        if ((r = uv_tcp_connect(connect_, client_,
+                            (const struct sockaddr*)&dst_addr_,
+                            OnUVClientConnected)) != 0) {
+            throw CppStreamException("connect address error");
+        }
+    }
+
     void OnConnect(int status) {
         if (status == 0) {
             is_connect_ = true;
+            connect_ms_ = now_millisec() - connect_start_ms_;
         }
         LogInfof(logger_, "tcp connected ssl enable:%s", ssl_enable_ ? "true" : "false");
         if (!ssl_enable_) {
@@ -224,22 +279,16 @@ private:
         buf->len  = buffer_size_;
     }
 
-    void OnWrite(write_req_t* req, int status) {
-        write_req_t* wr;
-      
+    virtual void OnQueueWrite(int status, size_t sent_size) override {
         if (ssl_enable_) {
             if (ssl_client_->GetState() < TLS_CLIENT_READY) {
                 AsyncRead();
                 return;
             }
         }
-        /* Free the read/write buffer and the request */
-        wr = (write_req_t*) req;
         if (callback_) {
-            callback_->OnWrite(status, wr->buf.len);
+            callback_->OnWrite(status, sent_size);
         }
-        free(wr->buf.base);
-        free(wr);
     }
 
     void OnRead(ssize_t nread, const uv_buf_t* buf) {
@@ -262,6 +311,9 @@ private:
                 callback_->OnConnect(ret);
             } else if (ret > 0) {
                 AsyncRead();
+            } else if (ssl_client_->GetState() == TLS_CLIENT_READY) {
+                //abbreviated handshake by the resumed session
+                callback_->OnConnect(0);
             } else {
                 LogInfof(logger_, "Ssl Client Hello Done");
             }
@@ -285,7 +337,9 @@ private:
     }
 
 private:
+    uv_loop_t* loop_             = nullptr;
     struct sockaddr_in dst_addr_;
+    uint16_t dst_port_           = 0;
     uv_tcp_t* client_            = nullptr;
     uv_connect_t* connect_       = nullptr;
     TcpClientCallback* callback_ = nullptr;
@@ -299,6 +353,15 @@ private:
     bool ssl_enable_ = false;
     SslClient* ssl_client_ = nullptr;
 
+private:
+    TcpWriteQueue write_queue_;
+
+private:
+    DnsResolver* resolver_    = nullptr;
+    int64_t connect_start_ms_ = 0;
+    int64_t dns_ms_           = 0;
+    int64_t connect_ms_       = 0;
+
 private:
     Logger* logger_ = nullptr;
 };
@@ -310,15 +373,6 @@ inline void OnUVClientConnected(uv_connect_t *conn, int status) {
     }
 }
 
-inline void OnUVClientWrite(uv_write_t* req, int status) {
-    TcpClient* client = static_cast<TcpClient*>(req->handle->data);
-
-    if (client) {
-        client->OnWrite((write_req_t*)req, status);
-    }
-    return;
-}
-
 inline void OnUVClientAlloc(uv_handle_t* handle,
                     size_t suggested_size,
                     uv_buf_t* buf)
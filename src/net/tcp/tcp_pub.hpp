@@ -5,17 +5,14 @@
 #include <stdint.h>
 #include <stddef.h>
 #include <string>
+#include <memory>
+#include <vector>
 
 namespace cpp_streamer
 {
 
 #define TCP_DEF_RECV_BUFFER_SIZE (5*1024)
 
-typedef struct {
-  uv_write_t req;
-  uv_buf_t buf;
-} write_req_t;
-
 class TcpClientCallback
 {
 public:
@@ -42,7 +39,12 @@ class TcpBaseSession
 public:
     virtual void AsyncWrite(const char* data, size_t data_size) = 0;
     virtual void AsyncWrite(std::shared_ptr<DataBuffer> buffer_ptr) = 0;
+    virtual void AsyncWrite(const std::vector<std::shared_ptr<DataBuffer>>& buffers) = 0;
+    //send the file region after the data written before, the session owns file_fd and closes it
+    virtual int SendFile(int file_fd, int64_t offset, size_t len) = 0;
     virtual void AsyncRead() = 0;
+    virtual size_t GetWriteQueueSize() = 0;
+    virtual bool IsWriteBlocked() = 0;
     virtual void Close() = 0;
     virtual std::string GetRemoteEndpoint() = 0;
     virtual std::string GetLocalEndpoint() = 0;
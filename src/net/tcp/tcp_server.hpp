@@ -9,6 +9,9 @@
 #include <cstdlib>
 #include <functional>
 #include <iostream>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <unistd.h>
 
 namespace cpp_streamer
 {
@@ -23,16 +26,24 @@ friend void on_uv_connection(uv_stream_t* handle, int status);
 friend void on_uv_server_close(uv_handle_t* handle);
 
 public:
+    //reuse_port: the port can be bound by the servers on other loops(SO_REUSEPORT),
+    //the kernel distributes the connections among them
     TcpServer(uv_loop_t* loop,
         uint16_t local_port,
-        TcpServerCallbackI* callback):loop_(loop)
-                                    , callback_(callback)
-                                    , closed_(false)
+        TcpServerCallbackI* callback,
+        bool reuse_port = false):loop_(loop)
+                                , callback_(callback)
+                                , closed_(false)
     {
         uv_ip4_addr("0.0.0.0", local_port, &server_addr_);
-        uv_tcp_init(loop_, &server_handle_);
-
-        uv_tcp_bind(&server_handle_, (const struct sockaddr*)&server_addr_, 0);
+        if (reuse_port) {
+            int fd = ReusePortSocket();
+            uv_tcp_init(loop_, &server_handle_);
+            uv_tcp_open(&server_handle_, fd);
+        } else {
+            uv_tcp_init(loop_, &server_handle_);
+            uv_tcp_bind(&server_handle_, (const struct sockaddr*)&server_addr_, 0);
+        }
 
         server_handle_.data = this;
         uv_listen((uv_stream_t*)&server_handle_, SOMAXCONN, on_uv_connection);
@@ -53,7 +64,37 @@ public:
         uv_close(reinterpret_cast<uv_handle_t*>(&server_handle_), static_cast<uv_close_cb>(on_uv_server_close));
     }
 
+    //close the listener and delete the server in the close callback,
+    //for the owner which can not wait for the loop, the server must not be closed before
+    void CloseAndDelete() {
+        if (closed_) {
+            return;
+        }
+        Close();
+        server_handle_.data = this;
+        delete_on_close_    = true;
+    }
+
 private:
+    int ReusePortSocket() {
+        int on = 1;
+        int fd = socket(AF_INET, SOCK_STREAM, 0);
+
+        if (fd < 0) {
+            throw CppStreamException("reuse port socket() failed");
+        }
+        if (setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on)) != 0
+            || setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, &on, sizeof(on)) != 0) {
+            close(fd);
+            throw CppStreamException("setsockopt SO_REUSEPORT failed");
+        }
+        if (bind(fd, (const struct sockaddr*)&server_addr_, sizeof(server_addr_)) != 0) {
+            close(fd);
+            throw CppStreamException("reuse port bind() failed");
+        }
+        return fd;
+    }
+
     void OnConnection(int status, uv_stream_t* handle) {
         if (callback_) {
             callback_->OnAccept(status, loop_, handle);
@@ -66,17 +107,22 @@ private:
     uv_tcp_t server_handle_;
     struct sockaddr_in server_addr_;
     bool closed_                    = false;
+    bool delete_on_close_           = false;
 };
 
 inline void on_uv_connection(uv_stream_t* handle, int status) {
     auto* server = static_cast<TcpServer*>(handle->data);
-    if (server) {
+    if (server && !server->closed_) {
         server->OnConnection(status, handle);
     }
 }
 
 inline void on_uv_server_close(uv_handle_t* handle) {
-    delete handle;
+    //the handle is a member of TcpServer
+    auto* server = static_cast<TcpServer*>(handle->data);
+    if (server && server->delete_on_close_) {
+        delete server;
+    }
 }
 
 }
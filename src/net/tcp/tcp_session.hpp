@@ -3,6 +3,7 @@
 #include "logger.hpp"
 #include "data_buffer.hpp"
 #include "tcp_pub.hpp"
+#include "tcp_write_queue.hpp"
 #include "ipaddress.hpp"
 #include "ssl_server.hpp"
 #include <uv.h>
@@ -15,9 +16,16 @@
 #include <sstream>
 #include <openssl/ssl.h>
 #include <assert.h>
+#include <errno.h>
+#include <unistd.h>
+#ifdef __linux__
+#include <sys/sendfile.h>
+#endif
 
 namespace cpp_streamer
 {
+#define TCP_SENDFILE_CHUNK   (256*1024)  //bytes in one sendfile call
+#define TCP_FILE_READ_CHUNK  (64*1024)   //bytes copied through the write queue when sendfile can not go on
 
 inline static void OnTcpClose(uv_handle_t* handle);
 inline static void OnUvAlloc(uv_handle_t* handle,
@@ -26,9 +34,8 @@ inline static void OnUvAlloc(uv_handle_t* handle,
 inline static void OnUvRead(uv_stream_t* handle,
                        ssize_t nread,
                        const uv_buf_t* buf);
-inline static void OnUvWrite(uv_write_t* req, int status);
 
-class TcpSession : public TcpBaseSession, public SslCallbackI
+class TcpSession : public TcpBaseSession, public SslCallbackI, public TcpWriteQueueCallbackI
 {
 friend void OnTcpClose(uv_handle_t* handle);
 friend void OnUvAlloc(uv_handle_t* handle,
@@ -37,13 +44,13 @@ friend void OnUvAlloc(uv_handle_t* handle,
 friend void OnUvRead(uv_stream_t* handle,
                     ssize_t nread,
                     const uv_buf_t* buf);
-friend void OnUvWrite(uv_write_t* req, int status);
 
 public:
     TcpSession(uv_loop_t* loop,
             uv_stream_t* server_uv_handle,
             TcpSessionCallbackI* callback,
             Logger* logger):callback_(callback)
+                            , write_queue_(loop, this, logger)
                             , logger_(logger)
     {
         buffer_    = (char*)malloc(buffer_size_);
@@ -53,7 +60,7 @@ public:
         // Set the UV handle.
         int err = uv_tcp_init(loop, uv_handle_);
         if (err != 0) {
-            delete uv_handle_;
+            free(uv_handle_);
             uv_handle_ = nullptr;
             free(buffer_);
             throw CppStreamException("uv_tcp_init() failed");
@@ -63,7 +70,7 @@ public:
           reinterpret_cast<uv_stream_t*>(uv_handle_));
     
         if (err != 0) {
-            delete uv_handle_;
+            free(uv_handle_);
             uv_handle_ = nullptr;
             free(buffer_);
             throw CppStreamException("uv_accept() failed");
@@ -71,6 +78,7 @@ public:
         int namelen = (int)sizeof(local_name_);
 	    uv_tcp_getsockname(uv_handle_, &local_name_, &namelen);
         uv_tcp_getpeername(uv_handle_, &peer_name_, &namelen);
+        write_queue_.SetStream(reinterpret_cast<uv_stream_t*>(uv_handle_));
         close_ = false;
     }
 
@@ -82,6 +90,7 @@ public:
             Logger* logger):callback_(callback)
                            , ssl_enable_(true)
                            , ssl_(new SslServer(key_file, cert_file, this, logger))
+                           , write_queue_(loop, this, logger)
                            , logger_(logger)
     {
         buffer_    = (char*)malloc(buffer_size_);
@@ -91,7 +100,7 @@ public:
         // Set the UV handle.
         int err = uv_tcp_init(loop, uv_handle_);
         if (err != 0) {
-            delete uv_handle_;
+            free(uv_handle_);
             uv_handle_ = nullptr;
             free(buffer_);
             throw CppStreamException("uv_tcp_init() failed");
@@ -101,7 +110,7 @@ public:
           reinterpret_cast<uv_stream_t*>(uv_handle_));
     
         if (err != 0) {
-            delete uv_handle_;
+            free(uv_handle_);
             uv_handle_ = nullptr;
             free(buffer_);
             throw CppStreamException("uv_accept() failed");
@@ -109,6 +118,7 @@ public:
         int namelen = (int)sizeof(local_name_);
         uv_tcp_getsockname(uv_handle_, &local_name_, &namelen);
         uv_tcp_getpeername(uv_handle_, &peer_name_, &namelen);
+        write_queue_.SetStream(reinterpret_cast<uv_stream_t*>(uv_handle_));
         close_ = false;
     }
     virtual ~TcpSession()
@@ -121,6 +131,9 @@ public:
         if (buffer_) {
             free(buffer_);
         }
+        if (file_buffer_) {
+            free(file_buffer_);
+        }
     }
 
 public:
@@ -151,20 +164,68 @@ public:
             ssl_->SslWrite((uint8_t*)data, len);
             return;
         }
-        write_req_t* wr = (write_req_t*) malloc(sizeof(write_req_t));
+        if (close_) {
+            return;
+        }
+        write_queue_.Write(data, len);
+    }
 
-        char* new_data = (char*)malloc(len);
-        memcpy(new_data, data, len);
+    //no copy, the queue keeps a reference of the buffer until it is written
+    virtual void AsyncWrite(std::shared_ptr<DataBuffer> buffer_ptr) override {
+        if (ssl_enable_ && ssl_) {
+            ssl_->SslWrite((uint8_t*)buffer_ptr->Data(), buffer_ptr->DataLen());
+            return;
+        }
+        if (close_) {
+            return;
+        }
+        write_queue_.Write(buffer_ptr);
+    }
 
-        wr->buf = uv_buf_init(new_data, len);
-        if (uv_write((uv_write_t*)wr, reinterpret_cast<uv_stream_t*>(uv_handle_), &wr->buf, 1, OnUvWrite)) {
-            free(new_data);
-            throw CppStreamException("uv_write error");
+    //the buffers are written in order by one system call when the socket takes them
+    virtual void AsyncWrite(const std::vector<std::shared_ptr<DataBuffer>>& buffers) override {
+        if (ssl_enable_ && ssl_) {
+            for (const auto& buffer_ptr : buffers) {
+                ssl_->SslWrite((uint8_t*)buffer_ptr->Data(), buffer_ptr->DataLen());
+            }
+            return;
+        }
+        if (close_) {
+            return;
         }
+        write_queue_.Write(buffers);
     }
 
-    virtual void AsyncWrite(std::shared_ptr<DataBuffer> buffer_ptr) override {
-        this->AsyncWrite(buffer_ptr->Data(), buffer_ptr->DataLen());
+    /*
+     * the file region goes to the socket by sendfile without being copied to the user space,
+     * it starts when the data written before is sent, and goes on in OnQueueWrite.
+     * when the socket is full, one chunk is read and queued instead, its completion tells
+     * the socket is writable again. the tls session reads and encrypts the chunks.
+     * the progress is reported by OnWrite, nothing else should be written till the file is sent.
+     */
+    virtual int SendFile(int file_fd, int64_t offset, size_t len) override {
+        if (close_ || file_fd_ >= 0) {
+            close(file_fd);
+            return -1;
+        }
+        file_fd_     = file_fd;
+        file_offset_ = offset;
+        file_remain_ = len;
+        return SendFileData();
+    }
+
+    //the bytes accepted and not written to the socket yet, with the file left
+    virtual size_t GetWriteQueueSize() override {
+        return write_queue_.GetQueueBytes() + file_remain_;
+    }
+
+    //over the high watermark till the queue drops under the low watermark
+    virtual bool IsWriteBlocked() override {
+        return write_queue_.IsBlocked();
+    }
+
+    void SetWriteWatermarks(size_t high, size_t low) {
+        write_queue_.SetWatermarks(high, low);
     }
 
     virtual void Close() override {
@@ -178,6 +239,9 @@ public:
             throw CppStreamException("uv_read_stop error");
         }
         LogDebugf(logger_, "tcp close");
+        CloseFile();
+        write_queue_.Close();
+        uv_handle_->data = nullptr;
         uv_close(reinterpret_cast<uv_handle_t*>(uv_handle_), static_cast<uv_close_cb>(OnTcpClose));
     }
 
@@ -186,7 +250,7 @@ public:
         uint16_t remoteport = 0;
         std::string remoteip = GetIpStr(&peer_name_, remoteport);
 
-        ss << remoteip << ":" << remoteport;
+        ss << remoteip << ":" << ntohs(remoteport);
         return ss.str();
     }
 
@@ -195,22 +259,16 @@ public:
         uint16_t localport = 0;
         std::string localip = GetIpStr(&local_name_, localport);
 
-        ss << localip << ":" << localport;
+        ss << localip << ":" << ntohs(localport);
         return ss.str();
     }
 
 private:
     virtual void PlaintextDataSend(const char* data, size_t len) override {
-        write_req_t* wr = (write_req_t*) malloc(sizeof(write_req_t));
-
-        char* new_data = (char*)malloc(len);
-        memcpy(new_data, data, len);
-
-        wr->buf = uv_buf_init(new_data, len);
-        if (uv_write((uv_write_t*)wr, reinterpret_cast<uv_stream_t*>(uv_handle_), &wr->buf, 1, OnUvWrite)) {
-            free(new_data);
-            throw CppStreamException("uv_write error");
+        if (close_) {
+            return;
         }
+        write_queue_.Write(data, len);
     }
 
     virtual void PlaintextDataRecv(const char* data, size_t len) override {
@@ -248,25 +306,86 @@ private:
         callback_->OnRead(0, buf->base, nread);
     }
 
-    void OnWrite(write_req_t* req, int status) {
-        write_req_t* wr;
-      
-        /* Free the read/write buffer and the request */
-        wr = (write_req_t*) req;
+    virtual void OnQueueWrite(int status, size_t sent_size) override {
         if (ssl_enable_ && ssl_) {
-            if (ssl_->GetState() == TLS_SERVER_DATA_RECV_STATE) {
-                if (callback_ && !close_) {
-                    callback_->OnWrite(status, wr->buf.len);
+            if (ssl_->GetState() != TLS_SERVER_DATA_RECV_STATE) {
+                return;
+            }
+        }
+        if (status == 0 && file_fd_ >= 0 && !close_) {
+            if (SendFileData() < 0) {
+                status = UV_EIO;
+            }
+        }
+        if (callback_ && !close_) {
+            callback_->OnWrite(status, sent_size);
+        }
+    }
+
+    int SendFileData() {
+        while (file_fd_ >= 0) {
+            if (file_remain_ == 0 || close_) {
+                CloseFile();
+                return 0;
+            }
+            //after the data queued before
+            if (write_queue_.GetQueueBytes() > 0) {
+                return 0;
+            }
+#ifdef __linux__
+            if (!ssl_enable_) {
+                uv_os_fd_t sock_fd;
+                off_t offset = (off_t)file_offset_;
+                size_t len   = (file_remain_ > TCP_SENDFILE_CHUNK) ? TCP_SENDFILE_CHUNK : file_remain_;
+
+                uv_fileno(reinterpret_cast<uv_handle_t*>(uv_handle_), &sock_fd);
+                ssize_t ret = sendfile(sock_fd, file_fd_, &offset, len);
+                if (ret > 0) {
+                    file_offset_ += ret;
+                    file_remain_ -= (size_t)ret;
+                    write_queue_.AddSentBytes((size_t)ret);
+                    continue;
+                }
+                if (ret < 0 && errno == EINTR) {
+                    continue;
+                }
+                if (ret == 0 || errno != EAGAIN) {
+                    LogErrorf(logger_, "sendfile error:%d, offset:%ld, remain:%lu",
+                            (ret == 0) ? 0 : errno, file_offset_, file_remain_);
+                    CloseFile();
+                    return -1;
                 }
             }
-        } else {
-            if (callback_ && !close_) {
-                callback_->OnWrite(status, wr->buf.len);
+#endif
+            size_t len = (file_remain_ > TCP_FILE_READ_CHUNK) ? TCP_FILE_READ_CHUNK : file_remain_;
+            if (!file_buffer_) {
+                file_buffer_ = (char*)malloc(TCP_FILE_READ_CHUNK);
             }
+            ssize_t ret = pread(file_fd_, file_buffer_, len, (off_t)file_offset_);
+            if (ret <= 0) {
+                LogErrorf(logger_, "file read error:%d, offset:%ld, remain:%lu",
+                        (ret == 0) ? 0 : errno, file_offset_, file_remain_);
+                CloseFile();
+                return -1;
+            }
+            file_offset_ += ret;
+            file_remain_ -= (size_t)ret;
+            if (ssl_enable_ && ssl_) {
+                ssl_->SslWrite((uint8_t*)file_buffer_, (size_t)ret);
+            } else {
+                write_queue_.Write(file_buffer_, (size_t)ret);
+            }
+            //go on if the socket takes the chunk at once, or in OnQueueWrite
         }
+        return 0;
+    }
 
-        free(wr->buf.base);
-        free(wr);
+    void CloseFile() {
+        if (file_fd_ >= 0) {
+            close(file_fd_);
+            file_fd_ = -1;
+        }
+        file_remain_ = 0;
     }
 
 private:
@@ -282,6 +401,15 @@ private:
     bool ssl_enable_     = false;
     SslServer* ssl_     = nullptr;
 
+private:
+    TcpWriteQueue write_queue_;
+
+private:
+    int file_fd_         = -1;
+    int64_t file_offset_ = 0;
+    size_t file_remain_  = 0;
+    char* file_buffer_   = nullptr;
+
 private:
     Logger* logger_;
 };
@@ -306,17 +434,8 @@ inline static void OnUvRead(uv_stream_t* handle, ssize_t nread, const uv_buf_t*
     return;
 }
 
-inline static void OnUvWrite(uv_write_t* req, int status) {
-    TcpSession* session = static_cast<TcpSession*>(req->handle->data);
-
-    if (session) {
-        session->OnWrite((write_req_t*)req, status);
-    }
-    return;
-}
-
 inline static void OnTcpClose(uv_handle_t* handle) {
-    delete handle;
+    free(handle);
 }
 
 }
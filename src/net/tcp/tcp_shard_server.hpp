@@ -0,0 +1,262 @@
+#ifndef TCP_SHARD_SERVER_HPP
+#define TCP_SHARD_SERVER_HPP
+#include "tcp_server.hpp"
+#include "tcp_pub.hpp"
+#include "logger.hpp"
+#include <uv.h>
+#include <memory>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <condition_variable>
+#include <stdint.h>
+#include <stddef.h>
+
+namespace cpp_streamer
+{
+#define TCP_SHARD_STATS_MS 1000
+
+inline void OnTcpShardStop(uv_async_t* handle);
+inline void OnTcpShardStats(uv_timer_t* handle);
+
+class TcpShardCallbackI
+{
+public:
+    //in the shard thread: create the server(HttpServer, WebSocketServer...) without listener on the shard loop,
+    //it gets the connections accepted by the shard
+    virtual TcpServerCallbackI* OnShardStart(size_t index, uv_loop_t* loop) = 0;
+    //in the shard thread every second
+    virtual size_t OnShardSessionCount(size_t index, TcpServerCallbackI* server) = 0;
+    //in the shard thread after the listener is closed: release the server and its sessions,
+    //the shard thread exits when nothing is active on the loop, so their handles must be
+    //closed(uv_close) here, the timers use the loop's timer wheel
+    virtual void OnShardStop(size_t index, TcpServerCallbackI* server) = 0;
+};
+
+/*
+ * one shard: a thread running its own loop with a listener bound by SO_REUSEPORT
+ */
+class TcpShard : public TcpServerCallbackI
+{
+friend void OnTcpShardStop(uv_async_t* handle);
+friend void OnTcpShardStats(uv_timer_t* handle);
+
+public:
+    TcpShard(size_t index, uint16_t port, TcpShardCallbackI* cb, Logger* logger):index_(index)
+                                                                                , port_(port)
+                                                                                , cb_(cb)
+                                                                                , logger_(logger)
+    {
+    }
+
+    virtual ~TcpShard()
+    {
+        Stop();
+    }
+
+public:
+    //return when the shard is listening or failed
+    int Start() {
+        std::unique_lock<std::mutex> lock(mutex_);
+
+        if (thread_ptr_) {
+            return 0;
+        }
+        thread_ptr_ = std::make_shared<std::thread>(&TcpShard::OnWork, this);
+        start_cv_.wait(lock, [this] { return started_; });
+        if (start_ret_ != 0) {
+            lock.unlock();
+            thread_ptr_->join();
+            thread_ptr_ = nullptr;
+            return start_ret_;
+        }
+        return 0;
+    }
+
+    void Stop() {
+        if (!thread_ptr_) {
+            return;
+        }
+        uv_async_send(&stop_async_);
+        thread_ptr_->join();
+        thread_ptr_ = nullptr;
+    }
+
+    int64_t GetAcceptCount() { return accept_count_; }
+    int64_t GetSessionCount() { return session_count_; }
+
+protected:
+    virtual void OnAccept(int ret_code, uv_loop_t* loop, uv_stream_t* handle) override {
+        if (ret_code == 0) {
+            accept_count_++;
+        }
+        if (server_cb_) {
+            server_cb_->OnAccept(ret_code, loop, handle);
+        }
+    }
+
+private:
+    void OnWork() {
+        int ret = 0;
+
+        uv_loop_init(&loop_);
+        uv_async_init(&loop_, &stop_async_, OnTcpShardStop);
+        stop_async_.data = this;
+
+        try {
+            server_ptr_.reset(new TcpServer(&loop_, port_, this, true));
+        } catch(const std::exception& e) {
+            LogErrorf(logger_, "tcp shard:%lu listen port:%d exception:%s", index_, port_, e.what());
+            ret = -1;
+        }
+        if (ret == 0) {
+            server_cb_ = cb_->OnShardStart(index_, &loop_);
+            uv_timer_init(&loop_, &stats_timer_);
+            stats_timer_.data = this;
+            uv_timer_start(&stats_timer_, OnTcpShardStats, TCP_SHARD_STATS_MS, TCP_SHARD_STATS_MS);
+            LogInfof(logger_, "tcp shard:%lu is listening on port:%d", index_, port_);
+        } else {
+            uv_close(reinterpret_cast<uv_handle_t*>(&stop_async_), nullptr);
+        }
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            start_ret_ = ret;
+            started_   = true;
+        }
+        start_cv_.notify_all();
+
+        uv_run(&loop_, UV_RUN_DEFAULT);
+
+        server_ptr_ = nullptr;
+        if (uv_loop_close(&loop_) != 0) {
+            LogWarnf(logger_, "tcp shard:%lu loop is closed with handles left", index_);
+        }
+        LogInfof(logger_, "tcp shard:%lu exits, accepted:%ld", index_, (int64_t)accept_count_);
+    }
+
+    void OnStop() {
+        uv_timer_stop(&stats_timer_);
+        uv_close(reinterpret_cast<uv_handle_t*>(&stats_timer_), nullptr);
+
+        server_ptr_->Close();
+        if (server_cb_) {
+            cb_->OnShardStop(index_, server_cb_);
+            server_cb_ = nullptr;
+        }
+        session_count_ = 0;
+        uv_close(reinterpret_cast<uv_handle_t*>(&stop_async_), nullptr);
+    }
+
+    void OnStats() {
+        if (server_cb_) {
+            session_count_ = (int64_t)cb_->OnShardSessionCount(index_, server_cb_);
+        }
+    }
+
+private:
+    size_t index_;
+    uint16_t port_;
+    TcpShardCallbackI* cb_ = nullptr;
+    Logger* logger_        = nullptr;
+
+private:
+    uv_loop_t loop_;
+    uv_async_t stop_async_;
+    uv_timer_t stats_timer_;
+    std::unique_ptr<TcpServer> server_ptr_;
+    TcpServerCallbackI* server_cb_ = nullptr;
+    std::shared_ptr<std::thread> thread_ptr_;
+
+private:
+    std::mutex mutex_;
+    std::condition_variable start_cv_;
+    bool started_   = false;
+    int start_ret_  = 0;
+
+private:
+    std::atomic<int64_t> accept_count_{0};
+    std::atomic<int64_t> session_count_{0};
+};
+
+/*
+ * sharded tcp server: shard_num threads, each runs its own loop and binds the same port
+ * by SO_REUSEPORT, the kernel distributes the connections among the shards, so the
+ * sessions are spread on the cores instead of pinned to one loop.
+ * every shard creates its own server by TcpShardCallbackI in the shard thread.
+ */
+class TcpShardServer
+{
+public:
+    TcpShardServer(uint16_t port, size_t shard_num, TcpShardCallbackI* cb, Logger* logger):port_(port)
+                                                                                    , logger_(logger)
+    {
+        if (shard_num == 0) {
+            shard_num = std::thread::hardware_concurrency();
+            if (shard_num == 0) {
+                shard_num = 1;
+            }
+        }
+        for (size_t index = 0; index < shard_num; index++) {
+            shards_.emplace_back(new TcpShard(index, port, cb, logger));
+        }
+    }
+
+    ~TcpShardServer()
+    {
+        Stop();
+    }
+
+public:
+    int Start() {
+        for (auto& shard : shards_) {
+            if (shard->Start() != 0) {
+                LogErrorf(logger_, "tcp shard server port:%d fail to start", port_);
+                Stop();
+                return -1;
+            }
+        }
+        LogInfof(logger_, "tcp shard server port:%d starts %lu shards", port_, shards_.size());
+        return 0;
+    }
+
+    //close the listeners, release the servers and join the shard threads
+    void Stop() {
+        for (auto& shard : shards_) {
+            shard->Stop();
+        }
+    }
+
+    size_t GetShardNum() { return shards_.size(); }
+    int64_t GetAcceptCount(size_t index) { return shards_[index]->GetAcceptCount(); }
+    int64_t GetSessionCount(size_t index) { return shards_[index]->GetSessionCount(); }
+    int64_t GetTotalSessionCount() {
+        int64_t count = 0;
+        for (auto& shard : shards_) {
+            count += shard->GetSessionCount();
+        }
+        return count;
+    }
+
+private:
+    uint16_t port_;
+    Logger* logger_ = nullptr;
+    std::vector<std::unique_ptr<TcpShard>> shards_;
+};
+
+inline void OnTcpShardStop(uv_async_t* handle) {
+    TcpShard* shard = (TcpShard*)handle->data;
+    if (shard) {
+        shard->OnStop();
+    }
+}
+
+inline void OnTcpShardStats(uv_timer_t* handle) {
+    TcpShard* shard = (TcpShard*)handle->data;
+    if (shard) {
+        shard->OnStats();
+    }
+}
+
+}
+#endif
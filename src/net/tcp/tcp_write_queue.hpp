@@ -0,0 +1,371 @@
+#ifndef TCP_WRITE_QUEUE_HPP
+#define TCP_WRITE_QUEUE_HPP
+#include "logger.hpp"
+#include "data_buffer.hpp"
+#include <uv.h>
+#include <memory>
+#include <deque>
+#include <vector>
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <stdlib.h>
+
+namespace cpp_streamer
+{
+#define TCP_WRITE_MAX_BUFS        64          //bufs in one uv_write
+#define TCP_WRITE_COALESCE_SIZE   (16*1024)   //small copied writes are merged into one buffer up to this size
+#define TCP_WRITE_HIGH_WATERMARK  (2*1024*1024)
+#define TCP_WRITE_LOW_WATERMARK   (512*1024)
+
+inline static void OnTcpQueueWrite(uv_write_t* req, int status);
+inline static void OnTcpQueueIdle(uv_idle_t* handle);
+inline static void OnTcpQueueIdleClose(uv_handle_t* handle);
+
+class TcpWriteQueueCallbackI
+{
+public:
+    virtual void OnQueueWrite(int status, size_t sent_size) = 0;
+};
+
+class TcpWriteQueue;
+
+typedef struct {
+    std::shared_ptr<DataBuffer> buffer_ptr;
+    size_t offset;
+    bool owned;//copied by the queue, the following writes can be appended
+} TcpWriteItem;
+
+typedef struct {
+    uv_write_t req;
+    TcpWriteQueue* queue;
+    size_t bytes;
+    std::vector<std::shared_ptr<DataBuffer>> refs;//released when the write is done
+    uv_buf_t bufs[TCP_WRITE_MAX_BUFS];
+} TcpWriteReq;
+
+/*
+ * per connection write queue:
+ * a write goes to the socket by uv_try_write at once when nothing is pending,
+ * the rest is queued and sent by one uv_write in flight at a time, which carries
+ * all the pending buffers(up to 64), shared buffers are referenced instead of copied
+ * and must not be modified after written.
+ * the writer is blocked over the high watermark till the queue drops under the low watermark.
+ * the bytes sent by uv_try_write are reported in the next loop iteration,
+ * so OnQueueWrite is never called inside Write.
+ */
+class TcpWriteQueue
+{
+friend void OnTcpQueueWrite(uv_write_t* req, int status);
+friend void OnTcpQueueIdle(uv_idle_t* handle);
+
+public:
+    TcpWriteQueue(uv_loop_t* loop, TcpWriteQueueCallbackI* cb, Logger* logger):cb_(cb)
+                                                                        , logger_(logger)
+    {
+        idle_ = (uv_idle_t*)malloc(sizeof(uv_idle_t));
+        uv_idle_init(loop, idle_);
+        idle_->data = this;
+    }
+
+    ~TcpWriteQueue()
+    {
+        Close();
+        if (inflight_) {
+            //the request is canceled or finished after the queue is gone
+            inflight_->queue = nullptr;
+            inflight_ = nullptr;
+        }
+        idle_->data = nullptr;
+        uv_close(reinterpret_cast<uv_handle_t*>(idle_), OnTcpQueueIdleClose);
+    }
+
+public:
+    void SetStream(uv_stream_t* stream) { stream_ = stream; }
+    void SetWatermarks(size_t high, size_t low) {
+        high_watermark_ = high;
+        low_watermark_  = low;
+        UpdateBlocked();
+    }
+    size_t GetHighWatermark() { return high_watermark_; }
+    size_t GetLowWatermark() { return low_watermark_; }
+
+    //bytes accepted and not written to the socket yet
+    size_t GetQueueBytes() {
+        return pending_bytes_ + (inflight_ ? inflight_->bytes : 0);
+    }
+    bool IsBlocked() { return blocked_; }
+
+public:
+    void Write(const char* data, size_t len) {
+        if (closed_ || len == 0) {
+            return;
+        }
+        size_t sent = TryWrite(data, len);
+        if (sent == len) {
+            return;
+        }
+        data += sent;
+        len  -= sent;
+
+        TcpWriteItem* tail = pending_.empty() ? nullptr : &pending_.back();
+        if (tail && tail->owned && tail->buffer_ptr->DataLen() + len <= TCP_WRITE_COALESCE_SIZE) {
+            tail->buffer_ptr->AppendData(data, len);
+        } else {
+            TcpWriteItem item;
+
+            item.buffer_ptr = std::make_shared<DataBuffer>(len > TCP_WRITE_COALESCE_SIZE ? len : TCP_WRITE_COALESCE_SIZE);
+            item.buffer_ptr->AppendData(data, len);
+            item.offset = 0;
+            item.owned  = true;
+            pending_.push_back(item);
+        }
+        pending_bytes_ += len;
+        UpdateBlocked();
+        Flush();
+    }
+
+    void Write(std::shared_ptr<DataBuffer> buffer_ptr) {
+        size_t len = buffer_ptr->DataLen();
+
+        if (closed_ || len == 0) {
+            return;
+        }
+        size_t sent = TryWrite(buffer_ptr->Data(), len);
+        if (sent == len) {
+            return;
+        }
+        TcpWriteItem item;
+
+        item.buffer_ptr = buffer_ptr;
+        item.offset     = sent;
+        item.owned      = false;
+        pending_.push_back(item);
+
+        pending_bytes_ += len - sent;
+        UpdateBlocked();
+        Flush();
+    }
+
+    //the buffers go to the socket by one gathered uv_try_write, no copy
+    void Write(const std::vector<std::shared_ptr<DataBuffer>>& buffers) {
+        uv_buf_t bufs[TCP_WRITE_MAX_BUFS];
+        unsigned int count = 0;
+
+        if (closed_) {
+            return;
+        }
+        for (const auto& buffer_ptr : buffers) {
+            if (count >= TCP_WRITE_MAX_BUFS) {
+                break;
+            }
+            if (buffer_ptr->DataLen() > 0) {
+                bufs[count++] = uv_buf_init(buffer_ptr->Data(), buffer_ptr->DataLen());
+            }
+        }
+        size_t sent = TryWrite(bufs, count);
+        bool queued = false;
+
+        for (const auto& buffer_ptr : buffers) {
+            size_t len = buffer_ptr->DataLen();
+
+            if (sent >= len) {
+                sent -= len;
+                continue;
+            }
+            TcpWriteItem item;
+
+            item.buffer_ptr = buffer_ptr;
+            item.offset     = sent;
+            item.owned      = false;
+            pending_.push_back(item);
+
+            pending_bytes_ += len - sent;
+            sent   = 0;
+            queued = true;
+        }
+        if (queued) {
+            UpdateBlocked();
+            Flush();
+        }
+    }
+
+    //bytes written to the socket by the owner(sendfile) while nothing is queued,
+    //they are reported in the next loop iteration like the ones of uv_try_write
+    void AddSentBytes(size_t bytes) {
+        if (closed_ || bytes == 0) {
+            return;
+        }
+        done_bytes_ += bytes;
+        if (!idle_started_) {
+            uv_idle_start(idle_, OnTcpQueueIdle);
+            idle_started_ = true;
+        }
+    }
+
+    //drop the pending data, the write in flight is left to libuv
+    void Close() {
+        if (closed_) {
+            return;
+        }
+        closed_ = true;
+        pending_.clear();
+        pending_bytes_ = 0;
+        done_bytes_    = 0;
+        if (idle_started_) {
+            uv_idle_stop(idle_);
+            idle_started_ = false;
+        }
+    }
+
+private:
+    size_t TryWrite(const char* data, size_t len) {
+        uv_buf_t buf = uv_buf_init((char*)data, len);
+
+        return TryWrite(&buf, 1);
+    }
+
+    size_t TryWrite(const uv_buf_t* bufs, unsigned int count) {
+        if (!stream_ || inflight_ || !pending_.empty() || count == 0) {
+            return 0;
+        }
+        int ret = uv_try_write(stream_, bufs, count);
+        if (ret <= 0) {
+            //UV_EAGAIN, or an error which is reported by uv_write
+            return 0;
+        }
+        done_bytes_ += ret;
+        if (!idle_started_) {
+            uv_idle_start(idle_, OnTcpQueueIdle);
+            idle_started_ = true;
+        }
+        return (size_t)ret;
+    }
+
+    void Flush() {
+        if (closed_ || !stream_ || inflight_ || pending_.empty()) {
+            return;
+        }
+        TcpWriteReq* wr = new TcpWriteReq;
+        unsigned int count = 0;
+
+        wr->queue = this;
+        wr->bytes = 0;
+        while (!pending_.empty() && count < TCP_WRITE_MAX_BUFS) {
+            TcpWriteItem& item = pending_.front();
+            size_t len = item.buffer_ptr->DataLen() - item.offset;
+
+            wr->bufs[count++] = uv_buf_init(item.buffer_ptr->Data() + item.offset, len);
+            wr->refs.push_back(item.buffer_ptr);
+            wr->bytes += len;
+            pending_.pop_front();
+        }
+        pending_bytes_ -= wr->bytes;
+        inflight_ = wr;
+
+        int ret = uv_write((uv_write_t*)wr, stream_, wr->bufs, count, OnTcpQueueWrite);
+        if (ret != 0) {
+            inflight_ = nullptr;
+            delete wr;
+            UpdateBlocked();
+            throw CppStreamException("uv_write error");
+        }
+    }
+
+    void OnWrite(TcpWriteReq* wr, int status) {
+        size_t bytes = wr->bytes;
+
+        inflight_ = nullptr;
+        delete wr;
+
+        if (closed_) {
+            return;
+        }
+        if (status < 0) {
+            LogErrorf(logger_, "tcp queue write error:%d, drop pending bytes:%lu", status, pending_bytes_);
+            pending_.clear();
+            pending_bytes_ = 0;
+        } else {
+            try {
+                Flush();
+            } catch(const std::exception& e) {
+                LogErrorf(logger_, "tcp queue flush exception:%s", e.what());
+                status = UV_EPIPE;
+            }
+        }
+        UpdateBlocked();
+
+        //the callback may release the queue, nothing is touched after it
+        if (cb_) {
+            cb_->OnQueueWrite(status, bytes);
+        }
+    }
+
+    void OnIdle() {
+        size_t bytes = done_bytes_;
+
+        uv_idle_stop(idle_);
+        idle_started_ = false;
+        done_bytes_   = 0;
+        if (bytes > 0 && cb_) {
+            cb_->OnQueueWrite(0, bytes);
+        }
+    }
+
+    void UpdateBlocked() {
+        size_t queue_bytes = GetQueueBytes();
+
+        if (!blocked_ && queue_bytes > high_watermark_) {
+            blocked_ = true;
+            LogDebugf(logger_, "tcp write queue is blocked, queue bytes:%lu", queue_bytes);
+        } else if (blocked_ && queue_bytes < low_watermark_) {
+            blocked_ = false;
+            LogDebugf(logger_, "tcp write queue is unblocked, queue bytes:%lu", queue_bytes);
+        }
+    }
+
+private:
+    TcpWriteQueueCallbackI* cb_ = nullptr;
+    Logger* logger_             = nullptr;
+    uv_stream_t* stream_        = nullptr;
+    uv_idle_t* idle_            = nullptr;
+    bool idle_started_          = false;
+    bool closed_                = false;
+
+private:
+    std::deque<TcpWriteItem> pending_;
+    size_t pending_bytes_       = 0;
+    TcpWriteReq* inflight_      = nullptr;
+    size_t done_bytes_          = 0;//written by uv_try_write, not reported yet
+
+private:
+    size_t high_watermark_      = TCP_WRITE_HIGH_WATERMARK;
+    size_t low_watermark_       = TCP_WRITE_LOW_WATERMARK;
+    bool blocked_               = false;
+};
+
+inline static void OnTcpQueueWrite(uv_write_t* req, int status) {
+    TcpWriteReq* wr = (TcpWriteReq*)req;
+
+    if (wr->queue) {
+        wr->queue->OnWrite(wr, status);
+        return;
+    }
+    delete wr;
+}
+
+inline static void OnTcpQueueIdle(uv_idle_t* handle) {
+    TcpWriteQueue* queue = (TcpWriteQueue*)handle->data;
+
+    if (queue) {
+        queue->OnIdle();
+    }
+}
+
+inline static void OnTcpQueueIdleClose(uv_handle_t* handle) {
+    free(handle);
+}
+
+}
+
+#endif
@@ -49,6 +49,9 @@ int TimeSync::RemoveSinker(const std::string& name) {
 }
 
 int TimeSync::SourceData(Media_Packet_Ptr pkt_ptr) {
+    metrics_.OnPacket(pkt_ptr->buffer_ptr_->DataLen());
+    metrics_.BeginStage();
+    metrics_.OnIngress(pkt_ptr->ingress_us_);
     if (pkt_ptr->av_type_ == MEDIA_VIDEO_TYPE) {
         HandleVideoPacket(pkt_ptr);
     } else if (pkt_ptr->av_type_ == MEDIA_AUDIO_TYPE) {
@@ -59,9 +62,12 @@ int TimeSync::SourceData(Media_Packet_Ptr pkt_ptr) {
 
 void TimeSync::OutputPacket(Media_Packet_Ptr pkt_ptr) {
     //LogInfof(logger_, "output packet:%s", pkt_ptr->Dump().c_str());
+    metrics_.EndStage();
+    metrics_.OnOutput(pkt_ptr->ingress_us_);
     for (auto sinker : sinkers_) {
         sinker.second->SourceData(pkt_ptr);
     }
+    metrics_.BeginStage();
 }
 
 void TimeSync::HandleVideoPacket(Media_Packet_Ptr pkt_ptr) {
@@ -25,7 +25,8 @@ public:
         } else {
             uv_ip4_addr(ipaddr_sz, port, &recv_addr);
         }
-        uv_udp_bind(&udp_handle_, (const struct sockaddr *)&recv_addr, UV_UDP_REUSEADDR);
+        //an ephemeral port is not bound with SO_REUSEADDR, linux may give the same port to two sockets
+        uv_udp_bind(&udp_handle_, (const struct sockaddr *)&recv_addr, (port == 0) ? 0 : UV_UDP_REUSEADDR);
 
         udp_handle_.data = this;
     }
@@ -35,6 +35,7 @@ inline void UdpReadCallback(uv_udp_t* handle,
                     const struct sockaddr* addr,
                     unsigned flags);
 inline void UdpSendCallback(uv_udp_send_t* req, int status);
+inline void UdpCloseCallback(uv_handle_t* handle);
 
 class UdpTuple
 {
@@ -79,6 +80,7 @@ friend void UdpReadCallback(uv_udp_t* handle,
                     const struct sockaddr* addr,
                     unsigned flags);
 friend void UdpSendCallback(uv_udp_send_t* req, int status);
+friend void UdpCloseCallback(uv_handle_t* handle);
 
 public:
     UdpSessionBase(uv_loop_t* loop, 
@@ -88,7 +90,7 @@ public:
                                 , logger_(logger)
     {
     }
-    ~UdpSessionBase()
+    virtual ~UdpSessionBase()
     {
         Close();
     }
@@ -149,6 +151,14 @@ public:
         uv_udp_recv_stop(&udp_handle_);
     }
 
+    //close the handle and delete the session in the close callback,
+    //the pending sends are canceled before it, the callback is not called any more
+    void CloseAndDelete() {
+        Close();
+        udp_handle_.data = this;
+        uv_close((uv_handle_t*)&udp_handle_, UdpCloseCallback);
+    }
+
 protected:
     void OnAlloc(uv_buf_t* buf) {
         buf->base = recv_buffer_;
@@ -173,11 +183,17 @@ protected:
                 cb_->OnRead(buf->base, nread, addr_tuple);
             }
         }
+        if (close_flag_) {
+            return;//closed in the callback
+        }
         TryRead();
     }
 
     void OnWrite(uv_udp_send_t* req, int status) {
         if (close_flag_) {
+            UdpReqInfo* wr = (UdpReqInfo*)req;
+            free(wr->buf.base);
+            free(wr);
             return;
         }
         UdpTuple addr;
@@ -247,6 +263,13 @@ inline void UdpSendCallback(uv_udp_send_t* req, int status) {
     }
 }
 
+inline void UdpCloseCallback(uv_handle_t* handle) {
+    UdpSessionBase* session = (UdpSessionBase*)handle->data;
+    if (session) {
+        delete session;
+    }
+}
+
 }
 
 #endif //UDP_PUB_HPP
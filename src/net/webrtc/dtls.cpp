@@ -2,7 +2,6 @@
 #include "byte_crypto.hpp"
 #include "logger.hpp"
 #include "timeex.hpp"
-#include "peerconnection.hpp"
 
 #include <assert.h>
 #include <stdio.h>
@@ -209,8 +208,8 @@ static long openssl_dtls_bio_out_callback_ex(BIO *b, int oper, const char *argp,
     return retvalue;
 }
 
-RtcDtls::RtcDtls(PeerConnection* pc, Logger* logger):logger_(logger),
-    pc_(pc)
+RtcDtls::RtcDtls(RtcDtlsCallbackI* cb, Logger* logger):logger_(logger),
+    cb_(cb)
 {
     for (auto& item : srtp_crypto_suite_vec) {
         if (!srtp_ciphers_.empty()) {
@@ -230,6 +229,28 @@ RtcDtls::RtcDtls(PeerConnection* pc, Logger* logger):logger_(logger),
 RtcDtls::~RtcDtls()
 {
     LogInfof(logger_, "destruct RtcDtls");
+    if (dtls_) {
+        //the bio_in and bio_out are freed by SSL_free
+        SSL_free(dtls_);
+        dtls_   = nullptr;
+        bio_in_ = nullptr;
+    }
+}
+
+std::mutex RtcDtlsIdentity::s_mutex_;
+std::shared_ptr<RtcDtlsIdentity> RtcDtlsIdentity::s_identity_;
+int64_t RtcDtlsIdentity::s_rotate_interval_ms_ = DTLS_IDENTITY_ROTATE_MS;
+
+RtcDtlsIdentity::RtcDtlsIdentity(Logger* logger):logger_(logger)
+{
+}
+
+RtcDtlsIdentity::~RtcDtlsIdentity()
+{
+    if (ctx_) {
+        SSL_CTX_free(ctx_);
+        ctx_ = nullptr;
+    }
     if(dtls_pkey_) {
         EVP_PKEY_free(dtls_pkey_);
         dtls_pkey_ = nullptr;
@@ -244,7 +265,58 @@ RtcDtls::~RtcDtls()
     }
 }
 
-int RtcDtls::GenPrivateKey() {
+void RtcDtlsIdentity::SetRotateInterval(int64_t interval_ms) {
+    std::lock_guard<std::mutex> lock(s_mutex_);
+    s_rotate_interval_ms_ = (interval_ms > 0) ? interval_ms : 0;
+}
+
+int64_t RtcDtlsIdentity::GetRotateInterval() {
+    std::lock_guard<std::mutex> lock(s_mutex_);
+    return s_rotate_interval_ms_;
+}
+
+std::shared_ptr<RtcDtlsIdentity> RtcDtlsIdentity::GetIdentity(Logger* logger) {
+    std::lock_guard<std::mutex> lock(s_mutex_);
+    int64_t now_ms = now_millisec();
+
+    if (s_identity_ && (s_rotate_interval_ms_ > 0)
+        && (now_ms - s_identity_->create_ms_ < s_rotate_interval_ms_)) {
+        return s_identity_;
+    }
+
+    std::shared_ptr<RtcDtlsIdentity> identity_ptr = std::make_shared<RtcDtlsIdentity>(logger);
+    if (identity_ptr->Init() < 0) {
+        LogErrorf(logger, "dtls identity init error");
+        return nullptr;
+    }
+
+    if (s_rotate_interval_ms_ > 0) {
+        LogInfof(logger, "dtls identity rotated, fingerprint:%s", identity_ptr->fingerprint_.c_str());
+        s_identity_ = identity_ptr;
+    } else {
+        s_identity_ = nullptr;
+    }
+    return identity_ptr;
+}
+
+int RtcDtlsIdentity::Init() {
+    /* Generate a private key to ctx->dtls_pkey. */
+    if (GenPrivateKey() < 0) {
+        return -1;
+    }
+
+    if (GenPrivateCert() < 0) {
+        return -1;
+    }
+
+    if (InitContext() < 0) {
+        return -1;
+    }
+    create_ms_ = now_millisec();
+    return 0;
+}
+
+int RtcDtlsIdentity::GenPrivateKey() {
     LogInfof(logger_, "openssl version:%08x", OPENSSL_VERSION_NUMBER);
 #if OPENSSL_VERSION_NUMBER < 0x30000000L /* OpenSSL 3.0 */
     EC_GROUP *ecgroup = NULL;
@@ -295,7 +367,6 @@ int RtcDtls::GenPrivateKey() {
         EC_GROUP_free(ecgroup);
         return -1;
     }
-    EC_KEY_free(dtls_eckey_);
     EC_GROUP_free(ecgroup);
 #else
     dtls_pkey_ = EVP_EC_gen(curve);
@@ -309,14 +380,13 @@ int RtcDtls::GenPrivateKey() {
 }
 
 int RtcDtls::SslContextInit() {
-    /* Generate a private key to ctx->dtls_pkey. */
-    if (GenPrivateKey() < 0) {
-        return -1;
-    }
-
-    if (GenPrivateCert() < 0) {
+    /* Reuse the process wide key, certificate and SSL_CTX. */
+    identity_ = RtcDtlsIdentity::GetIdentity(logger_);
+    if (!identity_) {
         return -1;
     }
+    ctx_         = identity_->ctx_;
+    fingerprint_ = identity_->fingerprint_;
 
     if (InitContext() < 0) {
         return -1;
@@ -326,7 +396,7 @@ int RtcDtls::SslContextInit() {
     return 0;
 }
 
-int RtcDtls::GenPrivateCert() {
+int RtcDtlsIdentity::GenPrivateCert() {
     const uint8_t *aor = (uint8_t*)"cppstreamer.org";
 
     dtls_cert_ = X509_new();
@@ -435,10 +505,7 @@ int RtcDtls::GenPrivateCert() {
     return 0;
 }
 
-int RtcDtls::InitContext() {
-    int ret = 0;
-    BIO *bio_out = NULL;
-
+int RtcDtlsIdentity::InitContext() {
 #if OPENSSL_VERSION_NUMBER < 0x10002000L /* OpenSSL v1.0.2 */
     ctx_ = SSL_CTX_new(DTLSv1_method());
 #else
@@ -493,12 +560,19 @@ int RtcDtls::InitContext() {
     SSL_CTX_set_verify_depth(ctx_, 4);
     /* Whether we should read as many input bytes as possible (for non-blocking reads) or not. */
     SSL_CTX_set_read_ahead(ctx_, 1);
-    /* Only support SRTP_AES128_CM_SHA1_80, please read ssl/d1_srtp.c */
-    if (SSL_CTX_set_tlsext_use_srtp(ctx_, "SRTP_AES128_CM_SHA1_80")) {
+    /* The dtls server selects its most preferred profile offered by the client, please read ssl/d1_srtp.c */
+    if (SSL_CTX_set_tlsext_use_srtp(ctx_, DTLS_SRTP_PROFILES)) {
         LogErrorf(logger_, "DTLS: SSL_CTX_set_tlsext_use_srtp failed");
         return -1;
     }
 
+    return 0;
+}
+
+int RtcDtls::InitContext() {
+    int ret = 0;
+    BIO *bio_out = NULL;
+
     /* The dtls should not be created unless the dtls_ctx has been initialized. */
     dtls_ = SSL_new(ctx_);
     if (!dtls_) {
@@ -648,7 +722,7 @@ void RtcDtls::OnDtlsData(uint8_t* buf, int size) {
         return;
     }
 
-    SetupSRtp(CRYPTO_SUITE_AES_CM_128_HMAC_SHA1_80);
+    SetupSRtp(GetSelectedSRtpSuite());
 
     return;
 }
@@ -675,7 +749,11 @@ int RtcDtls::DtlsStart()
     LogInfof(logger_, "dtls start...");
     dtls_handshake_starttime_ = now_millisec();
 
-    SSL_set_accept_state(dtls_);
+    if (role_ == ROLE_CLIENT) {
+        SSL_set_connect_state(dtls_);
+    } else {
+        SSL_set_accept_state(dtls_);
+    }
     LogInfof(logger_, "dtls work in %s mode", (SSL_is_server(dtls_) == 1) ? "server" : "client");
 
     r0 = SSL_do_handshake(dtls_);
@@ -693,6 +771,40 @@ int RtcDtls::DtlsStart()
     return ret;
 }
 
+void RtcDtls::CheckTimeout() {
+    if (!dtls_ || dtls_done_for_us_) {
+        return;
+    }
+    struct timeval timeout;
+    if (DTLSv1_get_timeout(dtls_, &timeout) != 1) {
+        return;
+    }
+    if (timeout.tv_sec > 0 || timeout.tv_usec > 0) {
+        return;
+    }
+    //the flight is written by the bio out callback again
+    if (DTLSv1_handle_timeout(dtls_) < 0) {
+        LogErrorf(logger_, "DTLS: handle timeout error");
+    }
+}
+
+CRYPTO_SUITE_ENUM RtcDtls::GetSelectedSRtpSuite() {
+    SRTP_PROTECTION_PROFILE* profile = SSL_get_selected_srtp_profile(dtls_);
+
+    if (!profile || !profile->name) {
+        LogWarnf(logger_, "no srtp profile is selected, use SRTP_AES128_CM_SHA1_80");
+        return CRYPTO_SUITE_AES_CM_128_HMAC_SHA1_80;
+    }
+    for (auto& entry : srtp_crypto_suites) {
+        if (strcmp(profile->name, entry.name) == 0) {
+            LogInfof(logger_, "dtls selected srtp profile:%s", entry.name);
+            return entry.crypto_suite;
+        }
+    }
+    LogErrorf(logger_, "unknown srtp profile:%s", profile->name);
+    return CRYPTO_SUITE_NONE;
+}
+
 int RtcDtls::SetupSRtp(CRYPTO_SUITE_ENUM srtp_suite) {
     size_t srtp_keylength{ 0 };
     size_t srtp_saltlength{ 0 };
@@ -753,10 +865,18 @@ int RtcDtls::SetupSRtp(CRYPTO_SUITE_ENUM srtp_suite) {
     }
 
 
-    srtp_remote_key  = srtp_material;
-    srtp_local_key   = srtp_remote_key + srtp_keylength;
-    srtp_remote_salt = srtp_local_key + srtp_keylength;
-    srtp_local_salt  = srtp_remote_salt + srtp_saltlength;
+    //client_key | server_key | client_salt | server_salt
+    if (role_ == ROLE_CLIENT) {
+        srtp_local_key   = srtp_material;
+        srtp_remote_key  = srtp_local_key + srtp_keylength;
+        srtp_local_salt  = srtp_remote_key + srtp_keylength;
+        srtp_remote_salt = srtp_local_salt + srtp_saltlength;
+    } else {
+        srtp_remote_key  = srtp_material;
+        srtp_local_key   = srtp_remote_key + srtp_keylength;
+        srtp_remote_salt = srtp_local_key + srtp_keylength;
+        srtp_local_salt  = srtp_remote_salt + srtp_saltlength;
+    }
 
         
     memcpy(srtp_local_masterkey, srtp_local_key, srtp_keylength);
@@ -770,7 +890,7 @@ int RtcDtls::SetupSRtp(CRYPTO_SUITE_ENUM srtp_suite) {
     LogInfof(logger_, "srtp init connected....");
 
     //set srtp parameters
-    pc_->OnDtlsConnected(srtp_suite,
+    cb_->OnDtlsConnected(srtp_suite,
                 srtp_local_masterkey, srtp_masterlength,
                 srtp_remote_masterkey, srtp_masterlength);
 
@@ -9,6 +9,8 @@
 #include <string>
 #include <vector>
 #include <map>
+#include <memory>
+#include <mutex>
 #include <openssl/ssl.h>
 #include <openssl/err.h>
 #include <openssl/ec.h>
@@ -19,11 +21,16 @@ namespace cpp_streamer
 
 #define DTLS_MTU 1350
 
+//the shared dtls certificate is regenerated once a day by default
+#define DTLS_IDENTITY_ROTATE_MS (24*60*60*1000)
+
 #define SRTP_MASTER_KEY_LENGTH   16
 #define SRTP_MASTER_SALT_LENGTH  14
 #define SRTP_MASTER_LENGTH (SRTP_MASTER_KEY_LENGTH + SRTP_MASTER_SALT_LENGTH)
 
 #define DTLS_SRTP_MASTER_KEY_LEN (16 + 16 + 14 + 14)
+//the srtp profiles in preference order, aes-gcm is done with one pass by openssl
+#define DTLS_SRTP_PROFILES "SRTP_AEAD_AES_128_GCM:SRTP_AES128_CM_SHA1_80"
 #define RTC_ELAPSED(x, y) ((y) - (x))
 
 #define SRTP_AESGCM_256_MASTER_KEY_LENGTH   32
@@ -121,15 +128,64 @@ public:
     uint16_t port;
 };
 
-class PeerConnection;
+/*
+ * the srtp keys are exported when the dtls handshake is done,
+ * the local key protects what we send, the remote key decrypts what we receive.
+ */
+class RtcDtlsCallbackI
+{
+public:
+    virtual void OnDtlsConnected(CRYPTO_SUITE_ENUM suite,
+                uint8_t* local_key, size_t local_key_len,
+                uint8_t* remote_key, size_t remote_key_len) = 0;
+};
 
-class RtcDtls
+/*
+ * private key, self-signed certificate, fingerprint and SSL_CTX
+ * shared by all the RtcDtls sessions in the process.
+ * the identity is regenerated when it is older than the rotate interval,
+ * the sessions created before keep the old one alive by the shared_ptr.
+ * rotate interval 0 means every session generates its own identity.
+ */
+class RtcDtlsIdentity
 {
+public:
+    RtcDtlsIdentity(Logger* logger);
+    ~RtcDtlsIdentity();
+
+public:
+    static std::shared_ptr<RtcDtlsIdentity> GetIdentity(Logger* logger);
+    static void SetRotateInterval(int64_t interval_ms);
+    static int64_t GetRotateInterval();
+
+public:
+    int Init();
+
 public:
     Logger* logger_      = nullptr;
     EVP_PKEY* dtls_pkey_ = nullptr;
     EC_KEY* dtls_eckey_  = NULL;
     X509 *dtls_cert_     = nullptr;
+    SSL_CTX* ctx_        = nullptr;
+    std::string fingerprint_;
+    int64_t create_ms_   = 0;
+
+private:
+    int GenPrivateKey();
+    int GenPrivateCert();
+    int InitContext();
+
+private:
+    static std::mutex s_mutex_;
+    static std::shared_ptr<RtcDtlsIdentity> s_identity_;
+    static int64_t s_rotate_interval_ms_;
+};
+
+class RtcDtls
+{
+public:
+    Logger* logger_      = nullptr;
+    std::shared_ptr<RtcDtlsIdentity> identity_;
     std::string fg_algorithm_;
     std::string fingerprint_;
 
@@ -159,9 +215,14 @@ public:
     char error_message[512];
 
 public:
-    UdpClient* udp_client_ = nullptr;
+    UdpSessionBase* udp_client_ = nullptr;
     UdpTuple remote_address_;
 
+public:
+    //ROLE_SERVER: wait for the ClientHello(the sfu is active),
+    //ROLE_CLIENT: send the ClientHello when started(the loopback server answers as active)
+    DTLS_ROLE role_ = ROLE_SERVER;
+
 public:
     std::string local_fragment_;
     std::string local_pwd_; 
@@ -178,10 +239,10 @@ public:
     std::string srtp_ciphers_;
 
 private:
-    PeerConnection* pc_;
+    RtcDtlsCallbackI* cb_;
 
 public:
-    RtcDtls(PeerConnection* pc, Logger* logger);
+    RtcDtls(RtcDtlsCallbackI* cb, Logger* logger);
     ~RtcDtls();
 
 public:
@@ -190,6 +251,8 @@ public:
 public:
     int SslContextInit();
     int DtlsStart();
+    //the handshake flight is sent again when it is timeout, called by the owner's timer
+    void CheckTimeout();
 
 public:
     void OnDtlsData(uint8_t* data, int size);
@@ -197,10 +260,9 @@ public:
     int OnState(enum DTLSState state, const char* type, const char* desc);
 
 private:
-    int GenPrivateKey();
-    int GenPrivateCert();
     int InitContext();
     int SetupSRtp(CRYPTO_SUITE_ENUM crypto_suite = CRYPTO_SUITE_AES_CM_128_HMAC_SHA1_80);
+    CRYPTO_SUITE_ENUM GetSelectedSRtpSuite();
 };
 
 }
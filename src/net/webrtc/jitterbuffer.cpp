@@ -7,13 +7,10 @@ namespace cpp_streamer
 JitterBuffer::JitterBuffer(MEDIA_PKT_TYPE type,
         JitterBufferCallbackI* cb, 
         uv_loop_t* loop, 
-        Logger* logger):TimerInterface(loop, 100)
+        Logger* logger):TimerInterface(loop, 100, true)
                        , logger_(logger)
                        , cb_(cb) 
                        , media_type_(type){
-    for (size_t i = 0; i < BUFFER_POOL_SIZE; i++) {
-        pkt_buffers_[i] = new uint8_t[RTP_PACKET_MAX_SIZE];
-    }
     if (type == MEDIA_VIDEO_TYPE) {
         buffer_timeout_ = JITTER_BUFFER_VIDEO_TIMEOUT;
     } else if (type == MEDIA_AUDIO_TYPE) {
@@ -25,22 +22,18 @@ JitterBuffer::JitterBuffer(MEDIA_PKT_TYPE type,
 }
 
 JitterBuffer::~JitterBuffer() {
-    for (size_t i = 0; i < BUFFER_POOL_SIZE; i++) {
-        if (pkt_buffers_[i]) {
-            delete[] pkt_buffers_[i];
-        }
+    for (auto item : rtp_packets_map_) {
+        item.second->Release();
     }
+    rtp_packets_map_.clear();
 }
 
 void JitterBuffer::InputRtpPacket(int clock_rate, 
-            RtpPacket* pkt) {
+            RtpPacketInfo* pkt_info) {
     int64_t extend_seq = 0;
     bool reset = false;
     bool first_pkt = false;
-    size_t index = (buffer_index_++) % RTP_PACKET_MAX_SIZE;
-    uint8_t* buffer = pkt_buffers_[index];
-
-    RtpPacket* input_pkt = pkt->Clone(buffer);
+    RtpPacket* input_pkt = pkt_info->pkt;
 
     if (!init_flag_) {
         init_flag_ = true;
@@ -52,6 +45,7 @@ void JitterBuffer::InputRtpPacket(int clock_rate,
     } else {
         bool bad_pkt = UpdateSeq(input_pkt, extend_seq, reset);
         if (!bad_pkt) {
+            pkt_info->Release();
             return;
         }
         if (reset) {
@@ -59,24 +53,24 @@ void JitterBuffer::InputRtpPacket(int clock_rate,
         }
     }
 
-    auto pkt_info_ptr = std::make_shared<RtpPacketInfo>(media_type_,
-                                                        clock_rate,
-                                                        input_pkt,
-                                                        extend_seq);
+    pkt_info->media_type_ = media_type_;
+    pkt_info->clock_rate_ = clock_rate;
+    pkt_info->extend_seq_ = extend_seq;
+
     if (reset) {
         //if the rtc client is reset, call the reset callback which send pli
-        ReportLost(pkt_info_ptr);
+        ReportLost(pkt_info);
     }
 
     //if it's the first packet, output the packet
     if (first_pkt || reset) {
-        OutputPacket(pkt_info_ptr);
+        OutputPacket(pkt_info);
         return;
     }
 
     //if the seq is continued, output the packet
     if ((output_seq_ + 1) == extend_seq) {
-        OutputPacket(pkt_info_ptr);
+        OutputPacket(pkt_info);
 
         //check the packet in map
         for (auto iter = rtp_packets_map_.begin();
@@ -88,8 +82,9 @@ void JitterBuffer::InputRtpPacket(int clock_rate,
                     LogDebugf(logger_, "jitter buffer media type:%d, output seq(%d) in buffer queue",
                         iter->second->media_type_, pkt_extend_seq);
                 }
-                OutputPacket(iter->second);
+                RtpPacketInfo* buffered_info = iter->second;
                 iter = rtp_packets_map_.erase(iter);
+                OutputPacket(buffered_info);
                 continue;
             }
             break;
@@ -97,13 +92,19 @@ void JitterBuffer::InputRtpPacket(int clock_rate,
         return;
     } else if (extend_seq <= output_seq_) {
         LogInfof(logger_, "receive old seq:%ld, output_seq:%ld media type:%d",
-                extend_seq, output_seq_, pkt_info_ptr->media_type_);
+                extend_seq, output_seq_, pkt_info->media_type_);
+        pkt_info->Release();
+        return;
+    }
+    auto ret = rtp_packets_map_.insert(std::make_pair(extend_seq, pkt_info));
+    if (!ret.second) {
+        //the duplicated packet, the buffered one is kept
+        pkt_info->Release();
         return;
     }
-    rtp_packets_map_[extend_seq] = pkt_info_ptr;
-    if (pkt_info_ptr->media_type_ == MEDIA_VIDEO_TYPE) {
+    if (pkt_info->media_type_ == MEDIA_VIDEO_TYPE) {
         LogDebugf(logger_, "JitterBuffer media type:%d, packets queue len:%lu, pkt seq:%d, last output seq:%d",
-            pkt_info_ptr->media_type_, rtp_packets_map_.size(), pkt_info_ptr->extend_seq_, output_seq_);
+            pkt_info->media_type_, rtp_packets_map_.size(), pkt_info->extend_seq_, output_seq_);
     }
 
     CheckTimeout();
@@ -122,23 +123,23 @@ void JitterBuffer::CheckTimeout() {
     int64_t now_ms = now_millisec();
     for(auto iter = rtp_packets_map_.begin();
         iter != rtp_packets_map_.end();) {
-        std::shared_ptr<RtpPacketInfo> pkt_info_ptr = iter->second;
-        int64_t diff_t = now_ms - pkt_info_ptr->pkt->GetLocalMs();
+        RtpPacketInfo* pkt_info = iter->second;
+        int64_t diff_t = now_ms - pkt_info->pkt->GetLocalMs();
 
         if (diff_t > buffer_timeout_) {
-            if (pkt_info_ptr->media_type_ == MEDIA_VIDEO_TYPE) {
+            if (pkt_info->media_type_ == MEDIA_VIDEO_TYPE) {
                 LogInfof(logger_, "timeout output type:%d, seq:%d, timeout:%ld",
-                    pkt_info_ptr->media_type_, pkt_info_ptr->extend_seq_, buffer_timeout_);
+                    pkt_info->media_type_, pkt_info->extend_seq_, buffer_timeout_);
             }
 
-            OutputPacket(pkt_info_ptr);
             iter = rtp_packets_map_.erase(iter);
-            ReportLost(pkt_info_ptr);
+            ReportLost(pkt_info);
+            OutputPacket(pkt_info);
             continue;
         }
-        if ((output_seq_ + 1) == pkt_info_ptr->extend_seq_) {
-            OutputPacket(iter->second);
+        if ((output_seq_ + 1) == pkt_info->extend_seq_) {
             iter = rtp_packets_map_.erase(iter);
+            OutputPacket(pkt_info);
             continue;
         }
         iter++;
@@ -147,19 +148,19 @@ void JitterBuffer::CheckTimeout() {
     return;
 }
 
-void JitterBuffer::ReportLost(std::shared_ptr<RtpPacketInfo> pkt_ptr) {
+void JitterBuffer::ReportLost(RtpPacketInfo* pkt_info) {
     int64_t now_ms = now_millisec();
 
     if (now_ms - report_lost_ts_ > 500) {
         report_lost_ts_ = now_ms;
-        cb_->RtpPacketReset(pkt_ptr);
+        cb_->RtpPacketReset(pkt_info);
     }
     
 }
 
-void JitterBuffer::OutputPacket(std::shared_ptr<RtpPacketInfo> pkt_ptr) {
-    output_seq_ = pkt_ptr->extend_seq_;
-    cb_->RtpPacketOutput(pkt_ptr);
+void JitterBuffer::OutputPacket(RtpPacketInfo* pkt_info) {
+    output_seq_ = pkt_info->extend_seq_;
+    cb_->RtpPacketOutput(pkt_info);
     return;
 }
 
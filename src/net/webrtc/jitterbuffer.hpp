@@ -13,8 +13,6 @@
 
 namespace cpp_streamer
 {
-#define BUFFER_POOL_SIZE 2048
-
 class JitterBuffer : public TimerInterface
 {
 public:
@@ -22,8 +20,9 @@ public:
     ~JitterBuffer();
 
 public:
+    //the jitter buffer owns the pkt_info
     void InputRtpPacket(int clock_rate, 
-            RtpPacket* input_pkt);
+            RtpPacketInfo* pkt_info);
 
 public:
     virtual void OnTimer() override;
@@ -31,9 +30,9 @@ public:
 private:
     void InitSeq(RtpPacket* input_pkt);
     bool UpdateSeq(RtpPacket* input_pkt, int64_t& extend_seq, bool& reset);
-    void OutputPacket(std::shared_ptr<RtpPacketInfo>);
+    void OutputPacket(RtpPacketInfo* pkt_info);
     void CheckTimeout();
-    void ReportLost(std::shared_ptr<RtpPacketInfo> pkt_ptr);
+    void ReportLost(RtpPacketInfo* pkt_info);
 
 private:
     Logger* logger_ = nullptr;
@@ -44,16 +43,12 @@ private:
     uint16_t max_seq_  = 0;
     uint32_t bad_seq_  = RTP_SEQ_MOD + 1;   /* so seq == bad_seq is false */
     uint32_t cycles_   = 0;
-    std::map<int64_t, std::shared_ptr<RtpPacketInfo>> rtp_packets_map_;//key: extend_seq, value: rtp packet info
+    std::map<int64_t, RtpPacketInfo*> rtp_packets_map_;//key: extend_seq, value: rtp packet info
 
 private:
     int64_t output_seq_ = 0;
     int64_t report_lost_ts_ = -1;
 
-private:
-    uint8_t* pkt_buffers_[BUFFER_POOL_SIZE];
-    size_t buffer_index_ = 0;
-
 private:
     int64_t buffer_timeout_ = JITTER_BUFFER_VIDEO_TIMEOUT;
 };
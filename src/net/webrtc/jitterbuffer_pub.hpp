@@ -3,47 +3,136 @@
 
 #include "rtp_packet.hpp"
 #include "av.hpp"
+#include "logger.hpp"
 #include <stddef.h>
 #include <stdint.h>
+#include <string.h>
 #include <string>
 #include <memory>
+#include <vector>
 
 namespace cpp_streamer
 {
 #define JITTER_BUFFER_AUDIO_TIMEOUT 100 //ms
 #define JITTER_BUFFER_VIDEO_TIMEOUT 400 //ms
 
+#define RTP_PACKET_POOL_KEEP 512 //the free slots kept by the pool, over it they are freed
+
+class RtpPacketPool;
+
+/*
+ * one received rtp packet in a slot of RtpPacketPool, the pkt is a view of the slot data.
+ * the slot is owned by the jitter buffer and then by the pack handle,
+ * the last owner returns it to the pool by Release().
+ */
 class RtpPacketInfo
 {
 public:
-    RtpPacketInfo(MEDIA_PKT_TYPE media_type,
-            int clock_rate, 
-            RtpPacket* input_pkt, 
-            int64_t extend_seq):media_type_(media_type)
-                                , extend_seq_(extend_seq)
-                                , clock_rate_(clock_rate)
+    RtpPacketInfo(RtpPacketPool* pool):pool_(pool)
     {
-        this->pkt = input_pkt->Clone();
     }
 
     ~RtpPacketInfo()
     {
-        delete this->pkt;
+    }
+
+public:
+    //copy the rtp data into the slot and parse it, throw when it is not rtp
+    void Load(const uint8_t* data, size_t len) {
+        if (len > RTP_PACKET_MAX_SIZE) {
+            CSM_THROW_ERROR("rtp len(%lu) is to large", len);
+        }
         this->pkt = nullptr;
+        memcpy(data_, data, len);
+        packet_.Reset(data_, len);
+        this->pkt = &packet_;
     }
 
+    inline void Release();
+
 public:
-    MEDIA_PKT_TYPE media_type_;
+    MEDIA_PKT_TYPE media_type_ = MEDIA_UNKOWN_TYPE;
     RtpPacket* pkt = nullptr;
     int64_t extend_seq_ = 0;
     int clock_rate_     = 0;
+
+private:
+    RtpPacketPool* pool_ = nullptr;
+    RtpPacket packet_;
+    uint8_t data_[RTP_PACKET_MAX_SIZE];
 };
 
+/*
+ * the receive slots of one PeerConnection, they are reused for the incoming
+ * rtp packets instead of the allocations for each packet.
+ * it must outlive the jitter buffers and the pack handles which own the slots.
+ */
+class RtpPacketPool
+{
+public:
+    RtpPacketPool(size_t keep = RTP_PACKET_POOL_KEEP):keep_(keep)
+    {
+        free_.reserve(keep_);
+    }
+
+    ~RtpPacketPool()
+    {
+        for (auto info : free_) {
+            delete info;
+        }
+        free_.clear();
+    }
+
+public:
+    RtpPacketInfo* Get() {
+        RtpPacketInfo* info = nullptr;
+
+        if (free_.empty()) {
+            info = new RtpPacketInfo(this);
+            alloc_count_++;
+        } else {
+            info = free_.back();
+            free_.pop_back();
+        }
+        in_use_++;
+        return info;
+    }
+
+    void Put(RtpPacketInfo* info) {
+        in_use_--;
+        info->pkt = nullptr;
+        if (free_.size() >= keep_) {
+            delete info;
+            return;
+        }
+        free_.push_back(info);
+    }
+
+    size_t InUseCount() { return in_use_; }
+    size_t FreeCount() { return free_.size(); }
+    int64_t AllocCount() { return alloc_count_; }
+
+private:
+    size_t keep_   = RTP_PACKET_POOL_KEEP;
+    size_t in_use_ = 0;
+    int64_t alloc_count_ = 0;
+    std::vector<RtpPacketInfo*> free_;
+};
+
+inline void RtpPacketInfo::Release() {
+    if (pool_) {
+        pool_->Put(this);
+        return;
+    }
+    delete this;
+}
+
 class JitterBufferCallbackI
 {
 public:
-    virtual void RtpPacketReset(std::shared_ptr<RtpPacketInfo> pkt_ptr) = 0;
-    virtual void RtpPacketOutput(std::shared_ptr<RtpPacketInfo> pkt_ptr) = 0;
+    virtual void RtpPacketReset(RtpPacketInfo* pkt_info) = 0;
+    //the callback owns the pkt_info, and releases it
+    virtual void RtpPacketOutput(RtpPacketInfo* pkt_info) = 0;
 };
 
 }
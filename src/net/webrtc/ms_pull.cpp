@@ -25,12 +25,17 @@ namespace cpp_streamer
 {
 #define MEDIASOUP_PULL_NAME "mspull"
 
+std::map<std::string, std::string> MsPull::def_options_ = {
+    {"keepalive", "false"}//reuse the http connections by the pool of the loop
+};
+
 MsPull::MsPull()
 {
     ByteCrypto::Init();
     name_ = MEDIASOUP_PULL_NAME;
     name_ += "_";
     name_ += UUID::MakeUUID();
+    options_ = def_options_;
 }
 
 MsPull::~MsPull()
@@ -192,7 +197,8 @@ bool MsPull::GetHostInfoByUrl(const std::string& url, std::string& host, uint16_
 
 void MsPull::BroadCasterRequest() {
     std::map<std::string, std::string> headers;
-    hc_req_ = new HttpClient(loop_, host_, port_, this, logger_, true);
+    hc_req_ = new HttpClient(loop_, host_, port_, this, logger_, true,
+            options_["keepalive"] == "true");
 
     std::stringstream subpath;
     ///rooms/:roomId/broadcasters
@@ -247,6 +253,9 @@ void MsPull::HandleBroadCasterResponse(std::shared_ptr<HttpClientResponse> resp_
                 resp_ptr->status_code_, data_str.c_str());
         return;
     }
+    if (hc_req_) {
+        Report("connect_ms", std::to_string(hc_req_->GetConnectMs()));
+    }
     Report("broadcaster", "ready");
     std::string data_str(resp_ptr->data_.Data(), resp_ptr->data_.DataLen());
 
@@ -507,7 +516,8 @@ void MsPull::HandleAudioConsumeResponse(std::shared_ptr<HttpClientResponse> resp
 
 void MsPull::TransportRequest() {
     std::map<std::string, std::string> headers;
-    hc_transport_ = new HttpClient(loop_, host_, port_, this, logger_, true);
+    hc_transport_ = new HttpClient(loop_, host_, port_, this, logger_, true,
+            options_["keepalive"] == "true");
 
     std::stringstream subpath;
     ///rooms/:roomId/broadcasters/:broadcasterId/transports
@@ -529,7 +539,8 @@ void MsPull::TransportRequest() {
 
 void MsPull::TransportConnectRequest() {
     std::map<std::string, std::string> headers;
-    hc_trans_connect_ = new HttpClient(loop_, host_, port_, this, logger_, true);
+    hc_trans_connect_ = new HttpClient(loop_, host_, port_, this, logger_, true,
+            options_["keepalive"] == "true");
 
     std::stringstream subpath;
     ///rooms/:roomId/broadcasters/:broadcasterId/transports/:transportId/connect
@@ -575,7 +586,8 @@ void MsPull::OnState(const std::string& type, const std::string& value) {
 
 void MsPull::VideoConsumeRequest() {
     std::map<std::string, std::string> headers;
-    hc_video_consume_ = new HttpClient(loop_, host_, port_, this, logger_, true);
+    hc_video_consume_ = new HttpClient(loop_, host_, port_, this, logger_, true,
+            options_["keepalive"] == "true");
 
     std::stringstream subpath;
     /*/rooms/:roomId/broadcasters/:broadcasterId/transports/:transportId/consume
@@ -600,7 +612,8 @@ void MsPull::VideoConsumeRequest() {
 
 void MsPull::AudioConsumeRequest() {
     std::map<std::string, std::string> headers;
-    hc_audio_consume_ = new HttpClient(loop_, host_, port_, this, logger_, true);
+    hc_audio_consume_ = new HttpClient(loop_, host_, port_, this, logger_, true,
+            options_["keepalive"] == "true");
 
     std::stringstream subpath;
     /*/rooms/:roomId/broadcasters/:broadcasterId/transports/:transportId/consume
@@ -632,6 +645,8 @@ void MsPull::Report(const std::string& type, const std::string& value) {
 }
 
 void MsPull::OnReceiveMediaPacket(Media_Packet_Ptr pkt_ptr) {
+    metrics_.OnPacket(pkt_ptr->buffer_ptr_->DataLen());
+    metrics_.OnIngress(pkt_ptr->ingress_us_);
     for (auto sinker : sinkers_) {
         sinker.second->SourceData(pkt_ptr);
     }
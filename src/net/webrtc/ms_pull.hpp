@@ -77,6 +77,9 @@ private:
 private:
     void Report(const std::string& type, const std::string& value);
 
+private:
+    static std::map<std::string, std::string> def_options_;
+
 private:
     Logger* logger_ = nullptr;
     std::string name_;
@@ -28,12 +28,17 @@ void SourceBroadcasterData(uv_async_t *handle) {
     ms->HandleMediaData();
 }
 
+std::map<std::string, std::string> MsPush::def_options_ = {
+    {"keepalive", "false"}//reuse the http connections by the pool of the loop
+};
+
 MsPush::MsPush()
 {
     ByteCrypto::Init();
     name_ = MEDIASOUP_PUSH_NAME;
     name_ += "_";
     name_ += UUID::MakeUUID();
+    options_ = def_options_;
 }
 
 MsPush::~MsPush()
@@ -59,6 +64,7 @@ Media_Packet_Ptr MsPush::GetMediaPacket() {
         
     pkt_ptr = packet_queue_.front();
     packet_queue_.pop();
+    metrics_.SetQueueDepth(packet_queue_.size());
 
     return pkt_ptr;
 }
@@ -69,6 +75,7 @@ void MsPush::HandleMediaData() {
         if (!pkt_ptr) {
             break;
         }
+        metrics_.BeginStage();
 
         if (pkt_ptr->av_type_ == MEDIA_VIDEO_TYPE) {
             pc_->SendVideoPacket(pkt_ptr);
@@ -78,7 +85,15 @@ void MsPush::HandleMediaData() {
             LogErrorf(logger_, "input media type error:%s",
                     avtype_tostring(pkt_ptr->av_type_).c_str());
         }
+        metrics_.EndStage();
+        //the rtp packets of it are sent as srtp
+        metrics_.OnOutput(pkt_ptr->ingress_us_);
     }
+
+    //the video frames dropped by the congestion control of the send stream
+    int64_t dropped_frames = pc_->GetDroppedFrames();
+    metrics_.OnDrop(dropped_frames - dropped_frames_);
+    dropped_frames_ = dropped_frames;
     return;
 }
 
@@ -114,6 +129,9 @@ int MsPush::SourceData(Media_Packet_Ptr pkt_ptr) {
     Media_Packet_Ptr new_ptr = pkt_ptr->copy();
 
     packet_queue_.push(new_ptr);
+    metrics_.OnPacket(new_ptr->buffer_ptr_->DataLen());
+    metrics_.SetQueueDepth(packet_queue_.size());
+    metrics_.OnIngress(new_ptr->ingress_us_);
 
     async_.data = (void*)this;
     uv_async_send(&async_);
@@ -140,7 +158,8 @@ void MsPush::StartNetwork(const std::string& url, void* loop_handle) {
 
 void MsPush::BroadCasterRequest() {
     std::map<std::string, std::string> headers;
-    hc_req_ = new HttpClient(loop_, host_, port_, this, logger_, true);
+    hc_req_ = new HttpClient(loop_, host_, port_, this, logger_, true,
+            options_["keepalive"] == "true");
 
     std::stringstream subpath;
     ///rooms/:roomId/broadcasters
@@ -165,7 +184,8 @@ void MsPush::BroadCasterRequest() {
 
 void MsPush::TransportRequest() {
     std::map<std::string, std::string> headers;
-    hc_transport_ = new HttpClient(loop_, host_, port_, this, logger_, true);
+    hc_transport_ = new HttpClient(loop_, host_, port_, this, logger_, true,
+            options_["keepalive"] == "true");
 
     std::stringstream subpath;
     ///rooms/:roomId/broadcasters/:broadcasterId/transports
@@ -184,7 +204,8 @@ void MsPush::TransportRequest() {
 
 void MsPush::TransportConnectRequest() {
     std::map<std::string, std::string> headers;
-    hc_trans_connect_ = new HttpClient(loop_, host_, port_, this, logger_, true);
+    hc_trans_connect_ = new HttpClient(loop_, host_, port_, this, logger_, true,
+            options_["keepalive"] == "true");
 
     std::stringstream subpath;
     ///rooms/:roomId/broadcasters/:broadcasterId/transports/:transportId/connect
@@ -217,7 +238,8 @@ void MsPush::TransportConnectRequest() {
 
 void MsPush::VideoProduceRequest() {
     std::map<std::string, std::string> headers;
-    hc_video_prd_ = new HttpClient(loop_, host_, port_, this, logger_, true);
+    hc_video_prd_ = new HttpClient(loop_, host_, port_, this, logger_, true,
+            options_["keepalive"] == "true");
 
     std::stringstream subpath;
     ///rooms/:roomId/broadcasters/:broadcasterId/transports/:transportId/producers
@@ -242,7 +264,8 @@ void MsPush::VideoProduceRequest() {
 
 void MsPush::AudioProduceRequest() {
     std::map<std::string, std::string> headers;
-    hc_audio_prd_ = new HttpClient(loop_, host_, port_, this, logger_, true);
+    hc_audio_prd_ = new HttpClient(loop_, host_, port_, this, logger_, true,
+            options_["keepalive"] == "true");
 
     std::stringstream subpath;
     ///rooms/:roomId/broadcasters/:broadcasterId/transports/:transportId/producers
@@ -463,6 +486,9 @@ void MsPush::HandleBroadCasterResponse(std::shared_ptr<HttpClientResponse> resp_
                 resp_ptr->status_code_, data_str.c_str());
         return;
     }
+    if (hc_req_) {
+        Report("connect_ms", std::to_string(hc_req_->GetConnectMs()));
+    }
     Report("broadcaster", "ready");
     std::string data_str(resp_ptr->data_.Data(), resp_ptr->data_.DataLen());
 
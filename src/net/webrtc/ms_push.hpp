@@ -75,6 +75,9 @@ private:
 private:
     void Report(const std::string& type, const std::string& value);
 
+private:
+    static std::map<std::string, std::string> def_options_;
+
 private:
     Logger* logger_ = nullptr;
     std::string name_;
@@ -83,6 +86,7 @@ private:
     std::queue<Media_Packet_Ptr> packet_queue_;
     std::mutex mutex_;
     uv_async_t async_;
+    int64_t dropped_frames_ = 0;
 
 private:
     HttpClient* hc_req_           = nullptr;
@@ -8,7 +8,7 @@
 namespace cpp_streamer
 {
 
-NackGenerator::NackGenerator(uv_loop_t* loop, Logger* logger, NackGeneratorCallbackI* cb):TimerInterface(loop, NACK_DEFAULT_TIMEOUT)
+NackGenerator::NackGenerator(uv_loop_t* loop, Logger* logger, NackGeneratorCallbackI* cb):TimerInterface(loop, NACK_DEFAULT_TIMEOUT, true)
                                                                              , logger_(logger)
     , cb_(cb)
 {
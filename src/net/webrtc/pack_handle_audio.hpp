@@ -23,11 +23,11 @@ public:
     }
 
 public:
-    virtual void InputRtpPacket(std::shared_ptr<RtpPacketInfo> pkt_ptr) override
+    virtual void InputRtpPacket(RtpPacketInfo* pkt_info) override
     {
-        size_t pkt_size = pkt_ptr->pkt->GetPayloadLength() + 1024;
+        size_t pkt_size = pkt_info->pkt->GetPayloadLength() + 1024;
         std::shared_ptr<Media_Packet> audio_pkt_ptr = std::make_shared<Media_Packet>(pkt_size);
-        int64_t dts = (int64_t)pkt_ptr->pkt->GetTimestamp();
+        int64_t dts = (int64_t)pkt_info->pkt->GetTimestamp();
 
         audio_pkt_ptr->av_type_    = MEDIA_AUDIO_TYPE;
         audio_pkt_ptr->codec_type_ = MEDIA_CODEC_OPUS;
@@ -35,8 +35,9 @@ public:
         audio_pkt_ptr->dts_        = dts;
         audio_pkt_ptr->pts_        = dts;
 
-        LogDebugf(logger_, "audio packet dts:%ld, payload:%lu", dts, pkt_ptr->pkt->GetPayloadLength());
-        audio_pkt_ptr->buffer_ptr_->AppendData((char*)pkt_ptr->pkt->GetPayload(), pkt_ptr->pkt->GetPayloadLength());
+        LogDebugf(logger_, "audio packet dts:%ld, payload:%lu", dts, pkt_info->pkt->GetPayloadLength());
+        audio_pkt_ptr->buffer_ptr_->AppendData((char*)pkt_info->pkt->GetPayload(), pkt_info->pkt->GetPayloadLength());
+        pkt_info->Release();
         cb_->MediaPacketOutput(audio_pkt_ptr);
     }
 
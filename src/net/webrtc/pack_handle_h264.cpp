@@ -9,15 +9,17 @@ namespace cpp_streamer
 static const uint8_t NAL_START_CODE[4] = {0, 0, 0, 1};
 static const size_t H264_STAPA_FIELD_SIZE = 2;
 
-PackHandleH264::PackHandleH264(PackCallbackI* cb, uv_loop_t* loop, Logger* logger):TimerInterface(loop, 100)
+PackHandleH264::PackHandleH264(PackCallbackI* cb, uv_loop_t* loop, Logger* logger):TimerInterface(loop, 100, true)
                                                     , cb_(cb)
                                                     , logger_(logger)
 {
+    buffer_pool_ = std::make_shared<DataBufferPool>();
     StartTimer();
 }
 
 PackHandleH264::~PackHandleH264() {
     StopTimer();
+    ClearFuaQueue();
 }
 
 void PackHandleH264::GetStartEndBit(RtpPacket* pkt, bool& start, bool& end) {
@@ -42,132 +44,111 @@ void PackHandleH264::OnTimer() {
     CheckFuaTimeout();
 }
 
-void PackHandleH264::InputRtpPacket(std::shared_ptr<RtpPacketInfo> pkt_ptr) {
+void PackHandleH264::InputRtpPacket(RtpPacketInfo* pkt_info) {
+    //the fua packet is kept in the queue till the frame is done, the others are released here
+    if (!HandleRtpPacket(pkt_info)) {
+        pkt_info->Release();
+    }
+}
+
+bool PackHandleH264::HandleRtpPacket(RtpPacketInfo* pkt_info) {
     if (!init_flag_) {
         init_flag_ = true;
-        last_extend_seq_ = pkt_ptr->extend_seq_;
+        last_extend_seq_ = pkt_info->extend_seq_;
     } else {
-        if ((last_extend_seq_ + 1) != pkt_ptr->extend_seq_) {
-            packets_queue_.clear();
+        if ((last_extend_seq_ + 1) != pkt_info->extend_seq_) {
+            ClearFuaQueue();
             start_flag_ = false;
             end_flag_   = false;
 
-            ReportLost(pkt_ptr);
-            last_extend_seq_ = pkt_ptr->extend_seq_;
-            return;
+            ReportLost(pkt_info);
+            last_extend_seq_ = pkt_info->extend_seq_;
+            return false;
         }
-        last_extend_seq_ = pkt_ptr->extend_seq_;
+        last_extend_seq_ = pkt_info->extend_seq_;
     }
 
-    uint8_t* payload_data = pkt_ptr->pkt->GetPayload();
+    uint8_t* payload_data = pkt_info->pkt->GetPayload();
     uint8_t nal_type = payload_data[0] & 0x1f;
 
     if ((nal_type >= 1) && (nal_type <= 23)) {//single nalu
-        int64_t dts = pkt_ptr->pkt->GetTimestamp();
-        size_t pkt_size = sizeof(NAL_START_CODE) + pkt_ptr->pkt->GetPayloadLength() + 1024;
-
-        auto h264_pkt_ptr = std::make_shared<Media_Packet>(pkt_size);
+        size_t payload_len = pkt_info->pkt->GetPayloadLength();
+        auto h264_pkt_ptr = NewFramePacket(sizeof(NAL_START_CODE) + payload_len,
+                                    (int64_t)pkt_info->pkt->GetTimestamp());
 
         h264_pkt_ptr->buffer_ptr_->AppendData((char*)NAL_START_CODE, sizeof(NAL_START_CODE));
-        h264_pkt_ptr->buffer_ptr_->AppendData((char*)payload_data, pkt_ptr->pkt->GetPayloadLength());
-
-        h264_pkt_ptr->av_type_    = MEDIA_VIDEO_TYPE;
-        h264_pkt_ptr->codec_type_ = MEDIA_CODEC_H264;
-        h264_pkt_ptr->fmt_type_   = MEDIA_FORMAT_RAW;
-        h264_pkt_ptr->dts_        = dts;
-        h264_pkt_ptr->pts_        = dts;
-
-        if ((nal_type == kAvcNaluTypeSPS) || (nal_type == kAvcNaluTypePPS)) {
-            h264_pkt_ptr->is_seq_hdr_   = true;
-            h264_pkt_ptr->is_key_frame_ = false;
-        } else if (nal_type == kAvcNaluTypeIDR) {
-            h264_pkt_ptr->is_seq_hdr_   = false;
-            h264_pkt_ptr->is_key_frame_ = true;
-        } else {
-            h264_pkt_ptr->is_seq_hdr_   = false;
-            h264_pkt_ptr->is_key_frame_ = false;
-        }
+        h264_pkt_ptr->buffer_ptr_->AppendData((char*)payload_data, payload_len);
+        SetFrameFlags(h264_pkt_ptr, nal_type);
 
         cb_->MediaPacketOutput(h264_pkt_ptr);
-        return;
+        return false;
     } else if (nal_type == 28) {//rtp fua
         bool start = false;
         bool end   = false;
 
-        GetStartEndBit(pkt_ptr->pkt, start, end);
+        GetStartEndBit(pkt_info->pkt, start, end);
 
         if (start && !end) {
-            packets_queue_.clear();
+            ClearFuaQueue();
             start_flag_ = start;
         } else if (start && end) {//exception happened
             LogErrorf(logger_, "rtp h264 pack error: both start and end flag are enable");
             ResetRtpFua();
-            ReportLost(pkt_ptr);
-            return;
+            ReportLost(pkt_info);
+            return false;
         }
 
         if (end && !start_flag_) {
             LogErrorf(logger_, "rtp h264 pack error: get end rtp packet but there is no start rtp packet");
             ResetRtpFua();
-            ReportLost(pkt_ptr);
-            return;
+            ReportLost(pkt_info);
+            return false;
         }
 
         if (end) {
             end_flag_ = true;
         }
 
-        packets_queue_.push_back(pkt_ptr);
+        packets_queue_.push_back(pkt_info);
 
         if (start_flag_ && end_flag_) {
-            auto h264_pkt_ptr = std::make_shared<Media_Packet>(50*1024);
+            //the frame buffer is sized by the fragments, they are copied into it once
+            auto h264_pkt_ptr = NewFramePacket(GetFuaFrameSize(), (int64_t)pkt_info->pkt->GetTimestamp());
             int64_t dts = 0;
             bool ok = DemuxFua(h264_pkt_ptr, dts);
             if (ok) {
-                h264_pkt_ptr->av_type_    = MEDIA_VIDEO_TYPE;
-                h264_pkt_ptr->codec_type_ = MEDIA_CODEC_H264;
-                h264_pkt_ptr->fmt_type_   = MEDIA_FORMAT_RAW;
-                h264_pkt_ptr->dts_        = dts;
-                h264_pkt_ptr->pts_        = dts;
+                h264_pkt_ptr->dts_ = dts;
+                h264_pkt_ptr->pts_ = dts;
                 nal_type = ((uint8_t*)h264_pkt_ptr->buffer_ptr_->Data())[4];
-                nal_type = nal_type & 0x1f;
-                if ((nal_type == kAvcNaluTypeSPS) || (nal_type == kAvcNaluTypePPS)) {
-                    h264_pkt_ptr->is_seq_hdr_   = true;
-                    h264_pkt_ptr->is_key_frame_ = false;
-                } else if (nal_type == kAvcNaluTypeIDR) {
-                    h264_pkt_ptr->is_seq_hdr_   = false;
-                    h264_pkt_ptr->is_key_frame_ = true;
-                } else {
-                    h264_pkt_ptr->is_seq_hdr_   = false;
-                    h264_pkt_ptr->is_key_frame_ = false;
-                }
+                SetFrameFlags(h264_pkt_ptr, nal_type & 0x1f);
                 cb_->MediaPacketOutput(h264_pkt_ptr);
             } else {
-                ReportLost(pkt_ptr);
+                ReportLost(pkt_info);
             }
             start_flag_ = false;
             end_flag_   = false;
-            return;
+            ClearFuaQueue();
+            return true;
         }
 
         CheckFuaTimeout();
-        return;
+        return true;
     } else if (nal_type == 24) {//handle stapA
-        bool ret = DemuxStapA(pkt_ptr);
+        bool ret = DemuxStapA(pkt_info);
         if (!ret) {
-            ReportLost(pkt_ptr);
+            ReportLost(pkt_info);
         }
     }
 
-    return;
+    return false;
 }
 
-void PackHandleH264::ReportLost(std::shared_ptr<RtpPacketInfo> pkt_ptr) {
+void PackHandleH264::ReportLost(RtpPacketInfo* pkt_info) {
     int64_t now_ms = now_millisec();
 
     if ((now_ms - report_lost_ts_) > 500) {
         report_lost_ts_ = now_ms;
-        cb_->PackHandleReset(pkt_ptr);
+        cb_->PackHandleReset(pkt_info);
     }
 }
 
@@ -175,20 +156,50 @@ void PackHandleH264::CheckFuaTimeout() {
     size_t queue_len = packets_queue_.size();
     int64_t now_ms = now_millisec();
     for (size_t index = 0; index < queue_len; index++) {
-        std::shared_ptr<RtpPacketInfo> pkt_ptr = packets_queue_.front();
-        int64_t pkt_local_ms = pkt_ptr->pkt->GetLocalMs();
+        RtpPacketInfo* pkt_info = packets_queue_.front();
+        int64_t pkt_local_ms = pkt_info->pkt->GetLocalMs();
         if ((now_ms - pkt_local_ms) < PACK_BUFFER_TIMEOUT) {
             break;
         }
         packets_queue_.pop_front();
-        LogWarnf(logger_, "h264 fua list is timeout, packet pop seq:%d", pkt_ptr->pkt->GetSeq());
+        LogWarnf(logger_, "h264 fua list is timeout, packet pop seq:%d", pkt_info->pkt->GetSeq());
+        pkt_info->Release();
     }
     return;
 }
 
-bool PackHandleH264::DemuxStapA(std::shared_ptr<RtpPacketInfo> pkt_ptr) {
-    uint8_t* payload_data = pkt_ptr->pkt->GetPayload();
-    size_t payload_length = pkt_ptr->pkt->GetPayloadLength();
+Media_Packet_Ptr PackHandleH264::NewFramePacket(size_t frame_size, int64_t dts) {
+    auto h264_pkt_ptr = std::make_shared<Media_Packet>(buffer_pool_->Get(frame_size));
+
+    h264_pkt_ptr->av_type_    = MEDIA_VIDEO_TYPE;
+    h264_pkt_ptr->codec_type_ = MEDIA_CODEC_H264;
+    h264_pkt_ptr->fmt_type_   = MEDIA_FORMAT_RAW;
+    h264_pkt_ptr->dts_        = dts;
+    h264_pkt_ptr->pts_        = dts;
+    return h264_pkt_ptr;
+}
+
+void PackHandleH264::SetFrameFlags(Media_Packet_Ptr h264_pkt_ptr, uint8_t nal_type) {
+    if ((nal_type == kAvcNaluTypeSPS) || (nal_type == kAvcNaluTypePPS)) {
+        h264_pkt_ptr->is_seq_hdr_   = true;
+        h264_pkt_ptr->is_key_frame_ = false;
+    } else if (nal_type == kAvcNaluTypeIDR) {
+        h264_pkt_ptr->is_seq_hdr_   = false;
+        h264_pkt_ptr->is_key_frame_ = true;
+    } else {
+        h264_pkt_ptr->is_seq_hdr_   = false;
+        h264_pkt_ptr->is_key_frame_ = false;
+    }
+}
+
+/*
+ * the nalus in one stapA are one access unit, eg. sps/pps/idr,
+ * they are output in one annexb packet: a key frame when there is idr,
+ * or a sequence header when there are only sps/pps.
+ */
+bool PackHandleH264::DemuxStapA(RtpPacketInfo* pkt_info) {
+    uint8_t* payload_data = pkt_info->pkt->GetPayload();
+    size_t payload_length = pkt_info->pkt->GetPayloadLength();
     std::vector<size_t> offsets;
 
     if (payload_length <= (sizeof(uint8_t) + H264_STAPA_FIELD_SIZE)) {
@@ -200,9 +211,9 @@ bool PackHandleH264::DemuxStapA(std::shared_ptr<RtpPacketInfo> pkt_ptr) {
     if (!ret) {
         return ret;
     }
-    int64_t dts = (int64_t)pkt_ptr->pkt->GetTimestamp();
-
     offsets.push_back(payload_length + H264_STAPA_FIELD_SIZE);//end offset.
+
+    size_t au_size = 0;
     for (size_t index = 0; index < (offsets.size() - 1); index++) {
         size_t start_offset = offsets[index];
         size_t end_offset = offsets[index + 1] - H264_STAPA_FIELD_SIZE;
@@ -211,31 +222,32 @@ bool PackHandleH264::DemuxStapA(std::shared_ptr<RtpPacketInfo> pkt_ptr) {
                 start_offset,  end_offset);
             return false;
         }
-        size_t pkt_size = sizeof(NAL_START_CODE) + end_offset - start_offset + 1024;
-        auto h264_pkt_ptr = std::make_shared<Media_Packet>(pkt_size);
+        au_size += sizeof(NAL_START_CODE) + end_offset - start_offset;
+    }
 
-        h264_pkt_ptr->buffer_ptr_->AppendData((char*)NAL_START_CODE, sizeof(NAL_START_CODE));
-        h264_pkt_ptr->buffer_ptr_->AppendData((char*)payload_data + start_offset, end_offset - start_offset);
-        h264_pkt_ptr->av_type_    = MEDIA_VIDEO_TYPE;
-        h264_pkt_ptr->codec_type_ = MEDIA_CODEC_H264;
-        h264_pkt_ptr->fmt_type_   = MEDIA_FORMAT_RAW;
-        h264_pkt_ptr->dts_        = dts;
-        h264_pkt_ptr->pts_        = dts;
+    auto h264_pkt_ptr = NewFramePacket(au_size, (int64_t)pkt_info->pkt->GetTimestamp());
+    bool has_idr  = false;
+    bool only_seq = true;
 
+    for (size_t index = 0; index < (offsets.size() - 1); index++) {
+        size_t start_offset = offsets[index];
+        size_t end_offset = offsets[index + 1] - H264_STAPA_FIELD_SIZE;
         uint8_t nal_type = *(payload_data + start_offset) & 0x1f;
 
-        if ((nal_type == kAvcNaluTypeSPS) || (nal_type == kAvcNaluTypePPS)) {
-            h264_pkt_ptr->is_seq_hdr_   = true;
-            h264_pkt_ptr->is_key_frame_ = false;
-        } else if (nal_type == kAvcNaluTypeIDR) {
-            h264_pkt_ptr->is_seq_hdr_   = false;
-            h264_pkt_ptr->is_key_frame_ = true;
-        } else {
-            h264_pkt_ptr->is_seq_hdr_   = false;
-            h264_pkt_ptr->is_key_frame_ = false;
+        h264_pkt_ptr->buffer_ptr_->AppendData((char*)NAL_START_CODE, sizeof(NAL_START_CODE));
+        h264_pkt_ptr->buffer_ptr_->AppendData((char*)payload_data + start_offset, end_offset - start_offset);
+
+        if (nal_type == kAvcNaluTypeIDR) {
+            has_idr = true;
+        }
+        if ((nal_type != kAvcNaluTypeSPS) && (nal_type != kAvcNaluTypePPS)) {
+            only_seq = false;
         }
-        cb_->MediaPacketOutput(h264_pkt_ptr);
     }
+    h264_pkt_ptr->is_key_frame_ = has_idr;
+    h264_pkt_ptr->is_seq_hdr_   = only_seq;
+
+    cb_->MediaPacketOutput(h264_pkt_ptr);
     return true;
 }
 
@@ -268,6 +280,18 @@ bool PackHandleH264::ParseStapAOffsets(const uint8_t* data, size_t data_len, std
     return true;
 }
 
+size_t PackHandleH264::GetFuaFrameSize() {
+    size_t frame_size = sizeof(NAL_START_CODE) + 1;//start code + nalu header
+
+    for (auto pkt_info : packets_queue_) {
+        size_t payload_len = pkt_info->pkt->GetPayloadLength();
+        if (payload_len > 2) {
+            frame_size += payload_len - 2;//fu indicator + fu header
+        }
+    }
+    return frame_size;
+}
+
 bool PackHandleH264::DemuxFua(Media_Packet_Ptr h264_pkt_ptr, int64_t& timestamp) {
     size_t queue_len = packets_queue_.size();
     bool has_start = false;
@@ -278,14 +302,13 @@ bool PackHandleH264::DemuxFua(Media_Packet_Ptr h264_pkt_ptr, int64_t& timestamp)
         bool start = false;
         bool end   = false;
 
-        std::shared_ptr<RtpPacketInfo> pkt_ptr = packets_queue_.front();
-        packets_queue_.pop_front();
+        RtpPacketInfo* pkt_info = packets_queue_[index];
 
-        timestamp = (int64_t)pkt_ptr->pkt->GetTimestamp();
-        GetStartEndBit(pkt_ptr->pkt, start, end);
+        timestamp = (int64_t)pkt_info->pkt->GetTimestamp();
+        GetStartEndBit(pkt_info->pkt, start, end);
 
-        uint8_t* payload   = pkt_ptr->pkt->GetPayload();
-        size_t payload_len = pkt_ptr->pkt->GetPayloadLength();
+        uint8_t* payload   = pkt_info->pkt->GetPayload();
+        size_t payload_len = pkt_info->pkt->GetPayloadLength();
         if (index == 0) {
             if (start) {
                 has_start = true;
@@ -312,10 +335,18 @@ bool PackHandleH264::DemuxFua(Media_Packet_Ptr h264_pkt_ptr, int64_t& timestamp)
     }
     return true;
 }
+
+void PackHandleH264::ClearFuaQueue() {
+    for (auto pkt_info : packets_queue_) {
+        pkt_info->Release();
+    }
+    packets_queue_.clear();
+}
+
 void PackHandleH264::ResetRtpFua() {
     start_flag_ = false;
     end_flag_   = false;
-    packets_queue_.clear();
+    ClearFuaQueue();
 }
 
 }
@@ -15,28 +15,34 @@ public:
     virtual ~PackHandleH264();
 
 public:
-    virtual void InputRtpPacket(std::shared_ptr<RtpPacketInfo> pkt_ptr) override;
+    virtual void InputRtpPacket(RtpPacketInfo* pkt_info) override;
 
 public:
     virtual void OnTimer() override;
     
 private:
     void GetStartEndBit(RtpPacket* pkt, bool& start, bool& end);
+    bool HandleRtpPacket(RtpPacketInfo* pkt_info);
+    void ClearFuaQueue();
     void ResetRtpFua();
+    size_t GetFuaFrameSize();
     bool DemuxFua(Media_Packet_Ptr h264_pkt_ptr, int64_t& timestamp);
-    bool DemuxStapA(std::shared_ptr<RtpPacketInfo>);
+    Media_Packet_Ptr NewFramePacket(size_t frame_size, int64_t dts);
+    void SetFrameFlags(Media_Packet_Ptr h264_pkt_ptr, uint8_t nal_type);
+    bool DemuxStapA(RtpPacketInfo* pkt_info);
     bool ParseStapAOffsets(const uint8_t* data, size_t data_len, std::vector<size_t> &offsets);
     void CheckFuaTimeout();
-    void ReportLost(std::shared_ptr<RtpPacketInfo> pkt_ptr);
+    void ReportLost(RtpPacketInfo* pkt_info);
     
 private:
     bool init_flag_  = false;
     bool start_flag_ = false;
     bool end_flag_   = false;
     int64_t last_extend_seq_ = 0;
-    std::deque<std::shared_ptr<RtpPacketInfo>> packets_queue_;
+    std::deque<RtpPacketInfo*> packets_queue_;//the fua packets owned by the queue
     PackCallbackI* cb_ = nullptr;
     int64_t report_lost_ts_ = -1;
+    std::shared_ptr<DataBufferPool> buffer_pool_;//the frame buffers, they are back when the frames are released
 
 private:
     Logger* logger_ = nullptr;
@@ -15,7 +15,7 @@ namespace cpp_streamer
 class PackCallbackI
 {
 public:
-    virtual void PackHandleReset(std::shared_ptr<RtpPacketInfo> pkt_ptr) = 0;
+    virtual void PackHandleReset(RtpPacketInfo* pkt_info) = 0;
     virtual void MediaPacketOutput(std::shared_ptr<Media_Packet> pkt_ptr) = 0;
 };
 
@@ -30,7 +30,8 @@ public:
     }
     
 public:
-    virtual void InputRtpPacket(std::shared_ptr<RtpPacketInfo> pkt_ptr) = 0;
+    //the pack handle owns the pkt_info, and releases it
+    virtual void InputRtpPacket(RtpPacketInfo* pkt_info) = 0;
 };
 
 }
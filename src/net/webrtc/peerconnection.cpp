@@ -7,12 +7,14 @@
 #include "rtcp_xr_dlrr.hpp"
 #include "rtcp_xr_rrt.hpp"
 #include "rtcpfb_nack.hpp"
+#include "rtcpfb_tcc.hpp"
 #include "srtp_session.hpp"
 #include "uuid.hpp"
 #include "byte_crypto.hpp"
 #include "pack_handle_h264.hpp"
 #include "pack_handle_audio.hpp"
 #include "h264_h265_header.hpp"
+#include "byte_stream.hpp"
 
 #include <cstring>
 #include <sstream>
@@ -23,7 +25,7 @@ namespace cpp_streamer
 #define RTCP_RR_INTERVAL (1*1000)
 
 PeerConnection::PeerConnection(uv_loop_t* loop, 
-        Logger* logger, PCStateReportI* state_report):TimerInterface(loop, 300)
+        Logger* logger, PCStateReportI* state_report):TimerInterface(loop, 300, true)
                                                       , loop_(loop)
                                                       , logger_(logger)
                                                       , state_report_(state_report)
@@ -32,9 +34,10 @@ PeerConnection::PeerConnection(uv_loop_t* loop,
                                                       , answer_sdp_(&dtls_, logger)
                                                       , jb_video_(MEDIA_VIDEO_TYPE, this, loop, logger)
                                                       , jb_audio_(MEDIA_AUDIO_TYPE, this, loop, logger)
+                                                      , pacer_(loop, this, logger)
+                                                      , bwe_(logger)
 {
-    udp_client_ = new UdpClient(loop, this, logger, nullptr, 0);
-    dtls_.udp_client_ = udp_client_;
+    transport_ = RtcUdpTransport::Acquire(loop, logger);
 
     memset(&last_xr_ntp_, 0, sizeof(last_xr_ntp_));
 
@@ -45,9 +48,12 @@ PeerConnection::~PeerConnection()
 {
     LogInfof(logger_, "destruct PeerConnection");
     StopTimer();
-    if (udp_client_) {
-        delete udp_client_;
-        udp_client_ = nullptr;
+    if (transport_) {
+        transport_->Unbind(this);
+        udp_client_       = nullptr;
+        dtls_.udp_client_ = nullptr;
+        RtcUdpTransport::Release(loop_);
+        transport_ = nullptr;
     }
     if (write_srtp_) {
         delete write_srtp_;
@@ -62,6 +68,11 @@ PeerConnection::~PeerConnection()
         video_send_stream_ = nullptr;
     }
 
+    if (fec_decoder_) {
+        delete fec_decoder_;
+        fec_decoder_ = nullptr;
+    }
+
     if (audio_send_stream_) {
         delete audio_send_stream_;
         audio_send_stream_ = nullptr;
@@ -78,6 +89,12 @@ PeerConnection::~PeerConnection()
     }
 }
 
+void PeerConnection::SetFecEnable(bool enable, int key_rate, int delta_rate) {
+    fec_enable_     = enable;
+    fec_key_rate_   = key_rate;
+    fec_delta_rate_ = delta_rate;
+}
+
 std::string PeerConnection::GetDirectionString(WebRtcSdpDirection direction_type) {
     switch (direction_type)
     {
@@ -133,6 +150,19 @@ int PeerConnection::ParseAnswerSdp(const std::string& sdp) {
 }
 
 
+bool PeerConnection::BindTransport(const UdpTuple& remote_address) {
+    udp_client_ = transport_->Bind(remote_address, dtls_.local_fragment_, this);
+    dtls_.udp_client_ = udp_client_;
+    if (!udp_client_) {
+        LogErrorf(logger_, "bind udp transport error, remote address:%s",
+                remote_address.to_string().c_str());
+        return false;
+    }
+    LogInfof(logger_, "bind udp transport remote address:%s, transport lanes:%lu, sessions:%lu",
+            remote_address.to_string().c_str(), transport_->LaneCount(), transport_->SessionCount());
+    return true;
+}
+
 void PeerConnection::SendStun(int64_t now_ms) {
     if (pc_state_ < PC_SDP_DONE_STATE) {
         return;
@@ -159,7 +189,10 @@ void PeerConnection::SendStun(int64_t now_ms) {
 
     UdpTuple remote_address(ice.hostip, ice.port);
     dtls_.remote_address_ = remote_address;
-    
+    if (!udp_client_ && !BindTransport(remote_address)) {
+        return;
+    }
+
     pkt.username_ = dtls_.remote_fragment_;
     pkt.username_ += ":";
     pkt.username_ += dtls_.local_fragment_;
@@ -207,16 +240,19 @@ std::string PeerConnection::CreateOfferSdp(WebRtcSdpDirection direction_type) {
     //video audio payload list
     offer_sdp_.video_pt_vec_.push_back(VPLAYLOAD_DEF_TYPE);
     offer_sdp_.video_pt_vec_.push_back(RTX_PAYLOAD_DEF_TYPE);
+    if (fec_enable_) {
+        offer_sdp_.video_pt_vec_.push_back(FEC_PAYLOAD_DEF_TYPE);
+    }
 
     offer_sdp_.audio_pt_vec_.push_back(APLAYLOAD_DEF_TYPE);
 
     //start: audio/video RtpMap
-    RtpMapInfo h264RtpInfo = {
+    RtpMapInfo videoRtpInfo = {
         .payload_type = VPLAYLOAD_DEF_TYPE,
-        .codec_type   = "H264",
+        .codec_type   = GetVideoCodecName(),
         .clock_rate   = 90000
     };
-    offer_sdp_.video_rtp_map_infos_[VPLAYLOAD_DEF_TYPE] = h264RtpInfo;
+    offer_sdp_.video_rtp_map_infos_[VPLAYLOAD_DEF_TYPE] = videoRtpInfo;
 
     RtpMapInfo rtxRtpInfo = {
         .payload_type = RTX_PAYLOAD_DEF_TYPE,
@@ -225,6 +261,15 @@ std::string PeerConnection::CreateOfferSdp(WebRtcSdpDirection direction_type) {
     };
     offer_sdp_.video_rtp_map_infos_[RTX_PAYLOAD_DEF_TYPE] = rtxRtpInfo;
 
+    if (fec_enable_) {
+        RtpMapInfo fecRtpInfo = {
+            .payload_type = FEC_PAYLOAD_DEF_TYPE,
+            .codec_type   = "flexfec",
+            .clock_rate   = 90000
+        };
+        offer_sdp_.video_rtp_map_infos_[FEC_PAYLOAD_DEF_TYPE] = fecRtpInfo;
+    }
+
     RtpMapInfo opusRtpInfo = {
         .payload_type = APLAYLOAD_DEF_TYPE,
         .codec_type   = "opus",
@@ -235,7 +280,7 @@ std::string PeerConnection::CreateOfferSdp(WebRtcSdpDirection direction_type) {
     //end: audio/video RtpMap
     
     //start: audio/video fmtp info
-    FmtpInfo h264FmtpInfo = {
+    FmtpInfo videoFmtpInfo = {
         .payload_type = VPLAYLOAD_DEF_TYPE,
         .attr_string  = "level-asymmetry-allowed=1;packetization-mode=1;profile-level-id=42e01f",
         .is_video     = true,
@@ -243,7 +288,11 @@ std::string PeerConnection::CreateOfferSdp(WebRtcSdpDirection direction_type) {
         .rtx_payload_type = RTX_PAYLOAD_DEF_TYPE
     
     };
-    offer_sdp_.video_fmtp_vec_.push_back(h264FmtpInfo);
+    if (video_codec_ == MEDIA_CODEC_H265) {
+        //main profile, level 3.1, the single rtp stream
+        videoFmtpInfo.attr_string = "level-id=93;profile-id=1;tier-flag=0;tx-mode=SRST";
+    }
+    offer_sdp_.video_fmtp_vec_.push_back(videoFmtpInfo);
 
     std::string rtxFmtpStr = "apt=";
     rtxFmtpStr += std::to_string(VPLAYLOAD_DEF_TYPE);
@@ -257,6 +306,18 @@ std::string PeerConnection::CreateOfferSdp(WebRtcSdpDirection direction_type) {
     };
     offer_sdp_.video_fmtp_vec_.push_back(rtxFmtpInfo);
 
+    if (fec_enable_) {
+        //the repair window in microseconds
+        FmtpInfo fecFmtpInfo = {
+            .payload_type = FEC_PAYLOAD_DEF_TYPE,
+            .attr_string  = "repair-window=200000",
+            .is_video     = true,
+            .is_rtx       = false,
+            .rtx_payload_type = 0
+        };
+        offer_sdp_.video_fmtp_vec_.push_back(fecFmtpInfo);
+    }
+
     FmtpInfo opusFmtpInfo = {
         .payload_type = APLAYLOAD_DEF_TYPE,
         .attr_string  = "minptime=10;useinbandfec=1",
@@ -339,6 +400,22 @@ std::string PeerConnection::CreateOfferSdp(WebRtcSdpDirection direction_type) {
     };
     offer_sdp_.ssrc_info_map_[offer_sdp_.video_rtx_ssrc_] = rtx_ssrc_info;
 
+    if (fec_enable_) {
+        offer_sdp_.video_fec_ssrc_ = ByteCrypto::GetRandomUint(1, 0xffffffff);
+        SSRCInfo fec_ssrc_info = {
+            .ssrc = offer_sdp_.video_fec_ssrc_,
+            .is_video = true,
+            .is_rtx   = false,
+            .msid     = offer_sdp_.v_msid_,
+            .msid_appdata = offer_sdp_.v_msid_appdata_,
+            .cname = offer_sdp_.video_cname_,
+            .rtx_ssrc = 0,
+            .is_fec   = true
+        };
+        offer_sdp_.ssrc_info_map_[offer_sdp_.video_fec_ssrc_] = fec_ssrc_info;
+        LogInfof(logger_, "video fec ssrc:%u", offer_sdp_.video_fec_ssrc_);
+    }
+
     SSRCInfo audio_ssrc_info = {
         .ssrc = offer_sdp_.audio_ssrc_,
         .is_video = false,
@@ -454,6 +531,21 @@ int PeerConnection::HandleRtcpRtpFb(uint8_t* data, int data_len) {
             }
             break;
         }
+        case FB_RTP_TCC:
+        {
+            RtcpFbTcc* tcc_pkt = nullptr;
+            try {
+                tcc_pkt = RtcpFbTcc::Parse(data, data_len);
+                if (tcc_pkt) {
+                    HandleRtcpTcc(tcc_pkt);
+                    delete tcc_pkt;
+                }
+            } catch(CppStreamException& e) {
+                LogErrorf(logger_, "rtcp feedback tcc error:%s", e.what());
+                return -1;
+            }
+            break;
+        }
         default:
         {
             LogWarnf(logger_, "receive rtcp psfb format(%d) is not handled.", header->fmt);
@@ -463,8 +555,52 @@ int PeerConnection::HandleRtcpRtpFb(uint8_t* data, int data_len) {
     return data_len;
 }
 
+void PeerConnection::HandleRtcpTcc(RtcpFbTcc* tcc_pkt) {
+    int64_t now_ms = now_millisec();
+
+    if (video_send_stream_) {
+        bwe_.SetRtt((int64_t)video_send_stream_->GetRtt());
+    }
+    bwe_.OnTransportFeedback(tcc_pkt, now_ms);
+
+    uint32_t target = bwe_.GetTargetBitrate();
+    pacer_.SetTargetBitrate(target);
+    if (video_send_stream_) {
+        video_send_stream_->SetTargetBitrate(target);
+    }
+
+    //report only the obvious changes, the feedback comes every 50~100ms
+    uint32_t diff = (target > report_bitrate_) ? (target - report_bitrate_) : (report_bitrate_ - target);
+    if (report_bitrate_ == 0 || diff * 20 > report_bitrate_) {
+        report_bitrate_ = target;
+        LogInfof(logger_, "transport cc target bitrate:%u, acked bitrate:%u, loss:%.03f",
+                target, bwe_.GetAckedBitrate(), bwe_.GetLossRate());
+        Report("target_bitrate", std::to_string(target));
+    }
+}
+
 int PeerConnection::HandleRtcpPsFb(uint8_t* data, int data_len) {
+    RtcpFbCommonHeader* header = (RtcpFbCommonHeader*)data;
+
+    if (data_len < (int)(sizeof(RtcpFbCommonHeader) + sizeof(RtcpFbHeader))) {
+        LogErrorf(logger_, "rtcp psfb len:%d is too short", data_len);
+        return data_len;
+    }
+    RtcpFbHeader* fb_header = (RtcpFbHeader*)(header + 1);
+    uint32_t media_ssrc = ntohl(fb_header->media_ssrc);
 
+    if (header->fmt != FB_PS_PLI && header->fmt != FB_PS_FIR) {
+        LogDebugf(logger_, "receive rtcp psfb format(%d) is not handled.", header->fmt);
+        return data_len;
+    }
+    //the fir carries the media ssrc in the fci, the one in the header is 0
+    if (!video_send_stream_
+        || (header->fmt == FB_PS_PLI && media_ssrc != video_send_stream_->GetSsrc())) {
+        return data_len;
+    }
+    LogInfof(logger_, "receive rtcp %s, media ssrc:%u",
+            header->fmt == FB_PS_PLI ? "pli" : "fir", media_ssrc);
+    Report("keyframe_request", header->fmt == FB_PS_PLI ? "pli" : "fir");
     return data_len;
 }
 
@@ -651,6 +787,7 @@ void PeerConnection::HandleRtpData(uint8_t* data, size_t len) {
     if (pc_state_ < PC_DTLS_DONE_STATE) {
         return;
     }
+    RtpPacketInfo* pkt_info = nullptr;
     try {
         if (!read_srtp_) {
             LogErrorf(logger_, "read srtp session is not ready and discard rtp packet");
@@ -663,23 +800,39 @@ void PeerConnection::HandleRtpData(uint8_t* data, size_t len) {
             return;
         }
 
-        RtpPacket* pkt = RtpPacket::Parse(data, len);
-        if (!pkt) {
-            return;
-        }
+        //the packet is parsed in a pooled slot, and the slot is handed over to the jitter buffer
+        pkt_info = rtp_pool_.Get();
+        pkt_info->Load(data, len);
+
+        RtpPacket* pkt = pkt_info->pkt;
         uint32_t ssrc = pkt->GetSsrc();
         if (mspull_ && ssrc == 1234) {
+            pkt_info->Release();
             return;//discard ssrc=1234 which is test ssrc.
         }
         if (video_recv_stream_ && (ssrc == video_recv_stream_->GetSsrc() || ssrc == video_recv_stream_->GetRtxSsrc())) {
             video_recv_stream_->HandleRtpPacket(pkt);
-            jb_video_.InputRtpPacket(video_recv_stream_->GetClockRate(), pkt);
+            if (fec_decoder_) {
+                //after the rtx demux, it may recover the earlier packets
+                fec_decoder_->OnMediaPacket(pkt->GetData(), pkt->GetDataLength());
+            }
+            RtpPacketInfo* input_info = pkt_info;
+            pkt_info = nullptr;
+            jb_video_.InputRtpPacket(video_recv_stream_->GetClockRate(), input_info);
+            return;
+        } else if (fec_decoder_ && ssrc == fec_ssrc_) {
+            fec_decoder_->OnFecPacket(pkt->GetData(), pkt->GetDataLength());
+            pkt_info->Release();
             return;
         } else if (audio_recv_stream_ && ssrc == audio_recv_stream_->GetSsrc()) {
             audio_recv_stream_->HandleRtpPacket(pkt);
-            jb_audio_.InputRtpPacket(audio_recv_stream_->GetClockRate(), pkt);
+            RtpPacketInfo* input_info = pkt_info;
+            pkt_info = nullptr;
+            jb_audio_.InputRtpPacket(audio_recv_stream_->GetClockRate(), input_info);
             return;
         } else {
+            pkt_info->Release();
+            pkt_info = nullptr;
             uint32_t v_ssrc   = video_recv_stream_ ? video_recv_stream_->GetSsrc() : 0;
             uint32_t rtx_ssrc = video_recv_stream_ ? video_recv_stream_->GetRtxSsrc() : 0;
             uint32_t a_ssrc   = audio_recv_stream_ ? audio_recv_stream_->GetSsrc() : 0;
@@ -688,7 +841,30 @@ void PeerConnection::HandleRtpData(uint8_t* data, size_t len) {
         }
     } catch(CppStreamException& e) {
         LogErrorf(logger_, "handle rtp data exception:%s", e.what());
+        if (pkt_info) {
+            pkt_info->Release();
+        }
+    }
+}
+
+/*
+ * the packet recovered by flexfec is handled as the received one ahead of the jitter buffer,
+ * the nack of it is removed by the recv stream.
+ */
+void PeerConnection::OnRecoveredPacket(uint8_t* data, size_t len) {
+    if (!video_recv_stream_) {
+        return;
     }
+    RtpPacketInfo* pkt_info = rtp_pool_.Get();
+    try {
+        pkt_info->Load(data, len);
+    } catch(CppStreamException& e) {
+        LogErrorf(logger_, "load fec recovered packet exception:%s", e.what());
+        pkt_info->Release();
+        return;
+    }
+    video_recv_stream_->HandleRtpPacket(pkt_info->pkt);
+    jb_video_.InputRtpPacket(video_recv_stream_->GetClockRate(), pkt_info);
 }
 
 void PeerConnection::Report(const std::string& type, const std::string& value) {
@@ -739,19 +915,52 @@ void PeerConnection::OnDtlsConnected(CRYPTO_SUITE_ENUM suite,
     return;
 }
 
-void PeerConnection::SendRtpPacket(uint8_t* data, size_t len) {
+void PeerConnection::SendRtpPacket(uint8_t* data, size_t len, size_t capacity, RTP_PACE_PRIORITY priority) {
+    //the media packets and their fec carry the ingress through the pacer, not the retransmissions
+    int64_t ingress_us = (priority == PACE_RETRANSMIT_PRIORITY) ? 0 : send_ingress_us_;
+    pacer_.Enqueue(data, len, capacity, priority, ingress_us);
+}
+
+void PeerConnection::SetPacingBitrate(uint32_t target_bitrate, double pacing_factor) {
+    pacer_.SetTargetBitrate(target_bitrate);
+    pacer_.SetPacingFactor(pacing_factor);
+}
+
+void PeerConnection::OnPacedRtpPacket(uint8_t* data, size_t len, size_t capacity, int64_t ingress_us) {
     if(!write_srtp_) {
         LogErrorf(logger_, "write_srtp is not ready");
         return;
     }
+
+    if (tcc_ext_id_ > 0) {
+        //the transport-wide seq is stamped by the send stream, the send time is taken here
+        uint8_t ext_len = 0;
+        uint8_t* ext_value = RtpPacket::FindOnebyteExtension(data, len, tcc_ext_id_, ext_len);
+        if (ext_value && ext_len == 2) {
+            bwe_.OnPacketSent(ByteStream::Read2Bytes(ext_value), len, now_millisec());
+        }
+    }
     
-    bool ret = write_srtp_->EncryptRtp(const_cast<uint8_t**>(&data), &len);
+    //protected in place with the tail room, the packets not writable are copied
+    bool ret = write_srtp_->ProtectRtp(&data, &len, capacity);
     if (!ret) {
         LogErrorf(logger_, "encrypt_rtp error");
         return;
     }
     udp_client_->Write((char*)data, len, dtls_.remote_address_);
     udp_client_->TryRead();
+
+    if (metrics_ && ingress_us > 0) {
+        metrics_->OnOutput(ingress_us);
+    }
+}
+
+uint16_t PeerConnection::NextTransportSeq() {
+    return transport_seq_++;
+}
+
+void PeerConnection::RequestKeyFrame() {
+    Report("keyframe_request", "congestion");
 }
 
 void PeerConnection::SendRtcpPacket(uint8_t* data, size_t len) {
@@ -794,6 +1003,15 @@ void PeerConnection::CreateVideoRecvStream() {
                 video_nack, this, logger_, loop_);
         }
         video_recv_stream_->RequestKeyFrame(-1);
+
+        int fec_payload   = answer_sdp_.GetVideoFecPayloadType();
+        uint32_t fec_ssrc = answer_sdp_.GetVideoFecSsrc();
+        if (fec_enable_ && fec_payload > 0 && fec_ssrc > 0) {
+            LogInfof(logger_, "create flexfec decoder, fec pt:%d, fec ssrc:%u, media ssrc:%u",
+                    fec_payload, fec_ssrc, ssrc);
+            fec_ssrc_    = fec_ssrc;
+            fec_decoder_ = new FlexFecDecoder(ssrc, this, logger_);
+        }
     }
 
 
@@ -855,6 +1073,20 @@ void PeerConnection::CreateSendStream() {
                 video_nack, this, logger_);
  
         }
+        video_send_stream_->SetVideoCodec(video_codec_);
+        //the fec ssrc is in the offer when the answer does not repeat it
+        int fec_payload   = answer_sdp_.GetVideoFecPayloadType();
+        uint32_t fec_ssrc = answer_sdp_.GetVideoFecSsrc();
+        if (fec_ssrc == 0) {
+            fec_ssrc = offer_sdp_.GetVideoFecSsrc();
+        }
+        if (fec_enable_ && fec_payload > 0 && fec_ssrc > 0) {
+            video_send_stream_->EnableFec((uint8_t)fec_payload, fec_ssrc,
+                    fec_key_rate_, fec_delta_rate_);
+        } else if (fec_enable_) {
+            LogInfof(logger_, "flexfec is not negotiated, fec pt:%d, fec ssrc:%u",
+                    fec_payload, fec_ssrc);
+        }
     }
 
     if (answer_sdp_.GetAudioSsrc() > 0) {
@@ -866,9 +1098,33 @@ void PeerConnection::CreateSendStream() {
         audio_send_stream_->SetChannel(answer_sdp_.channel_);
     }
 
+    int tcc_id = 0;
+    for (auto& item : answer_sdp_.ext_map_) {
+        if (item.second.desc.find("transport-wide-cc") != std::string::npos) {
+            tcc_id = item.second.ext_id;
+            break;
+        }
+    }
+    SetTransportSeqExtensionId(tcc_id);
+
     return;
 }
 
+void PeerConnection::SetTransportSeqExtensionId(int ext_id) {
+    if (ext_id <= 0 || ext_id >= 15) {
+        LogInfof(logger_, "transport-wide cc is not negotiated, ext id:%d", ext_id);
+        tcc_ext_id_ = 0;
+        return;
+    }
+    tcc_ext_id_ = (uint8_t)ext_id;
+    if (video_send_stream_) {
+        video_send_stream_->SetTransportSeqExtensionId(tcc_ext_id_);
+    }
+    if (audio_send_stream_) {
+        audio_send_stream_->SetTransportSeqExtensionId(tcc_ext_id_);
+    }
+}
+
 void PeerConnection::CreateSendStream2() {
     bool video_nack = offer_sdp_.IsVideoNackEnable();
     bool audio_nack = offer_sdp_.IsAudioNackEnable();
@@ -897,6 +1153,7 @@ void PeerConnection::CreateSendStream2() {
                     offer_sdp_.GetVideoClockRate(),
                     video_nack, this, logger_);
         }
+        video_send_stream_->SetVideoCodec(video_codec_);
     }
 
     if (offer_sdp_.GetAudioSsrc() > 0) {
@@ -907,6 +1164,8 @@ void PeerConnection::CreateSendStream2() {
                 audio_nack, this, logger_);
         audio_send_stream_->SetChannel(offer_sdp_.channel_);
     }
+    //mediasoup takes the header extension ids of the offer
+    SetTransportSeqExtensionId(offer_sdp_.em_tcc_);
     return;
 }
 
@@ -915,7 +1174,9 @@ int PeerConnection::SendVideoPacket(Media_Packet_Ptr pkt_ptr) {
         return -1;
     }
 
+    send_ingress_us_ = pkt_ptr->ingress_us_;
     video_send_stream_->SendPacket(pkt_ptr);
+    send_ingress_us_ = 0;
     return 0;
 }
 
@@ -923,7 +1184,9 @@ int PeerConnection::SendAudioPacket(Media_Packet_Ptr pkt_ptr) {
     if (!audio_send_stream_) {
         return -1;
     }
+    send_ingress_us_ = pkt_ptr->ingress_us_;
     audio_send_stream_->SendPacket(pkt_ptr);
+    send_ingress_us_ = 0;
     return 0;
 }
 
@@ -1073,8 +1336,12 @@ void PeerConnection::OnStatics(int64_t now_ms) {
         int64_t resend_total = 0;
         std::stringstream ss;
         
+        int64_t pace_delay = 0;
+        int64_t pace_max_delay = 0;
+        
         resend_total = video_send_stream_->GetResendCount(now_ms, resend_pps);
         video_send_stream_->GetStatics(vkps, vpps);
+        pacer_.GetQueueDelay(pace_delay, pace_max_delay);
         ss << "{";
         ss << "\"v_kbps\":" << vkps << ","; 
         ss << "\"v_pps\":" << vpps << ",";
@@ -1082,7 +1349,13 @@ void PeerConnection::OnStatics(int64_t now_ms) {
         ss << "\"jitter\":" << video_send_stream_->GetJitter() << ",";
         ss << "\"lost\":" << video_send_stream_->GetLostRate() << ",";
         ss << "\"resend total\":" << resend_total << ",";
-        ss << "\"resend pps\":" << resend_pps;
+        ss << "\"resend pps\":" << resend_pps << ",";
+        ss << "\"fec total\":" << video_send_stream_->GetFecCount() << ",";
+        ss << "\"drop frames\":" << video_send_stream_->GetDroppedFrames() << ",";
+        ss << "\"drop bytes\":" << video_send_stream_->GetDroppedBytes() << ",";
+        ss << "\"pace delay\":" << pace_delay << ",";
+        ss << "\"pace max delay\":" << pace_max_delay << ",";
+        ss << "\"pace queue bytes\":" << pacer_.QueueBytes();
         ss << "}";
         Report("video_statics", ss.str());
     }
@@ -1118,7 +1391,9 @@ void PeerConnection::OnStatics(int64_t now_ms) {
         ss << "\"jitter\":" << video_recv_stream_->GetJitter() << ",";
         ss << "\"lost\":" << video_recv_stream_->GetLostRate() << ",";
         ss << "\"resend total\":" << resend_total << ",";
-        ss << "\"resend pps\":" << resend_pps;
+        ss << "\"resend pps\":" << resend_pps << ",";
+        ss << "\"fec total\":" << (fec_decoder_ ? fec_decoder_->GetFecCount() : 0) << ",";
+        ss << "\"fec recovered\":" << (fec_decoder_ ? fec_decoder_->GetRecoveredCount() : 0);
         ss << "}";
         Report("video_statics", ss.str());
     }
@@ -1339,6 +1614,10 @@ bool PeerConnection::GetVideoRtx(SDP_TYPE type) {
     }
 }
 
+std::string PeerConnection::GetVideoCodecName() {
+    return (video_codec_ == MEDIA_CODEC_H265) ? "H265" : "H264";
+}
+
 int PeerConnection::GetVideoPayloadType(SDP_TYPE type) {
     if (type == SDP_OFFER) {
         for(auto& rtp_item : offer_sdp_.video_rtp_map_infos_) {
@@ -1359,7 +1638,7 @@ int PeerConnection::GetVideoPayloadType(SDP_TYPE type) {
 void PeerConnection::SetVideoPayloadType(SDP_TYPE type, int payloadType) {
     RtpMapInfo info;
     info.payload_type = payloadType;
-    info.codec_type   = "H264";
+    info.codec_type   = GetVideoCodecName();
     info.clock_rate   = 90000;
 
     if (type == SDP_OFFER) {
@@ -1701,28 +1980,29 @@ std::string PeerConnection::GetAudioCName() {
     return offer_sdp_.audio_cname_;
 }
 
-void PeerConnection::RtpPacketReset(std::shared_ptr<RtpPacketInfo> pkt_ptr) {
+void PeerConnection::RtpPacketReset(RtpPacketInfo* pkt_info) {
     LogInfof(logger_, "rtp jitter buffer reset");
 }
 
-void PeerConnection::RtpPacketOutput(std::shared_ptr<RtpPacketInfo> pkt_ptr) {
-    if (pkt_ptr->media_type_ == MEDIA_VIDEO_TYPE) {
+void PeerConnection::RtpPacketOutput(RtpPacketInfo* pkt_info) {
+    if (pkt_info->media_type_ == MEDIA_VIDEO_TYPE) {
         if (!h264_pack_) {
             h264_pack_ = new PackHandleH264(this, loop_, logger_);
         }
-        h264_pack_->InputRtpPacket(pkt_ptr);
-    } else if (pkt_ptr->media_type_ == MEDIA_AUDIO_TYPE) {
+        h264_pack_->InputRtpPacket(pkt_info);
+    } else if (pkt_info->media_type_ == MEDIA_AUDIO_TYPE) {
         if (!audio_pack_) {
             audio_pack_ = new PackHandleAudio(this, logger_);
         }
-        audio_pack_->InputRtpPacket(pkt_ptr);
+        audio_pack_->InputRtpPacket(pkt_info);
     } else {
         LogErrorf(logger_, "rtp pack receive unknown media type:%d",
-                pkt_ptr->media_type_);
+                pkt_info->media_type_);
+        pkt_info->Release();
     }
 }
 
-void PeerConnection::PackHandleReset(std::shared_ptr<RtpPacketInfo> pkt_ptr) {
+void PeerConnection::PackHandleReset(RtpPacketInfo* pkt_info) {
     LogInfof(logger_, "pack handle reset");
     find_keyframe_ = true;
     if (video_recv_stream_) {
@@ -1739,11 +2019,12 @@ void PeerConnection::MediaPacketOutput(std::shared_ptr<Media_Packet> pkt_ptr) {
         if(H264_IS_AUD(p[pos])) {
             return;
         }
-        if (find_keyframe_) {
-            if (!H264_IS_KEYFRAME(p[pos])) {
+        //the sps/pps go before the keyframe, the access unit may begin with sps
+        if (find_keyframe_ && !pkt_ptr->is_seq_hdr_) {
+            if (!pkt_ptr->is_key_frame_ && !H264_IS_KEYFRAME(p[pos])) {
                 return;
             }
-            find_keyframe_ = false;;
+            find_keyframe_ = false;
         }
     } else if (pkt_ptr->av_type_ == MEDIA_AUDIO_TYPE) {
         pkt_ptr->dts_ = pkt_ptr->pts_ = pkt_ptr->dts_ * 1000 / audio_recv_stream_->GetClockRate();
@@ -4,14 +4,19 @@
 #include "dtls.hpp"
 #include "sdp.hpp"
 #include "udp_client.hpp"
+#include "rtc_udp_transport.hpp"
 #include "srtp_session.hpp"
 #include "rtc_send_stream.hpp"
 #include "rtc_recv_stream.hpp"
+#include "flexfec.hpp"
 #include "jitterbuffer.hpp"
+#include "rtc_pacer.hpp"
+#include "send_side_bwe.hpp"
 #include "timer.hpp"
 #include "rtcp_xr_dlrr.hpp"
 #include "pack_handle_pub.hpp"
 #include "media_callback_interface.hpp"
+#include "metrics.hpp"
 
 namespace cpp_streamer
 {
@@ -101,6 +106,9 @@ class PeerConnection : public UdpSessionCallbackI
     , public TimerInterface
     , public JitterBufferCallbackI
     , public PackCallbackI
+    , public RtcPacerCallbackI
+    , public FlexFecRecoverSinkI
+    , public RtcDtlsCallbackI
 {
 public:
     PeerConnection(uv_loop_t* loop, Logger* logger, PCStateReportI* state_report);
@@ -119,6 +127,15 @@ public:
     void SetFingerPrintsSha256(const std::string& sha256_value);
     std::string GetFingerSha256();
     void UpdatePcState(PC_STATE pc_state);
+    void SetPacingBitrate(uint32_t target_bitrate, double pacing_factor = PACER_DEFAULT_FACTOR);
+    //the video codec in the offer, h264 or h265, set before CreateOfferSdp
+    void SetVideoCodec(MEDIA_CODEC_TYPE codec_type) { video_codec_ = codec_type; }
+    //flexfec in the offer, the rates are the fec percents of the keyframe and delta frame packets
+    void SetFecEnable(bool enable, int key_rate = FEC_DEF_KEY_RATE, int delta_rate = FEC_DEF_DELTA_RATE);
+    //the video frames dropped by the congestion control
+    int64_t GetDroppedFrames() { return video_send_stream_ ? video_send_stream_->GetDroppedFrames() : 0; }
+    //the pipeline latency of the media packets sent is recorded when their rtp packets leave as srtp
+    void SetMetrics(StreamerMetrics* metrics) { metrics_ = metrics; }
 
 public:
     int GetVideoMid(SDP_TYPE type);
@@ -181,10 +198,11 @@ public:
 public:
     void SetMediaCallback(MediaCallbackI* cb) { media_cb_ = cb; }
 
+//RtcDtlsCallbackI
 public:
-    void OnDtlsConnected(CRYPTO_SUITE_ENUM suite,
+    virtual void OnDtlsConnected(CRYPTO_SUITE_ENUM suite,
                 uint8_t* local_key, size_t local_key_len,
-                uint8_t* remote_key, size_t remote_key_len);
+                uint8_t* remote_key, size_t remote_key_len) override;
 
 //TimerInterface
 protected:
@@ -195,17 +213,25 @@ protected:
     virtual void OnRead(const char* data, size_t data_size, UdpTuple address) override;
 
 protected:
-    virtual void SendRtpPacket(uint8_t* data, size_t len) override;
+    virtual void SendRtpPacket(uint8_t* data, size_t len, size_t capacity, RTP_PACE_PRIORITY priority) override;
     virtual void SendRtcpPacket(uint8_t* data, size_t len) override;
+    virtual uint16_t NextTransportSeq() override;
+    virtual void RequestKeyFrame() override;
+
+protected:
+    virtual void OnPacedRtpPacket(uint8_t* data, size_t len, size_t capacity, int64_t ingress_us) override;
 
 public:
-    virtual void RtpPacketReset(std::shared_ptr<RtpPacketInfo> pkt_ptr) override;
-    virtual void RtpPacketOutput(std::shared_ptr<RtpPacketInfo> pkt_ptr) override;
+    virtual void RtpPacketReset(RtpPacketInfo* pkt_info) override;
+    virtual void RtpPacketOutput(RtpPacketInfo* pkt_info) override;
 
 public:
-    virtual void PackHandleReset(std::shared_ptr<RtpPacketInfo> pkt_ptr) override;
+    virtual void PackHandleReset(RtpPacketInfo* pkt_info) override;
     virtual void MediaPacketOutput(std::shared_ptr<Media_Packet> pkt_ptr) override;
 
+protected:
+    virtual void OnRecoveredPacket(uint8_t* data, size_t len) override;
+
 public:
     void SetMsPull(bool enable) { mspull_ = enable; }
     bool GetMsPull() { return mspull_; }
@@ -217,6 +243,7 @@ private:
 private:
     void CreateSendStream();
     void CreateRecvStream();
+    void SetTransportSeqExtensionId(int ext_id);
     void OnStatics(int64_t now_ms);
 
 private:
@@ -230,10 +257,13 @@ private:
     int HandleRtcpPsFb(uint8_t* data, int len);
     int HandleRtcpXr(uint8_t* data, int len);
     int HandleXrDlrr(XrDlrrData* dlrr_block);
+    void HandleRtcpTcc(RtcpFbTcc* tcc_pkt);
 
+    bool BindTransport(const UdpTuple& remote_address);
     void SendStun(int64_t now_ms);
     void SendXrDlrr(int64_t now_ms);
     void SendRr(int64_t now_ms);
+    std::string GetVideoCodecName();
 
 private:
     uv_loop_t* loop_ = nullptr;
@@ -244,12 +274,14 @@ private:
     int64_t last_stun_ms_ = -1;
 
 private:
-    UdpClient* udp_client_ = nullptr;
+    RtcUdpTransport* transport_ = nullptr;//the udp sockets shared with the PeerConnections on the loop
+    UdpClient* udp_client_ = nullptr;     //the socket bound to the remote address, set by the first stun
     std::string pc_ipaddr_str_;
     uint16_t pc_udp_port_ = 0;
     RtcDtls dtls_;
     SdpTransform offer_sdp_;
     SdpTransform answer_sdp_;
+    MEDIA_CODEC_TYPE video_codec_ = MEDIA_CODEC_H264;
 
     SRtpSession* write_srtp_ = nullptr;
     SRtpSession* read_srtp_  = nullptr;
@@ -271,10 +303,29 @@ private:
 private:
     int64_t last_statics_ms_ = -1;
 
+private://flexfec
+    bool fec_enable_     = false;
+    int fec_key_rate_    = FEC_DEF_KEY_RATE;
+    int fec_delta_rate_  = FEC_DEF_DELTA_RATE;
+    uint32_t fec_ssrc_   = 0;
+    FlexFecDecoder* fec_decoder_ = nullptr;
+
 private:
+    RtpPacketPool rtp_pool_;//the receive slots, it outlives the jitter buffers and the pack handles
     JitterBuffer jb_video_;
     JitterBuffer jb_audio_;
 
+private:
+    RtcPacer pacer_;
+    StreamerMetrics* metrics_ = nullptr;
+    int64_t send_ingress_us_  = 0;//the ingress of the media packet being packetized
+
+private://transport-wide cc
+    SendSideBwe bwe_;
+    uint8_t tcc_ext_id_       = 0;
+    uint16_t transport_seq_   = 0;
+    uint32_t report_bitrate_  = 0;
+
 private:
     PackHandleBase* h264_pack_  = nullptr;
     PackHandleBase* audio_pack_ = nullptr;
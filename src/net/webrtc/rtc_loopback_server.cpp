@@ -0,0 +1,484 @@
+#include "rtc_loopback_server.hpp"
+#include "rtcp_pspli.hpp"
+#include "byte_stream.hpp"
+#include "timeex.hpp"
+#include "stringex.hpp"
+#include "byte_crypto.hpp"
+
+#include <vector>
+#include <arpa/inet.h>
+
+namespace cpp_streamer
+{
+//the servers are found by the local http port in the static handles
+static std::map<uint16_t, RtcLoopbackServer*> s_servers;
+
+static RtcLoopbackServer* GetServer(const HttpRequest* request) {
+    std::string local_address = request->local_address();
+    uint16_t port = 0;
+
+    size_t pos = local_address.rfind(":");
+    if (pos != local_address.npos) {
+        port = atoi(local_address.substr(pos + 1).c_str());
+    }
+    auto iter = s_servers.find(port);
+    if (iter == s_servers.end()) {
+        return nullptr;
+    }
+    return iter->second;
+}
+
+RtcLoopbackSession::RtcLoopbackSession(RtcLoopbackServer* server, UdpServer* udp_server,
+        bool publisher, const std::string& stream, Logger* logger):server_(server)
+                                                                , udp_server_(udp_server)
+                                                                , logger_(logger)
+                                                                , publisher_(publisher)
+                                                                , stream_(stream)
+                                                                , dtls_(this, logger)
+                                                                , offer_sdp_(&dtls_, logger)
+                                                                , answer_sdp_(&dtls_, logger)
+{
+    dtls_.role_       = ROLE_CLIENT;
+    dtls_.udp_client_ = udp_server_;
+    create_ms_    = now_millisec();
+    last_recv_ms_ = create_ms_;
+}
+
+RtcLoopbackSession::~RtcLoopbackSession()
+{
+    if (write_srtp_) {
+        delete write_srtp_;
+        write_srtp_ = nullptr;
+    }
+    if (read_srtp_) {
+        delete read_srtp_;
+        read_srtp_ = nullptr;
+    }
+}
+
+std::string RtcLoopbackSession::CreateAnswer(const std::string& offer, const std::string& candidate) {
+    offer_sdp_.Parse(offer);
+
+    if (dtls_.remote_fragment_.empty() || dtls_.remote_pwd_.empty()) {
+        LogErrorf(logger_, "the offer has no ice ufrag or pwd, stream:%s", stream_.c_str());
+        return "";
+    }
+    if (offer_sdp_.video_pt_vec_.empty() && offer_sdp_.audio_pt_vec_.empty()) {
+        LogErrorf(logger_, "the offer has no media, stream:%s", stream_.c_str());
+        return "";
+    }
+    if (dtls_.SslContextInit() < 0) {
+        LogErrorf(logger_, "SslContextInit error");
+        return "";
+    }
+    video_ssrc_     = offer_sdp_.GetVideoSsrc();
+    video_rtx_ssrc_ = offer_sdp_.GetVideoRtxSsrc();
+    audio_ssrc_     = offer_sdp_.GetAudioSsrc();
+
+    //the header extensions are not answered, so no transport-cc feedback is expected
+    answer_sdp_ = offer_sdp_;
+    answer_sdp_.dtls_      = &dtls_;
+    answer_sdp_.setup_     = "active";
+    answer_sdp_.direction_ = publisher_ ? "recvonly" : "sendonly";
+    answer_sdp_.vmid_      = 0;
+    answer_sdp_.amid_      = 1;
+    answer_sdp_.ice_lite_  = true;
+    answer_sdp_.session_name_ = "cpp_streamer_loopback";
+    answer_sdp_.candidates_.push_back(candidate);
+
+    return answer_sdp_.GenSdpString(offer_sdp_.has_video_, offer_sdp_.has_audio_);
+}
+
+void RtcLoopbackSession::OnStun(StunPacket* pkt, const UdpTuple& address) {
+    StunPacket resp;
+    struct sockaddr_in* addr = (struct sockaddr_in*)malloc(sizeof(struct sockaddr_in));
+
+    memset(addr, 0, sizeof(struct sockaddr_in));
+    uv_ip4_addr(address.ip_address.c_str(), address.port, addr);
+
+    last_recv_ms_ = now_millisec();
+    dtls_.remote_address_ = address;
+
+    resp.stun_class_  = STUN_SUCCESS_RESPONSE;
+    resp.xor_address_ = (struct sockaddr*)addr;//freed by the packet
+    resp.password_    = dtls_.local_pwd_;
+    resp.add_msg_integrity_ = true;
+    memcpy(resp.transaction_id_, pkt->transaction_id_, sizeof(resp.transaction_id_));
+    resp.Serialize();
+
+    udp_server_->Write((char*)resp.data_, resp.data_len_, address);
+
+    if (!dtls_started_) {
+        dtls_started_ = true;
+        dtls_.DtlsStart();
+    }
+}
+
+void RtcLoopbackSession::OnDtlsData(uint8_t* data, size_t len) {
+    last_recv_ms_ = now_millisec();
+    dtls_.OnDtlsData(data, (int)len);
+}
+
+void RtcLoopbackSession::OnDtlsConnected(CRYPTO_SUITE_ENUM suite,
+                uint8_t* local_key, size_t local_key_len,
+                uint8_t* remote_key, size_t remote_key_len) {
+    if (write_srtp_) {
+        return;
+    }
+    try {
+        write_srtp_ = new SRtpSession(SRTP_SESSION_OUT_TYPE, suite, local_key, local_key_len);
+        read_srtp_  = new SRtpSession(SRTP_SESSION_IN_TYPE, suite, remote_key, remote_key_len);
+    } catch(CppStreamException& e) {
+        LogErrorf(logger_, "create srtp session error:%s", e.what());
+        return;
+    }
+    int64_t connect_ms = now_millisec() - create_ms_;
+    LogInfof(logger_, "loopback %s session is connected, stream:%s, cost:%ldms",
+            publisher_ ? "whip" : "whep", stream_.c_str(), connect_ms);
+    server_->OnConnected(connect_ms);
+
+    if (!publisher_) {
+        server_->RequestKeyFrame(stream_);
+    }
+}
+
+void RtcLoopbackSession::OnRtp(uint8_t* data, size_t len) {
+    if (!read_srtp_) {
+        return;
+    }
+    last_recv_ms_ = now_millisec();
+    if (!read_srtp_->DecryptSrtp(data, &len)) {
+        return;
+    }
+    server_->rtp_recv_count_++;
+    if (!publisher_) {
+        return;
+    }
+    uint32_t ssrc = ByteStream::Read4Bytes(data + 8);
+    if (ssrc == video_ssrc_) {
+        server_->Reflect(this, data, len, true, false);
+    } else if (ssrc == video_rtx_ssrc_) {
+        server_->Reflect(this, data, len, true, true);
+    } else if (ssrc == audio_ssrc_) {
+        server_->Reflect(this, data, len, false, false);
+    }
+    //the flexfec packets are not reflected, the players may not negotiate it
+}
+
+void RtcLoopbackSession::OnRtcp(uint8_t* data, size_t len) {
+    if (!read_srtp_) {
+        return;
+    }
+    last_recv_ms_ = now_millisec();
+    if (!read_srtp_->DecryptSrtcp(data, &len)) {
+        return;
+    }
+    if (publisher_) {
+        return;
+    }
+    //the key frame requests of the players go to the publisher
+    uint8_t* p = data;
+    size_t left_len = len;
+    while (left_len >= sizeof(RtcpCommonHeader)) {
+        RtcpCommonHeader* header = (RtcpCommonHeader*)p;
+        size_t item_len = sizeof(RtcpCommonHeader) + GetRtcpLength(header);
+        if (item_len > left_len) {
+            break;
+        }
+        if (header->packet_type == RTCP_PSFB && (header->count == FB_PS_PLI || header->count == FB_PS_FIR)) {
+            server_->RequestKeyFrame(stream_);
+            break;
+        }
+        p        += item_len;
+        left_len -= item_len;
+    }
+}
+
+void RtcLoopbackSession::SendMedia(const uint8_t* data, size_t len, bool is_video, bool is_rtx) {
+    if (!write_srtp_ || len > RTP_PACKET_MAX_SIZE) {
+        return;
+    }
+    uint32_t ssrc = is_video ? (is_rtx ? video_rtx_ssrc_ : video_ssrc_) : audio_ssrc_;
+    if (ssrc == 0) {
+        return;
+    }
+    uint8_t* send_data = send_buffer_;
+
+    memcpy(send_data, data, len);
+    ByteStream::Write4Bytes(send_data + 8, ssrc);
+    if (!write_srtp_->ProtectRtp(&send_data, &len, sizeof(send_buffer_))) {
+        return;
+    }
+    udp_server_->Write((char*)send_data, len, dtls_.remote_address_);
+    server_->rtp_send_count_++;
+}
+
+void RtcLoopbackSession::SendPli() {
+    if (!write_srtp_ || video_ssrc_ == 0) {
+        return;
+    }
+    RtcpPsPli pli;
+    pli.SetSenderSsrc(1);
+    pli.SetMediaSsrc(video_ssrc_);
+
+    uint8_t* send_data = send_buffer_;
+    size_t len = pli.GetDataLen();
+
+    memcpy(send_data, pli.GetData(), len);
+    if (!write_srtp_->ProtectRtcp(&send_data, &len, sizeof(send_buffer_))) {
+        return;
+    }
+    udp_server_->Write((char*)send_data, len, dtls_.remote_address_);
+}
+
+RtcLoopbackServer::RtcLoopbackServer(uv_loop_t* loop, const std::string& ip,
+        uint16_t http_port, uint16_t udp_port, Logger* logger):TimerInterface(loop, RTC_LOOPBACK_CHECK_MS)
+                                                            , loop_(loop)
+                                                            , logger_(logger)
+                                                            , ip_(ip)
+                                                            , http_port_(http_port)
+                                                            , udp_port_(udp_port)
+{
+    ByteCrypto::Init();
+    SRtpSession::Init(logger);
+
+    udp_server_  = new UdpServer(loop_, udp_port_, this, logger_);
+    http_server_ = new HttpServer(http_port_, loop_, logger_);
+    http_server_->AddHandle(RTC_LOOPBACK_WHIP_URI, RtcLoopbackServer::OnWhipPost);
+    http_server_->AddHandle(RTC_LOOPBACK_WHEP_URI, RtcLoopbackServer::OnWhepPost);
+    s_servers[http_port_] = this;
+
+    StartTimer();
+    LogInfof(logger_, "rtc loopback server starts, ip:%s, http port:%d, udp port:%d",
+            ip_.c_str(), http_port_, udp_port_);
+}
+
+RtcLoopbackServer::~RtcLoopbackServer()
+{
+    StopTimer();
+    s_servers.erase(http_port_);
+    if (http_server_) {
+        delete http_server_;
+        http_server_ = nullptr;
+    }
+    for (RtcLoopbackSession* session : sessions_) {
+        delete session;
+    }
+    sessions_.clear();
+    if (udp_server_) {
+        udp_server_->CloseAndDelete();
+        udp_server_ = nullptr;
+    }
+}
+
+size_t RtcLoopbackServer::GetConnectedCount() {
+    size_t count = 0;
+    for (RtcLoopbackSession* session : sessions_) {
+        if (session->IsConnected()) {
+            count++;
+        }
+    }
+    return count;
+}
+
+void RtcLoopbackServer::OnWhipPost(const HttpRequest* request, std::shared_ptr<HttpResponse> response_ptr) {
+    RtcLoopbackServer* server = GetServer(request);
+    if (!server) {
+        response_ptr->SetStatusCode(404);
+        response_ptr->SetStatus("Not Found");
+        response_ptr->Write(nullptr, 0);
+        return;
+    }
+    server->HandleOffer(request, response_ptr, true);
+}
+
+void RtcLoopbackServer::OnWhepPost(const HttpRequest* request, std::shared_ptr<HttpResponse> response_ptr) {
+    RtcLoopbackServer* server = GetServer(request);
+    if (!server) {
+        response_ptr->SetStatusCode(404);
+        response_ptr->SetStatus("Not Found");
+        response_ptr->Write(nullptr, 0);
+        return;
+    }
+    server->HandleOffer(request, response_ptr, false);
+}
+
+//the stream is app/stream of the params, eg. ?app=live&stream=1000
+void RtcLoopbackServer::HandleOffer(const HttpRequest* request,
+        std::shared_ptr<HttpResponse> response_ptr, bool publisher) {
+    if (request->method_ != "POST" || !request->content_body_ || request->content_length_ <= 0) {
+        response_ptr->SetStatusCode(400);
+        response_ptr->SetStatus("Bad Request");
+        response_ptr->Write(nullptr, 0);
+        return;
+    }
+    std::string app;
+    std::string stream_name;
+    auto iter = request->params.find("app");
+    if (iter != request->params.end()) {
+        app = iter->second;
+    }
+    iter = request->params.find("stream");
+    if (iter != request->params.end()) {
+        stream_name = iter->second;
+    }
+    std::string stream = app + "/" + stream_name;
+    std::string offer(request->content_body_, request->content_length_);
+    std::string candidate = "1 1 udp 2130706431 " + ip_ + " " + std::to_string(udp_port_) + " typ host";
+
+    RtcLoopbackSession* session = new RtcLoopbackSession(this, udp_server_, publisher, stream, logger_);
+    std::string answer = session->CreateAnswer(offer, candidate);
+    if (answer.empty()) {
+        delete session;
+        response_ptr->SetStatusCode(400);
+        response_ptr->SetStatus("Bad Request");
+        response_ptr->Write(nullptr, 0);
+        return;
+    }
+    sessions_.insert(session);
+    ufrag_sessions_[session->GetLocalUfrag()] = session;
+    if (publisher) {
+        //the earlier publisher of the stream is only counted
+        publishers_[stream] = session;
+    } else {
+        players_[stream].insert(session);
+    }
+    LogInfof(logger_, "loopback %s session is created, stream:%s, remote:%s, sessions:%lu",
+            publisher ? "whip" : "whep", stream.c_str(),
+            request->remote_address().c_str(), sessions_.size());
+
+    response_ptr->SetStatusCode(201);
+    response_ptr->SetStatus("Created");
+    response_ptr->AddHeader("Content-Type", "application/sdp");
+    response_ptr->AddHeader("Location", std::string(publisher ? RTC_LOOPBACK_WHIP_URI : RTC_LOOPBACK_WHEP_URI)
+            + "?session=" + session->GetLocalUfrag());
+    response_ptr->Write(answer.c_str(), answer.length());
+}
+
+void RtcLoopbackServer::OnWrite(size_t sent_size, UdpTuple address) {
+    return;
+}
+
+void RtcLoopbackServer::OnRead(const char* data, size_t data_size, UdpTuple address) {
+    uint8_t* p = (uint8_t*)data;
+
+    if (StunPacket::IsBindingRequest(p, data_size)) {
+        HandleStun(p, data_size, address);
+        return;
+    }
+    auto iter = address_sessions_.find(address.to_string());
+    if (iter == address_sessions_.end()) {
+        unknown_count_++;
+        return;
+    }
+    RtcLoopbackSession* session = iter->second;
+
+    if (IsRtcp(p, data_size)) {
+        session->OnRtcp(p, data_size);
+    } else if (IsRtp(p, data_size)) {
+        session->OnRtp(p, data_size);
+    } else if (RtcDtls::IsDtls(p, data_size)) {
+        session->OnDtlsData(p, data_size);
+    }
+}
+
+//the stun username is "local ufrag:remote ufrag" of the server side
+void RtcLoopbackServer::HandleStun(const uint8_t* data, size_t len, const UdpTuple& address) {
+    StunPacket* pkt = nullptr;
+    try {
+        pkt = StunPacket::Parse(data, len);
+    } catch(CppStreamException& e) {
+        LogErrorf(logger_, "handle stun packet exception:%s", e.what());
+        return;
+    }
+    std::string ufrag = pkt->username_;
+    size_t pos = ufrag.find(":");
+    if (pos != ufrag.npos) {
+        ufrag = ufrag.substr(0, pos);
+    }
+    auto iter = ufrag_sessions_.find(ufrag);
+    if (iter == ufrag_sessions_.end()) {
+        unknown_count_++;
+        delete pkt;
+        return;
+    }
+    RtcLoopbackSession* session = iter->second;
+    std::string address_key = address.to_string();
+
+    auto addr_iter = session_addresses_.find(session);
+    if (addr_iter == session_addresses_.end() || addr_iter->second != address_key) {
+        if (addr_iter != session_addresses_.end()) {
+            address_sessions_.erase(addr_iter->second);
+        }
+        address_sessions_[address_key] = session;
+        session_addresses_[session]     = address_key;
+    }
+    session->OnStun(pkt, address);
+    delete pkt;
+}
+
+void RtcLoopbackServer::Reflect(RtcLoopbackSession* publisher, const uint8_t* data, size_t len,
+        bool is_video, bool is_rtx) {
+    auto iter = players_.find(publisher->GetStream());
+    if (iter == players_.end()) {
+        return;
+    }
+    for (RtcLoopbackSession* player : iter->second) {
+        player->SendMedia(data, len, is_video, is_rtx);
+    }
+}
+
+void RtcLoopbackServer::RequestKeyFrame(const std::string& stream) {
+    auto iter = publishers_.find(stream);
+    if (iter == publishers_.end()) {
+        return;
+    }
+    iter->second->SendPli();
+}
+
+void RtcLoopbackServer::RemoveSession(RtcLoopbackSession* session) {
+    std::string stream = session->GetStream();
+
+    if (session->IsPublisher()) {
+        auto iter = publishers_.find(stream);
+        if (iter != publishers_.end() && iter->second == session) {
+            publishers_.erase(iter);
+        }
+    } else {
+        auto iter = players_.find(stream);
+        if (iter != players_.end()) {
+            iter->second.erase(session);
+            if (iter->second.empty()) {
+                players_.erase(iter);
+            }
+        }
+    }
+    auto addr_iter = session_addresses_.find(session);
+    if (addr_iter != session_addresses_.end()) {
+        address_sessions_.erase(addr_iter->second);
+        session_addresses_.erase(addr_iter);
+    }
+    ufrag_sessions_.erase(session->GetLocalUfrag());
+    sessions_.erase(session);
+    delete session;
+}
+
+void RtcLoopbackServer::OnTimer() {
+    int64_t now_ms = now_millisec();
+    std::vector<RtcLoopbackSession*> idle_sessions;
+
+    for (RtcLoopbackSession* session : sessions_) {
+        if (now_ms - session->GetLastRecvMs() > RTC_LOOPBACK_IDLE_MS) {
+            idle_sessions.push_back(session);
+            continue;
+        }
+        session->CheckTimeout();
+    }
+    for (RtcLoopbackSession* session : idle_sessions) {
+        LogInfof(logger_, "loopback session is idle and removed, stream:%s, ufrag:%s",
+                session->GetStream().c_str(), session->GetLocalUfrag().c_str());
+        RemoveSession(session);
+    }
+}
+
+}
@@ -0,0 +1,170 @@
+#ifndef RTC_LOOPBACK_SERVER_HPP
+#define RTC_LOOPBACK_SERVER_HPP
+#include "http_server.hpp"
+#include "http_common.hpp"
+#include "udp_server.hpp"
+#include "dtls.hpp"
+#include "sdp.hpp"
+#include "stun.hpp"
+#include "srtp_session.hpp"
+#include "rtprtcp_pub.hpp"
+#include "latency_stats.hpp"
+#include "timer.hpp"
+#include "logger.hpp"
+
+#include <uv.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <string>
+#include <set>
+#include <map>
+#include <unordered_map>
+
+namespace cpp_streamer
+{
+#define RTC_LOOPBACK_CHECK_MS  1000
+#define RTC_LOOPBACK_IDLE_MS   (10*1000)//the session without any packet is removed
+#define RTC_LOOPBACK_WHIP_URI  "/rtc/v1/whip/"
+#define RTC_LOOPBACK_WHEP_URI  "/rtc/v1/whip-play/"
+
+class RtcLoopbackServer;
+
+/*
+ * one whip publisher or whep player of the loopback server.
+ * the answer takes the codecs and the ssrcs of the offer, so the client sends and
+ * receives the ssrcs of its own offer. it is ice-lite, and it is the dtls client
+ * (a=setup:active) which starts the handshake after the first stun binding request.
+ */
+class RtcLoopbackSession : public RtcDtlsCallbackI
+{
+public:
+    RtcLoopbackSession(RtcLoopbackServer* server, UdpServer* udp_server,
+            bool publisher, const std::string& stream, Logger* logger);
+    virtual ~RtcLoopbackSession();
+
+public:
+    //return the answer sdp, empty when the offer is not valid
+    std::string CreateAnswer(const std::string& offer, const std::string& candidate);
+    std::string GetLocalUfrag() { return dtls_.local_fragment_; }
+    std::string GetStream() { return stream_; }
+    bool IsPublisher() { return publisher_; }
+    bool IsConnected() { return write_srtp_ != nullptr; }
+    int64_t GetLastRecvMs() { return last_recv_ms_; }
+
+public:
+    void OnStun(StunPacket* pkt, const UdpTuple& address);
+    void OnDtlsData(uint8_t* data, size_t len);
+    void OnRtp(uint8_t* data, size_t len);
+    void OnRtcp(uint8_t* data, size_t len);
+    void CheckTimeout() { dtls_.CheckTimeout(); }
+
+public:
+    //the rtp packet of the publisher with the ssrc replaced by the one of the player
+    void SendMedia(const uint8_t* data, size_t len, bool is_video, bool is_rtx);
+    void SendPli();
+
+//RtcDtlsCallbackI
+public:
+    virtual void OnDtlsConnected(CRYPTO_SUITE_ENUM suite,
+                uint8_t* local_key, size_t local_key_len,
+                uint8_t* remote_key, size_t remote_key_len) override;
+
+private:
+    RtcLoopbackServer* server_ = nullptr;
+    UdpServer* udp_server_     = nullptr;
+    Logger* logger_            = nullptr;
+    bool publisher_            = false;
+    std::string stream_;
+
+private:
+    RtcDtls dtls_;
+    SdpTransform offer_sdp_;
+    SdpTransform answer_sdp_;
+    SRtpSession* write_srtp_ = nullptr;
+    SRtpSession* read_srtp_  = nullptr;
+    bool dtls_started_       = false;
+
+private:
+    uint32_t video_ssrc_     = 0;
+    uint32_t video_rtx_ssrc_ = 0;
+    uint32_t audio_ssrc_     = 0;
+
+private:
+    int64_t create_ms_    = 0;
+    int64_t last_recv_ms_ = 0;
+    uint8_t send_buffer_[RTP_PACKET_BUFFER_SIZE];
+};
+
+/*
+ * a minimal local whip/whep endpoint for the offline end-to-end benchmarks:
+ * POST the offer to http://ip:port/rtc/v1/whip/?app=live&stream=xxx to publish,
+ * POST to http://ip:port/rtc/v1/whip-play/?app=live&stream=xxx to play.
+ * all the sessions share one udp port, they are found by the local ice ufrag of
+ * the stun username, then by the remote address.
+ * the rtp packets of a publisher are reflected to the players of the same stream,
+ * without any player they are decrypted and counted only(sink).
+ * the http server and the udp server must run on the same loop.
+ */
+class RtcLoopbackServer : public UdpSessionCallbackI, public TimerInterface
+{
+friend class RtcLoopbackSession;
+
+public:
+    RtcLoopbackServer(uv_loop_t* loop, const std::string& ip,
+            uint16_t http_port, uint16_t udp_port, Logger* logger);
+    virtual ~RtcLoopbackServer();
+
+public:
+    static void OnWhipPost(const HttpRequest* request, std::shared_ptr<HttpResponse> response_ptr);
+    static void OnWhepPost(const HttpRequest* request, std::shared_ptr<HttpResponse> response_ptr);
+
+public:
+    size_t GetSessionCount() { return sessions_.size(); }
+    size_t GetConnectedCount();
+    int64_t GetRtpRecvCount() { return rtp_recv_count_; }
+    int64_t GetRtpSendCount() { return rtp_send_count_; }
+    //from the offer to the srtp keys of the dtls
+    LatencyStats& GetConnectStats() { return connect_stats_; }
+
+protected://UdpSessionCallbackI
+    virtual void OnWrite(size_t sent_size, UdpTuple address) override;
+    virtual void OnRead(const char* data, size_t data_size, UdpTuple address) override;
+
+protected://TimerInterface
+    virtual void OnTimer() override;
+
+private:
+    void HandleOffer(const HttpRequest* request, std::shared_ptr<HttpResponse> response_ptr, bool publisher);
+    void HandleStun(const uint8_t* data, size_t len, const UdpTuple& address);
+    void Reflect(RtcLoopbackSession* publisher, const uint8_t* data, size_t len, bool is_video, bool is_rtx);
+    void RequestKeyFrame(const std::string& stream);
+    void OnConnected(int64_t connect_ms) { connect_stats_.Add(connect_ms); }
+    void RemoveSession(RtcLoopbackSession* session);
+
+private:
+    uv_loop_t* loop_   = nullptr;
+    Logger* logger_    = nullptr;
+    std::string ip_;
+    uint16_t http_port_ = 0;
+    uint16_t udp_port_  = 0;
+    HttpServer* http_server_ = nullptr;
+    UdpServer* udp_server_   = nullptr;
+
+private:
+    std::set<RtcLoopbackSession*> sessions_;
+    std::unordered_map<std::string, RtcLoopbackSession*> ufrag_sessions_;
+    std::unordered_map<std::string, RtcLoopbackSession*> address_sessions_;
+    std::unordered_map<RtcLoopbackSession*, std::string> session_addresses_;
+    std::map<std::string, RtcLoopbackSession*> publishers_;
+    std::map<std::string, std::set<RtcLoopbackSession*>> players_;
+
+private:
+    int64_t rtp_recv_count_ = 0;
+    int64_t rtp_send_count_ = 0;
+    int64_t unknown_count_  = 0;
+    LatencyStats connect_stats_;
+};
+
+}
+
+#endif
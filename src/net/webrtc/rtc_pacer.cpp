@@ -0,0 +1,173 @@
+#include "rtc_pacer.hpp"
+
+#include <cstring>
+
+namespace cpp_streamer
+{
+
+RtcPacer::RtcPacer(uv_loop_t* loop,
+        RtcPacerCallbackI* cb,
+        Logger* logger):TimerInterface(loop, PACER_INTERVAL_MS, true)
+                        , loop_(loop)
+                        , cb_(cb)
+                        , logger_(logger)
+{
+}
+
+RtcPacer::~RtcPacer()
+{
+    StopTimer();
+    for (auto pkt : resend_queue_) {
+        delete pkt;
+    }
+    for (auto pkt : video_queue_) {
+        delete pkt;
+    }
+    for (auto pkt : pool_) {
+        delete pkt;
+    }
+    resend_queue_.clear();
+    video_queue_.clear();
+    pool_.clear();
+}
+
+void RtcPacer::Enqueue(uint8_t* data, size_t len, size_t capacity, RTP_PACE_PRIORITY priority, int64_t ingress_us) {
+    if (len > RTP_PACKET_MAX_SIZE) {
+        LogErrorf(logger_, "pacer packet len:%lu is too large", len);
+        return;
+    }
+    int64_t now_ms = (int64_t)uv_now(loop_);
+
+    UpdateBudget(now_ms);
+
+    //audio is never held back, the others go directly when nothing is waiting
+    if (priority == PACE_AUDIO_PRIORITY || (QueuePackets() == 0 && budget_bytes_ > 0)) {
+        budget_bytes_ -= (int64_t)len;
+        delay_count_++;
+        cb_->OnPacedRtpPacket(data, len, capacity, ingress_us);
+        return;
+    }
+
+    PacerPacket* pkt = GetPacket();
+    memcpy(pkt->data, data, len);
+    pkt->len        = len;
+    pkt->enqueue_ms = now_ms;
+    pkt->ingress_us = ingress_us;
+    queue_bytes_ += len;
+
+    if (priority == PACE_RETRANSMIT_PRIORITY) {
+        resend_queue_.push_back(pkt);
+    } else {
+        video_queue_.push_back(pkt);
+    }
+    StartTimer();
+}
+
+size_t RtcPacer::QueuePackets() {
+    return resend_queue_.size() + video_queue_.size();
+}
+
+void RtcPacer::GetQueueDelay(int64_t& avg_ms, int64_t& max_ms) {
+    avg_ms = (delay_count_ > 0) ? (delay_total_ms_ / delay_count_) : 0;
+    max_ms = delay_max_ms_;
+
+    delay_total_ms_ = 0;
+    delay_count_    = 0;
+    delay_max_ms_   = 0;
+}
+
+void RtcPacer::OnTimer() {
+    Process((int64_t)uv_now(loop_));
+}
+
+uint32_t RtcPacer::GetPacingRate(int64_t now_ms) {
+    uint32_t rate = (uint32_t)(target_bitrate_ * pacing_factor_);
+
+    if (video_queue_.empty()) {
+        return rate;
+    }
+    //drain the queue before the oldest packet waits longer than the limit
+    int64_t waited = now_ms - video_queue_.front()->enqueue_ms;
+    int64_t left   = PACER_QUEUE_TIME_LIMIT_MS - waited;
+    if (left < PACER_INTERVAL_MS) {
+        left = PACER_INTERVAL_MS;
+    }
+    uint32_t drain_rate = (uint32_t)((int64_t)queue_bytes_ * 8 * 1000 / left);
+
+    return (drain_rate > rate) ? drain_rate : rate;
+}
+
+void RtcPacer::UpdateBudget(int64_t now_ms) {
+    if (last_update_ms_ < 0) {
+        last_update_ms_ = now_ms;
+        budget_bytes_   = (int64_t)GetPacingRate(now_ms) * PACER_INTERVAL_MS / 8000;
+        return;
+    }
+    int64_t elapsed = now_ms - last_update_ms_;
+    if (elapsed <= 0) {
+        return;
+    }
+    last_update_ms_ = now_ms;
+
+    int64_t rate = (int64_t)GetPacingRate(now_ms);
+    int64_t max_budget = rate * PACER_BURST_MS / 8000;
+
+    budget_bytes_ += rate * elapsed / 8000;
+    if (budget_bytes_ > max_budget) {
+        budget_bytes_ = max_budget;
+    }
+}
+
+bool RtcPacer::SendQueue(std::deque<PacerPacket*>& queue, int64_t now_ms) {
+    while (!queue.empty()) {
+        if (budget_bytes_ <= 0) {
+            return false;
+        }
+        PacerPacket* pkt = queue.front();
+        queue.pop_front();
+
+        int64_t delay = now_ms - pkt->enqueue_ms;
+        delay_total_ms_ += delay;
+        delay_count_++;
+        if (delay > delay_max_ms_) {
+            delay_max_ms_ = delay;
+        }
+
+        budget_bytes_ -= (int64_t)pkt->len;
+        queue_bytes_  -= pkt->len;
+        cb_->OnPacedRtpPacket(pkt->data, pkt->len, sizeof(pkt->data), pkt->ingress_us);
+        FreePacket(pkt);
+    }
+    return true;
+}
+
+void RtcPacer::Process(int64_t now_ms) {
+    UpdateBudget(now_ms);
+
+    if (SendQueue(resend_queue_, now_ms)) {
+        SendQueue(video_queue_, now_ms);
+    }
+
+    if (QueuePackets() == 0) {
+        StopTimer();
+    }
+}
+
+PacerPacket* RtcPacer::GetPacket() {
+    if (pool_.empty()) {
+        return new PacerPacket;
+    }
+    PacerPacket* pkt = pool_.back();
+    pool_.pop_back();
+    return pkt;
+}
+
+void RtcPacer::FreePacket(PacerPacket* pkt) {
+    if (pool_.size() >= PACER_POOL_MAX) {
+        delete pkt;
+        return;
+    }
+    pool_.push_back(pkt);
+}
+
+}
@@ -0,0 +1,99 @@
+#ifndef RTC_PACER_HPP
+#define RTC_PACER_HPP
+#include "logger.hpp"
+#include "timer.hpp"
+#include "rtc_stream_pub.hpp"
+#include "rtprtcp_pub.hpp"
+
+#include <uv.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <deque>
+#include <vector>
+
+namespace cpp_streamer
+{
+#define PACER_INTERVAL_MS          5
+#define PACER_BURST_MS             (2*PACER_INTERVAL_MS)
+#define PACER_DEFAULT_BITRATE      (2*1000*1000) //bps
+#define PACER_DEFAULT_FACTOR       2.5
+#define PACER_QUEUE_TIME_LIMIT_MS  500
+#define PACER_POOL_MAX             512
+
+class RtcPacerCallbackI
+{
+public:
+    //capacity: the writable buffer size of data, 0 when it is not writable
+    //ingress_us: the pipeline ingress time given to Enqueue, 0 when it is not given
+    virtual void OnPacedRtpPacket(uint8_t* data, size_t len, size_t capacity, int64_t ingress_us) = 0;
+};
+
+typedef struct {
+    uint8_t data[RTP_PACKET_BUFFER_SIZE];//the tail room is for the srtp trailer
+    size_t len;
+    int64_t enqueue_ms;
+    int64_t ingress_us;
+} PacerPacket;
+
+/*
+ * leaky bucket pacer: the bucket is refilled at pacing factor * target bitrate
+ * every 5ms, the retransmission queue is drained before video,
+ * audio is sent at once and only charged to the budget.
+ * the pacing rate is raised when the queue can not be drained in 500ms.
+ */
+class RtcPacer : public TimerInterface
+{
+public:
+    RtcPacer(uv_loop_t* loop, RtcPacerCallbackI* cb, Logger* logger);
+    virtual ~RtcPacer();
+
+public:
+    void SetTargetBitrate(uint32_t bitrate) { target_bitrate_ = bitrate; }
+    uint32_t GetTargetBitrate() { return target_bitrate_; }
+    void SetPacingFactor(double factor) { pacing_factor_ = factor; }
+    double GetPacingFactor() { return pacing_factor_; }
+
+public:
+    void Enqueue(uint8_t* data, size_t len, size_t capacity, RTP_PACE_PRIORITY priority, int64_t ingress_us = 0);
+    size_t QueueBytes() { return queue_bytes_; }
+    size_t QueuePackets();
+    void GetQueueDelay(int64_t& avg_ms, int64_t& max_ms);
+
+//TimerInterface
+protected:
+    virtual void OnTimer() override;
+
+private:
+    void UpdateBudget(int64_t now_ms);
+    void Process(int64_t now_ms);
+    bool SendQueue(std::deque<PacerPacket*>& queue, int64_t now_ms);
+    uint32_t GetPacingRate(int64_t now_ms);
+    PacerPacket* GetPacket();
+    void FreePacket(PacerPacket* pkt);
+
+private:
+    uv_loop_t* loop_ = nullptr;
+    RtcPacerCallbackI* cb_ = nullptr;
+    Logger* logger_ = nullptr;
+
+private:
+    uint32_t target_bitrate_ = PACER_DEFAULT_BITRATE;
+    double pacing_factor_    = PACER_DEFAULT_FACTOR;
+    int64_t budget_bytes_    = 0;
+    int64_t last_update_ms_  = -1;
+
+private:
+    std::deque<PacerPacket*> resend_queue_;
+    std::deque<PacerPacket*> video_queue_;
+    std::vector<PacerPacket*> pool_;
+    size_t queue_bytes_ = 0;
+
+private://queue delay statics
+    int64_t delay_total_ms_ = 0;
+    int64_t delay_count_    = 0;
+    int64_t delay_max_ms_   = 0;
+};
+
+}
+
+#endif
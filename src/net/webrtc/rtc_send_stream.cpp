@@ -1,15 +1,14 @@
 #include "rtc_send_stream.hpp"
 #include "h264_h265_header.hpp"
-#include "rtp_h264_pack.hpp"
+#include "rtp_packetizer.hpp"
 #include "opus_header.hpp"
 
 #include "timeex.hpp"
+#include "byte_stream.hpp"
 
 namespace cpp_streamer
 {
 
-#define SEND_BUFFER_SIZE 2048
-
 RtcSendStream::RtcSendStream(MEDIA_PKT_TYPE type, 
             uint32_t ssrc, uint8_t payload, 
             int clock_rate, bool nack, 
@@ -28,11 +27,9 @@ RtcSendStream::RtcSendStream(MEDIA_PKT_TYPE type,
         .ntp_frac = 0
     };
 
-    send_buffer_.resize(SEND_BUFFER_SIZE);
-    for (auto& item : send_buffer_) {
-        item.last_ms = 0;
-        item.retry_count = 0;
-        item.pkt = nullptr;
+    //only the video packets are kept for the nack, audio is not resent
+    if (nack_enable_ && media_type_ == MEDIA_VIDEO_TYPE) {
+        ResizeHistory(SEND_HISTORY_MIN_SLOTS);
     }
     LogInfof(logger, "RtcSendStream construct type:%s, ssrc:%u, payload:%d, clock rate:%d, nack:%s, rtx disable",
             type == MEDIA_VIDEO_TYPE ? "video" : "audio",
@@ -60,11 +57,9 @@ RtcSendStream::RtcSendStream(MEDIA_PKT_TYPE type,
         .ntp_frac = 0
     };
 
-    send_buffer_.resize(SEND_BUFFER_SIZE);
-    for (auto& item : send_buffer_) {
-        item.last_ms = 0;
-        item.retry_count = 0;
-        item.pkt = nullptr;
+    //only the video packets are kept for the nack, audio is not resent
+    if (nack_enable_ && media_type_ == MEDIA_VIDEO_TYPE) {
+        ResizeHistory(SEND_HISTORY_MIN_SLOTS);
     }
     LogInfof(logger, "RtcSendStream construct type:%s, ssrc:%u, payload:%d, clock rate:%d, nack:%s, rtx enable, rtx payload:%d, rtx ssrc:%u",
             type == MEDIA_VIDEO_TYPE ? "video" : "audio",
@@ -76,15 +71,64 @@ RtcSendStream::RtcSendStream(MEDIA_PKT_TYPE type,
 
 RtcSendStream::~RtcSendStream()
 {
+    if (packetizer_) {
+        delete packetizer_;
+        packetizer_ = nullptr;
+    }
+    if (fec_encoder_) {
+        delete fec_encoder_;
+        fec_encoder_ = nullptr;
+    }
     LogInfof(logger_, "destruct RtcSendStream %s", avtype_tostring(media_type_).c_str());
+}
 
-    for (auto& item : send_buffer_) {
-        item.last_ms     = 0;
-        item.retry_count = 0;
-        if(item.pkt) {
-            delete item.pkt;
-            item.pkt = nullptr;
-        }
+/*
+ one byte extension with the transport-wide seq, the value is stamped in StampTransportSeq:
+  0xBE 0xDE | length=1 | ID | L=1 | seq high | seq low | 0(pad)
+ */
+void RtcSendStream::SetTransportSeqExtensionId(uint8_t id) {
+    if (id == 0 || id >= 15) {
+        tcc_ext_id_ = 0;
+        tcc_ext_    = nullptr;
+        return;
+    }
+    tcc_ext_id_ = id;
+
+    memset(tcc_ext_data_, 0, sizeof(tcc_ext_data_));
+    ByteStream::Write2Bytes(tcc_ext_data_, 0xBEDE);
+    ByteStream::Write2Bytes(tcc_ext_data_ + 2, 1);
+    tcc_ext_data_[4] = (uint8_t)((id << 4) | 0x01);
+
+    tcc_ext_ = (HeaderExtension*)tcc_ext_data_;
+    LogInfof(logger_, "RtcSendStream %s set transport-wide seq extension id:%d",
+            avtype_tostring(media_type_).c_str(), id);
+}
+
+void RtcSendStream::EnableFec(uint8_t fec_payload, uint32_t fec_ssrc, int key_rate, int delta_rate) {
+    if (media_type_ != MEDIA_VIDEO_TYPE) {
+        return;
+    }
+    if (!fec_encoder_) {
+        fec_encoder_ = new FlexFecEncoder(this, logger_);
+    }
+    fec_payload_ = fec_payload;
+    fec_ssrc_    = fec_ssrc;
+    fec_encoder_->SetProtectionRate(key_rate, delta_rate);
+    LogInfof(logger_, "RtcSendStream enable flexfec, payload:%d, ssrc:%u, keyframe rate:%d, delta frame rate:%d",
+            fec_payload, fec_ssrc, key_rate, delta_rate);
+}
+
+void RtcSendStream::SetTargetBitrate(uint32_t bitrate) {
+    if (media_type_ != MEDIA_VIDEO_TYPE) {
+        return;
+    }
+    //drain the backlog at the old bitrate before the change
+    GetBacklogMs(now_millisec());
+    target_bitrate_ = bitrate;
+    if (target_bitrate_ == 0) {
+        backlog_bytes_     = 0;
+        backlog_update_ms_ = 0;
+        wait_keyframe_     = false;
     }
 }
 
@@ -104,36 +148,212 @@ void RtcSendStream::SendPacket(Media_Packet_Ptr pkt_ptr) {
 }
 
 void RtcSendStream::SendVideoPacket(Media_Packet_Ptr pkt_ptr) {
+    //the payload type is negotiated for one codec, the packetizer must match it
+    if (video_codec_ != MEDIA_CODEC_UNKOWN && pkt_ptr->codec_type_ != video_codec_) {
+        if ((codec_drop_count_++ % 500) == 0) {
+            LogErrorf(logger_, "drop video packet codec:%s, the negotiated codec:%s, drop count:%ld",
+                    codectype_tostring(pkt_ptr->codec_type_).c_str(),
+                    codectype_tostring(video_codec_).c_str(), codec_drop_count_);
+        }
+        return;
+    }
     if (pkt_ptr->codec_type_ == MEDIA_CODEC_H264) {
         SendH264Packet(pkt_ptr);
+    } else if (pkt_ptr->codec_type_ == MEDIA_CODEC_H265) {
+        SendH265Packet(pkt_ptr);
     }
 }
 
 void RtcSendStream::SendAudioPacket(Media_Packet_Ptr pkt_ptr) {
     uint8_t* data = (uint8_t*)pkt_ptr->buffer_ptr_->Data();
-    uint8_t len   = pkt_ptr->buffer_ptr_->DataLen();
+    size_t len    = pkt_ptr->buffer_ptr_->DataLen();
     int64_t ts    = pkt_ptr->dts_;
     ts = ts * clock_rate_ / 1000;
 
-    RtpPacket* pkt = GenerateSinglePackets(data, len);
+    RtpPacketizer* packetizer = GetPacketizer(MEDIA_CODEC_OPUS);
+    packetizer->Packetize(data, len, (uint32_t)ts, true);
+}
+
+/*
+ * the packetizer is made for the codec of the stream, the header
+ * fields are set for every frame because they may be changed.
+ */
+RtpPacketizer* RtcSendStream::GetPacketizer(MEDIA_CODEC_TYPE codec_type) {
+    if (!packetizer_ || packetizer_codec_ != codec_type) {
+        if (packetizer_) {
+            delete packetizer_;
+            packetizer_ = nullptr;
+        }
+        if (codec_type == MEDIA_CODEC_H265) {
+            packetizer_ = new RtpH265Packetizer(this);
+        } else if (codec_type == MEDIA_CODEC_H264) {
+            packetizer_ = new RtpH264Packetizer(this);
+        } else {
+            packetizer_ = new RtpOpusPacketizer(this);
+        }
+        packetizer_codec_ = codec_type;
+        LogInfof(logger_, "RtcSendStream %s create packetizer for codec:%s",
+                avtype_tostring(media_type_).c_str(), codectype_tostring(codec_type).c_str());
+    }
+    packetizer_->SetHeader(pt_, ssrc_, tcc_ext_);
+    return packetizer_;
+}
+
+void RtcSendStream::BeginFecFrame(bool key_frame) {
+    if (!fec_encoder_) {
+        return;
+    }
+    fec_encoder_->SetHeader(fec_payload_, fec_ssrc_, ssrc_, tcc_ext_);
+    fec_encoder_->BeginFrame(key_frame);
+}
+
+void RtcSendStream::EndFecFrame() {
+    if (fec_encoder_) {
+        fec_encoder_->EndFrame();
+    }
+}
+
+int64_t RtcSendStream::GetBacklogMs(int64_t now_ms) {
+    if (target_bitrate_ == 0) {
+        return 0;
+    }
+    if (backlog_update_ms_ > 0 && now_ms > backlog_update_ms_) {
+        backlog_bytes_ -= (int64_t)target_bitrate_ * (now_ms - backlog_update_ms_) / 8000;
+        if (backlog_bytes_ < 0) {
+            backlog_bytes_ = 0;
+        }
+    }
+    backlog_update_ms_ = now_ms;
+    return backlog_bytes_ * 8000 / target_bitrate_;
+}
+
+/*
+ * the frames are dropped by priority when the backlog at the target bitrate grows:
+ *   over CONGESTION_NON_REF_MS: the non-reference frames, no other frame refers to them;
+ *   over CONGESTION_DELTA_MS: all the frames until the next keyframe, the delta frames
+ *   after a dropped reference one can not be decoded.
+ * the keyframe is requested when the backlog is drained, an earlier one would be dropped too.
+ * the slices of one frame have the same dts and share the decision.
+ */
+bool RtcSendStream::DropFrame(SEND_FRAME_TYPE frame_type, size_t len, int64_t dts) {
+    if (target_bitrate_ == 0) {
+        return false;
+    }
+    if (dts == frame_dts_) {
+        if (frame_dropped_) {
+            dropped_bytes_ += len;
+        }
+        return frame_dropped_;
+    }
+    int64_t now_ms     = now_millisec();
+    int64_t backlog_ms = GetBacklogMs(now_ms);
+    bool drop = false;
+
+    if (frame_type == SEND_FRAME_KEY) {
+        drop = backlog_ms >= CONGESTION_DELTA_MS;
+        if (wait_keyframe_ && !drop) {
+            LogInfof(logger_, "send keyframe after congestion, backlog:%ldms, dropped frames:%ld",
+                    backlog_ms, dropped_frames_);
+        }
+        wait_keyframe_ = drop;
+    } else if (wait_keyframe_ || backlog_ms >= CONGESTION_DELTA_MS) {
+        if (!wait_keyframe_) {
+            LogWarnf(logger_, "congestion backlog:%ldms, target bitrate:%u, drop the frames until the next keyframe",
+                    backlog_ms, target_bitrate_);
+        }
+        drop = true;
+        wait_keyframe_ = true;
+    } else if (frame_type == SEND_FRAME_NON_REFERENCE) {
+        drop = backlog_ms >= CONGESTION_NON_REF_MS;
+    }
+    frame_dts_     = dts;
+    frame_dropped_ = drop;
+    if (!drop) {
+        return false;
+    }
+    dropped_frames_++;
+    dropped_bytes_ += len;
+
+    if (wait_keyframe_ && backlog_ms < CONGESTION_NON_REF_MS
+        && now_ms - keyframe_request_ms_ >= CONGESTION_KEYFRAME_REQUEST_MS) {
+        keyframe_request_ms_ = now_ms;
+        LogInfof(logger_, "request keyframe after congestion, backlog:%ldms", backlog_ms);
+        cb_->RequestKeyFrame();
+    }
+    return true;
+}
 
-    pkt->SetPayloadType(pt_);
-    pkt->SetSsrc(ssrc_);
-    pkt->SetSeq(seq_++);
-    pkt->SetTimestamp((uint32_t)ts);
-    pkt->SetMarker(1);
-    //LogInfof(logger_, "send audio packet:%s",
-    //        pkt->Dump().c_str());
+uint8_t* RtcSendStream::NewRtpPacket(uint16_t& seq) {
+    seq = seq_++;
+    if (media_type_ != MEDIA_VIDEO_TYPE || !nack_enable_ || history_slots_.empty()) {
+        return send_buffer_;
+    }
+    //the packet is written in the history slot directly, the old one is overwritten
+    size_t index = seq & (history_slots_.size() - 1);
+    history_slots_[index].valid = false;
+    return GetSlotData(index);
+}
 
-    SendAudioRtpPacket(pkt);
+void RtcSendStream::OnRtpPacket(uint8_t* data, size_t len, uint16_t seq) {
+    StampTransportSeq(data, len);
+    if (media_type_ == MEDIA_AUDIO_TYPE) {
+        SendAudioRtpData(data, len, sizeof(send_buffer_));
+        return;
+    }
+    if (fec_encoder_) {
+        fec_encoder_->AddPacket(data, len);
+    }
+    if (data == send_buffer_) {
+        SendVideoRtpData(data, len, sizeof(send_buffer_), false);
+        return;
+    }
+    SaveSlot(seq, len);
+    //the history slot is kept for the nack, not protected in place
+    SendVideoRtpData(data, len, 0, false);
+}
 
-    delete pkt;
+//the fec packets are not in the nack history and not counted in the sr of the media ssrc
+void RtcSendStream::OnFecPacket(uint8_t* data, size_t len, size_t capacity) {
+    StampTransportSeq(data, len);
+    if (target_bitrate_ > 0) {
+        backlog_bytes_ += len;
+    }
+    statics_.Update(len, now_millisec());
+    cb_->SendRtpPacket(data, len, capacity, PACE_VIDEO_PRIORITY);
 }
 
 void RtcSendStream::SendH264Packet(Media_Packet_Ptr pkt_ptr) {
     uint8_t* data = (uint8_t*)pkt_ptr->buffer_ptr_->Data();
     size_t len    = pkt_ptr->buffer_ptr_->DataLen();
-    int64_t ts    = pkt_ptr->dts_;
+
+    int pos = GetNaluTypePos(data);
+    if (pos < 3) {
+        LogErrorf(logger_, "h264 packet fail to find nalu start code, len:%lu", len);
+        return;
+    }
+    if (H264_IS_SPS(data[pos]) || H264_IS_PPS(data[pos])) {
+        //the access unit with sps/pps/idr, send them one by one over the packet buffer
+        std::vector<size_t> offsets;
+        if (AnnexBNaluOffsets(data, len, offsets) && offsets.size() > 1) {
+            for (size_t index = 0; index < offsets.size(); index++) {
+                size_t end = ((index + 1) < offsets.size()) ? offsets[index + 1] : len;
+                uint8_t* p = data + offsets[index];
+                pos = GetNaluTypePos(p);
+                if (pos < 3) {
+                    continue;
+                }
+                SendH264Nalu(pkt_ptr, p, end - offsets[index],
+                        H264_IS_SPS(p[pos]) || H264_IS_PPS(p[pos]), H264_IS_KEYFRAME(p[pos]));
+            }
+            return;
+        }
+    }
+    SendH264Nalu(pkt_ptr, data, len, pkt_ptr->is_seq_hdr_, pkt_ptr->is_key_frame_);
+}
+
+void RtcSendStream::SendH264Nalu(Media_Packet_Ptr pkt_ptr, uint8_t* data, size_t len,
+                                 bool seq_hdr, bool key_frame) {
+    int64_t ts = pkt_ptr->dts_;
     ts = ts * clock_rate_ / 1000;
 
     int pos = GetNaluTypePos(data);
@@ -146,12 +366,9 @@ void RtcSendStream::SendH264Packet(Media_Packet_Ptr pkt_ptr) {
         LogDebugf(logger_, "send h264 keyframe len:%lu, pos:%d", len, pos);
     }
 
-    pkt_ptr->buffer_ptr_->ConsumeData(pos);
-    data = (uint8_t*)pkt_ptr->buffer_ptr_->Data();
-    len  = pkt_ptr->buffer_ptr_->DataLen();
-    //LogInfof(logger_, "h264 data:0x%02x",
-    //        data[0], data[1], data[2], data[3], data[4]);
-    if (pkt_ptr->is_seq_hdr_) {
+    data += pos;
+    len  -= pos;
+    if (seq_hdr) {
         if (len >= sizeof(sps_)) {
             LogErrorf(logger_, "nalu sps/pps len:%lu error", len);
             return;
@@ -169,58 +386,135 @@ void RtcSendStream::SendH264Packet(Media_Packet_Ptr pkt_ptr) {
         return;
     }
 
-    if (pkt_ptr->is_key_frame_) {
-        if (sps_len_ > 0 && pps_len_ > 0) {
-            std::vector<std::pair<uint8_t*, int>> data_vec;
+    SEND_FRAME_TYPE frame_type = SEND_FRAME_REFERENCE;
+    if (key_frame || H264_IS_KEYFRAME(data[0])) {
+        frame_type = SEND_FRAME_KEY;
+    } else if ((data[0] & 0x60) == 0) {
+        //nal_ref_idc is 0
+        frame_type = SEND_FRAME_NON_REFERENCE;
+    }
+    if (DropFrame(frame_type, len, pkt_ptr->dts_)) {
+        return;
+    }
 
-            data_vec.push_back({sps_, sps_len_});
-            data_vec.push_back({pps_, pps_len_});           
+    RtpPacketizer* packetizer = GetPacketizer(MEDIA_CODEC_H264);
+    BeginFecFrame(key_frame);
+    if (key_frame && sps_len_ > 0 && pps_len_ > 0) {
+        RtpNaluItem items[2] = {
+            { sps_, (size_t)sps_len_ },
+            { pps_, (size_t)pps_len_ }
+        };
+        packetizer->PacketizeAggregate(items, 2, (uint32_t)ts);
+    }
+    packetizer->Packetize(data, len, (uint32_t)ts, true);
+    EndFecFrame();
+}
+
+void RtcSendStream::SendH265Packet(Media_Packet_Ptr pkt_ptr) {
+    uint8_t* data = (uint8_t*)pkt_ptr->buffer_ptr_->Data();
+    size_t len    = pkt_ptr->buffer_ptr_->DataLen();
 
-            //StapA packet
-            RtpPacket* pkt = GenerateStapAPackets(data_vec);
-            pkt->SetPayloadType(pt_);
-            pkt->SetSsrc(ssrc_);
-            pkt->SetSeq(seq_++);
-            pkt->SetTimestamp((uint32_t)ts);
-            pkt->SetMarker(0);
+    if (pkt_ptr->is_seq_hdr_ && pkt_ptr->fmt_type_ == MEDIA_FORMAT_FLV) {
+        HEVC_DEC_CONF_RECORD hevc_info;
+        size_t vps_len = sizeof(vps_);
+        size_t sps_len = sizeof(sps_);
+        size_t pps_len = sizeof(pps_);
+
+        if (GetHevcDecInfoFromExtradata(&hevc_info, data, len) < 0
+            || GetVpsSpsPpsFromHevcDecInfo(&hevc_info, vps_, vps_len,
+                    sps_, sps_len, pps_, pps_len) < 0) {
+            LogErrorf(logger_, "h265 sequence header len:%lu error", len);
+            return;
+        }
+        vps_len_ = (int)vps_len;
+        sps_len_ = (int)sps_len;
+        pps_len_ = (int)pps_len;
+        return;
+    }
 
-            SendVideoRtpPacket(pkt);
-            delete pkt;
+    int pos = GetNaluTypePos(data);
+    if (pos < 3) {
+        LogErrorf(logger_, "h265 packet fail to find nalu start code, len:%lu", len);
+        return;
+    }
+    uint8_t nalu_type = GET_HEVC_NALU_TYPE(data[pos]);
+    if (nalu_type >= NAL_UNIT_VPS && nalu_type <= NAL_UNIT_PPS) {
+        //the access unit with vps/sps/pps/irap, send them one by one over the packet buffer
+        std::vector<size_t> offsets;
+        if (AnnexBNaluOffsets(data, len, offsets) && offsets.size() > 1) {
+            for (size_t index = 0; index < offsets.size(); index++) {
+                size_t end = ((index + 1) < offsets.size()) ? offsets[index + 1] : len;
+                SendH265Nalu(pkt_ptr, data + offsets[index], end - offsets[index]);
+            }
+            return;
         }
     }
+    SendH265Nalu(pkt_ptr, data, len);
+}
+
+void RtcSendStream::SendH265Nalu(Media_Packet_Ptr pkt_ptr, uint8_t* data, size_t len) {
+    int64_t ts = pkt_ptr->dts_;
+    ts = ts * clock_rate_ / 1000;
 
-    //single packet
-    if (len <= kPayloadMaxSize) {
-        RtpPacket* pkt = GenerateSinglePackets(data, len);
+    int pos = GetNaluTypePos(data);
+    if (pos < 3 || len <= (size_t)pos + kH265NalHeaderSize) {
+        LogErrorf(logger_, "h265 nalu fail to find start code, len:%lu", len);
+        return;
+    }
+    uint8_t nalu_type = GET_HEVC_NALU_TYPE(data[pos]);
+    data += pos;
+    len  -= pos;
 
-        pkt->SetPayloadType(pt_);
-        pkt->SetSsrc(ssrc_);
-        pkt->SetSeq(seq_++);
-        pkt->SetTimestamp((uint32_t)ts);
-        pkt->SetMarker(1);
+    if (nalu_type >= NAL_UNIT_VPS && nalu_type <= NAL_UNIT_PPS) {
+        if (len >= sizeof(sps_)) {
+            LogErrorf(logger_, "h265 nalu vps/sps/pps len:%lu error", len);
+            return;
+        }
+        uint8_t* dst = (nalu_type == NAL_UNIT_VPS) ? vps_ : ((nalu_type == NAL_UNIT_SPS) ? sps_ : pps_);
+        int& dst_len = (nalu_type == NAL_UNIT_VPS) ? vps_len_ : ((nalu_type == NAL_UNIT_SPS) ? sps_len_ : pps_len_);
 
-        SendVideoRtpPacket(pkt);
-        delete pkt;
+        memcpy(dst, data, len);
+        dst_len = (int)len;
+        return;
+    }
+    if (nalu_type == NAL_UNIT_ACCESS_UNIT_DELIMITER
+        || nalu_type == NAL_UNIT_SEI || nalu_type == NAL_UNIT_SEI_SUFFIX) {
         return;
     }
 
-    //fuA packet
-    std::vector<RtpPacket*> fuA_vec = GenerateFuAPackets(data, len);
-    for (auto fuA_pkt : fuA_vec) {
-        fuA_pkt->SetPayloadType(pt_);
-        fuA_pkt->SetSsrc(ssrc_);
-        fuA_pkt->SetSeq(seq_++);
-        fuA_pkt->SetTimestamp((uint32_t)ts);
+    //the irap pictures: bla, idr and cra
+    bool is_irap = (nalu_type >= NAL_UNIT_CODED_SLICE_BLA) && (nalu_type <= NAL_UNIT_RESERVED_23);
+    SEND_FRAME_TYPE frame_type = SEND_FRAME_REFERENCE;
+    if (is_irap) {
+        frame_type = SEND_FRAME_KEY;
+    } else if (nalu_type <= NAL_UNIT_RESERVED_14 && (nalu_type % 2) == 0) {
+        //the sub-layer non-reference pictures: trail_n, tsa_n, stsa_n, radl_n, rasl_n
+        frame_type = SEND_FRAME_NON_REFERENCE;
+    }
+    if (DropFrame(frame_type, len, pkt_ptr->dts_)) {
+        return;
+    }
 
-        SendVideoRtpPacket(fuA_pkt);
-        delete fuA_pkt;
+    RtpPacketizer* packetizer = GetPacketizer(MEDIA_CODEC_H265);
+    BeginFecFrame(is_irap);
+    if (is_irap && vps_len_ > 0 && sps_len_ > 0 && pps_len_ > 0) {
+        RtpNaluItem items[3] = {
+            { vps_, (size_t)vps_len_ },
+            { sps_, (size_t)sps_len_ },
+            { pps_, (size_t)pps_len_ }
+        };
+        packetizer->PacketizeAggregate(items, 3, (uint32_t)ts);
     }
-    return;
+    packetizer->Packetize(data, len, (uint32_t)ts, true);
+    EndFecFrame();
 }
 
-void RtcSendStream::SendVideoRtpPacket(RtpPacket* pkt, bool resend) {
+void RtcSendStream::SendVideoRtpData(uint8_t* data, size_t len, size_t capacity, bool resend) {
     sent_count_++;
-    sent_bytes_ += pkt->GetDataLength();
+    sent_bytes_ += len;
+    if (target_bitrate_ > 0) {
+        backlog_bytes_ += len;
+    }
 
     if (last_sr_ts_ == 0) {
         last_sr_ts_ = now_millisec();
@@ -228,16 +522,29 @@ void RtcSendStream::SendVideoRtpPacket(RtpPacket* pkt, bool resend) {
         cb_->SendRtcpPacket(sr->GetData(), sr->GetDataLen());
         delete sr;
     }
-    if (!resend) {
-        SaveBuffer(pkt);
+    statics_.Update(len, now_millisec());
+    cb_->SendRtpPacket(data, len, capacity,
+            resend ? PACE_RETRANSMIT_PRIORITY : PACE_VIDEO_PRIORITY);
+}
+
+/*
+ * the transport-wide seq is stamped when the packet is made, so the flexfec packets
+ * protect the bytes on the wire, the bwe takes the send time when it is paced out.
+ */
+void RtcSendStream::StampTransportSeq(uint8_t* data, size_t len) {
+    if (tcc_ext_id_ == 0) {
+        return;
+    }
+    uint8_t ext_len = 0;
+    uint8_t* ext_value = RtpPacket::FindOnebyteExtension(data, len, tcc_ext_id_, ext_len);
+    if (ext_value && ext_len == 2) {
+        ByteStream::Write2Bytes(ext_value, cb_->NextTransportSeq());
     }
-    statics_.Update(pkt->GetDataLength(), now_millisec());
-    cb_->SendRtpPacket(pkt->GetData(), pkt->GetDataLength());
 }
 
-void RtcSendStream::SendAudioRtpPacket(RtpPacket* pkt) {
+void RtcSendStream::SendAudioRtpData(uint8_t* data, size_t len, size_t capacity) {
     sent_count_++;
-    sent_bytes_ += pkt->GetDataLength();
+    sent_bytes_ += len;
 
     if (last_sr_ts_ == 0) {
         last_sr_ts_ = now_millisec();
@@ -245,11 +552,13 @@ void RtcSendStream::SendAudioRtpPacket(RtpPacket* pkt) {
         cb_->SendRtcpPacket(sr->GetData(), sr->GetDataLen());
         delete sr;
     }
-    statics_.Update(pkt->GetDataLength(), now_millisec());
-    cb_->SendRtpPacket(pkt->GetData(), pkt->GetDataLength());
+    statics_.Update(len, now_millisec());
+    cb_->SendRtpPacket(data, len, capacity, PACE_AUDIO_PRIORITY);
 }
 
 void RtcSendStream::OnTimer(int64_t now_ts) {
+    UpdateHistoryDepth(now_ts);
+
     if (now_ts - last_sr_ts_ > 500) {
         last_sr_ts_ = now_ts;
         RtcpSrPacket* sr = GetRtcpSr(last_sr_ts_);
@@ -273,64 +582,181 @@ RtcpSrPacket* RtcSendStream::GetRtcpSr(int64_t now_ms) {
     return sr_pkt;
 }
 
-void RtcSendStream::SaveBuffer(RtpPacket* pkt) {
-    if (nack_enable_) {
-        size_t index = pkt->GetSeq() % SEND_BUFFER_SIZE;
-        SendRtpPacketInfo& info = send_buffer_[index];
-        if (info.pkt) {
-            delete info.pkt;
-            info.pkt = nullptr;
+void RtcSendStream::ResizeHistory(size_t slot_count) {
+    std::vector<uint8_t> old_slab;
+    std::vector<SendRtpSlot> old_slots;
+
+    old_slab.swap(history_slab_);
+    old_slots.swap(history_slots_);
+
+    history_slab_.resize(slot_count * RTP_PACKET_MAX_SIZE);
+    history_slots_.resize(slot_count);
+    for (auto& slot : history_slots_) {
+        memset(&slot, 0, sizeof(slot));
+    }
+
+    //the slot count is a power of 2, keep the newer packet when two seqs meet
+    for (size_t index = 0; index < old_slots.size(); index++) {
+        SendRtpSlot& old_slot = old_slots[index];
+        if (!old_slot.valid) {
+            continue;
         }
-        //LogInfof(logger_, "save buffer seq:%d, index:%lu", pkt->GetSeq(), index);
-        info.pkt         = pkt->Clone(nullptr);
-        info.retry_count = 0;
-        info.last_ms     = 0;
+        size_t new_index = old_slot.seq & (slot_count - 1);
+        SendRtpSlot& slot = history_slots_[new_index];
+        if (slot.valid && slot.sent_ms > old_slot.sent_ms) {
+            continue;
+        }
+        slot = old_slot;
+        memcpy(GetSlotData(new_index), &old_slab[index * RTP_PACKET_MAX_SIZE], old_slot.len);
+    }
+}
+
+/*
+ * the history keeps SEND_HISTORY_MS of packets, the slot count follows
+ * the packet rate and is checked every second.
+ */
+void RtcSendStream::UpdateHistoryDepth(int64_t now_ms) {
+    if (!nack_enable_ || media_type_ != MEDIA_VIDEO_TYPE) {
+        return;
+    }
+    if (history_check_ms_ == 0) {
+        history_check_ms_ = now_ms;
+        history_saved_    = 0;
+        return;
+    }
+    int64_t diff_ms = now_ms - history_check_ms_;
+    if (diff_ms < 1000) {
+        return;
+    }
+    size_t pps = history_saved_ * 1000 / diff_ms;
+    history_check_ms_ = now_ms;
+    history_saved_    = 0;
+
+    //25% margin for the bursts of keyframes
+    size_t need = pps * SEND_HISTORY_MS / 1000 * 5 / 4;
+    size_t slot_count = SEND_HISTORY_MIN_SLOTS;
+    while (slot_count < need && slot_count < SEND_HISTORY_MAX_SLOTS) {
+        slot_count <<= 1;
+    }
+
+    size_t current = history_slots_.size();
+    if (slot_count > current || slot_count * 4 <= current) {
+        LogInfof(logger_, "resize send history from %lu to %lu slots, pps:%lu",
+                current, slot_count, pps);
+        ResizeHistory(slot_count);
     }
 }
 
+void RtcSendStream::SaveSlot(uint16_t seq, size_t len) {
+    size_t index = seq & (history_slots_.size() - 1);
+    SendRtpSlot& slot = history_slots_[index];
+
+    slot.seq         = seq;
+    slot.len         = len;
+    slot.sent_ms     = now_millisec();
+    slot.retry_count = 0;
+    slot.last_ms     = 0;
+    slot.valid       = true;
+
+    history_saved_++;
+}
+
+/*
+ * rtx payload: the original seq(2bytes) + the original payload,
+ * the header and extensions are kept, the padding is removed.
+ */
+size_t RtcSendStream::MakeRtxPacket(uint8_t* data, size_t len) {
+    RtpCommonHeader* header = (RtpCommonHeader*)data;
+    size_t header_len = sizeof(RtpCommonHeader) + 4 * header->csrc_count;
+
+    if (header->extension) {
+        HeaderExtension* ext = (HeaderExtension*)(data + header_len);
+        header_len += 4 + 4 * ntohs(ext->length);
+    }
+    if (header_len >= len) {
+        return 0;
+    }
+    size_t payload_len = len - header_len;
+    if (header->padding) {
+        uint8_t pad_len = data[len - 1];
+        if (pad_len >= payload_len) {
+            return 0;
+        }
+        payload_len -= pad_len;
+    }
+    if (header_len + 2 + payload_len > RTP_PACKET_MAX_SIZE) {
+        return 0;
+    }
+    memcpy(rtx_buffer_, data, header_len);
+
+    RtpCommonHeader* rtx_header = (RtpCommonHeader*)rtx_buffer_;
+    rtx_header->padding      = 0;
+    rtx_header->payload_type = rtx_payload_;
+    rtx_header->ssrc         = (uint32_t)htonl(rtx_ssrc_);
+    rtx_header->sequence     = htons(rtx_seq_++);
+
+    ByteStream::Write2Bytes(rtx_buffer_ + header_len, ntohs(header->sequence));
+    memcpy(rtx_buffer_ + header_len + 2, data + header_len, payload_len);
+
+    return header_len + 2 + payload_len;
+}
+
 void RtcSendStream::ResendRtpPacket(uint16_t seq) {
-    size_t index = seq % SEND_BUFFER_SIZE;
+    if (history_slots_.empty()) {
+        return;
+    }
+    size_t index = seq & (history_slots_.size() - 1);
 
-    SendRtpPacketInfo& info = send_buffer_[index];
-    if (!info.pkt) {
+    SendRtpSlot& slot = history_slots_[index];
+    if (!slot.valid) {
         LogWarnf(logger_, "fail to find rtp packet by seq:%d, index:%lu", seq, index);
         return;
     }
-    if (info.pkt->GetSeq() != seq) {
+    if (slot.seq != seq) {
         LogWarnf(logger_, "fail to get rtp packet(%d) by seq:%d, index:%lu", 
-                seq, info.pkt->GetSeq(), index);
+                slot.seq, seq, index);
         return;
     }
 
     int64_t now_ms = now_millisec();
-    if (info.last_ms == 0) {
-        info.retry_count = 1;
-        info.last_ms     = now_ms;
+    if (now_ms - slot.sent_ms > SEND_HISTORY_MS) {
+        LogDebugf(logger_, "rtp packet seq:%d is out of the send history, sent %ldms ago",
+                seq, now_ms - slot.sent_ms);
+        return;
+    }
+    if (slot.last_ms == 0) {
+        slot.retry_count = 1;
+        slot.last_ms     = now_ms;
     } else {
         float interval = avg_rtt_ > 10 ? avg_rtt_ / 2 : avg_rtt_;
-        if ((float)(now_ms - info.last_ms + 10) < interval) {
+        if ((float)(now_ms - slot.last_ms + 10) < interval) {
             LogDebugf(logger_, "resend too often and ignore nack request, interval:%ld, rtt:%f",
-                    now_ms - info.last_ms, avg_rtt_);
+                    now_ms - slot.last_ms, avg_rtt_);
             return;
         }
-        info.retry_count++;
-        if (info.retry_count > 5) {
-            LogInfof(logger_, "resend times(%d) is too large, seq:%d", info.retry_count,seq);
+        slot.retry_count++;
+        if (slot.retry_count > 5) {
+            LogInfof(logger_, "resend times(%d) is too large, seq:%d", slot.retry_count,seq);
         }
     }
-    info.last_ms = now_ms;
+    slot.last_ms = now_ms;
 
     resend_cnt_++;
     LogDebugf(logger_, "resend packet seq:%d, retry count:%d",
-            seq, info.retry_count);
+            seq, slot.retry_count);
     if (!has_rtx_) {
-        SendVideoRtpPacket(info.pkt, true);
+        //the history slot is kept for the next nack, not protected in place
+        StampTransportSeq(GetSlotData(index), slot.len);
+        SendVideoRtpData(GetSlotData(index), slot.len, 0, true);
+        return;
+    }
+    size_t rtx_len = MakeRtxPacket(GetSlotData(index), slot.len);
+    if (rtx_len == 0) {
+        LogWarnf(logger_, "fail to make rtx packet by seq:%d", seq);
         return;
     }
-    RtpPacket* rtx_pkt = info.pkt->Clone();
-    rtx_pkt->RtxMux(rtx_payload_, rtx_ssrc_, rtx_seq_++);
-    SendVideoRtpPacket(rtx_pkt, true);
-    delete rtx_pkt;
+    StampTransportSeq(rtx_buffer_, rtx_len);
+    SendVideoRtpData(rtx_buffer_, rtx_len, sizeof(rtx_buffer_), true);
     return;
 }
 
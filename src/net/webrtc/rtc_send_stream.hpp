@@ -4,6 +4,8 @@
 #include "logger.hpp"
 #include "media_packet.hpp"
 #include "rtp_packet.hpp"
+#include "rtp_packetizer.hpp"
+#include "flexfec.hpp"
 #include "rtcp_sr.hpp"
 #include "rtcp_rr.hpp"
 #include "rtcpfb_nack.hpp"
@@ -16,13 +18,30 @@
 namespace cpp_streamer
 {
 
+#define SEND_HISTORY_MS        1000
+#define SEND_HISTORY_MIN_SLOTS 256
+#define SEND_HISTORY_MAX_SLOTS 4096
+
+#define CONGESTION_NON_REF_MS  150  //the backlog to drop the non-reference frames
+#define CONGESTION_DELTA_MS    400  //the backlog to drop all the frames until the next keyframe
+#define CONGESTION_KEYFRAME_REQUEST_MS 1000
+
+typedef enum {
+    SEND_FRAME_KEY,
+    SEND_FRAME_REFERENCE,
+    SEND_FRAME_NON_REFERENCE
+} SEND_FRAME_TYPE;
+
 typedef struct {
+    uint16_t seq;
+    size_t len;
+    int64_t sent_ms;
     int retry_count;
     int64_t last_ms;
-    RtpPacket* pkt;
-} SendRtpPacketInfo;
+    bool valid;
+} SendRtpSlot;
 
-class RtcSendStream
+class RtcSendStream : public RtpPacketSinkI, public FlexFecSinkI
 {
 public:
     RtcSendStream(MEDIA_PKT_TYPE type, 
@@ -33,7 +52,7 @@ public:
             uint32_t ssrc, uint8_t payload, int clock_rate,
             bool nack, uint8_t rtx_payload, uint32_t rtx_ssrc,
             RtcSendStreamCallbackI* cb, Logger* logger);
-    ~RtcSendStream();
+    virtual ~RtcSendStream();
 
 public:
     void SetSsrc(uint32_t ssrc) { ssrc_ = ssrc; }
@@ -46,11 +65,27 @@ public:
     void SetChannel(int channel) { channel_ = channel; }
     int GetChannel() { return channel_; }
 
+    //the negotiated video codec, the packets of other codecs are dropped
+    void SetVideoCodec(MEDIA_CODEC_TYPE codec_type) { video_codec_ = codec_type; }
+    MEDIA_CODEC_TYPE GetVideoCodec() { return video_codec_; }
+
     void SetRtxPT(uint8_t pt) { rtx_payload_ = pt; }
     uint8_t GetRtxPT() { return rtx_payload_; }
     void SetRtxSsrc(uint32_t ssrc) { rtx_ssrc_ = ssrc; }
     uint32_t GetRtxSsrc() { return rtx_ssrc_; }
 
+    void SetTransportSeqExtensionId(uint8_t id);
+    uint8_t GetTransportSeqExtensionId() { return tcc_ext_id_; }
+
+    //flexfec of the video packets on the fec ssrc, the rates are the percents of the media packets
+    void EnableFec(uint8_t fec_payload, uint32_t fec_ssrc, int key_rate, int delta_rate);
+    int64_t GetFecCount() { return fec_encoder_ ? fec_encoder_->GetFecCount() : 0; }
+
+    //the estimated bandwidth, the video frames are dropped by priority when the backlog is over it, 0: disable
+    void SetTargetBitrate(uint32_t bitrate);
+    int64_t GetDroppedFrames() { return dropped_frames_; }
+    int64_t GetDroppedBytes() { return dropped_bytes_; }
+
 public:
     void SendPacket(Media_Packet_Ptr pkt_ptr);
     void OnTimer(int64_t now_ts);
@@ -73,12 +108,32 @@ private:
 
 private:
     void SendH264Packet(Media_Packet_Ptr pkt_ptr);
+    void SendH265Packet(Media_Packet_Ptr pkt_ptr);
+    void SendH264Nalu(Media_Packet_Ptr pkt_ptr, uint8_t* data, size_t len, bool seq_hdr, bool key_frame);
+    void SendH265Nalu(Media_Packet_Ptr pkt_ptr, uint8_t* data, size_t len);
+    RtpPacketizer* GetPacketizer(MEDIA_CODEC_TYPE codec_type);
+    void BeginFecFrame(bool key_frame);
+    void EndFecFrame();
+    bool DropFrame(SEND_FRAME_TYPE frame_type, size_t len, int64_t dts);
+    int64_t GetBacklogMs(int64_t now_ms);
+
+protected:
+    virtual uint8_t* NewRtpPacket(uint16_t& seq) override;
+    virtual void OnRtpPacket(uint8_t* data, size_t len, uint16_t seq) override;
+    virtual void OnFecPacket(uint8_t* data, size_t len, size_t capacity) override;
 
 private:
-    void SendVideoRtpPacket(RtpPacket* pkt, bool resend = false);
-    void SendAudioRtpPacket(RtpPacket* pkt);
-    void SaveBuffer(RtpPacket* pkt);
+    void SendVideoRtpData(uint8_t* data, size_t len, size_t capacity, bool resend);
+    void SendAudioRtpData(uint8_t* data, size_t len, size_t capacity);
+    void StampTransportSeq(uint8_t* data, size_t len);
+    void SaveSlot(uint16_t seq, size_t len);
     void ResendRtpPacket(uint16_t seq);
+    size_t MakeRtxPacket(uint8_t* data, size_t len);
+
+private:
+    void ResizeHistory(size_t slot_count);
+    void UpdateHistoryDepth(int64_t now_ms);
+    uint8_t* GetSlotData(size_t index) { return &history_slab_[index * RTP_PACKET_MAX_SIZE]; }
 
 private:
     RtcpSrPacket* GetRtcpSr(int64_t now_ms);
@@ -101,17 +156,51 @@ private:
     uint32_t rtx_ssrc_   = 0;
     uint16_t rtx_seq_    = 0;
 
+private://transport-wide seq extension, the seq is stamped when the packet is paced out
+    uint8_t tcc_ext_id_ = 0;
+    uint8_t tcc_ext_data_[8];
+    HeaderExtension* tcc_ext_ = nullptr;
+
 private:
     RtcSendStreamCallbackI* cb_ = nullptr;
 
 private:
+    uint8_t vps_[512];
     uint8_t sps_[512];
     uint8_t pps_[512];
+    int vps_len_ = 0;
     int sps_len_ = 0;
     int pps_len_ = 0;
 
-private:
-    std::vector<SendRtpPacketInfo> send_buffer_;
+private://the packets are written in the history slots, or in the send buffer without nack
+    RtpPacketizer* packetizer_ = nullptr;
+    MEDIA_CODEC_TYPE packetizer_codec_ = MEDIA_CODEC_UNKOWN;
+    MEDIA_CODEC_TYPE video_codec_      = MEDIA_CODEC_UNKOWN;
+    int64_t codec_drop_count_          = 0;
+    uint8_t send_buffer_[RTP_PACKET_BUFFER_SIZE];
+
+private://flexfec, the media packets are copied in the encoder before srtp
+    FlexFecEncoder* fec_encoder_ = nullptr;
+    uint8_t fec_payload_ = 0;
+    uint32_t fec_ssrc_   = 0;
+
+private://congestion, the backlog is the video bytes not drained at the target bitrate
+    uint32_t target_bitrate_   = 0;
+    int64_t backlog_bytes_     = 0;
+    int64_t backlog_update_ms_ = 0;
+    bool wait_keyframe_        = false;
+    int64_t keyframe_request_ms_ = 0;
+    int64_t frame_dts_         = -1;
+    bool frame_dropped_        = false;
+    int64_t dropped_frames_    = 0;
+    int64_t dropped_bytes_     = 0;
+
+private://nack history, mtu slots in one slab indexed by seq, saved before srtp
+    std::vector<uint8_t> history_slab_;
+    std::vector<SendRtpSlot> history_slots_;
+    size_t history_saved_     = 0;
+    int64_t history_check_ms_ = 0;
+    uint8_t rtx_buffer_[RTP_PACKET_BUFFER_SIZE];
 
 private://for rtcp sr
     NTP_TIMESTAMP last_sr_ntp_ts_;
@@ -13,11 +13,22 @@ namespace cpp_streamer
 #define RTT_DEFAULT 30 //ms
 #define RETRANSMIT_MAX_COUNT 20
 
+typedef enum {
+    PACE_AUDIO_PRIORITY,
+    PACE_RETRANSMIT_PRIORITY,
+    PACE_VIDEO_PRIORITY
+} RTP_PACE_PRIORITY;
+
 class RtcSendStreamCallbackI
 {
 public:
-    virtual void SendRtpPacket(uint8_t* data, size_t len) = 0;
+    //capacity: the buffer size of data when it can be overwritten after the call, otherwise 0
+    virtual void SendRtpPacket(uint8_t* data, size_t len, size_t capacity, RTP_PACE_PRIORITY priority) = 0;
     virtual void SendRtcpPacket(uint8_t* data, size_t len) = 0;
+    //the transport-wide seq shared by the send streams, it is stamped before flexfec protects the packet
+    virtual uint16_t NextTransportSeq() = 0;
+    //a new keyframe is needed from the source, the frames are dropped until it comes
+    virtual void RequestKeyFrame() = 0;
 };
 
 }
@@ -0,0 +1,222 @@
+#include "rtc_udp_transport.hpp"
+#include "stun.hpp"
+
+#include <map>
+#include <mutex>
+#include <arpa/inet.h>
+
+namespace cpp_streamer
+{
+
+static std::mutex s_transport_mutex;
+static std::map<uv_loop_t*, RtcUdpTransport*> s_transports;
+
+RtcUdpLane::RtcUdpLane(uv_loop_t* loop,
+        RtcUdpTransport* transport,
+        Logger* logger):transport_(transport)
+                        , logger_(logger)
+{
+    client_ = new UdpClient(loop, this, logger, nullptr, 0);
+    client_->TryRead();
+
+    uint16_t port = 0;
+    std::string ip = client_->GetLocalAddress(port);
+    LogInfof(logger_, "rtc udp lane construct, local port:%d", ntohs(port));
+}
+
+RtcUdpLane::~RtcUdpLane()
+{
+    LogInfof(logger_, "rtc udp lane destruct, unknown packets:%ld", unknown_count_);
+    if (client_) {
+        client_->CloseAndDelete();
+        client_ = nullptr;
+    }
+}
+
+void RtcUdpLane::OnWrite(size_t sent_size, UdpTuple address) {
+}
+
+void RtcUdpLane::OnRead(const char* data, size_t data_size, UdpTuple address) {
+    uint64_t key = RtcUdpTransport::GetAddressKey(address);
+    auto iter = sessions_.find(key);
+
+    if (iter != sessions_.end()) {
+        //the session may be deleted in it, nothing is touched after
+        iter->second->OnRead(data, data_size, address);
+        return;
+    }
+
+    UdpSessionCallbackI* session = FindByStunUserName(data, data_size);
+    if (!session || key == 0) {
+        unknown_count_++;
+        return;
+    }
+    LogInfof(logger_, "rtc udp lane learns the remote address:%s by stun username",
+            address.to_string().c_str());
+    AddAddress(key, session);
+    session->OnRead(data, data_size, address);
+}
+
+UdpSessionCallbackI* RtcUdpLane::FindByStunUserName(const char* data, size_t data_size) {
+    if (ufrag_sessions_.empty() || !StunPacket::IsBindingRequest((uint8_t*)data, data_size)) {
+        return nullptr;
+    }
+    StunPacket* pkt = nullptr;
+    try {
+        pkt = StunPacket::Parse((uint8_t*)data, data_size);
+    } catch(CppStreamException& e) {
+        LogErrorf(logger_, "rtc udp lane parse stun exception:%s", e.what());
+        return nullptr;
+    }
+    if (!pkt) {
+        return nullptr;
+    }
+    //username: local ufrag:remote ufrag, in the request to us
+    std::string username = pkt->username_;
+    delete pkt;
+
+    size_t pos = username.find(':');
+    if (pos == std::string::npos) {
+        return nullptr;
+    }
+    auto iter = ufrag_sessions_.find(username.substr(0, pos));
+    if (iter == ufrag_sessions_.end()) {
+        return nullptr;
+    }
+    return iter->second;
+}
+
+void RtcUdpLane::AddAddress(uint64_t key, UdpSessionCallbackI* session) {
+    sessions_[key] = session;
+    session_keys_[session].push_back(key);
+}
+
+RtcUdpTransport::RtcUdpTransport(uv_loop_t* loop, Logger* logger):loop_(loop)
+                                                                , logger_(logger)
+{
+    LogInfof(logger_, "rtc udp transport construct");
+}
+
+RtcUdpTransport::~RtcUdpTransport()
+{
+    for (auto lane : lanes_) {
+        delete lane;
+    }
+    lanes_.clear();
+    session_lanes_.clear();
+    LogInfof(logger_, "rtc udp transport destruct");
+}
+
+RtcUdpTransport* RtcUdpTransport::Acquire(uv_loop_t* loop, Logger* logger) {
+    std::lock_guard<std::mutex> lock(s_transport_mutex);
+    RtcUdpTransport* transport = nullptr;
+
+    auto iter = s_transports.find(loop);
+    if (iter == s_transports.end()) {
+        transport = new RtcUdpTransport(loop, logger);
+        s_transports[loop] = transport;
+    } else {
+        transport = iter->second;
+    }
+    transport->ref_count_++;
+    return transport;
+}
+
+void RtcUdpTransport::Release(uv_loop_t* loop) {
+    std::lock_guard<std::mutex> lock(s_transport_mutex);
+
+    auto iter = s_transports.find(loop);
+    if (iter == s_transports.end()) {
+        return;
+    }
+    RtcUdpTransport* transport = iter->second;
+    if (--transport->ref_count_ > 0) {
+        return;
+    }
+    s_transports.erase(iter);
+    delete transport;
+}
+
+//the lanes are ipv4 sockets, an ipv6 address has no key
+uint64_t RtcUdpTransport::GetAddressKey(const UdpTuple& address) {
+    struct in_addr addr;
+
+    if (inet_pton(AF_INET, address.ip_address.c_str(), &addr) != 1) {
+        return 0;
+    }
+    return ((uint64_t)ntohl(addr.s_addr) << 16) | address.port;
+}
+
+UdpClient* RtcUdpTransport::Bind(const UdpTuple& remote_address,
+        const std::string& local_ufrag,
+        UdpSessionCallbackI* session) {
+    struct in6_addr addr6;
+    if (inet_pton(AF_INET6, remote_address.ip_address.c_str(), &addr6) == 1) {
+        LogErrorf(logger_, "rtc udp transport bind error, ipv6 remote address:%s is not supported",
+                remote_address.to_string().c_str());
+        return nullptr;
+    }
+    uint64_t key = GetAddressKey(remote_address);
+    if (key == 0) {
+        LogErrorf(logger_, "rtc udp transport bind error, remote address:%s",
+                remote_address.to_string().c_str());
+        return nullptr;
+    }
+    Unbind(session);
+
+    //the first socket which has no session to the remote address
+    RtcUdpLane* lane = nullptr;
+    for (auto item : lanes_) {
+        if (item->sessions_.find(key) == item->sessions_.end()) {
+            lane = item;
+            break;
+        }
+    }
+    if (!lane) {
+        lane = new RtcUdpLane(loop_, this, logger_);
+        lanes_.push_back(lane);
+    }
+    lane->AddAddress(key, session);
+    if (!local_ufrag.empty()) {
+        lane->ufrag_sessions_[local_ufrag] = session;
+        lane->session_ufrags_[session]     = local_ufrag;
+    }
+    session_lanes_[session] = lane;
+
+    LogDebugf(logger_, "rtc udp transport bind remote address:%s, lanes:%lu, sessions:%lu",
+            remote_address.to_string().c_str(), lanes_.size(), session_lanes_.size());
+    return lane->GetClient();
+}
+
+void RtcUdpTransport::Unbind(UdpSessionCallbackI* session) {
+    auto iter = session_lanes_.find(session);
+    if (iter == session_lanes_.end()) {
+        return;
+    }
+    RtcUdpLane* lane = iter->second;
+    session_lanes_.erase(iter);
+
+    for (uint64_t key : lane->session_keys_[session]) {
+        lane->sessions_.erase(key);
+    }
+    lane->session_keys_.erase(session);
+
+    auto ufrag_iter = lane->session_ufrags_.find(session);
+    if (ufrag_iter != lane->session_ufrags_.end()) {
+        lane->ufrag_sessions_.erase(ufrag_iter->second);
+        lane->session_ufrags_.erase(ufrag_iter);
+    }
+
+    if (lane->SessionCount() > 0) {
+        return;
+    }
+    for (auto lane_iter = lanes_.begin(); lane_iter != lanes_.end(); lane_iter++) {
+        if (*lane_iter == lane) {
+            lanes_.erase(lane_iter);
+            break;
+        }
+    }
+    delete lane;
+}
+
+}
@@ -0,0 +1,94 @@
+#ifndef RTC_UDP_TRANSPORT_HPP
+#define RTC_UDP_TRANSPORT_HPP
+#include "udp_client.hpp"
+#include "logger.hpp"
+
+#include <uv.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <string>
+#include <vector>
+#include <unordered_map>
+
+namespace cpp_streamer
+{
+
+class RtcUdpTransport;
+
+/*
+ * one udp socket of the transport, the sessions on it are found
+ * by the remote address, or by the local ice ufrag in the stun username
+ * for the stun requests from a new address.
+ */
+class RtcUdpLane : public UdpSessionCallbackI
+{
+friend class RtcUdpTransport;
+
+public:
+    RtcUdpLane(uv_loop_t* loop, RtcUdpTransport* transport, Logger* logger);
+    virtual ~RtcUdpLane();
+
+public:
+    UdpClient* GetClient() { return client_; }
+    size_t SessionCount() { return session_keys_.size(); }
+
+protected:
+    virtual void OnWrite(size_t sent_size, UdpTuple address) override;
+    virtual void OnRead(const char* data, size_t data_size, UdpTuple address) override;
+
+private:
+    UdpSessionCallbackI* FindByStunUserName(const char* data, size_t data_size);
+    void AddAddress(uint64_t key, UdpSessionCallbackI* session);
+
+private:
+    RtcUdpTransport* transport_ = nullptr;
+    Logger* logger_     = nullptr;
+    UdpClient* client_  = nullptr;
+
+private:
+    std::unordered_map<uint64_t, UdpSessionCallbackI*> sessions_;//remote address key -> session
+    std::unordered_map<std::string, UdpSessionCallbackI*> ufrag_sessions_;
+    std::unordered_map<UdpSessionCallbackI*, std::vector<uint64_t>> session_keys_;
+    std::unordered_map<UdpSessionCallbackI*, std::string> session_ufrags_;
+    int64_t unknown_count_ = 0;
+};
+
+/*
+ * the PeerConnections on one loop share the udp sockets of the transport instead of
+ * one socket for each. the sessions with different remote addresses go to the same socket,
+ * the sessions to the same remote address(eg. the sfu udp port) take different sockets,
+ * because the remote side tells the sessions by our address.
+ * so the socket count is the max session count to one remote address, not the session count.
+ */
+class RtcUdpTransport
+{
+public:
+    RtcUdpTransport(uv_loop_t* loop, Logger* logger);
+    ~RtcUdpTransport();
+
+public:
+    //one transport for each loop, it is deleted when the last PeerConnection releases it
+    static RtcUdpTransport* Acquire(uv_loop_t* loop, Logger* logger);
+    static void Release(uv_loop_t* loop);
+    static uint64_t GetAddressKey(const UdpTuple& address);
+
+public:
+    //returns the socket which the session writes to, nullptr when the address is invalid or ipv6
+    UdpClient* Bind(const UdpTuple& remote_address, const std::string& local_ufrag, UdpSessionCallbackI* session);
+    void Unbind(UdpSessionCallbackI* session);
+    size_t LaneCount() { return lanes_.size(); }
+    size_t SessionCount() { return session_lanes_.size(); }
+
+private:
+    uv_loop_t* loop_ = nullptr;
+    Logger* logger_  = nullptr;
+    std::vector<RtcUdpLane*> lanes_;
+    std::unordered_map<UdpSessionCallbackI*, RtcUdpLane*> session_lanes_;
+
+private:
+    int ref_count_ = 0;
+};
+
+}
+
+#endif
@@ -0,0 +1,302 @@
+#include "send_side_bwe.hpp"
+
+#include <cmath>
+#include <cstring>
+
+namespace cpp_streamer
+{
+
+SendSideBwe::SendSideBwe(Logger* logger):logger_(logger)
+{
+    history_.resize(BWE_HISTORY_SIZE);
+    for (auto& item : history_) {
+        item.seq     = 0;
+        item.size    = 0;
+        item.send_ms = 0;
+        item.valid   = false;
+    }
+    memset(&group_, 0, sizeof(group_));
+    memset(&prev_group_, 0, sizeof(prev_group_));
+}
+
+SendSideBwe::~SendSideBwe()
+{
+}
+
+void SendSideBwe::OnPacketSent(uint16_t seq, size_t size, int64_t now_ms) {
+    BweSentPacket& pkt = history_[seq % BWE_HISTORY_SIZE];
+
+    pkt.seq     = seq;
+    pkt.size    = size;
+    pkt.send_ms = now_ms;
+    pkt.valid   = true;
+}
+
+void SendSideBwe::OnTransportFeedback(RtcpFbTcc* tcc, int64_t now_ms) {
+    for (const TccPacketResult& result : tcc->GetResults()) {
+        BweSentPacket& pkt = history_[result.seq % BWE_HISTORY_SIZE];
+        if (!pkt.valid || pkt.seq != result.seq) {
+            continue;
+        }
+        //a packet is counted once, the later feedbacks of it are ignored
+        pkt.valid = false;
+        total_packets_++;
+        if (!result.received) {
+            lost_packets_++;
+            continue;
+        }
+        OnPacketAcked(pkt, result.recv_us);
+    }
+
+    UpdateDelayBitrate(now_ms);
+    UpdateLossBitrate(now_ms);
+
+    uint32_t target = Clamp(delay_bitrate_ < loss_bitrate_ ? delay_bitrate_ : loss_bitrate_);
+    if (target != target_bitrate_) {
+        LogDebugf(logger_, "bwe target bitrate:%u, delay bitrate:%u, loss bitrate:%u, acked bitrate:%u, loss:%.03f, usage:%d, threshold:%.02f",
+                target, delay_bitrate_, loss_bitrate_, acked_bitrate_, loss_rate_, usage_, threshold_);
+    }
+    target_bitrate_ = target;
+}
+
+void SendSideBwe::OnPacketAcked(BweSentPacket& pkt, int64_t recv_us) {
+    UpdateAckedBitrate(recv_us / 1000, pkt.size);
+
+    if (!has_group_) {
+        has_group_ = true;
+        group_.first_send_ms = group_.last_send_ms = pkt.send_ms;
+        group_.first_recv_us = group_.last_recv_us = recv_us;
+        group_.size = pkt.size;
+        return;
+    }
+    if (pkt.send_ms < group_.first_send_ms) {
+        //reordered packet of the previous group
+        return;
+    }
+    if (pkt.send_ms - group_.first_send_ms <= BWE_GROUP_MS) {
+        if (pkt.send_ms > group_.last_send_ms) {
+            group_.last_send_ms = pkt.send_ms;
+        }
+        if (recv_us > group_.last_recv_us) {
+            group_.last_recv_us = recv_us;
+        }
+        group_.size += pkt.size;
+        return;
+    }
+
+    if (has_prev_group_) {
+        double send_delta_ms = (double)(group_.last_send_ms - prev_group_.last_send_ms);
+        double recv_delta_ms = (double)(group_.last_recv_us - prev_group_.last_recv_us) / 1000.0;
+        OnGroupDelta(send_delta_ms, recv_delta_ms, group_.last_recv_us / 1000);
+    }
+    prev_group_     = group_;
+    has_prev_group_ = true;
+
+    group_.first_send_ms = group_.last_send_ms = pkt.send_ms;
+    group_.first_recv_us = group_.last_recv_us = recv_us;
+    group_.size = pkt.size;
+}
+
+void SendSideBwe::OnGroupDelta(double send_delta_ms, double recv_delta_ms, int64_t recv_ms) {
+    UpdateTrendline(recv_delta_ms - send_delta_ms, recv_ms);
+
+    if (delay_hist_.size() < BWE_TRENDLINE_WINDOW) {
+        return;
+    }
+    //linear regression of the smoothed delay over the arrival time
+    double sum_x = 0.0;
+    double sum_y = 0.0;
+    for (auto& item : delay_hist_) {
+        sum_x += item.first;
+        sum_y += item.second;
+    }
+    double avg_x = sum_x / delay_hist_.size();
+    double avg_y = sum_y / delay_hist_.size();
+    double numerator   = 0.0;
+    double denominator = 0.0;
+    for (auto& item : delay_hist_) {
+        numerator   += (item.first - avg_x) * (item.second - avg_y);
+        denominator += (item.first - avg_x) * (item.first - avg_x);
+    }
+    double trend = prev_trend_;
+    if (denominator != 0.0) {
+        trend = numerator / denominator;
+    }
+    DetectUsage(trend, send_delta_ms, recv_ms);
+}
+
+void SendSideBwe::UpdateTrendline(double delay_delta_ms, int64_t recv_ms) {
+    if (first_recv_ms_ < 0) {
+        first_recv_ms_ = recv_ms;
+    }
+    if (num_deltas_ < 60) {
+        num_deltas_++;
+    }
+    accumulated_delay_ += delay_delta_ms;
+    smoothed_delay_ = BWE_TRENDLINE_SMOOTHING * smoothed_delay_
+                    + (1.0 - BWE_TRENDLINE_SMOOTHING) * accumulated_delay_;
+
+    delay_hist_.push_back(std::make_pair((double)(recv_ms - first_recv_ms_), smoothed_delay_));
+    if (delay_hist_.size() > BWE_TRENDLINE_WINDOW) {
+        delay_hist_.pop_front();
+    }
+}
+
+void SendSideBwe::DetectUsage(double trend, double send_delta_ms, int64_t recv_ms) {
+    double modified_trend = (double)num_deltas_ * trend * BWE_TRENDLINE_GAIN;
+
+    if (modified_trend > threshold_) {
+        if (time_over_using_ < 0) {
+            time_over_using_ = send_delta_ms / 2;
+        } else {
+            time_over_using_ += send_delta_ms;
+        }
+        overuse_counter_++;
+        if (time_over_using_ > BWE_OVERUSE_MIN_MS && overuse_counter_ > 1 && trend >= prev_trend_) {
+            time_over_using_ = 0;
+            overuse_counter_ = 0;
+            usage_ = BWE_OVERUSING;
+        }
+    } else if (modified_trend < -threshold_) {
+        time_over_using_ = -1;
+        overuse_counter_ = 0;
+        usage_ = BWE_UNDERUSING;
+    } else {
+        time_over_using_ = -1;
+        overuse_counter_ = 0;
+        usage_ = BWE_NORMAL;
+    }
+    prev_trend_ = trend;
+
+    UpdateThreshold(modified_trend, recv_ms);
+}
+
+void SendSideBwe::UpdateThreshold(double modified_trend, int64_t now_ms) {
+    if (last_threshold_ms_ < 0) {
+        last_threshold_ms_ = now_ms;
+    }
+    double abs_trend = std::fabs(modified_trend);
+
+    //a sudden spike does not move the threshold
+    if (abs_trend > threshold_ + 15.0) {
+        last_threshold_ms_ = now_ms;
+        return;
+    }
+    double k = (abs_trend < threshold_) ? 0.039 : 0.0087;
+    int64_t diff_ms = now_ms - last_threshold_ms_;
+    if (diff_ms > 100) {
+        diff_ms = 100;
+    }
+    if (diff_ms < 0) {
+        diff_ms = 0;
+    }
+    threshold_ += k * (abs_trend - threshold_) * (double)diff_ms;
+    if (threshold_ < 6.0) {
+        threshold_ = 6.0;
+    } else if (threshold_ > 600.0) {
+        threshold_ = 600.0;
+    }
+    last_threshold_ms_ = now_ms;
+}
+
+void SendSideBwe::UpdateAckedBitrate(int64_t recv_ms, size_t size) {
+    acked_hist_.push_back(std::make_pair(recv_ms, size));
+    acked_bytes_ += size;
+
+    while (!acked_hist_.empty() && acked_hist_.front().first < recv_ms - BWE_ACKED_WINDOW_MS) {
+        acked_bytes_ -= acked_hist_.front().second;
+        acked_hist_.pop_front();
+    }
+    int64_t span = acked_hist_.back().first - acked_hist_.front().first;
+    if (span < BWE_ACKED_WINDOW_MS / 2) {
+        return;
+    }
+    acked_bitrate_ = (uint32_t)((int64_t)acked_bytes_ * 8 * 1000 / span);
+}
+
+void SendSideBwe::UpdateDelayBitrate(int64_t now_ms) {
+    if (last_update_ms_ < 0) {
+        last_update_ms_ = now_ms;
+        return;
+    }
+    int64_t elapsed = now_ms - last_update_ms_;
+    last_update_ms_ = now_ms;
+
+    switch (usage_)
+    {
+        case BWE_OVERUSING:
+        {
+            int64_t interval = (rtt_ms_ > 100) ? rtt_ms_ : 100;
+            if (last_decrease_ms_ > 0 && now_ms - last_decrease_ms_ < interval) {
+                break;
+            }
+            uint32_t base = (acked_bitrate_ > 0) ? acked_bitrate_ : delay_bitrate_;
+            uint32_t decreased = Clamp(0.85 * base);
+            if (decreased < delay_bitrate_) {
+                delay_bitrate_ = decreased;
+            }
+            last_decrease_ms_ = now_ms;
+            break;
+        }
+        case BWE_UNDERUSING:
+        {
+            //the queues are draining, hold the rate
+            break;
+        }
+        case BWE_NORMAL:
+        default:
+        {
+            if (elapsed > 1000) {
+                elapsed = 1000;
+            }
+            double increased = delay_bitrate_ * std::pow(1.08, (double)elapsed / 1000.0);
+            if (acked_bitrate_ > 0) {
+                //do not run away from what the network has delivered
+                double limit = 1.5 * acked_bitrate_ + 10000;
+                if (increased > limit) {
+                    increased = limit;
+                }
+            }
+            if (increased > delay_bitrate_) {
+                delay_bitrate_ = Clamp(increased);
+            }
+            break;
+        }
+    }
+}
+
+void SendSideBwe::UpdateLossBitrate(int64_t now_ms) {
+    if (total_packets_ < BWE_LOSS_MIN_PACKETS) {
+        return;
+    }
+    loss_rate_ = (float)lost_packets_ / (float)total_packets_;
+    lost_packets_  = 0;
+    total_packets_ = 0;
+
+    if (last_loss_update_ms_ < 0) {
+        last_loss_update_ms_ = now_ms;
+    }
+    int64_t elapsed = now_ms - last_loss_update_ms_;
+    last_loss_update_ms_ = now_ms;
+
+    if (loss_rate_ > BWE_LOSS_HIGH) {
+        loss_bitrate_ = Clamp(target_bitrate_ * (1.0 - 0.5 * loss_rate_));
+    } else if (loss_rate_ < BWE_LOSS_LOW) {
+        if (elapsed > 1000) {
+            elapsed = 1000;
+        }
+        loss_bitrate_ = Clamp(loss_bitrate_ * std::pow(1.08, (double)elapsed / 1000.0) + 1000);
+    }
+}
+
+uint32_t SendSideBwe::Clamp(double bitrate) {
+    if (bitrate < BWE_MIN_BITRATE) {
+        return BWE_MIN_BITRATE;
+    }
+    if (bitrate > BWE_MAX_BITRATE) {
+        return BWE_MAX_BITRATE;
+    }
+    return (uint32_t)bitrate;
+}
+
+}
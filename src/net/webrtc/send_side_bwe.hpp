@@ -0,0 +1,133 @@
+#ifndef SEND_SIDE_BWE_HPP
+#define SEND_SIDE_BWE_HPP
+#include "logger.hpp"
+#include "rtcpfb_tcc.hpp"
+
+#include <stdint.h>
+#include <stddef.h>
+#include <deque>
+#include <vector>
+
+namespace cpp_streamer
+{
+#define BWE_HISTORY_SIZE        4096
+#define BWE_MIN_BITRATE         (100*1000)      //bps
+#define BWE_MAX_BITRATE         (20*1000*1000)  //bps
+#define BWE_START_BITRATE       (2*1000*1000)   //bps
+#define BWE_GROUP_MS            5
+#define BWE_TRENDLINE_WINDOW    20
+#define BWE_TRENDLINE_GAIN      4.0
+#define BWE_TRENDLINE_SMOOTHING 0.9
+#define BWE_OVERUSE_MIN_MS      10
+#define BWE_ACKED_WINDOW_MS     500
+#define BWE_LOSS_MIN_PACKETS    20
+#define BWE_LOSS_HIGH           0.10
+#define BWE_LOSS_LOW            0.02
+
+typedef enum {
+    BWE_NORMAL,
+    BWE_OVERUSING,
+    BWE_UNDERUSING
+} BWE_USAGE;
+
+typedef struct {
+    uint16_t seq;
+    size_t size;
+    int64_t send_ms;
+    bool valid;
+} BweSentPacket;
+
+typedef struct {
+    int64_t first_send_ms;
+    int64_t last_send_ms;
+    int64_t first_recv_us;
+    int64_t last_recv_us;
+    size_t size;
+} BwePacketGroup;
+
+/*
+ * send side bandwidth estimation on transport-wide cc feedback:
+ * delay based: the delay variation between the packet groups(5ms bursts) goes
+ *   into a trendline filter, the slope is compared with an adaptive threshold,
+ *   overuse decreases the rate to 0.85 * acked bitrate, normal increases it by 8%/s.
+ * loss based: loss > 10% decreases the rate by loss/2, loss < 2% increases it by 8%/s.
+ * the target bitrate is the min of the two.
+ */
+class SendSideBwe
+{
+public:
+    SendSideBwe(Logger* logger);
+    ~SendSideBwe();
+
+public:
+    void OnPacketSent(uint16_t seq, size_t size, int64_t now_ms);
+    void OnTransportFeedback(RtcpFbTcc* tcc, int64_t now_ms);
+    void SetRtt(int64_t rtt_ms) { rtt_ms_ = rtt_ms; }
+
+public:
+    uint32_t GetTargetBitrate() { return target_bitrate_; }
+    uint32_t GetAckedBitrate() { return acked_bitrate_; }
+    float GetLossRate() { return loss_rate_; }
+    BWE_USAGE GetUsage() { return usage_; }
+
+private:
+    void OnPacketAcked(BweSentPacket& pkt, int64_t recv_us);
+    void OnGroupDelta(double send_delta_ms, double recv_delta_ms, int64_t recv_ms);
+    void UpdateTrendline(double delay_delta_ms, int64_t recv_ms);
+    void DetectUsage(double trend, double send_delta_ms, int64_t recv_ms);
+    void UpdateThreshold(double modified_trend, int64_t now_ms);
+    void UpdateAckedBitrate(int64_t recv_ms, size_t size);
+    void UpdateDelayBitrate(int64_t now_ms);
+    void UpdateLossBitrate(int64_t now_ms);
+    uint32_t Clamp(double bitrate);
+
+private:
+    Logger* logger_ = nullptr;
+
+private://send history
+    std::vector<BweSentPacket> history_;
+
+private://packet groups
+    bool has_group_ = false;
+    bool has_prev_group_ = false;
+    BwePacketGroup group_;
+    BwePacketGroup prev_group_;
+
+private://trendline
+    std::deque<std::pair<double, double>> delay_hist_;//recv ms, smoothed delay ms
+    double accumulated_delay_ = 0.0;
+    double smoothed_delay_    = 0.0;
+    int64_t first_recv_ms_    = -1;
+    size_t num_deltas_        = 0;
+    double prev_trend_        = 0.0;
+
+private://overuse detector
+    double threshold_          = 12.5;
+    int64_t last_threshold_ms_ = -1;
+    double time_over_using_    = -1.0;
+    int overuse_counter_       = 0;
+    BWE_USAGE usage_           = BWE_NORMAL;
+
+private://acked bitrate
+    std::deque<std::pair<int64_t, size_t>> acked_hist_;//recv ms, bytes
+    size_t acked_bytes_      = 0;
+    uint32_t acked_bitrate_  = 0;
+
+private://rate control
+    uint32_t delay_bitrate_  = BWE_START_BITRATE;
+    uint32_t loss_bitrate_   = BWE_START_BITRATE;
+    uint32_t target_bitrate_ = BWE_START_BITRATE;
+    int64_t last_update_ms_  = -1;
+    int64_t last_decrease_ms_ = -1;
+    int64_t rtt_ms_          = 100;
+
+private://loss
+    size_t lost_packets_     = 0;
+    size_t total_packets_    = 0;
+    float loss_rate_         = 0.0;
+    int64_t last_loss_update_ms_ = -1;
+};
+
+}
+
+#endif
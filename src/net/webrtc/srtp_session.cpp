@@ -163,9 +163,9 @@ SRtpSession::SRtpSession(SRTP_SESSION_TYPE session_type, CRYPTO_SUITE_ENUM suite
 
     if (err != srtp_err_status_ok) {
         CSM_THROW_ERROR("srtp_create error: %s", SRtpSession::errors.at(err));
+    }
     LogInfof(SRtpSession::logger_, "srtp session construct, type:<%s>, suite:%s",
         session_desc.c_str(), suite_desc.c_str());
-    }
 }
 
 SRtpSession::~SRtpSession() {
@@ -177,25 +177,37 @@ SRtpSession::~SRtpSession() {
     }
 }
 
-bool SRtpSession::EncryptRtp(uint8_t** data, size_t* len) {
+uint8_t* SRtpSession::GetProtectBuffer(uint8_t* data, size_t len, size_t capacity) {
     //in srtp.h
     //#define SRTP_MAX_TRAILER_LEN (SRTP_MAX_TAG_LEN + SRTP_MAX_MKI_LEN)
-    //SRTP_MAX_TRAILER_LEN=-16+128
-    if (*len + SRTP_MAX_TRAILER_LEN > SRTP_ENCRYPT_BUFFER_SIZE) {
-        LogErrorf(SRtpSession::logger_, "fail to encrypt RTP packet, size too big (%lu bytes)", *len);
-        return false;
+    //SRTP_MAX_TRAILER_LEN=16+128
+    if (len + SRTP_MAX_TRAILER_LEN <= capacity) {
+        return data;
     }
+    if (len + SRTP_MAX_TRAILER_LEN > SRTP_ENCRYPT_BUFFER_SIZE) {
+        LogErrorf(SRtpSession::logger_, "fail to encrypt packet, size too big (%lu bytes)", len);
+        return nullptr;
+    }
+    std::memcpy(encrypt_buffer_, data, len);
+    return encrypt_buffer_;
+}
 
-    std::memcpy(encrypt_buffer_, *data, *len);
+bool SRtpSession::ProtectRtp(uint8_t** data, size_t* len, size_t capacity) {
+    uint8_t* buffer = GetProtectBuffer(*data, *len, capacity);
+    if (!buffer) {
+        return false;
+    }
+    int protect_len = (int)*len;
 
-    srtp_err_status_t err = srtp_protect(session_, (void*)(encrypt_buffer_), (int*)(len));
+    srtp_err_status_t err = srtp_protect(session_, (void*)buffer, &protect_len);
 
     if (err != srtp_err_status_ok) {
         LogErrorf(SRtpSession::logger_, "srtp_protect error: %s", SRtpSession::errors.at(err));
         return false;
     }
 
-    *data = encrypt_buffer_;
+    *data = buffer;
+    *len  = (size_t)protect_len;
     return true;
 }
 
@@ -208,24 +220,22 @@ bool SRtpSession::DecryptSrtp(uint8_t* data, size_t* len) {
     return true;
 }
 
-bool SRtpSession::EncryptRtcp(uint8_t** data, size_t* len) {
-    //#define SRTP_MAX_TRAILER_LEN (SRTP_MAX_TAG_LEN + SRTP_MAX_MKI_LEN)
-    //SRTP_MAX_TRAILER_LEN=-16+128
-    if (*len + SRTP_MAX_TRAILER_LEN > SRTP_ENCRYPT_BUFFER_SIZE) {
-        LogErrorf(SRtpSession::logger_, "fail to encrypt RTP packet, size too big (%lu bytes)", *len);
+bool SRtpSession::ProtectRtcp(uint8_t** data, size_t* len, size_t capacity) {
+    uint8_t* buffer = GetProtectBuffer(*data, *len, capacity);
+    if (!buffer) {
         return false;
     }
+    int protect_len = (int)*len;
 
-    std::memcpy(encrypt_buffer_, *data, *len);
-
-    srtp_err_status_t err = srtp_protect_rtcp(session_, (void*)(encrypt_buffer_), (int*)(len));
+    srtp_err_status_t err = srtp_protect_rtcp(session_, (void*)buffer, &protect_len);
 
     if (err != srtp_err_status_ok) {
         LogErrorf(SRtpSession::logger_, "srtp_protect_rtcp error: %s", SRtpSession::errors.at(err));
         return false;
     }
 
-    *data = encrypt_buffer_;
+    *data = buffer;
+    *len  = (size_t)protect_len;
     return true;
 }
 
@@ -43,9 +43,13 @@ public:
     static void OnSRtpEvent(srtp_event_data_t* data);
 
 public:
-    bool EncryptRtp(uint8_t** data, size_t* len);
+    //capacity: the buffer size of data, it is protected in place when the srtp trailer fits in,
+    //otherwise it is copied into the encrypt buffer and data points to it
+    bool ProtectRtp(uint8_t** data, size_t* len, size_t capacity);
+    bool ProtectRtcp(uint8_t** data, size_t* len, size_t capacity);
+    bool EncryptRtp(uint8_t** data, size_t* len) { return ProtectRtp(data, len, 0); }
     bool DecryptSrtp(uint8_t* data, size_t* len);
-    bool EncryptRtcp(uint8_t** data, size_t* len);
+    bool EncryptRtcp(uint8_t** data, size_t* len) { return ProtectRtcp(data, len, 0); }
     bool DecryptSrtcp(uint8_t* data, size_t* len);
     void RemoveStream(uint32_t ssrc);
 
@@ -54,6 +58,9 @@ private:
     static bool init_;
     static std::vector<const char*> errors;
 
+private:
+    uint8_t* GetProtectBuffer(uint8_t* data, size_t len, size_t capacity);
+
 private:
     srtp_t session_ = nullptr;
 
@@ -20,6 +20,11 @@ namespace cpp_streamer
 {
 #define WHEP_NAME "whep"
 
+std::map<std::string, std::string> Whep::def_options_ = {
+    {"keepalive", "false"},//reuse the http connections by the pool of the loop
+    {"fec", "false"}       //receive the flexfec of the video when the answer has it
+};
+
 Whep::Whep()
 {
     ByteCrypto::Init();
@@ -27,6 +32,7 @@ Whep::Whep()
     name_ += "_";
     name_ += UUID::MakeUUID();
     LogInfof(logger_, "construct Whep");
+    options_ = def_options_;
 }
 
 Whep::~Whep()
@@ -80,6 +86,9 @@ void Whep::StartNetwork(const std::string& url, void* loop_handle) {
 
     pc_ = new PeerConnection((uv_loop_t*)loop_handle, logger_, this);
     pc_->SetMediaCallback(this);
+    if (options_["fec"] == "true") {
+        pc_->SetFecEnable(true);
+    }
 
     bool https_enable = false;
     if (!GetHostInfoByUrl(url, host_, port_, subpath_, https_enable)) {
@@ -164,7 +173,8 @@ int Whep::Start(const std::string& host, uint16_t port, const std::string& subpa
 
     ReleaseHttpClient();
     std::map<std::string, std::string> headers;
-    hc_ = new HttpClient(loop_, host_, port_, this, logger_, https_enable);
+    hc_ = new HttpClient(loop_, host_, port_, this, logger_, https_enable,
+            options_["keepalive"] == "true");
     LogInfof(logger_, "whep http post host:%s, port:%d, subpath:%s",
             host_.c_str(), port_, subpath.c_str());
     start_ms_ = now_millisec();
@@ -177,6 +187,9 @@ void Whep::OnHttpRead(int ret, std::shared_ptr<HttpClientResponse> resp_ptr) {
         ReleaseHttpClient();
         return;
     }
+    if (report_ && hc_) {
+        report_->OnReport(name_, "connect_ms", std::to_string(hc_->GetConnectMs()));
+    }
     std::string resp_data(resp_ptr->data_.Data(), resp_ptr->data_.DataLen());
 
     LogInfof(logger_, "http status:%d, status desc:%s, content len:%d, subpath:%s",
@@ -203,6 +216,8 @@ void Whep::OnState(const std::string& type, const std::string& value) {
 }
 
 void Whep::OnReceiveMediaPacket(Media_Packet_Ptr pkt_ptr) {
+    metrics_.OnPacket(pkt_ptr->buffer_ptr_->DataLen());
+    metrics_.OnIngress(pkt_ptr->ingress_us_);
     if (sinkers_.empty()) {
         return;
     }
@@ -45,6 +45,9 @@ private:
             uint16_t& port, std::string& subpath, bool& https_enable);
     int Start(const std::string& host, uint16_t port, const std::string& subpath, bool https_enable);
 
+private:
+    static std::map<std::string, std::string> def_options_;
+
 private:
     Logger* logger_ = nullptr;
     std::string name_;
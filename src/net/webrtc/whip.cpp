@@ -4,6 +4,7 @@
 
 #include <iostream>
 #include <stdio.h>
+#include <stdlib.h>
 
 void* make_whip_streamer() {
     cpp_streamer::Whip* whip = new cpp_streamer::Whip();
@@ -25,12 +26,21 @@ void SourceWhipData(uv_async_t *handle) {
     whip->HandleMediaData();
 }
 
+std::map<std::string, std::string> Whip::def_options_ = {
+    {"keepalive", "false"},   //reuse the http connections by the pool of the loop
+    {"vcodec", "h264"},       //the video codec in the offer: h264 or h265
+    {"fec", "false"},         //flexfec of the video in the offer
+    {"fec_key_rate", "30"},   //the fec packets percent of the keyframe packets
+    {"fec_delta_rate", "10"}  //the fec packets percent of the delta frame packets
+};
+
 Whip::Whip()
 {
     ByteCrypto::Init();
     name_ = WHIP_NAME;
     name_ += "_";
     name_ += UUID::MakeUUID();
+    options_ = def_options_;
 }
 
 Whip::~Whip()
@@ -54,6 +64,7 @@ Media_Packet_Ptr Whip::GetMediaPacket() {
         
     pkt_ptr = packet_queue_.front();
     packet_queue_.pop();
+    metrics_.SetQueueDepth(packet_queue_.size());
 
     return pkt_ptr;
 }
@@ -65,6 +76,7 @@ void Whip::HandleMediaData() {
         if (!pkt_ptr) {
             break;
         }
+        metrics_.BeginStage();
 
         if (pkt_ptr->av_type_ == MEDIA_VIDEO_TYPE) {
             pc_->SendVideoPacket(pkt_ptr);
@@ -74,7 +86,15 @@ void Whip::HandleMediaData() {
             LogErrorf(logger_, "input media type error:%s",
                     avtype_tostring(pkt_ptr->av_type_).c_str());
         }
+        metrics_.EndStage();
+        //the pipeline latency is recorded by the peer connection when the rtp packets
+        //of it leave as srtp, after the pacer
     }
+
+    //the video frames dropped by the congestion control of the send stream
+    int64_t dropped_frames = pc_->GetDroppedFrames();
+    metrics_.OnDrop(dropped_frames - dropped_frames_);
+    dropped_frames_ = dropped_frames;
     return;
 }
 
@@ -110,6 +130,9 @@ int Whip::SourceData(Media_Packet_Ptr pkt_ptr) {
     Media_Packet_Ptr new_ptr = pkt_ptr->copy();
 
     packet_queue_.push(new_ptr);
+    metrics_.OnPacket(new_ptr->buffer_ptr_->DataLen());
+    metrics_.SetQueueDepth(packet_queue_.size());
+    metrics_.OnIngress(new_ptr->ingress_us_);
 
     async_.data = (void*)this;
     uv_async_send(&async_);
@@ -126,6 +149,14 @@ void Whip::StartNetwork(const std::string& url, void* loop_handle) {
     uv_async_init(loop_, &async_, SourceWhipData);
 
     pc_ = new PeerConnection((uv_loop_t*)loop_handle, logger_, this);
+    pc_->SetMetrics(&metrics_);
+    if (options_["vcodec"] == "h265") {
+        pc_->SetVideoCodec(MEDIA_CODEC_H265);
+    }
+    if (options_["fec"] == "true") {
+        pc_->SetFecEnable(true, atoi(options_["fec_key_rate"].c_str()),
+                atoi(options_["fec_delta_rate"].c_str()));
+    }
 
     bool https_enable = false;
     if (!GetHostInfoByUrl(url, host_, port_, subpath_, https_enable)) {
@@ -210,7 +241,8 @@ int Whip::Start(const std::string& host, uint16_t port, const std::string& subpa
 
     ReleaseHttpClient();
     std::map<std::string, std::string> headers;
-    hc_ = new HttpClient(loop_, host_, port_, this, logger_, https_enable);
+    hc_ = new HttpClient(loop_, host_, port_, this, logger_, https_enable,
+            options_["keepalive"] == "true");
     LogInfof(logger_, "http post host:%s, port:%d, subpath:%s",
             host_.c_str(), port_, subpath.c_str());
     start_ms_ = now_millisec();
@@ -223,6 +255,9 @@ void Whip::OnHttpRead(int ret, std::shared_ptr<HttpClientResponse> resp_ptr) {
         ReleaseHttpClient();
         return;
     }
+    if (report_ && hc_) {
+        report_->OnReport(name_, "connect_ms", std::to_string(hc_->GetConnectMs()));
+    }
     std::string resp_data(resp_ptr->data_.Data(), resp_ptr->data_.DataLen());
 
     LogInfof(logger_, "http status:%d, status desc:%s, content len:%d, subpath:%s",
@@ -49,6 +49,9 @@ private:
             uint16_t& port, std::string& subpath, bool& https_enable);
     int Start(const std::string& host, uint16_t port, const std::string& subpath, bool https_enable);
 
+private:
+    static std::map<std::string, std::string> def_options_;
+
 private:
     Logger* logger_ = nullptr;
     std::string name_;
@@ -57,6 +60,7 @@ private:
     std::queue<Media_Packet_Ptr> packet_queue_;
     std::mutex mutex_;
     uv_async_t async_;
+    int64_t dropped_frames_ = 0;
 
 private:
     HttpClient* hc_ = nullptr;
@@ -0,0 +1,1143 @@
+#include "cpp_streamer_interface.hpp"
+#include "cpp_streamer_factory.hpp"
+#include "logger.hpp"
+#include "media_packet.hpp"
+#include "h264_h265_header.hpp"
+#include "amf0.hpp"
+#include "rtp_packetizer.hpp"
+#include "pack_handle_h264.hpp"
+#include "srtp_session.hpp"
+#include "byte_stream.hpp"
+#include "timeex.hpp"
+
+#include <iostream>
+#include <uv.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <unistd.h>
+#include <algorithm>
+#include <memory>
+#include <vector>
+
+using namespace cpp_streamer;
+
+static Logger* s_logger = nullptr;
+static const int VIDEO_CLOCK_RATE   = 90000;
+static const int AAC_SAMPLE_RATE    = 44100;
+static const int AAC_FRAME_SAMPLES  = 1024;
+static const int OPUS_FRAME_MS      = 20;
+static const int FRAME_RATE         = 30;
+static const uint32_t VIDEO_SSRC    = 0x11223344;
+static const uint32_t AUDIO_SSRC    = 0x55667788;
+static const uint8_t VIDEO_PT       = 96;
+static const uint8_t AUDIO_PT       = 111;
+static const int BATCH_COUNT        = 256;
+
+//x264 high profile 1280x720, the pps of the same stream
+static const uint8_t H264_SPS[] = {0x67, 0x64, 0x00, 0x1f, 0xac, 0xd9, 0x40, 0x50, 0x05, 0xbb, 0x01, 0x10,
+                                   0x00, 0x00, 0x03, 0x00, 0x10, 0x00, 0x00, 0x03, 0x03, 0xc0, 0xf1, 0x83,
+                                   0x19, 0x60};
+static const uint8_t H264_PPS[] = {0x68, 0xeb, 0xe3, 0xcb, 0x22, 0xc0};
+
+//x265 main profile 1280x720
+static const uint8_t H265_VPS[] = {0x40, 0x01, 0x0c, 0x01, 0xff, 0xff, 0x01, 0x60, 0x00, 0x00, 0x03, 0x00,
+                                   0x90, 0x00, 0x00, 0x03, 0x00, 0x00, 0x03, 0x00, 0x5d, 0x95, 0x98, 0x09};
+static const uint8_t H265_SPS[] = {0x42, 0x01, 0x01, 0x01, 0x60, 0x00, 0x00, 0x03, 0x00, 0x90, 0x00, 0x00,
+                                   0x03, 0x00, 0x00, 0x03, 0x00, 0x5d, 0xa0, 0x02, 0x80, 0x80, 0x2d, 0x16,
+                                   0x59, 0x59, 0xa4, 0x93, 0x2b, 0xc0, 0x5a, 0x70, 0x80, 0x00, 0x01, 0xf4,
+                                   0x80, 0x00, 0x3a, 0x98, 0x04};
+static const uint8_t H265_PPS[] = {0x44, 0x01, 0xc1, 0x72, 0xb4, 0x62, 0x40};
+
+//aac lc, 44100hz, stereo
+static const uint8_t AAC_ASC[] = {0x12, 0x10};
+
+typedef struct {
+    int frame_count;
+    int gop;
+    size_t key_frame_size;
+    size_t delta_frame_size;
+    size_t audio_frame_size;
+    size_t chunk_size;
+    int amf_count;
+} BenchConfig;
+
+//packets: the input packets of the muxers and the encoders, the output packets of the demuxers
+typedef struct {
+    std::string name;
+    std::string codec;
+    int64_t packets;
+    int64_t bytes;
+    int64_t cost_us;
+} BenchResult;
+
+typedef struct {
+    size_t offset;//in the annexb data, after the start code
+    size_t len;
+    bool param_set;
+} SynthNalu;
+
+/*
+ * one synthetic access unit:
+ * video: annexb with the parameter sets before the keyframe, avcc without them
+ * audio: the raw aac or opus frame in annexb
+ */
+typedef struct {
+    MEDIA_PKT_TYPE av_type;
+    MEDIA_CODEC_TYPE codec_type;
+    int64_t dts;
+    bool key;
+    std::vector<uint8_t> annexb;
+    std::vector<uint8_t> avcc;
+    std::vector<SynthNalu> nalus;
+} SynthFrame;
+
+typedef std::vector<uint8_t> RecordPacket;
+
+static uint32_t s_fill_seed = 1;
+
+//the filler bytes are never zero, so there is no start code emulation in the payload
+static void FillPayload(uint8_t* data, size_t len) {
+    for (size_t index = 0; index < len; index++) {
+        s_fill_seed = s_fill_seed * 1103515245 + 12345;
+        data[index] = (uint8_t)((s_fill_seed >> 16) % 255 + 1);
+    }
+}
+
+static void AppendNalu(SynthFrame& frame, const uint8_t* data, size_t len, bool param_set) {
+    static const uint8_t start_code[] = {0x00, 0x00, 0x00, 0x01};
+    uint8_t len_data[4];
+
+    frame.annexb.insert(frame.annexb.end(), start_code, start_code + sizeof(start_code));
+    frame.nalus.push_back({frame.annexb.size(), len, param_set});
+    frame.annexb.insert(frame.annexb.end(), data, data + len);
+
+    if (param_set) {
+        return;
+    }
+    ByteStream::Write4Bytes(len_data, (uint32_t)len);
+    frame.avcc.insert(frame.avcc.end(), len_data, len_data + sizeof(len_data));
+    frame.avcc.insert(frame.avcc.end(), data, data + len);
+}
+
+static void MakeVideoFrames(const BenchConfig& config, MEDIA_CODEC_TYPE codec_type,
+        std::vector<SynthFrame>& frames) {
+    std::vector<uint8_t> slice;
+
+    frames.resize(config.frame_count);
+    for (int index = 0; index < config.frame_count; index++) {
+        SynthFrame& frame = frames[index];
+        bool key = (index % config.gop) == 0;
+        size_t size = key ? config.key_frame_size : config.delta_frame_size;
+
+        frame.av_type    = MEDIA_VIDEO_TYPE;
+        frame.codec_type = codec_type;
+        frame.dts        = (int64_t)index * 1000 / FRAME_RATE;
+        frame.key        = key;
+
+        slice.resize(size);
+        FillPayload(slice.data(), slice.size());
+        if (codec_type == MEDIA_CODEC_H264) {
+            if (key) {
+                AppendNalu(frame, H264_SPS, sizeof(H264_SPS), true);
+                AppendNalu(frame, H264_PPS, sizeof(H264_PPS), true);
+            }
+            slice[0] = key ? 0x65 : 0x41;
+        } else {
+            if (key) {
+                AppendNalu(frame, H265_VPS, sizeof(H265_VPS), true);
+                AppendNalu(frame, H265_SPS, sizeof(H265_SPS), true);
+                AppendNalu(frame, H265_PPS, sizeof(H265_PPS), true);
+            }
+            slice[0] = key ? (uint8_t)(NAL_UNIT_CODED_SLICE_IDR << 1) : (uint8_t)(NAL_UNIT_CODED_SLICE_TRAIL_R << 1);
+            slice[1] = 0x01;
+        }
+        AppendNalu(frame, slice.data(), slice.size(), false);
+    }
+}
+
+static void MakeAudioFrames(const BenchConfig& config, MEDIA_CODEC_TYPE codec_type,
+        int64_t duration_ms, std::vector<SynthFrame>& frames) {
+    for (int64_t index = 0; ; index++) {
+        int64_t dts = (codec_type == MEDIA_CODEC_AAC)
+                    ? index * AAC_FRAME_SAMPLES * 1000 / AAC_SAMPLE_RATE
+                    : index * OPUS_FRAME_MS;
+        if (dts >= duration_ms) {
+            break;
+        }
+        frames.emplace_back();
+        SynthFrame& frame = frames.back();
+
+        frame.av_type    = MEDIA_AUDIO_TYPE;
+        frame.codec_type = codec_type;
+        frame.dts        = dts;
+        frame.key        = false;
+        frame.annexb.resize(config.audio_frame_size);
+        FillPayload(frame.annexb.data(), frame.annexb.size());
+        if (codec_type == MEDIA_CODEC_OPUS) {
+            frame.annexb[0] = 0xfc;//celt fullband 20ms, stereo, one frame
+        }
+    }
+}
+
+//the audio and video frames in the dts order
+static void Interleave(const std::vector<SynthFrame>& video, const std::vector<SynthFrame>& audio,
+        std::vector<const SynthFrame*>& output) {
+    size_t video_index = 0;
+    size_t audio_index = 0;
+
+    while (video_index < video.size() || audio_index < audio.size()) {
+        if (audio_index >= audio.size()
+            || (video_index < video.size() && video[video_index].dts <= audio[audio_index].dts)) {
+            output.push_back(&video[video_index++]);
+        } else {
+            output.push_back(&audio[audio_index++]);
+        }
+    }
+}
+
+static void MakeAvcC(std::vector<uint8_t>& avcc) {
+    avcc.push_back(0x01);
+    avcc.push_back(H264_SPS[1]);
+    avcc.push_back(H264_SPS[2]);
+    avcc.push_back(H264_SPS[3]);
+    avcc.push_back(0xff);//4 bytes nalu length
+    avcc.push_back(0xe1);//one sps
+    avcc.push_back((uint8_t)(sizeof(H264_SPS) >> 8));
+    avcc.push_back((uint8_t)(sizeof(H264_SPS) & 0xff));
+    avcc.insert(avcc.end(), H264_SPS, H264_SPS + sizeof(H264_SPS));
+    avcc.push_back(0x01);//one pps
+    avcc.push_back((uint8_t)(sizeof(H264_PPS) >> 8));
+    avcc.push_back((uint8_t)(sizeof(H264_PPS) & 0xff));
+    avcc.insert(avcc.end(), H264_PPS, H264_PPS + sizeof(H264_PPS));
+}
+
+static void MakeHvcC(std::vector<uint8_t>& hvcc) {
+    const uint8_t header[] = {
+        0x01,                               //configurationVersion
+        0x01,                               //general_profile_space, tier, profile_idc: main
+        0x60, 0x00, 0x00, 0x00,             //general_profile_compatibility_flags
+        0x90, 0x00, 0x00, 0x00, 0x00, 0x00, //general_constraint_indicator_flags
+        0x5d,                               //general_level_idc
+        0xf0, 0x00,                         //min_spatial_segmentation_idc
+        0xfc,                               //parallelismType
+        0xfd,                               //chromaFormat: 4:2:0
+        0xf8,                               //bitDepthLumaMinus8
+        0xf8,                               //bitDepthChromaMinus8
+        0x00, 0x00,                         //avgFrameRate
+        0x0f,                               //one temporal layer, nested, 4 bytes nalu length
+        0x03                                //numOfArrays: vps/sps/pps
+    };
+    const std::pair<const uint8_t*, size_t> param_sets[] = {
+        {H265_VPS, sizeof(H265_VPS)},
+        {H265_SPS, sizeof(H265_SPS)},
+        {H265_PPS, sizeof(H265_PPS)}
+    };
+    hvcc.insert(hvcc.end(), header, header + sizeof(header));
+    for (auto& item : param_sets) {
+        hvcc.push_back(0x80 | GET_HEVC_NALU_TYPE(item.first[0]));
+        hvcc.push_back(0x00);
+        hvcc.push_back(0x01);
+        hvcc.push_back((uint8_t)(item.second >> 8));
+        hvcc.push_back((uint8_t)(item.second & 0xff));
+        hvcc.insert(hvcc.end(), item.first, item.first + item.second);
+    }
+}
+
+static Media_Packet_Ptr MakeMediaPacket(MEDIA_PKT_TYPE av_type, MEDIA_CODEC_TYPE codec_type,
+        int64_t dts, bool key, const std::vector<uint8_t>& data) {
+    Media_Packet_Ptr pkt_ptr = std::make_shared<Media_Packet>(data.size());
+
+    pkt_ptr->av_type_      = av_type;
+    pkt_ptr->codec_type_   = codec_type;
+    pkt_ptr->fmt_type_     = MEDIA_FORMAT_RAW;
+    pkt_ptr->dts_          = dts;
+    pkt_ptr->pts_          = dts;
+    pkt_ptr->is_key_frame_ = key;
+    pkt_ptr->buffer_ptr_->AppendData((char*)data.data(), data.size());
+    return pkt_ptr;
+}
+
+static Media_Packet_Ptr MakeSeqPacket(MEDIA_PKT_TYPE av_type, MEDIA_CODEC_TYPE codec_type,
+        const std::vector<uint8_t>& data) {
+    Media_Packet_Ptr pkt_ptr = MakeMediaPacket(av_type, codec_type, 0, false, data);
+
+    pkt_ptr->is_seq_hdr_ = true;
+    if (codec_type == MEDIA_CODEC_AAC) {
+        pkt_ptr->has_flv_audio_asc_ = true;
+        pkt_ptr->sample_rate_ = AAC_SAMPLE_RATE;
+        pkt_ptr->channel_     = 2;
+    }
+    return pkt_ptr;
+}
+
+/*
+ * the sinker of the streamer under test, it counts the output packets
+ * and appends their data when the output is the input of the next bench.
+ */
+class BenchSinker : public CppStreamerInterface
+{
+public:
+    BenchSinker(std::vector<uint8_t>* output):output_(output)
+    {
+    }
+    virtual ~BenchSinker()
+    {
+    }
+
+public:
+    virtual std::string StreamerName() override {
+        return "benchsinker";
+    }
+    virtual void SetLogger(Logger* logger) override {
+    }
+    virtual int AddSinker(CppStreamerInterface* sinker) override {
+        return 0;
+    }
+    virtual int RemoveSinker(const std::string& name) override {
+        return 0;
+    }
+    virtual int SourceData(Media_Packet_Ptr pkt_ptr) override {
+        uint8_t* data = (uint8_t*)pkt_ptr->buffer_ptr_->Data();
+        size_t len    = pkt_ptr->buffer_ptr_->DataLen();
+
+        count_++;
+        bytes_ += len;
+        if (output_) {
+            output_->insert(output_->end(), data, data + len);
+        }
+        return 0;
+    }
+    virtual void StartNetwork(const std::string& url, void* loop_handle) override {
+    }
+    virtual void AddOption(const std::string& key, const std::string& value) override {
+    }
+    virtual void SetReporter(StreamerReport* reporter) override {
+    }
+
+public:
+    int64_t count_ = 0;
+    int64_t bytes_ = 0;
+
+private:
+    std::vector<uint8_t>* output_ = nullptr;
+};
+
+/*
+ * the rtp packets are written into one slot, the bench only counts them
+ * unless the recording is on, the recorded packets feed the receive benches.
+ */
+class RtpBenchSink : public RtpPacketSinkI
+{
+public:
+    RtpBenchSink(std::vector<RecordPacket>* records):records_(records)
+    {
+    }
+
+public:
+    virtual uint8_t* NewRtpPacket(uint16_t& seq) override {
+        seq = seq_++;
+        return slot_;
+    }
+    virtual void OnRtpPacket(uint8_t* data, size_t len, uint16_t seq) override {
+        count_++;
+        bytes_ += len;
+        if (records_) {
+            records_->push_back(RecordPacket(data, data + len));
+        }
+    }
+
+public:
+    int64_t count_ = 0;
+    int64_t bytes_ = 0;
+
+private:
+    std::vector<RecordPacket>* records_ = nullptr;
+    uint16_t seq_ = 0;
+    uint8_t slot_[RTP_PACKET_BUFFER_SIZE];
+};
+
+class DepacketizeSink : public PackCallbackI
+{
+public:
+    virtual void PackHandleReset(RtpPacketInfo* pkt_info) override {
+        lost_count_++;
+    }
+    virtual void MediaPacketOutput(std::shared_ptr<Media_Packet> pkt_ptr) override {
+        frame_count_++;
+        frame_bytes_ += pkt_ptr->buffer_ptr_->DataLen();
+    }
+
+public:
+    int64_t frame_count_ = 0;
+    int64_t frame_bytes_ = 0;
+    int64_t lost_count_  = 0;
+};
+
+class MemoryIoReader : public IoReadInterface
+{
+public:
+    MemoryIoReader(const std::vector<uint8_t>& data):data_(data)
+    {
+    }
+
+public:
+    virtual int Read(size_t offset, uint8_t* data_buffer, size_t data_buffer_len) override {
+        if (offset >= data_.size()) {
+            return 0;
+        }
+        size_t len = std::min(data_buffer_len, data_.size() - offset);
+        memcpy(data_buffer, data_.data() + offset, len);
+        return (int)len;
+    }
+
+private:
+    const std::vector<uint8_t>& data_;
+};
+
+//the writer of the mp4 boxes which the mp4 demuxer reads
+class Mp4Writer
+{
+public:
+    Mp4Writer(std::vector<uint8_t>& output):output_(output)
+    {
+    }
+
+public:
+    size_t BeginBox(const char* type) {
+        size_t pos = output_.size();
+        Write4Bytes(0);
+        output_.insert(output_.end(), type, type + 4);
+        return pos;
+    }
+    void EndBox(size_t pos) {
+        ByteStream::Write4Bytes(&output_[pos], (uint32_t)(output_.size() - pos));
+    }
+    void Write4Bytes(uint32_t value) {
+        uint8_t data[4];
+        ByteStream::Write4Bytes(data, value);
+        output_.insert(output_.end(), data, data + sizeof(data));
+    }
+    void Write2Bytes(uint16_t value) {
+        uint8_t data[2];
+        ByteStream::Write2Bytes(data, value);
+        output_.insert(output_.end(), data, data + sizeof(data));
+    }
+    void WriteZero(size_t len) {
+        output_.insert(output_.end(), len, 0);
+    }
+    void WriteData(const uint8_t* data, size_t len) {
+        output_.insert(output_.end(), data, data + len);
+    }
+
+private:
+    std::vector<uint8_t>& output_;
+};
+
+static void WriteMatrix(Mp4Writer& writer) {
+    const uint32_t matrix[] = {0x00010000, 0, 0, 0, 0x00010000, 0, 0, 0, 0x40000000};
+    for (uint32_t value : matrix) {
+        writer.Write4Bytes(value);
+    }
+}
+
+//ftyp | moov(mvhd, trak(tkhd, mdia(mdhd, hdlr, minf(stbl)))) of one h264 track, one sample per chunk
+static void WriteMp4Moov(Mp4Writer& writer, const std::vector<SynthFrame>& frames, uint32_t mdat_offset) {
+    uint32_t duration = (uint32_t)(frames.size() * VIDEO_CLOCK_RATE / FRAME_RATE);
+    size_t moov = writer.BeginBox("moov");
+
+    size_t mvhd = writer.BeginBox("mvhd");
+    writer.Write4Bytes(0);
+    writer.Write4Bytes(0);
+    writer.Write4Bytes(0);
+    writer.Write4Bytes(VIDEO_CLOCK_RATE);
+    writer.Write4Bytes(duration);
+    writer.Write4Bytes(0x00010000);
+    writer.Write2Bytes(0x0100);
+    writer.WriteZero(10);
+    WriteMatrix(writer);
+    writer.WriteZero(24);
+    writer.Write4Bytes(2);
+    writer.EndBox(mvhd);
+
+    size_t trak = writer.BeginBox("trak");
+    size_t tkhd = writer.BeginBox("tkhd");
+    writer.Write4Bytes(0x00000003);
+    writer.Write4Bytes(0);
+    writer.Write4Bytes(0);
+    writer.Write4Bytes(1);
+    writer.Write4Bytes(0);
+    writer.Write4Bytes(duration);
+    writer.WriteZero(8);
+    writer.Write2Bytes(0);
+    writer.Write2Bytes(0);
+    writer.Write2Bytes(0);
+    writer.Write2Bytes(0);
+    WriteMatrix(writer);
+    writer.Write4Bytes(1280 << 16);
+    writer.Write4Bytes(720 << 16);
+    writer.EndBox(tkhd);
+
+    size_t mdia = writer.BeginBox("mdia");
+    size_t mdhd = writer.BeginBox("mdhd");
+    writer.Write4Bytes(0);
+    writer.Write4Bytes(0);
+    writer.Write4Bytes(0);
+    writer.Write4Bytes(VIDEO_CLOCK_RATE);
+    writer.Write4Bytes(duration);
+    writer.Write2Bytes(0x55c4);//und
+    writer.Write2Bytes(0);
+    writer.EndBox(mdhd);
+
+    size_t hdlr = writer.BeginBox("hdlr");
+    writer.Write4Bytes(0);
+    writer.Write4Bytes(0);
+    writer.WriteData((const uint8_t*)"vide", 4);
+    writer.WriteZero(12);
+    writer.WriteData((const uint8_t*)"VideoHandler", 13);
+    writer.EndBox(hdlr);
+
+    size_t minf = writer.BeginBox("minf");
+    size_t stbl = writer.BeginBox("stbl");
+
+    size_t stsd = writer.BeginBox("stsd");
+    writer.Write4Bytes(0);
+    writer.Write4Bytes(1);
+    size_t avc1 = writer.BeginBox("avc1");
+    writer.WriteZero(6);
+    writer.Write2Bytes(1);//data reference index
+    writer.WriteZero(16);
+    writer.Write2Bytes(1280);
+    writer.Write2Bytes(720);
+    writer.Write4Bytes(0x00480000);
+    writer.Write4Bytes(0x00480000);
+    writer.Write4Bytes(0);
+    writer.Write2Bytes(1);
+    writer.WriteZero(32);
+    writer.Write2Bytes(0x0018);
+    writer.Write2Bytes(0xffff);
+    size_t avcc_box = writer.BeginBox("avcC");
+    std::vector<uint8_t> avcc;
+    MakeAvcC(avcc);
+    writer.WriteData(avcc.data(), avcc.size());
+    writer.EndBox(avcc_box);
+    writer.EndBox(avc1);
+    writer.EndBox(stsd);
+
+    size_t stts = writer.BeginBox("stts");
+    writer.Write4Bytes(0);
+    writer.Write4Bytes(1);
+    writer.Write4Bytes((uint32_t)frames.size());
+    writer.Write4Bytes(VIDEO_CLOCK_RATE / FRAME_RATE);
+    writer.EndBox(stts);
+
+    std::vector<uint32_t> key_samples;
+    for (size_t index = 0; index < frames.size(); index++) {
+        if (frames[index].key) {
+            key_samples.push_back((uint32_t)index + 1);
+        }
+    }
+    size_t stss = writer.BeginBox("stss");
+    writer.Write4Bytes(0);
+    writer.Write4Bytes((uint32_t)key_samples.size());
+    for (uint32_t sample : key_samples) {
+        writer.Write4Bytes(sample);
+    }
+    writer.EndBox(stss);
+
+    size_t stsc = writer.BeginBox("stsc");
+    writer.Write4Bytes(0);
+    writer.Write4Bytes(1);
+    writer.Write4Bytes(1);
+    writer.Write4Bytes(1);
+    writer.Write4Bytes(1);
+    writer.EndBox(stsc);
+
+    size_t stsz = writer.BeginBox("stsz");
+    writer.Write4Bytes(0);
+    writer.Write4Bytes(0);
+    writer.Write4Bytes((uint32_t)frames.size());
+    for (auto& frame : frames) {
+        writer.Write4Bytes((uint32_t)frame.avcc.size());
+    }
+    writer.EndBox(stsz);
+
+    size_t stco = writer.BeginBox("stco");
+    writer.Write4Bytes(0);
+    writer.Write4Bytes((uint32_t)frames.size());
+    uint32_t offset = mdat_offset;
+    for (auto& frame : frames) {
+        writer.Write4Bytes(offset);
+        offset += (uint32_t)frame.avcc.size();
+    }
+    writer.EndBox(stco);
+
+    writer.EndBox(stbl);
+    writer.EndBox(minf);
+    writer.EndBox(mdia);
+    writer.EndBox(trak);
+    writer.EndBox(moov);
+}
+
+static void MakeMp4File(const std::vector<SynthFrame>& frames, std::vector<uint8_t>& mp4_data) {
+    Mp4Writer writer(mp4_data);
+
+    size_t ftyp = writer.BeginBox("ftyp");
+    writer.WriteData((const uint8_t*)"isom", 4);
+    writer.Write4Bytes(0x200);
+    writer.WriteData((const uint8_t*)"isomavc1", 8);
+    writer.EndBox(ftyp);
+
+    //the moov size does not depend on the chunk offsets, write it twice for the mdat position
+    size_t moov_pos = mp4_data.size();
+    WriteMp4Moov(writer, frames, 0);
+    uint32_t mdat_offset = (uint32_t)mp4_data.size() + 8;
+    mp4_data.resize(moov_pos);
+    WriteMp4Moov(writer, frames, mdat_offset);
+
+    size_t mdat = writer.BeginBox("mdat");
+    for (auto& frame : frames) {
+        writer.WriteData(frame.avcc.data(), frame.avcc.size());
+    }
+    writer.EndBox(mdat);
+}
+
+static CppStreamerInterface* MakeBenchStreamer(const std::string& name, CppStreamerInterface* sinker) {
+    CppStreamerInterface* streamer = CppStreamerFactory::MakeStreamer(name);
+    if (!streamer) {
+        LogErrorf(s_logger, "make streamer %s error", name.c_str());
+        return nullptr;
+    }
+    streamer->SetLogger(s_logger);
+    streamer->AddSinker(sinker);
+    return streamer;
+}
+
+/*
+ * feed the packets to the streamer in batches, the packets of one batch
+ * are made before the timing, only the SourceData calls are timed.
+ */
+static int64_t FeedStreamer(CppStreamerInterface* streamer, std::vector<Media_Packet_Ptr>& seq_packets,
+        const std::vector<const SynthFrame*>& frames, bool avcc, int64_t& bytes) {
+    std::vector<Media_Packet_Ptr> batch;
+    int64_t cost_us = 0;
+
+    for (auto& pkt_ptr : seq_packets) {
+        streamer->SourceData(pkt_ptr);
+    }
+    for (size_t index = 0; index < frames.size(); index += BATCH_COUNT) {
+        size_t end = std::min(frames.size(), index + BATCH_COUNT);
+
+        batch.clear();
+        for (size_t pos = index; pos < end; pos++) {
+            const SynthFrame* frame = frames[pos];
+            const std::vector<uint8_t>& data = (avcc && frame->av_type == MEDIA_VIDEO_TYPE) ? frame->avcc : frame->annexb;
+
+            batch.push_back(MakeMediaPacket(frame->av_type, frame->codec_type, frame->dts, frame->key, data));
+            bytes += (int64_t)data.size();
+        }
+        int64_t start_us = now_microsec();
+        for (auto& pkt_ptr : batch) {
+            streamer->SourceData(pkt_ptr);
+        }
+        cost_us += now_microsec() - start_us;
+    }
+    return cost_us;
+}
+
+//the container data in chunks as it is read from a file or a socket
+static int64_t FeedChunks(CppStreamerInterface* streamer, const std::vector<uint8_t>& data, size_t chunk_size) {
+    std::vector<Media_Packet_Ptr> batch;
+    int64_t cost_us = 0;
+
+    for (size_t pos = 0; pos < data.size(); ) {
+        batch.clear();
+        for (int index = 0; index < BATCH_COUNT && pos < data.size(); index++) {
+            size_t len = std::min(chunk_size, data.size() - pos);
+            Media_Packet_Ptr pkt_ptr = std::make_shared<Media_Packet>(len);
+
+            pkt_ptr->buffer_ptr_->AppendData((char*)data.data() + pos, len);
+            batch.push_back(pkt_ptr);
+            pos += len;
+        }
+        int64_t start_us = now_microsec();
+        for (auto& pkt_ptr : batch) {
+            streamer->SourceData(pkt_ptr);
+        }
+        cost_us += now_microsec() - start_us;
+    }
+    return cost_us;
+}
+
+static int BenchMux(const std::string& name, const std::string& codec,
+        std::vector<Media_Packet_Ptr>& seq_packets, const std::vector<const SynthFrame*>& frames, bool avcc,
+        std::vector<uint8_t>* output, std::vector<BenchResult>& results) {
+    BenchSinker sinker(output);
+    CppStreamerInterface* muxer = MakeBenchStreamer(name, &sinker);
+    if (!muxer) {
+        return -1;
+    }
+    int64_t bytes   = 0;
+    int64_t cost_us = FeedStreamer(muxer, seq_packets, frames, avcc, bytes);
+
+    delete muxer;
+    if (sinker.count_ == 0) {
+        LogErrorf(s_logger, "%s(%s) has no output", name.c_str(), codec.c_str());
+        return -1;
+    }
+    results.push_back({name, codec, (int64_t)frames.size(), bytes, cost_us});
+    return 0;
+}
+
+static int BenchDemux(const std::string& name, const std::string& codec,
+        const std::vector<uint8_t>& data, size_t chunk_size, std::vector<BenchResult>& results) {
+    BenchSinker sinker(nullptr);
+    CppStreamerInterface* demuxer = MakeBenchStreamer(name, &sinker);
+    if (!demuxer) {
+        return -1;
+    }
+    int64_t cost_us = FeedChunks(demuxer, data, chunk_size);
+
+    delete demuxer;
+    if (sinker.count_ == 0) {
+        LogErrorf(s_logger, "%s(%s) has no output", name.c_str(), codec.c_str());
+        return -1;
+    }
+    results.push_back({name, codec, sinker.count_, (int64_t)data.size(), cost_us});
+    return 0;
+}
+
+//the mp4 demuxer reads the whole file by the io reader in one SourceData call
+static int BenchMp4Demux(const std::vector<uint8_t>& mp4_data, std::vector<BenchResult>& results) {
+    BenchSinker sinker(nullptr);
+    CppStreamerInterface* demuxer = MakeBenchStreamer("mp4demux", &sinker);
+    if (!demuxer) {
+        return -1;
+    }
+    MemoryIoReader reader(mp4_data);
+    Media_Packet_Ptr pkt_ptr = std::make_shared<Media_Packet>();
+    pkt_ptr->io_reader_ = &reader;
+
+    int64_t start_us = now_microsec();
+    demuxer->SourceData(pkt_ptr);
+    int64_t cost_us = now_microsec() - start_us;
+
+    delete demuxer;
+    if (sinker.count_ == 0) {
+        LogErrorf(s_logger, "mp4demux has no output");
+        return -1;
+    }
+    results.push_back({"mp4demux", "h264", sinker.count_, (int64_t)mp4_data.size(), cost_us});
+    return 0;
+}
+
+static void BenchNaluConvert(const std::vector<SynthFrame>& frames, std::vector<BenchResult>& results) {
+    std::vector<std::shared_ptr<DataBuffer>> nalus;
+    int64_t annexb_bytes = 0;
+    int64_t avcc_bytes   = 0;
+    int64_t annexb_us    = 0;
+    int64_t avcc_us      = 0;
+
+    for (auto& frame : frames) {
+        int64_t start_us = now_microsec();
+        nalus.clear();
+        AnnexB2Avcc((uint8_t*)frame.annexb.data(), frame.annexb.size(), nalus);
+        annexb_us += now_microsec() - start_us;
+        annexb_bytes += (int64_t)frame.annexb.size();
+
+        start_us = now_microsec();
+        nalus.clear();
+        Avcc2Nalus((uint8_t*)frame.avcc.data(), frame.avcc.size(), nalus);
+        avcc_us += now_microsec() - start_us;
+        avcc_bytes += (int64_t)frame.avcc.size();
+    }
+    results.push_back({"annexb2avcc", "h264", (int64_t)frames.size(), annexb_bytes, annexb_us});
+    results.push_back({"avcc2nalus", "h264", (int64_t)frames.size(), avcc_bytes, avcc_us});
+}
+
+//the parameter sets are aggregated before the keyframe as the webrtc senders do
+static void PacketizeFrames(RtpPacketizer& packetizer, const std::vector<SynthFrame>& frames) {
+    RtpNaluItem param_sets[4];
+
+    for (auto& frame : frames) {
+        uint32_t ts  = (uint32_t)(frame.dts * VIDEO_CLOCK_RATE / 1000);
+        uint8_t* data = (uint8_t*)frame.annexb.data();
+        size_t count = 0;
+
+        for (size_t index = 0; index < frame.nalus.size(); index++) {
+            const SynthNalu& nalu = frame.nalus[index];
+
+            if (nalu.param_set) {
+                param_sets[count++] = {data + nalu.offset, nalu.len};
+                continue;
+            }
+            if (count > 0) {
+                packetizer.PacketizeAggregate(param_sets, count, ts);
+                count = 0;
+            }
+            packetizer.Packetize(data + nalu.offset, nalu.len, ts, index == (frame.nalus.size() - 1));
+        }
+    }
+}
+
+static void BenchPacketize(const std::string& codec, const std::vector<SynthFrame>& frames,
+        std::vector<RecordPacket>* records, std::vector<BenchResult>& results) {
+    RtpBenchSink sink(nullptr);
+    std::unique_ptr<RtpPacketizer> packetizer;
+
+    if (codec == "h264") {
+        packetizer.reset(new RtpH264Packetizer(&sink));
+    } else if (codec == "h265") {
+        packetizer.reset(new RtpH265Packetizer(&sink));
+    } else {
+        packetizer.reset(new RtpOpusPacketizer(&sink));
+    }
+    bool is_audio = (codec == "opus");
+    packetizer->SetHeader(is_audio ? AUDIO_PT : VIDEO_PT, is_audio ? AUDIO_SSRC : VIDEO_SSRC, nullptr);
+
+    int64_t bytes    = 0;
+    int64_t start_us = now_microsec();
+    if (is_audio) {
+        for (auto& frame : frames) {
+            uint32_t ts = (uint32_t)(frame.dts * 48);
+            packetizer->Packetize((uint8_t*)frame.annexb.data(), frame.annexb.size(), ts, true);
+        }
+    } else {
+        PacketizeFrames(*packetizer, frames);
+    }
+    int64_t cost_us = now_microsec() - start_us;
+
+    for (auto& frame : frames) {
+        bytes += (int64_t)frame.annexb.size();
+    }
+    results.push_back({"rtp_packetize", codec, sink.count_, bytes, cost_us});
+
+    if (records) {
+        RtpBenchSink record_sink(records);
+        RtpH264Packetizer record_packetizer(&record_sink);
+
+        record_packetizer.SetHeader(VIDEO_PT, VIDEO_SSRC, nullptr);
+        PacketizeFrames(record_packetizer, frames);
+    }
+}
+
+static int BenchDepacketize(const std::vector<RecordPacket>& packets, std::vector<BenchResult>& results) {
+    DepacketizeSink sink;
+    RtpPacketPool pool;
+    std::unique_ptr<PackHandleH264> pack(new PackHandleH264(&sink, uv_default_loop(), s_logger));
+    int64_t bytes = 0;
+    int64_t extend_seq = 0;
+
+    int64_t start_us = now_microsec();
+    for (auto& pkt : packets) {
+        RtpPacketInfo* pkt_info = pool.Get();
+        try {
+            pkt_info->Load(pkt.data(), pkt.size());
+        } catch(CppStreamException& e) {
+            pkt_info->Release();
+            continue;
+        }
+        pkt_info->media_type_ = MEDIA_VIDEO_TYPE;
+        pkt_info->clock_rate_ = VIDEO_CLOCK_RATE;
+        pkt_info->extend_seq_ = extend_seq++;
+        pack->InputRtpPacket(pkt_info);
+        bytes += (int64_t)pkt.size();
+    }
+    int64_t cost_us = now_microsec() - start_us;
+
+    if (sink.frame_count_ == 0 || sink.lost_count_ > 0) {
+        LogErrorf(s_logger, "rtp depacketize frames:%ld, lost reports:%ld", sink.frame_count_, sink.lost_count_);
+        return -1;
+    }
+    results.push_back({"rtp_depacketize", "h264", (int64_t)packets.size(), bytes, cost_us});
+    return 0;
+}
+
+//protect the recorded packets in place in batches, the copy into the batch is not timed
+static void BenchSrtp(const std::vector<RecordPacket>& packets, std::vector<BenchResult>& results) {
+    typedef struct {
+        CRYPTO_SUITE_ENUM suite;
+        const char* name;
+        size_t key_len;
+    } BenchSuite;
+    const BenchSuite suites[] = {
+        { CRYPTO_SUITE_AES_CM_128_HMAC_SHA1_80, "AES_CM_128_HMAC_SHA1_80", 30 },
+        { CRYPTO_SUITE_AEAD_AES_128_GCM,        "AEAD_AES_128_GCM",        28 }
+    };
+    std::vector<uint8_t> batch_data(BATCH_COUNT * RTP_PACKET_BUFFER_SIZE);
+    size_t batch_lens[BATCH_COUNT];
+
+    SRtpSession::Init(s_logger);
+    for (auto& item : suites) {
+        std::vector<uint8_t> key(item.key_len);
+        for (auto& byte : key) {
+            byte = (uint8_t)(rand() & 0xff);
+        }
+        SRtpSession session(SRTP_SESSION_OUT_TYPE, item.suite, key.data(), key.size());
+        int64_t bytes   = 0;
+        int64_t cost_us = 0;
+
+        for (size_t index = 0; index < packets.size(); index += BATCH_COUNT) {
+            size_t count = std::min(packets.size() - index, (size_t)BATCH_COUNT);
+
+            for (size_t pos = 0; pos < count; pos++) {
+                const RecordPacket& pkt = packets[index + pos];
+                memcpy(&batch_data[pos * RTP_PACKET_BUFFER_SIZE], pkt.data(), pkt.size());
+                batch_lens[pos] = pkt.size();
+                bytes += (int64_t)pkt.size();
+            }
+            int64_t start_us = now_microsec();
+            for (size_t pos = 0; pos < count; pos++) {
+                uint8_t* data = &batch_data[pos * RTP_PACKET_BUFFER_SIZE];
+                session.ProtectRtp(&data, &batch_lens[pos], RTP_PACKET_BUFFER_SIZE);
+            }
+            cost_us += now_microsec() - start_us;
+        }
+        results.push_back({"srtp_protect", item.name, (int64_t)packets.size(), bytes, cost_us});
+    }
+}
+
+//the rtmp connect command, it is encoded and decoded as the rtmp handshake does
+static void BenchAmf0(int count, std::vector<BenchResult>& results) {
+    std::map<std::string, AMF_ITERM*> amf_obj;
+    auto add_string = [&amf_obj](const std::string& key, const std::string& value) {
+        AMF_ITERM* item = new AMF_ITERM();
+        item->SetAmfType(AMF_DATA_TYPE_STRING);
+        item->desc_str_ = value;
+        amf_obj[key] = item;
+    };
+    auto add_number = [&amf_obj](const std::string& key, double value) {
+        AMF_ITERM* item = new AMF_ITERM();
+        item->SetAmfType(AMF_DATA_TYPE_NUMBER);
+        item->number_ = value;
+        amf_obj[key] = item;
+    };
+    add_string("app", "live");
+    add_string("type", "nonprivate");
+    add_string("flashVer", "FMLE/3.0 (compatible; FMSc/1.0)");
+    add_string("swfUrl", "rtmp://127.0.0.1:1935/live");
+    add_string("tcUrl", "rtmp://127.0.0.1:1935/live");
+    add_number("capabilities", 239);
+    add_number("audioCodecs", 3575);
+    add_number("videoCodecs", 252);
+    add_number("videoFunction", 1);
+    AMF_ITERM* fpad = new AMF_ITERM();
+    fpad->SetAmfType(AMF_DATA_TYPE_BOOL);
+    fpad->enable_ = false;
+    amf_obj["fpad"] = fpad;
+
+    DataBuffer buffer;
+    int64_t bytes    = 0;
+    int64_t start_us = now_microsec();
+    for (int index = 0; index < count; index++) {
+        buffer.Reset();
+        AMF_Encoder::Encode(std::string("connect"), buffer);
+        AMF_Encoder::Encode((double)(index + 1), buffer);
+        AMF_Encoder::Encode(amf_obj, buffer);
+        bytes += buffer.DataLen();
+    }
+    int64_t encode_us = now_microsec() - start_us;
+
+    int64_t decode_count = 0;
+    start_us = now_microsec();
+    for (int index = 0; index < count; index++) {
+        uint8_t* data = (uint8_t*)buffer.Data();
+        int left_len  = (int)buffer.DataLen();
+
+        while (left_len > 0) {
+            AMF_ITERM amf_item;
+            if (AMF_Decoder::Decode(data, left_len, amf_item) < 0) {
+                break;
+            }
+            decode_count++;
+        }
+    }
+    int64_t decode_us = now_microsec() - start_us;
+
+    for (auto& iter : amf_obj) {
+        delete iter.second;
+    }
+    results.push_back({"amf0_encode", "connect", count, bytes, encode_us});
+    results.push_back({"amf0_decode", "connect", count, (int64_t)buffer.DataLen() * count, decode_us});
+    if (decode_count != (int64_t)count * 3) {
+        LogErrorf(s_logger, "amf0 decode items:%ld, expect:%ld", decode_count, (int64_t)count * 3);
+    }
+}
+
+static void WriteJson(FILE* file_p, const BenchConfig& config, const std::vector<BenchResult>& results) {
+    fprintf(file_p, "{\n");
+    fprintf(file_p, "  \"bench\": \"cpp_streamer_bench\",\n");
+    fprintf(file_p, "  \"config\": {\"frames\": %d, \"gop\": %d, \"key_frame_size\": %lu, \"delta_frame_size\": %lu, "
+            "\"audio_frame_size\": %lu, \"chunk_size\": %lu, \"amf_count\": %d},\n",
+            config.frame_count, config.gop, config.key_frame_size, config.delta_frame_size,
+            config.audio_frame_size, config.chunk_size, config.amf_count);
+    fprintf(file_p, "  \"results\": [\n");
+    for (size_t index = 0; index < results.size(); index++) {
+        const BenchResult& result = results[index];
+        double seconds = (double)std::max(result.cost_us, (int64_t)1) / 1000000.0;
+
+        fprintf(file_p, "    {\"name\": \"%s\", \"codec\": \"%s\", \"packets\": %ld, \"bytes\": %ld, "
+                "\"seconds\": %.6f, \"mb_per_s\": %.2f, \"packets_per_s\": %.0f}%s\n",
+                result.name.c_str(), result.codec.c_str(), result.packets, result.bytes,
+                seconds, (double)result.bytes / seconds / (1024.0 * 1024.0), (double)result.packets / seconds,
+                (index + 1 < results.size()) ? "," : "");
+    }
+    fprintf(file_p, "  ]\n");
+    fprintf(file_p, "}\n");
+}
+
+/*
+ * synthetic h264/h265/aac/opus access units in memory, no file or network:
+ * flvmux --> flvdemux, mpegtsmux --> mpegtsdemux, mp4 in memory --> mp4demux,
+ * annexb/avcc conversion, rtp packetize --> depacketize, srtp protect, amf0 encode/decode
+ */
+static int RunBench(const BenchConfig& config, std::vector<BenchResult>& results) {
+    std::vector<SynthFrame> h264_frames;
+    std::vector<SynthFrame> h265_frames;
+    std::vector<SynthFrame> aac_frames;
+    std::vector<SynthFrame> opus_frames;
+
+    MakeVideoFrames(config, MEDIA_CODEC_H264, h264_frames);
+    MakeVideoFrames(config, MEDIA_CODEC_H265, h265_frames);
+    int64_t duration_ms = h264_frames.back().dts + 1000 / FRAME_RATE;
+    MakeAudioFrames(config, MEDIA_CODEC_AAC, duration_ms, aac_frames);
+    MakeAudioFrames(config, MEDIA_CODEC_OPUS, duration_ms, opus_frames);
+
+    std::vector<const SynthFrame*> h264_aac;
+    std::vector<const SynthFrame*> h265_opus;
+    Interleave(h264_frames, aac_frames, h264_aac);
+    Interleave(h265_frames, opus_frames, h265_opus);
+
+    std::vector<uint8_t> asc(AAC_ASC, AAC_ASC + sizeof(AAC_ASC));
+    std::vector<uint8_t> hvcc;
+    MakeHvcC(hvcc);
+
+    std::vector<uint8_t> flv_data;
+    std::vector<Media_Packet_Ptr> flv_seq = {
+        MakeSeqPacket(MEDIA_AUDIO_TYPE, MEDIA_CODEC_AAC, asc)
+    };
+    if (BenchMux("flvmux", "h264+aac", flv_seq, h264_aac, false, &flv_data, results) < 0) {
+        return -1;
+    }
+    if (BenchDemux("flvdemux", "h264+aac", flv_data, config.chunk_size, results) < 0) {
+        return -1;
+    }
+
+    std::vector<uint8_t> ts_data;
+    std::vector<Media_Packet_Ptr> ts_seq = {
+        MakeSeqPacket(MEDIA_AUDIO_TYPE, MEDIA_CODEC_AAC, asc)
+    };
+    if (BenchMux("mpegtsmux", "h264+aac", ts_seq, h264_aac, false, &ts_data, results) < 0) {
+        return -1;
+    }
+    std::vector<Media_Packet_Ptr> ts_hevc_seq = {
+        MakeSeqPacket(MEDIA_VIDEO_TYPE, MEDIA_CODEC_H265, hvcc)
+    };
+    if (BenchMux("mpegtsmux", "h265+opus", ts_hevc_seq, h265_opus, true, nullptr, results) < 0) {
+        return -1;
+    }
+    //the mpegts demuxer takes the whole ts packets only
+    size_t ts_chunk_size = std::max(config.chunk_size / 188, (size_t)1) * 188;
+    if (BenchDemux("mpegtsdemux", "h264+aac", ts_data, ts_chunk_size, results) < 0) {
+        return -1;
+    }
+
+    std::vector<uint8_t> mp4_data;
+    MakeMp4File(h264_frames, mp4_data);
+    if (BenchMp4Demux(mp4_data, results) < 0) {
+        return -1;
+    }
+
+    BenchNaluConvert(h264_frames, results);
+
+    std::vector<RecordPacket> rtp_packets;
+    BenchPacketize("h264", h264_frames, &rtp_packets, results);
+    BenchPacketize("h265", h265_frames, nullptr, results);
+    BenchPacketize("opus", opus_frames, nullptr, results);
+    if (BenchDepacketize(rtp_packets, results) < 0) {
+        return -1;
+    }
+    BenchSrtp(rtp_packets, results);
+
+    BenchAmf0(config.amf_count, results);
+    return 0;
+}
+
+int main(int argc, char** argv) {
+    BenchConfig config = {
+        .frame_count      = 3000,
+        .gop              = 60,
+        .key_frame_size   = 60000,
+        .delta_frame_size = 8000,
+        .audio_frame_size = 256,
+        .chunk_size       = 64 * 1024,
+        .amf_count        = 100000
+    };
+    char output_name[128];
+    bool output_name_ready = false;
+    int opt = 0;
+
+    while ((opt = getopt(argc, argv, "n:g:k:d:a:c:m:o:h")) != -1) {
+        switch (opt) {
+            case 'n': config.frame_count      = atoi(optarg); break;
+            case 'g': config.gop              = atoi(optarg); break;
+            case 'k': config.key_frame_size   = (size_t)atoi(optarg); break;
+            case 'd': config.delta_frame_size = (size_t)atoi(optarg); break;
+            case 'a': config.audio_frame_size = (size_t)atoi(optarg); break;
+            case 'c': config.chunk_size       = (size_t)atoi(optarg); break;
+            case 'm': config.amf_count        = atoi(optarg); break;
+            case 'o': strncpy(output_name, optarg, sizeof(output_name)); output_name_ready = true; break;
+            case 'h':
+            default:
+            {
+                printf("Usage: %s [-n video frame count, default 3000, 30fps]\n\
+    [-g gop, default 60]\n\
+    [-k key frame size, default 60000]\n\
+    [-d delta frame size, default 8000]\n\
+    [-a audio frame size, default 256]\n\
+    [-c demux input chunk size, default 65536]\n\
+    [-m amf0 message count, default 100000]\n\
+    [-o output json file, default stdout]\n",
+                    argv[0]);
+                return -1;
+            }
+        }
+    }
+
+    if (config.frame_count <= 0 || config.gop <= 0 || config.amf_count <= 0 || config.chunk_size == 0
+        || config.key_frame_size < 16 || config.delta_frame_size < 16 || config.audio_frame_size < 16) {
+        std::cout << "bench config error.\r\n";
+        return -1;
+    }
+
+    s_logger = new Logger();
+    s_logger->SetLevel(LOGGER_ERROR_LEVEL);
+
+    CppStreamerFactory::SetLogger(s_logger);
+    CppStreamerFactory::SetLibPath("./output/lib");
+
+    std::vector<BenchResult> results;
+    int ret = RunBench(config, results);
+    CppStreamerFactory::ReleaseAll();
+    if (ret < 0) {
+        std::cout << "cpp streamer bench error.\r\n";
+        delete s_logger;
+        return -1;
+    }
+
+    FILE* file_p = output_name_ready ? fopen(output_name, "wb") : stdout;
+    if (!file_p) {
+        std::cout << "open output file error.\r\n";
+        delete s_logger;
+        return -1;
+    }
+    WriteJson(file_p, config, results);
+    if (file_p != stdout) {
+        fclose(file_p);
+    }
+    delete s_logger;
+    return 0;
+}
@@ -0,0 +1,383 @@
+#include "logger.hpp"
+#include "peerconnection.hpp"
+#include "dtls.hpp"
+#include "udp_client.hpp"
+#include "timer.hpp"
+#include "timeex.hpp"
+
+#include <iostream>
+#include <uv.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+using namespace cpp_streamer;
+
+static Logger* s_logger = nullptr;
+static const int DEF_SESSION_COUNT = 200;
+static const int DEF_CONCURRENCY   = 16;
+static const int64_t HANDSHAKE_TIMEOUT_MS = 5000;
+static const uint32_t CHECK_INTERVAL_MS   = 5;//release the finished sessions and start the next
+
+class BenchStateReport : public PCStateReportI
+{
+public:
+    virtual void OnState(const std::string& type, const std::string& value) override {
+    }
+};
+
+class DtlsEndpointCallbackI
+{
+public:
+    virtual void OnEndpointConnected() = 0;
+};
+
+/*
+ * one side of the dtls session: RtcDtls on a loopback udp socket,
+ * the datagrams read are fed to the dtls.
+ */
+class DtlsEndpoint : public UdpSessionCallbackI, public RtcDtlsCallbackI
+{
+public:
+    DtlsEndpoint(uv_loop_t* loop, DTLS_ROLE role, DtlsEndpointCallbackI* cb):dtls_(this, s_logger)
+                                                                           , cb_(cb)
+    {
+        udp_client_ = new UdpClient(loop, this, s_logger, "127.0.0.1", 0);
+        dtls_.role_       = role;
+        dtls_.udp_client_ = udp_client_;
+    }
+    virtual ~DtlsEndpoint()
+    {
+        //the handle is closed in the loop, the session is deleted in its close callback
+        udp_client_->CloseAndDelete();
+        udp_client_ = nullptr;
+    }
+
+public:
+    int Init() {
+        if (dtls_.SslContextInit() < 0) {
+            return -1;
+        }
+        udp_client_->TryRead();
+        return 0;
+    }
+
+    uint16_t GetLocalPort() {
+        uint16_t port = 0;
+        udp_client_->GetLocalAddress(port);
+        return ntohs(port);
+    }
+
+    void SetRemotePort(uint16_t port) {
+        dtls_.remote_address_ = UdpTuple("127.0.0.1", port);
+    }
+
+    int Start() { return dtls_.DtlsStart(); }
+    void CheckTimeout() { dtls_.CheckTimeout(); }
+    bool IsConnected() { return connected_; }
+
+protected:
+    virtual void OnWrite(size_t sent_size, UdpTuple address) override {
+    }
+
+    virtual void OnRead(const char* data, size_t data_size, UdpTuple address) override {
+        if (RtcDtls::IsDtls((const uint8_t*)data, data_size)) {
+            dtls_.OnDtlsData((uint8_t*)data, (int)data_size);
+        }
+    }
+
+    virtual void OnDtlsConnected(CRYPTO_SUITE_ENUM suite,
+                uint8_t* local_key, size_t local_key_len,
+                uint8_t* remote_key, size_t remote_key_len) override {
+        if (connected_) {
+            return;
+        }
+        connected_ = true;
+        cb_->OnEndpointConnected();
+    }
+
+private:
+    RtcDtls dtls_;
+    DtlsEndpointCallbackI* cb_ = nullptr;
+    UdpClient* udp_client_     = nullptr;
+    bool connected_ = false;
+};
+
+class DtlsSessionCallbackI
+{
+public:
+    virtual void OnSessionDone(int64_t handshake_us) = 0;
+};
+
+/*
+ * the client and the server endpoints of one handshake, it is done when
+ * both sides have exported the srtp keys.
+ */
+class DtlsSession : public DtlsEndpointCallbackI
+{
+public:
+    DtlsSession(uv_loop_t* loop, DtlsSessionCallbackI* cb):cb_(cb)
+                                                          , client_(loop, ROLE_CLIENT, this)
+                                                          , server_(loop, ROLE_SERVER, this)
+    {
+    }
+    virtual ~DtlsSession()
+    {
+    }
+
+public:
+    int Start() {
+        start_us_ = now_microsec();
+        if (client_.Init() < 0 || server_.Init() < 0) {
+            return -1;
+        }
+        client_.SetRemotePort(server_.GetLocalPort());
+        server_.SetRemotePort(client_.GetLocalPort());
+
+        //the server waits for the ClientHello which the client sends at start
+        if (server_.Start() < 0 || client_.Start() < 0) {
+            return -1;
+        }
+        return 0;
+    }
+
+    bool IsDone() { return done_; }
+    int64_t GetStartUs() { return start_us_; }
+
+    void CheckTimeout() {
+        client_.CheckTimeout();
+        server_.CheckTimeout();
+    }
+
+protected:
+    virtual void OnEndpointConnected() override {
+        if (done_ || !client_.IsConnected() || !server_.IsConnected()) {
+            return;
+        }
+        done_ = true;
+        cb_->OnSessionDone(now_microsec() - start_us_);
+    }
+
+private:
+    DtlsSessionCallbackI* cb_ = nullptr;
+    DtlsEndpoint client_;
+    DtlsEndpoint server_;
+    int64_t start_us_ = 0;
+    bool done_        = false;
+};
+
+/*
+ * the dtls handshakes between two endpoints in the process over the loopback:
+ * every session makes its keys(SslContextInit), completes the handshake and
+ * exports the srtp keys on both sides, up to concurrency sessions are in flight.
+ * the next session is started when one is done, the timer releases the done ones.
+ */
+class DtlsHandshakeBench : public TimerInterface, public DtlsSessionCallbackI
+{
+public:
+    DtlsHandshakeBench(uv_loop_t* loop, int session_count, int concurrency):TimerInterface(loop, CHECK_INTERVAL_MS, true)
+                                                                          , loop_(loop)
+                                                                          , session_count_(session_count)
+                                                                          , concurrency_(concurrency)
+    {
+    }
+    virtual ~DtlsHandshakeBench()
+    {
+        StopTimer();
+        for (auto session : sessions_) {
+            delete session;
+        }
+        sessions_.clear();
+    }
+
+public:
+    //return the sessions established per second
+    double Run() {
+        start_us_ = now_microsec();
+        StartSessions();
+        StartTimer();
+        uv_run(loop_, UV_RUN_DEFAULT);
+
+        int64_t cost_us = end_us_ - start_us_;
+        if (cost_us <= 0) {
+            return 0.0;
+        }
+        return (double)established_ * 1000000.0 / (double)cost_us;
+    }
+
+    int GetEstablished() { return established_; }
+    int GetFailed() { return failed_; }
+    double GetAvgHandshakeMs() {
+        return established_ > 0 ? (double)handshake_us_ / established_ / 1000.0 : 0.0;
+    }
+
+protected:
+    //in the dtls callback of the session, it is not released here
+    virtual void OnSessionDone(int64_t handshake_us) override {
+        established_++;
+        handshake_us_ += handshake_us;
+        in_flight_--;
+        end_us_ = now_microsec();
+        StartSessions();
+    }
+
+    virtual void OnTimer() override {
+        int64_t now_us = now_microsec();
+
+        for (size_t index = 0; index < sessions_.size();) {
+            DtlsSession* session = sessions_[index];
+
+            if (!session->IsDone()) {
+                if (now_us - session->GetStartUs() <= HANDSHAKE_TIMEOUT_MS * 1000) {
+                    session->CheckTimeout();
+                    index++;
+                    continue;
+                }
+                failed_++;
+                in_flight_--;
+            }
+            delete session;
+            sessions_[index] = sessions_.back();
+            sessions_.pop_back();
+        }
+        StartSessions();
+        if (sessions_.empty()) {
+            if (end_us_ == 0) {
+                end_us_ = now_us;
+            }
+            StopTimer();
+            uv_stop(loop_);
+        }
+    }
+
+private:
+    void StartSessions() {
+        while (started_ < session_count_ && in_flight_ < concurrency_) {
+            DtlsSession* session = new DtlsSession(loop_, this);
+
+            started_++;
+            if (session->Start() < 0) {
+                std::cout << "dtls session start error\r\n";
+                failed_++;
+                delete session;
+                continue;
+            }
+            in_flight_++;
+            sessions_.push_back(session);
+        }
+    }
+
+private:
+    uv_loop_t* loop_    = nullptr;
+    int session_count_  = 0;
+    int concurrency_    = 0;
+    std::vector<DtlsSession*> sessions_;
+    int started_        = 0;
+    int in_flight_      = 0;
+    int established_    = 0;
+    int failed_         = 0;
+    int64_t start_us_   = 0;
+    int64_t end_us_     = 0;
+    int64_t handshake_us_ = 0;
+};
+
+/*
+ * create the PeerConnections and generate the offer sdp as the whip/whep
+ * streamers do at startup, return the setups per second.
+ */
+static double RunSetup(uv_loop_t* loop, int session_count, int64_t rotate_ms) {
+    BenchStateReport report;
+    std::vector<PeerConnection*> pcs;
+
+    RtcDtlsIdentity::SetRotateInterval(rotate_ms);
+
+    int64_t start_us = now_microsec();
+    for (int index = 0; index < session_count; index++) {
+        PeerConnection* pc = new PeerConnection(loop, s_logger, &report);
+        std::string sdp = pc->CreateOfferSdp(RECV_ONLY);
+        if (sdp.empty()) {
+            std::cout << "create offer sdp error\r\n";
+            delete pc;
+            break;
+        }
+        pcs.push_back(pc);
+    }
+    int64_t cost_us = now_microsec() - start_us;
+
+    for (auto pc : pcs) {
+        delete pc;
+    }
+    uv_run(loop, UV_RUN_NOWAIT);
+
+    if (cost_us <= 0 || pcs.empty()) {
+        return 0.0;
+    }
+    return (double)pcs.size() * 1000000.0 / (double)cost_us;
+}
+
+static void RunHandshake(uv_loop_t* loop, int session_count, int concurrency,
+        int64_t rotate_ms, const char* name) {
+    RtcDtlsIdentity::SetRotateInterval(rotate_ms);
+
+    DtlsHandshakeBench* bench = new DtlsHandshakeBench(loop, session_count, concurrency);
+    double rate = bench->Run();
+
+    printf("  %s: %.1f sessions established/sec, handshake avg:%.2fms, established:%d, failed:%d\r\n",
+            name, rate, bench->GetAvgHandshakeMs(), bench->GetEstablished(), bench->GetFailed());
+    delete bench;
+    //the udp handles are closed
+    uv_run(loop, UV_RUN_NOWAIT);
+}
+
+int main(int argc, char** argv) {
+    int opt = 0;
+    int session_count = DEF_SESSION_COUNT;
+    int concurrency   = DEF_CONCURRENCY;
+    int64_t rotate_ms = DTLS_IDENTITY_ROTATE_MS;
+
+    while ((opt = getopt(argc, argv, "n:c:r:h")) != -1) {
+        switch (opt) {
+            case 'n': session_count = atoi(optarg); break;
+            case 'c': concurrency = atoi(optarg); break;
+            case 'r': rotate_ms = atoll(optarg); break;
+            case 'h':
+            default:
+            {
+                printf("Usage: %s [-n session count, default %d]\n\
+    [-c handshakes in flight, default %d]\n\
+    [-r dtls identity rotate interval in ms, default one day]\n",
+                    argv[0], DEF_SESSION_COUNT, DEF_CONCURRENCY);
+                return -1;
+            }
+        }
+    }
+
+    if (session_count <= 0 || concurrency <= 0) {
+        std::cout << "please input session count and concurrency.\r\n";
+        return -1;
+    }
+
+    s_logger = new Logger();
+    s_logger->SetLevel(LOGGER_ERROR_LEVEL);
+
+    uv_loop_t* loop = uv_default_loop();
+
+    double per_session = RunSetup(loop, session_count, 0);
+    double shared      = RunSetup(loop, session_count, rotate_ms);
+
+    printf("dtls startup sessions:%d, handshakes in flight:%d\r\n", session_count, concurrency);
+    printf("peer connection setup(identity and offer sdp, no handshake):\r\n");
+    printf("  identity per session: %.1f setups/sec\r\n", per_session);
+    printf("  shared identity     : %.1f setups/sec (rotate %lldms)\r\n",
+            shared, (long long)rotate_ms);
+
+    printf("dtls handshake on the loopback(both sides, srtp keys exported):\r\n");
+    RunHandshake(loop, session_count, concurrency, 0, "identity per session");
+    RunHandshake(loop, session_count, concurrency, rotate_ms, "shared identity     ");
+
+    delete s_logger;
+    return 0;
+}
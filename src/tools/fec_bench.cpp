@@ -0,0 +1,353 @@
+#include "logger.hpp"
+#include "flexfec.hpp"
+#include "rtp_packetizer.hpp"
+#include "rtprtcp_pub.hpp"
+#include "byte_stream.hpp"
+
+#include <iostream>
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+using namespace cpp_streamer;
+
+static Logger* s_logger = nullptr;
+static const uint32_t VIDEO_SSRC  = 0x11223344;
+static const uint32_t FEC_SSRC    = 0x55667788;
+static const uint8_t VIDEO_PT     = 106;
+static const uint8_t FEC_PT       = 108;
+static const int VIDEO_CLOCK_RATE = 90000;
+static const size_t SENT_SLOTS    = 1024;
+
+static const int DEF_SECONDS      = 60;
+static const int DEF_FPS          = 30;
+static const int DEF_KBPS         = 2000;
+static const int DEF_GOP          = 60;
+static const int DEF_KEY_FACTOR   = 5;
+static const int DEF_RTT_MS       = 100;
+static const double s_def_losses[] = { 1.0, 3.0, 5.0, 10.0, 20.0 };
+
+typedef struct {
+    int seconds;
+    int fps;
+    int kbps;
+    int gop;
+    int rtt_ms;
+    int key_rate;
+    int delta_rate;
+    double burst;
+} BenchConfig;
+
+typedef struct {
+    uint8_t data[RTP_PACKET_MAX_SIZE];
+    size_t len;
+    bool is_fec;
+} BenchPacket;
+
+//the lost media packet: when the receiver sees the gap for the nack, and when fec recovers it
+typedef struct {
+    uint16_t seq;
+    double detect_ms;
+    double recover_ms;
+    bool valid;
+} LostInfo;
+
+typedef struct {
+    int64_t media;
+    int64_t fec;
+    int64_t lost;
+    int64_t recovered;
+    int64_t corrupt;
+    int64_t saved_count;
+    double saved_total_ms;
+    double saved_max_ms;
+} BenchResult;
+
+/*
+ * emulate the webrtc video sender and receiver without the network:
+ * frames --> h264 packetizer --> flexfec encoder --> lossy link(delay rtt/2) --> flexfec decoder,
+ * a lost packet costs rtt after the gap is found by nack, fec recovers it when the fec packet comes.
+ */
+class FecBench : public RtpPacketSinkI, public FlexFecSinkI, public FlexFecRecoverSinkI
+{
+public:
+    FecBench(const BenchConfig& config, double loss):config_(config)
+                                                    , loss_(loss / 100.0)
+                                                    , encoder_(this, s_logger)
+                                                    , decoder_(VIDEO_SSRC, this, s_logger)
+                                                    , packetizer_(this)
+    {
+        memset(&result_, 0, sizeof(result_));
+        sent_.resize(SENT_SLOTS);
+        lost_.resize(SENT_SLOTS);
+        for (auto& item : lost_) {
+            item.valid = false;
+        }
+        encoder_.SetHeader(FEC_PT, FEC_SSRC, VIDEO_SSRC, nullptr);
+        encoder_.SetProtectionRate(config.key_rate, config.delta_rate);
+        packetizer_.SetHeader(VIDEO_PT, VIDEO_SSRC, nullptr);
+
+        //gilbert-elliott: the bad state lasts burst packets on average
+        double burst = config.burst < 1.0 ? 1.0 : config.burst;
+        bad_to_good_ = 1.0 / burst;
+        good_to_bad_ = loss_ >= 1.0 ? 1.0 : loss_ * bad_to_good_ / (1.0 - loss_);
+    }
+    ~FecBench()
+    {
+    }
+
+public:
+    BenchResult Run() {
+        int frames = config_.seconds * config_.fps;
+        size_t frame_bytes = (size_t)config_.kbps * 1000 / 8 / config_.fps;
+        size_t delta_bytes = frame_bytes * config_.gop / (config_.gop - 1 + DEF_KEY_FACTOR);
+        std::vector<uint8_t> nalu(delta_bytes * DEF_KEY_FACTOR * 2);
+
+        for (auto& byte : nalu) {
+            byte = (uint8_t)(rand() & 0xff);
+        }
+        for (int index = 0; index < frames; index++) {
+            bool key_frame = (index % config_.gop) == 0;
+            size_t size = key_frame ? delta_bytes * DEF_KEY_FACTOR : delta_bytes;
+            //+-20% for the frame sizes
+            size = size * (80 + rand() % 41) / 100;
+            if (size < 2) {
+                size = 2;
+            }
+            nalu[0] = key_frame ? 0x65 : 0x41;
+
+            frame_packets_.clear();
+            uint32_t ts = (uint32_t)((int64_t)index * VIDEO_CLOCK_RATE / config_.fps);
+            encoder_.BeginFrame(key_frame);
+            packetizer_.Packetize(nalu.data(), size, ts, true);
+            encoder_.EndFrame();
+
+            SendFrame((double)index * 1000.0 / config_.fps);
+        }
+        return result_;
+    }
+
+protected:
+    virtual uint8_t* NewRtpPacket(uint16_t& seq) override {
+        seq = seq_++;
+        frame_packets_.emplace_back();
+        return frame_packets_.back().data;
+    }
+
+    virtual void OnRtpPacket(uint8_t* data, size_t len, uint16_t seq) override {
+        BenchPacket& pkt = frame_packets_.back();
+        pkt.len    = len;
+        pkt.is_fec = false;
+
+        BenchPacket& sent = sent_[seq % SENT_SLOTS];
+        memcpy(sent.data, data, len);
+        sent.len = len;
+
+        //the fec packets of a full group may be added to the frame packets here
+        encoder_.AddPacket(sent.data, len);
+        result_.media++;
+    }
+
+    virtual void OnFecPacket(uint8_t* data, size_t len, size_t capacity) override {
+        frame_packets_.emplace_back();
+        BenchPacket& pkt = frame_packets_.back();
+        memcpy(pkt.data, data, len);
+        pkt.len    = len;
+        pkt.is_fec = true;
+        result_.fec++;
+    }
+
+    virtual void OnRecoveredPacket(uint8_t* data, size_t len) override {
+        uint16_t seq = ByteStream::Read2Bytes(data + 2);
+        BenchPacket& sent = sent_[seq % SENT_SLOTS];
+        if (sent.len != len || memcmp(sent.data, data, len) != 0) {
+            result_.corrupt++;
+        }
+        LostInfo& info = lost_[seq % SENT_SLOTS];
+        if (!info.valid || info.seq != seq || info.recover_ms >= 0) {
+            return;
+        }
+        result_.recovered++;
+        info.recover_ms = now_ms_;
+        UpdateSaved(info);
+    }
+
+private:
+    //the packets of the frame are paced out at the bitrate
+    void SendFrame(double frame_ms) {
+        double send_ms = frame_ms > last_send_ms_ ? frame_ms : last_send_ms_;
+
+        for (auto& pkt : frame_packets_) {
+            send_ms += (double)pkt.len * 8 / config_.kbps;
+            now_ms_ = send_ms + config_.rtt_ms / 2.0;
+            if (IsLost()) {
+                if (!pkt.is_fec) {
+                    OnLost(ByteStream::Read2Bytes(pkt.data + 2));
+                }
+                continue;
+            }
+            if (pkt.is_fec) {
+                decoder_.OnFecPacket(pkt.data, pkt.len);
+                continue;
+            }
+            uint16_t seq = ByteStream::Read2Bytes(pkt.data + 2);
+            DetectGap(seq);
+            decoder_.OnMediaPacket(pkt.data, pkt.len);
+        }
+        last_send_ms_ = send_ms;
+    }
+
+    bool IsLost() {
+        double value = (double)rand() / RAND_MAX;
+        if (bad_state_) {
+            bad_state_ = value >= bad_to_good_;
+        } else {
+            bad_state_ = value < good_to_bad_;
+        }
+        return bad_state_;
+    }
+
+    void OnLost(uint16_t seq) {
+        LostInfo& info = lost_[seq % SENT_SLOTS];
+        info.seq        = seq;
+        info.detect_ms  = -1;
+        info.recover_ms = -1;
+        info.valid      = true;
+        pending_lost_.push_back(seq);
+        result_.lost++;
+    }
+
+    //the nack of the lost packets is sent when a later packet arrives
+    void DetectGap(uint16_t seq) {
+        size_t keep = 0;
+        for (size_t index = 0; index < pending_lost_.size(); index++) {
+            uint16_t lost_seq = pending_lost_[index];
+            if ((int16_t)(seq - lost_seq) <= 0) {
+                pending_lost_[keep++] = lost_seq;
+                continue;
+            }
+            LostInfo& info = lost_[lost_seq % SENT_SLOTS];
+            info.detect_ms = now_ms_;
+            UpdateSaved(info);
+        }
+        pending_lost_.resize(keep);
+    }
+
+    void UpdateSaved(LostInfo& info) {
+        if (info.detect_ms < 0 || info.recover_ms < 0) {
+            return;
+        }
+        double saved = info.detect_ms + config_.rtt_ms - info.recover_ms;
+        result_.saved_count++;
+        result_.saved_total_ms += saved;
+        result_.saved_max_ms = saved > result_.saved_max_ms ? saved : result_.saved_max_ms;
+    }
+
+private:
+    BenchConfig config_;
+    double loss_;
+    double good_to_bad_ = 0.0;
+    double bad_to_good_ = 1.0;
+    bool bad_state_     = false;
+
+private:
+    FlexFecEncoder encoder_;
+    FlexFecDecoder decoder_;
+    RtpH264Packetizer packetizer_;
+    uint16_t seq_ = 0;
+
+private:
+    std::vector<BenchPacket> frame_packets_;
+    std::vector<BenchPacket> sent_;
+    std::vector<LostInfo> lost_;
+    std::vector<uint16_t> pending_lost_;
+    double now_ms_       = 0.0;
+    double last_send_ms_ = 0.0;
+
+private:
+    BenchResult result_;
+};
+
+static void PrintResult(double loss, const BenchResult& result) {
+    double overhead  = result.media > 0 ? (double)result.fec * 100.0 / result.media : 0.0;
+    double recovered = result.lost > 0 ? (double)result.recovered * 100.0 / result.lost : 0.0;
+    double saved_avg = result.saved_count > 0 ? result.saved_total_ms / result.saved_count : 0.0;
+
+    printf("loss:%5.1f%% media:%8ld fec:%7ld(%5.1f%%) lost:%6ld fec recovered:%6ld(%5.1f%%) left for nack:%6ld, saved vs nack avg:%6.1fms max:%6.1fms, corrupt:%ld\r\n",
+            loss, result.media, result.fec, overhead, result.lost, result.recovered, recovered,
+            result.lost - result.recovered, saved_avg, result.saved_max_ms, result.corrupt);
+}
+
+int main(int argc, char** argv) {
+    int opt = 0;
+    double loss = -1.0;
+    BenchConfig config = {
+        .seconds    = DEF_SECONDS,
+        .fps        = DEF_FPS,
+        .kbps       = DEF_KBPS,
+        .gop        = DEF_GOP,
+        .rtt_ms     = DEF_RTT_MS,
+        .key_rate   = FEC_DEF_KEY_RATE,
+        .delta_rate = FEC_DEF_DELTA_RATE,
+        .burst      = 1.0
+    };
+
+    while ((opt = getopt(argc, argv, "l:b:r:k:d:s:f:v:g:h")) != -1) {
+        switch (opt) {
+            case 'l': loss = atof(optarg); break;
+            case 'b': config.burst = atof(optarg); break;
+            case 'r': config.rtt_ms = atoi(optarg); break;
+            case 'k': config.key_rate = atoi(optarg); break;
+            case 'd': config.delta_rate = atoi(optarg); break;
+            case 's': config.seconds = atoi(optarg); break;
+            case 'f': config.fps = atoi(optarg); break;
+            case 'v': config.kbps = atoi(optarg); break;
+            case 'g': config.gop = atoi(optarg); break;
+            case 'h':
+            default:
+            {
+                printf("Usage: %s [-l loss percent, default 1/3/5/10/20]\n\
+    [-b average burst loss length in packets, default 1]\n\
+    [-r rtt ms, default %d]\n\
+    [-k keyframe fec percent, default %d]\n\
+    [-d delta frame fec percent, default %d]\n\
+    [-s seconds, default %d] [-f fps, default %d]\n\
+    [-v video kbps, default %d] [-g gop frames, default %d]\n",
+                    argv[0], DEF_RTT_MS, FEC_DEF_KEY_RATE, FEC_DEF_DELTA_RATE,
+                    DEF_SECONDS, DEF_FPS, DEF_KBPS, DEF_GOP);
+                return -1;
+            }
+        }
+    }
+
+    if (config.seconds <= 0 || config.fps <= 0 || config.kbps <= 0
+        || config.gop <= 1 || config.rtt_ms < 0 || loss >= 100.0) {
+        std::cout << "please input the positive seconds, fps, kbps, gop(>1) and the loss under 100%.\r\n";
+        return -1;
+    }
+
+    s_logger = new Logger();
+    s_logger->SetLevel(LOGGER_ERROR_LEVEL);
+
+    printf("flexfec bench, %ds %dfps %dkbps gop:%d, rtt:%dms, burst:%.1f, fec keyframe:%d%% delta frame:%d%%\r\n",
+            config.seconds, config.fps, config.kbps, config.gop, config.rtt_ms,
+            config.burst, config.key_rate, config.delta_rate);
+    srand(1);
+    if (loss >= 0) {
+        FecBench bench(config, loss);
+        PrintResult(loss, bench.Run());
+    } else {
+        for (double item : s_def_losses) {
+            FecBench bench(config, item);
+            PrintResult(item, bench.Run());
+        }
+    }
+
+    delete s_logger;
+    return 0;
+}
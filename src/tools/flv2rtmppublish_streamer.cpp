@@ -32,6 +32,8 @@ public:
 
     int MakeStreamers(uv_loop_t* loop_handle) {
         loop_ = loop_handle;
+        metrics_registry_.EnablePipelineLatency(true);
+
         flvdemux_streamer_ = CppStreamerFactory::MakeStreamer("flvdemux");
         if (!flvdemux_streamer_) {
             LogErrorf(logger_, "make streamer flvdemux error");
@@ -42,6 +44,7 @@ public:
         flvdemux_streamer_->SetLogger(logger_);
         flvdemux_streamer_->AddOption("re", "true");
         flvdemux_streamer_->SetReporter(this);
+        flvdemux_streamer_->SetMetrics(&metrics_registry_);
  
         rtmppublish_streamer_ = CppStreamerFactory::MakeStreamer("rtmppublish");
         if (!rtmppublish_streamer_) {
@@ -51,6 +54,7 @@ public:
         LogInfof(logger_, "make rtmppublish streamer:%p, name:%s", rtmppublish_streamer_, rtmppublish_streamer_->StreamerName().c_str());
         rtmppublish_streamer_->SetLogger(logger_);
         rtmppublish_streamer_->SetReporter(this);
+        rtmppublish_streamer_->SetMetrics(&metrics_registry_);
         rtmppublish_streamer_->StartNetwork(dst_url_, loop_handle);
 
         flvdemux_streamer_->AddSinker(rtmppublish_streamer_);
@@ -131,6 +135,7 @@ protected:
         } while (read_n > 0);
         fclose(file_p);
         LogInfof(logger_, "flv read is over...");
+        LogWarnf(logger_, "pipeline latency:\n%s", metrics_registry_.DumpPipelineLatency().c_str());
         uv_loop_close(loop_);
     }
 
@@ -145,6 +150,7 @@ private:
     Logger* logger_ = nullptr;
     CppStreamerInterface* rtmppublish_streamer_ = nullptr;
     CppStreamerInterface* flvdemux_streamer_    = nullptr;
+    MetricsRegistry metrics_registry_;
 };
 
 int main(int argc, char** argv) {
@@ -0,0 +1,505 @@
+#include "logger.hpp"
+#include "cpp_streamer_factory.hpp"
+#include "tcp_client.hpp"
+#include "timer.hpp"
+#include "timeex.hpp"
+#include "latency_stats.hpp"
+
+#include <iostream>
+#include <uv.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <sstream>
+#include <unistd.h>
+#include <sys/resource.h>
+#include <signal.h>
+#include <chrono>
+#include <thread>
+#include <memory>
+#include <vector>
+#include <atomic>
+
+using namespace cpp_streamer;
+
+static Logger* s_logger = nullptr;
+static const int BENCH_MAX = 20000;
+static const size_t VIEWERS_INTERVAL = 100;//viewers connected per 10ms
+
+/*
+ * one http-flv viewer on the client loop: GET the stream and count the bytes,
+ * a slow viewer never reads after the request, and should be evicted by the server.
+ */
+class FlvViewer : public TcpClientCallback
+{
+public:
+    FlvViewer(uv_loop_t* loop, const std::string& host, uint16_t port,
+            const std::string& path, bool slow):host_(host)
+                                              , port_(port)
+                                              , path_(path)
+                                              , slow_(slow)
+    {
+        client_ = new TcpClient(loop, this, s_logger);
+    }
+    virtual ~FlvViewer()
+    {
+        if (client_) {
+            delete client_;
+            client_ = nullptr;
+        }
+    }
+
+public:
+    void Start() {
+        start_ms_ = now_millisec();
+        try {
+            client_->Connect(host_, port_);
+        } catch(CppStreamException& e) {
+            LogErrorf(s_logger, "viewer connect exception:%s", e.what());
+            closed_ = true;
+        }
+    }
+
+    int64_t GetFirstByteMs() { return first_byte_ms_; }
+    int64_t GetBytes() { return bytes_; }
+    bool IsClosed() { return closed_; }
+    bool IsSlow() { return slow_; }
+
+protected:
+    virtual void OnConnect(int ret_code) override {
+        if (ret_code < 0) {
+            LogErrorf(s_logger, "viewer connect error:%d", ret_code);
+            closed_ = true;
+            return;
+        }
+        std::stringstream ss;
+
+        ss << "GET " << path_ << " HTTP/1.1\r\n";
+        ss << "Host: " << host_ << ":" << port_ << "\r\n";
+        ss << "Accept: */*\r\n";
+        ss << "\r\n";
+        std::string req = ss.str();
+        client_->Send(req.c_str(), req.length());
+        if (!slow_) {
+            client_->AsyncRead();
+        }
+    }
+
+    virtual void OnWrite(int ret_code, size_t sent_size) override {
+        if (ret_code < 0) {
+            closed_ = true;
+        }
+    }
+
+    virtual void OnRead(int ret_code, const char* data, size_t data_size) override {
+        if (ret_code < 0) {
+            closed_ = true;
+            client_->Close();
+            return;
+        }
+        if (first_byte_ms_ < 0 && data_size > 0) {
+            first_byte_ms_ = now_millisec() - start_ms_;
+        }
+        bytes_ += data_size;
+    }
+
+private:
+    TcpClient* client_ = nullptr;
+    std::string host_;
+    uint16_t port_ = 0;
+    std::string path_;
+    bool slow_     = false;
+    bool closed_   = false;
+    int64_t start_ms_      = 0;
+    int64_t first_byte_ms_ = -1;
+    int64_t bytes_         = 0;
+};
+
+/*
+ * the viewers run on their own loop and thread, connect in batches and
+ * report the aggregate throughput every second.
+ */
+class FlvViewers : public TimerInterface
+{
+public:
+    FlvViewers(uv_loop_t* loop, const std::string& host, uint16_t port, const std::string& path,
+            size_t count, size_t slow_count, int64_t end_ms):TimerInterface(loop, 10)
+                                                           , loop_(loop)
+                                                           , end_ms_(end_ms)
+    {
+        for (size_t i = 0; i < count; i++) {
+            viewers_.push_back(new FlvViewer(loop, host, port, path, i < slow_count));
+        }
+    }
+    virtual ~FlvViewers()
+    {
+        StopTimer();
+        for (FlvViewer* viewer : viewers_) {
+            delete viewer;
+        }
+        viewers_.clear();
+    }
+
+public:
+    void Start() {
+        start_ms_ = report_ms_ = now_millisec();
+        StartTimer();
+    }
+
+    void Dump() {
+        LatencyStats first_byte_stats;
+        int64_t total_bytes = 0;
+        size_t closed_count = 0;
+        size_t slow_closed  = 0;
+
+        for (FlvViewer* viewer : viewers_) {
+            if (viewer->GetFirstByteMs() >= 0) {
+                first_byte_stats.Add(viewer->GetFirstByteMs());
+            }
+            total_bytes += viewer->GetBytes();
+            if (viewer->IsClosed()) {
+                closed_count++;
+                if (viewer->IsSlow()) {
+                    slow_closed++;
+                }
+            }
+        }
+        int64_t duration_ms = now_millisec() - start_ms_;
+        LogWarnf(s_logger, "viewers:%lu, closed:%lu(slow:%lu), bytes:%ld, duration:%ldms, %.1fMbps",
+                viewers_.size(), closed_count, slow_closed, total_bytes, duration_ms,
+                duration_ms > 0 ? (double)total_bytes * 8 / 1000.0 / duration_ms : 0.0);
+        LogWarnf(s_logger, "time to first byte %s", first_byte_stats.Dump().c_str());
+    }
+
+protected:
+    virtual void OnTimer() override {
+        size_t i = 0;
+        for (i = start_index_; i < start_index_ + VIEWERS_INTERVAL && i < viewers_.size(); i++) {
+            viewers_[i]->Start();
+        }
+        start_index_ = i;
+
+        int64_t now_ms = now_millisec();
+        if (now_ms >= end_ms_) {
+            uv_stop(loop_);
+            return;
+        }
+        if (now_ms - report_ms_ < 1000) {
+            return;
+        }
+        int64_t total_bytes = 0;
+        for (FlvViewer* viewer : viewers_) {
+            total_bytes += viewer->GetBytes();
+        }
+        LogWarnf(s_logger, "viewers started:%lu, %.1fMbps", start_index_,
+                (double)(total_bytes - report_bytes_) * 8 / 1000.0 / (now_ms - report_ms_));
+        report_bytes_ = total_bytes;
+        report_ms_    = now_ms;
+    }
+
+private:
+    uv_loop_t* loop_ = nullptr;
+    int64_t end_ms_  = 0;
+    std::vector<FlvViewer*> viewers_;
+    size_t start_index_   = 0;
+    int64_t start_ms_     = 0;
+    int64_t report_ms_    = 0;
+    int64_t report_bytes_ = 0;
+};
+
+void CloseCallback(uv_async_t *handle);
+
+/*
+ * flv file --> flvdemux(re) --> flvmux --> httpflv, on the default loop,
+ * the viewers on the loopback.
+ */
+class Flv2HttpFlvBench : public StreamerReport
+{
+public:
+    Flv2HttpFlvBench(const std::string& src_flv, const std::string& url,
+            size_t bench_count, size_t slow_count, int duration_s):src_flv_(src_flv)
+                                                                 , url_(url)
+                                                                 , bench_count_(bench_count)
+                                                                 , slow_count_(slow_count)
+                                                                 , duration_s_(duration_s)
+    {
+    }
+    virtual ~Flv2HttpFlvBench()
+    {
+    }
+
+public:
+    int MakeStreamers(uv_loop_t* loop_handle) {
+        loop_ = loop_handle;
+        uv_async_init(loop_, &async_, CloseCallback);
+        async_.data = (void*)this;
+        metrics_registry_.EnablePipelineLatency(true);
+
+        flv_demux_streamer_ = CppStreamerFactory::MakeStreamer("flvdemux");
+        if (!flv_demux_streamer_) {
+            LogErrorf(s_logger, "make streamer flvdemux error");
+            return -1;
+        }
+        flv_demux_streamer_->SetLogger(s_logger);
+        flv_demux_streamer_->AddOption("re", "true");
+        flv_demux_streamer_->SetReporter(this);
+        flv_demux_streamer_->SetMetrics(&metrics_registry_);
+
+        flv_mux_streamer_ = CppStreamerFactory::MakeStreamer("flvmux");
+        if (!flv_mux_streamer_) {
+            LogErrorf(s_logger, "make streamer flvmux error");
+            return -1;
+        }
+        flv_mux_streamer_->SetLogger(s_logger);
+        flv_mux_streamer_->SetReporter(this);
+        flv_mux_streamer_->SetMetrics(&metrics_registry_);
+        flv_demux_streamer_->AddSinker(flv_mux_streamer_);
+
+        httpflv_streamer_ = CppStreamerFactory::MakeStreamer("httpflv");
+        if (!httpflv_streamer_) {
+            LogErrorf(s_logger, "make streamer httpflv error");
+            return -1;
+        }
+        httpflv_streamer_->SetLogger(s_logger);
+        httpflv_streamer_->SetReporter(this);
+        httpflv_streamer_->AddOption("slow_timeout_ms", "3000");
+        httpflv_streamer_->AddOption("metrics_path", "/metrics");
+        httpflv_streamer_->SetMetrics(&metrics_registry_);
+        flv_mux_streamer_->AddSinker(httpflv_streamer_);
+
+        try {
+            httpflv_streamer_->StartNetwork(url_, loop_);
+        } catch(CppStreamException& e) {
+            LogErrorf(s_logger, "httpflv start network exception:%s", e.what());
+            return -1;
+        }
+        return 0;
+    }
+
+    void Start() {
+        source_thread_ptr_ = std::make_shared<std::thread>(&Flv2HttpFlvBench::OnSourceWork, this);
+        viewer_thread_ptr_ = std::make_shared<std::thread>(&Flv2HttpFlvBench::OnViewerWork, this);
+    }
+
+    void Stop() {
+        if (source_thread_ptr_) {
+            source_thread_ptr_->join();
+            source_thread_ptr_ = nullptr;
+        }
+        if (viewer_thread_ptr_) {
+            viewer_thread_ptr_->join();
+            viewer_thread_ptr_ = nullptr;
+        }
+        LogWarnf(s_logger, "server evicted viewers:%ld, last statics:%s",
+                (int64_t)evict_count_, last_statics_.c_str());
+        LogWarnf(s_logger, "streamer metrics:\n%s", metrics_registry_.DumpPrometheus().c_str());
+        LogWarnf(s_logger, "pipeline latency:\n%s", metrics_registry_.DumpPipelineLatency().c_str());
+        LogInfof(s_logger, "job is done.");
+        exit(0);
+    }
+
+protected:
+    virtual void OnReport(const std::string& name,
+            const std::string& type,
+            const std::string& value) override {
+        if (type == "statics") {
+            last_statics_ = value;
+            size_t pos = value.find("\"evicts\":");
+            if (pos != value.npos) {
+                evict_count_ = atoll(value.c_str() + pos + strlen("\"evicts\":"));
+            }
+            LogInfof(s_logger, "report name:%s, type:%s, value:%s",
+                    name.c_str(), type.c_str(), value.c_str());
+            return;
+        }
+        LogWarnf(s_logger, "report name:%s, type:%s, value:%s",
+                name.c_str(), type.c_str(), value.c_str());
+    }
+
+private:
+    bool GetHostInfo(std::string& host, uint16_t& port, std::string& path) {
+        size_t pos = url_.find("://");
+        if (pos == url_.npos) {
+            return false;
+        }
+        std::string host_str = url_.substr(pos + 3);
+        pos = host_str.find("/");
+        if (pos == host_str.npos) {
+            return false;
+        }
+        path     = host_str.substr(pos);
+        host_str = host_str.substr(0, pos);
+        pos = host_str.find(":");
+        if (pos == host_str.npos) {
+            host = host_str;
+            port = 80;
+        } else {
+            host = host_str.substr(0, pos);
+            port = atoi(host_str.substr(pos + 1).c_str());
+        }
+        if (host == "0.0.0.0") {
+            host = "127.0.0.1";
+        }
+        return true;
+    }
+
+    //the demuxer in re mode paces the source like a live encoder
+    void OnSourceWork() {
+        FILE* file_p = fopen(src_flv_.c_str(), "r");
+        if (!file_p) {
+            LogErrorf(s_logger, "open flv file error:%s", src_flv_.c_str());
+            return;
+        }
+        int64_t end_ms = now_millisec() + duration_s_ * 1000;
+        uint8_t read_data[4096];
+        size_t read_n = 0;
+        do {
+            read_n = fread(read_data, 1, sizeof(read_data), file_p);
+            if (read_n > 0) {
+                Media_Packet_Ptr pkt_ptr = std::make_shared<Media_Packet>();
+                pkt_ptr->buffer_ptr_->AppendData((char*)read_data, read_n);
+                flv_demux_streamer_->SourceData(pkt_ptr);
+            }
+        } while (read_n > 0 && now_millisec() < end_ms);
+        fclose(file_p);
+        LogInfof(s_logger, "flv file read is over...");
+    }
+
+    void OnViewerWork() {
+        std::string host;
+        std::string path;
+        uint16_t port = 0;
+        uv_loop_t loop;
+
+        if (!GetHostInfo(host, port, path)) {
+            LogErrorf(s_logger, "fail to get the host by url:%s", url_.c_str());
+            uv_async_send(&async_);
+            return;
+        }
+        uv_loop_init(&loop);
+        FlvViewers* viewers = new FlvViewers(&loop, host, port, path, bench_count_, slow_count_,
+                now_millisec() + duration_s_ * 1000);
+        viewers->Start();
+        uv_run(&loop, UV_RUN_DEFAULT);
+
+        viewers->Dump();
+        delete viewers;
+        uv_run(&loop, UV_RUN_NOWAIT);
+        uv_async_send(&async_);
+    }
+
+private:
+    std::string src_flv_;
+    std::string url_;
+    size_t bench_count_ = 1;
+    size_t slow_count_  = 0;
+    int duration_s_     = 30;
+    uv_loop_t* loop_    = nullptr;
+    uv_async_t async_;
+    std::shared_ptr<std::thread> source_thread_ptr_;
+    std::shared_ptr<std::thread> viewer_thread_ptr_;
+    std::atomic<int64_t> evict_count_{0};
+    std::string last_statics_;
+
+private:
+    CppStreamerInterface* flv_demux_streamer_ = nullptr;
+    CppStreamerInterface* flv_mux_streamer_   = nullptr;
+    CppStreamerInterface* httpflv_streamer_   = nullptr;
+    MetricsRegistry metrics_registry_;//served on the metrics path of the httpflv port
+};
+
+void CloseCallback(uv_async_t *handle) {
+    Flv2HttpFlvBench* bench = (Flv2HttpFlvBench*)(handle->data);
+    bench->Stop();
+}
+
+int main(int argc, char** argv) {
+    char input_flv_name[516];
+    char output_url_name[516];
+    char log_file[516];
+
+    int opt = 0;
+    bool input_flv_name_ready = false;
+    bool output_url_name_ready = false;
+    bool log_file_ready = false;
+    int bench_count = 0;
+    int slow_count  = 0;
+    int duration_s  = 30;
+
+    while ((opt = getopt(argc, argv, "i:o:l:n:s:t:h")) != -1) {
+        switch (opt) {
+            case 'i': strncpy(input_flv_name, optarg, sizeof(input_flv_name)); input_flv_name_ready = true; break;
+            /*eg: httpflv://127.0.0.1:8080/live/stream.flv*/
+            case 'o': strncpy(output_url_name, optarg, sizeof(output_url_name)); output_url_name_ready = true; break;
+            case 'n': bench_count = atoi(optarg); break;
+            case 's': slow_count  = atoi(optarg); break;
+            case 't': duration_s  = atoi(optarg); break;
+            case 'l': strncpy(log_file, optarg, sizeof(log_file)); log_file_ready = true; break;
+            case 'h':
+            default:
+            {
+                printf("Usage: %s [-i input flv file]\n\
+    [-o httpflv url]\n\
+    [-n viewer count]\n\
+    [-s slow viewer count, they do not read]\n\
+    [-t duration seconds, default 30]\n\
+    [-l log file name]\n",
+                    argv[0]);
+                return -1;
+            }
+        }
+    }
+
+    if (!input_flv_name_ready || !output_url_name_ready) {
+        std::cout << "please input flv file/output httpflv url\r\n";
+        return -1;
+    }
+    if (bench_count <= 0 || bench_count > BENCH_MAX) {
+        std::cout << "viewer count should be in (0, " << BENCH_MAX << "].\r\n";
+        return -1;
+    }
+    if (slow_count < 0 || slow_count > bench_count || duration_s <= 0) {
+        std::cout << "slow count or duration error.\r\n";
+        return -1;
+    }
+
+    signal(SIGPIPE, SIG_IGN);
+
+    //two sockets for every viewer on the loopback
+    struct rlimit limit;
+    if (getrlimit(RLIMIT_NOFILE, &limit) == 0 && limit.rlim_cur < limit.rlim_max) {
+        limit.rlim_cur = limit.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &limit);
+    }
+
+    s_logger = new Logger();
+    if (log_file_ready) {
+        s_logger->SetFilename(std::string(log_file));
+    }
+    s_logger->SetLevel(LOGGER_WARN_LEVEL);
+
+    CppStreamerFactory::SetLogger(s_logger);
+    CppStreamerFactory::SetLibPath("./output/lib");
+
+    LogWarnf(s_logger, "httpflv bench is starting, input flv:%s, url:%s, viewers:%d, slow:%d, duration:%ds",
+            input_flv_name, output_url_name, bench_count, slow_count, duration_s);
+    uv_loop_t* loop = uv_default_loop();
+
+    std::shared_ptr<Flv2HttpFlvBench> bench_ptr = std::make_shared<Flv2HttpFlvBench>(input_flv_name,
+            output_url_name,
+            (size_t)bench_count,
+            (size_t)slow_count,
+            duration_s);
+
+    if (bench_ptr->MakeStreamers(loop) < 0) {
+        LogErrorf(s_logger, "make httpflv bench streamers error");
+        return -1;
+    }
+    bench_ptr->Start();
+    while (true) {
+        uv_run(loop, UV_RUN_DEFAULT);
+    }
+    return 0;
+}
@@ -1,6 +1,7 @@
 #include "logger.hpp"
 #include "cpp_streamer_factory.hpp"
 #include "timer.hpp"
+#include "latency_stats.hpp"
 
 #include <iostream>
 #include <uv.h>
@@ -51,6 +52,7 @@ public:
         }
         start_ = false;
         Clean();
+        LogInfof(logger_, "connect latency %s", connect_stats_.Dump().c_str());
         LogInfof(logger_, "job is done.");
         exit(0);
     }
@@ -93,6 +95,7 @@ public:
             CppStreamerInterface* mediasoup_puller = CppStreamerFactory::MakeStreamer("mspull");
             mediasoup_puller->SetLogger(logger_);
             mediasoup_puller->SetReporter(this);
+            mediasoup_puller->AddOption("keepalive", "true");
             mediasoup_puller->AddSinker(this);
 
             mediasoup_puller_vec.push_back(mediasoup_puller);
@@ -154,6 +157,13 @@ protected:
             const std::string& value) override {
         LogWarnf(logger_, "report name:%s, type:%s, value:%s",
                 name.c_str(), type.c_str(), value.c_str());
+        if (type == "connect_ms") {
+            connect_stats_.Add(atoll(value.c_str()));
+            if (connect_stats_.Count() == bench_count_) {
+                LogWarnf(logger_, "connect latency %s", connect_stats_.Dump().c_str());
+            }
+            return;
+        }
         if (type == "audio_produce") {
             if (value == "ready") {
                 int index = GetWhipIndex(name);
@@ -189,6 +199,7 @@ private:
 
 private:
     Logger* logger_ = nullptr;
+    LatencyStats connect_stats_;
     std::vector<CppStreamerInterface*> mediasoup_puller_vec;
 };
 /*
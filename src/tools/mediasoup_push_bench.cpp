@@ -1,6 +1,7 @@
 #include "logger.hpp"
 #include "cpp_streamer_factory.hpp"
 #include "timer.hpp"
+#include "latency_stats.hpp"
 
 #include <iostream>
 #include <uv.h>
@@ -59,6 +60,7 @@ public:
     int MakeStreamers(uv_loop_t* loop_handle) {
         loop_ = loop_handle;
         uv_async_init(loop_, &async_, CloseCallback);
+        metrics_registry_.EnablePipelineLatency(true);
 
         tsdemux_streamer_ = CppStreamerFactory::MakeStreamer("mpegtsdemux");
         if (!tsdemux_streamer_) {
@@ -70,6 +72,7 @@ public:
         tsdemux_streamer_->SetLogger(logger_);
         tsdemux_streamer_->AddOption("re", "true");
         tsdemux_streamer_->SetReporter(this);
+        tsdemux_streamer_->SetMetrics(&metrics_registry_);
 
         for (size_t i = 0; i < bench_count_; i++) {
             CppStreamerInterface* mediasoup_pusher = CppStreamerFactory::MakeStreamer("mspush");
@@ -79,6 +82,8 @@ public:
             }
             mediasoup_pusher->SetLogger(logger_);
             mediasoup_pusher->SetReporter(this);
+            mediasoup_pusher->SetMetrics(&metrics_registry_);
+            mediasoup_pusher->AddOption("keepalive", "true");
             tsdemux_streamer_->AddSinker(mediasoup_pusher);
 
             mediasoup_pusher_vec.push_back(mediasoup_pusher);
@@ -122,7 +127,10 @@ public:
     }
 
     void Stop() {
+        //the metrics of the streamers are released in Clean
+        LogWarnf(logger_, "pipeline latency:\n%s", metrics_registry_.DumpPipelineLatency().c_str());
         Clean();
+        LogInfof(logger_, "connect latency %s", connect_stats_.Dump().c_str());
         LogInfof(logger_, "job is done.");
         exit(0);
     }
@@ -152,6 +160,13 @@ protected:
             const std::string& value) override {
         LogWarnf(logger_, "report name:%s, type:%s, value:%s",
                 name.c_str(), type.c_str(), value.c_str());
+        if (type == "connect_ms") {
+            connect_stats_.Add(atoll(value.c_str()));
+            if (connect_stats_.Count() == bench_count_) {
+                LogWarnf(logger_, "connect latency %s", connect_stats_.Dump().c_str());
+            }
+            return;
+        }
         if (type == "audio_produce") {
             if (value == "ready") {
                 int index = GetWhipIndex(name);
@@ -258,6 +273,8 @@ private:
 
 private:
     Logger* logger_ = nullptr;
+    LatencyStats connect_stats_;
+    MetricsRegistry metrics_registry_;
     std::vector<CppStreamerInterface*> mediasoup_pusher_vec;
     CppStreamerInterface* tsdemux_streamer_    = nullptr;
 };
@@ -0,0 +1,426 @@
+#include "logger.hpp"
+#include "rtc_pacer.hpp"
+#include "rtp_packetizer.hpp"
+#include "rtprtcp_pub.hpp"
+#include "byte_stream.hpp"
+
+#include <uv.h>
+#include <algorithm>
+#include <iostream>
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+using namespace cpp_streamer;
+
+static Logger* s_logger = nullptr;
+static const uint32_t VIDEO_SSRC  = 0x11223344;
+static const uint8_t VIDEO_PT     = 106;
+static const int VIDEO_CLOCK_RATE = 90000;
+static const size_t SEQ_SLOTS     = 65536;
+static const int MAX_RESEND       = 5;
+
+static const int DEF_SECONDS      = 60;
+static const int DEF_FPS          = 30;
+static const int DEF_KBPS         = 2000;
+static const int DEF_GOP          = 60;
+static const int DEF_KEY_FACTOR   = 5;
+static const int DEF_RTT_MS       = 100;
+static const int DEF_LINK_KBPS    = 3000;
+static const int DEF_QUEUE_MS     = 50;
+static const double s_def_losses[] = { 0.0, 1.0, 3.0, 5.0 };
+
+typedef struct {
+    int seconds;
+    int fps;
+    int kbps;
+    int gop;
+    int rtt_ms;
+    int link_kbps;
+    int queue_ms;
+    double factor;
+    double burst;
+} BenchConfig;
+
+typedef struct {
+    size_t len;
+    size_t frame;
+    int resend;
+} SeqSlot;
+
+typedef struct {
+    int64_t capture_ms;
+    int64_t done_ms;
+    size_t pending;
+    bool broken;
+} FrameInfo;
+
+typedef struct {
+    int64_t media;
+    int64_t queue_drop;
+    int64_t wire_loss;
+    int64_t resend;
+    int64_t broken_frames;
+    double latency_avg_ms;
+    int64_t latency_p95_ms;
+    int64_t latency_max_ms;
+    int64_t pacer_delay_avg_ms;
+    int64_t pacer_delay_max_ms;
+} BenchResult;
+
+//the bench drives the pacer on a virtual clock, Tick is the 5ms timer
+class BenchPacer : public RtcPacer
+{
+public:
+    BenchPacer(uv_loop_t* loop, RtcPacerCallbackI* cb, Logger* logger):RtcPacer(loop, cb, logger)
+    {
+    }
+
+public:
+    void Tick() { OnTimer(); }
+};
+
+/*
+ * emulate the webrtc video sender over a constrained uplink without the network:
+ * frames --> h264 packetizer --> [rtc pacer] --> bottleneck(link rate, drop-tail queue)
+ * --> lossy wire(gilbert-elliott, delay rtt/2) --> receiver,
+ * a lost packet is retransmitted through the same path rtt later, at most 5 times.
+ * the same frames are sent with the pacer and without it(the frame is one burst).
+ * the uv loop is never run: its cached time is set to the virtual clock, so uv_now
+ * in the pacer follows the emulation.
+ */
+class PacerBench : public RtpPacketSinkI, public RtcPacerCallbackI
+{
+public:
+    PacerBench(const BenchConfig& config, double loss, bool paced):config_(config)
+                                                                 , loss_(loss / 100.0)
+                                                                 , paced_(paced)
+                                                                 , packetizer_(this)
+    {
+        memset(&result_, 0, sizeof(result_));
+        slots_.resize(SEQ_SLOTS);
+        packetizer_.SetHeader(VIDEO_PT, VIDEO_SSRC, nullptr);
+
+        uv_loop_init(&loop_);
+        loop_.time = 0;
+        pacer_ = new BenchPacer(&loop_, this, s_logger);
+        pacer_->SetTargetBitrate((uint32_t)config.kbps * 1000);
+        pacer_->SetPacingFactor(config.factor);
+
+        queue_limit_ = (double)config.link_kbps * config.queue_ms / 8.0;
+
+        //gilbert-elliott: the bad state lasts burst packets on average
+        double burst = config.burst < 1.0 ? 1.0 : config.burst;
+        bad_to_good_ = 1.0 / burst;
+        good_to_bad_ = loss_ >= 1.0 ? 1.0 : loss_ * bad_to_good_ / (1.0 - loss_);
+    }
+    ~PacerBench()
+    {
+        delete pacer_;
+        //the timer wheel handle is closed in the loop
+        uv_run(&loop_, UV_RUN_NOWAIT);
+        uv_loop_close(&loop_);
+    }
+
+public:
+    BenchResult Run() {
+        int frames = config_.seconds * config_.fps;
+        size_t frame_bytes = (size_t)config_.kbps * 1000 / 8 / config_.fps;
+        size_t delta_bytes = frame_bytes * config_.gop / (config_.gop - 1 + DEF_KEY_FACTOR);
+        std::vector<uint8_t> nalu(delta_bytes * DEF_KEY_FACTOR * 2);
+        int64_t pacer_delay_total = 0;
+        int64_t pacer_delay_count = 0;
+
+        for (auto& byte : nalu) {
+            byte = (uint8_t)(rand() & 0xff);
+        }
+        frames_.resize(frames);
+
+        int next_frame = 0;
+        int64_t end_ms = (int64_t)frames * 1000 / config_.fps + 5000;
+        for (now_ms_ = 0; now_ms_ < end_ms; now_ms_++) {
+            loop_.time = (uint64_t)now_ms_;
+
+            while (next_frame < frames && (int64_t)next_frame * 1000 / config_.fps <= now_ms_) {
+                bool key_frame = (next_frame % config_.gop) == 0;
+                size_t size = key_frame ? delta_bytes * DEF_KEY_FACTOR : delta_bytes;
+                //+-20% for the frame sizes
+                size = size * (80 + rand() % 41) / 100;
+                if (size < 2) {
+                    size = 2;
+                }
+                nalu[0] = key_frame ? 0x65 : 0x41;
+
+                FrameInfo& frame = frames_[next_frame];
+                frame.capture_ms = now_ms_;
+                frame.done_ms    = -1;
+                frame.pending    = 0;
+                frame.broken     = false;
+
+                current_frame_ = next_frame;
+                uint32_t ts = (uint32_t)((int64_t)next_frame * VIDEO_CLOCK_RATE / config_.fps);
+                packetizer_.Packetize(nalu.data(), size, ts, true);
+                next_frame++;
+            }
+            SendResends();
+
+            if (paced_ && (now_ms_ % PACER_INTERVAL_MS) == 0) {
+                pacer_->Tick();
+                int64_t avg_ms = 0;
+                int64_t max_ms = 0;
+                pacer_->GetQueueDelay(avg_ms, max_ms);
+                pacer_delay_total += avg_ms;
+                pacer_delay_count++;
+                if (max_ms > result_.pacer_delay_max_ms) {
+                    result_.pacer_delay_max_ms = max_ms;
+                }
+            }
+        }
+        result_.pacer_delay_avg_ms = pacer_delay_count > 0 ? pacer_delay_total / pacer_delay_count : 0;
+        MakeLatency();
+        return result_;
+    }
+
+protected:
+    virtual uint8_t* NewRtpPacket(uint16_t& seq) override {
+        seq = seq_++;
+        return packet_;
+    }
+
+    virtual void OnRtpPacket(uint8_t* data, size_t len, uint16_t seq) override {
+        SeqSlot& slot = slots_[seq];
+        slot.len    = len;
+        slot.frame  = current_frame_;
+        slot.resend = 0;
+        frames_[current_frame_].pending++;
+        result_.media++;
+
+        if (paced_) {
+            pacer_->Enqueue(data, len, 0, PACE_VIDEO_PRIORITY);
+            return;
+        }
+        SendLink(data, len);
+    }
+
+    virtual void OnPacedRtpPacket(uint8_t* data, size_t len, size_t capacity, int64_t ingress_us) override {
+        SendLink(data, len);
+    }
+
+private:
+    //the bottleneck drains at the link rate, the packet over its queue is dropped
+    void SendLink(uint8_t* data, size_t len) {
+        uint16_t seq = ByteStream::Read2Bytes(data + 2);
+
+        double drained = (double)(now_ms_ - link_ms_) * config_.link_kbps / 8.0;
+        link_ms_ = now_ms_;
+        queue_bytes_ = queue_bytes_ > drained ? queue_bytes_ - drained : 0.0;
+
+        if (queue_bytes_ + len > queue_limit_) {
+            result_.queue_drop++;
+            OnLost(seq);
+            return;
+        }
+        queue_bytes_ += len;
+        if (IsLost()) {
+            result_.wire_loss++;
+            OnLost(seq);
+            return;
+        }
+        int64_t arrive_ms = now_ms_ + (int64_t)(queue_bytes_ * 8.0 / config_.link_kbps) + config_.rtt_ms / 2;
+        FrameInfo& frame = frames_[slots_[seq].frame];
+        if (arrive_ms > frame.done_ms) {
+            frame.done_ms = arrive_ms;
+        }
+        frame.pending--;
+    }
+
+    //the nack comes back rtt later, the retransmission goes through the pacer and the link again
+    void OnLost(uint16_t seq) {
+        SeqSlot& slot = slots_[seq];
+        if (slot.resend >= MAX_RESEND) {
+            frames_[slot.frame].broken = true;
+            return;
+        }
+        slot.resend++;
+        resends_.push_back(std::make_pair(now_ms_ + config_.rtt_ms, seq));
+    }
+
+    void SendResends() {
+        size_t keep = 0;
+        for (size_t index = 0; index < resends_.size(); index++) {
+            if (resends_[index].first > now_ms_) {
+                resends_[keep++] = resends_[index];
+                continue;
+            }
+            uint16_t seq = resends_[index].second;
+            SeqSlot& slot = slots_[seq];
+
+            ByteStream::Write2Bytes(packet_ + 2, seq);
+            result_.resend++;
+            if (paced_) {
+                pacer_->Enqueue(packet_, slot.len, 0, PACE_RETRANSMIT_PRIORITY);
+            } else {
+                SendLink(packet_, slot.len);
+            }
+        }
+        resends_.resize(keep);
+    }
+
+    bool IsLost() {
+        double value = (double)rand_r(&loss_seed_) / RAND_MAX;
+        if (bad_state_) {
+            bad_state_ = value >= bad_to_good_;
+        } else {
+            bad_state_ = value < good_to_bad_;
+        }
+        return bad_state_;
+    }
+
+    //the frame latency: from the capture to the arrival of its last packet
+    void MakeLatency() {
+        std::vector<int64_t> latencies;
+        int64_t total = 0;
+
+        for (auto& frame : frames_) {
+            if (frame.broken || frame.pending > 0) {
+                result_.broken_frames++;
+                continue;
+            }
+            int64_t latency = frame.done_ms - frame.capture_ms;
+            latencies.push_back(latency);
+            total += latency;
+        }
+        if (latencies.empty()) {
+            return;
+        }
+        std::sort(latencies.begin(), latencies.end());
+        result_.latency_avg_ms = (double)total / latencies.size();
+        result_.latency_p95_ms = latencies[latencies.size() * 95 / 100];
+        result_.latency_max_ms = latencies.back();
+    }
+
+private:
+    BenchConfig config_;
+    double loss_;
+    bool paced_;
+    double good_to_bad_ = 0.0;
+    double bad_to_good_ = 1.0;
+    bool bad_state_     = false;
+    unsigned int loss_seed_ = 1;
+
+private:
+    uv_loop_t loop_;
+    BenchPacer* pacer_ = nullptr;
+    RtpH264Packetizer packetizer_;
+    uint16_t seq_ = 0;
+    uint8_t packet_[RTP_PACKET_BUFFER_SIZE];
+
+private:
+    std::vector<SeqSlot> slots_;
+    std::vector<FrameInfo> frames_;
+    std::vector<std::pair<int64_t, uint16_t>> resends_;
+    size_t current_frame_ = 0;
+    int64_t now_ms_       = 0;
+    int64_t link_ms_      = 0;
+    double queue_bytes_   = 0.0;
+    double queue_limit_   = 0.0;
+
+private:
+    BenchResult result_;
+};
+
+static void PrintResult(double loss, bool paced, const BenchResult& result) {
+    printf("loss:%4.1f%% %-8s media:%7ld queue drop:%6ld wire loss:%6ld resend:%6ld broken frames:%4ld, frame latency avg:%6.1fms p95:%5ldms max:%5ldms, pacer delay avg:%3ldms max:%4ldms\r\n",
+            loss, paced ? "paced" : "unpaced", result.media, result.queue_drop, result.wire_loss,
+            result.resend, result.broken_frames, result.latency_avg_ms, result.latency_p95_ms,
+            result.latency_max_ms, result.pacer_delay_avg_ms, result.pacer_delay_max_ms);
+}
+
+static void RunBench(const BenchConfig& config, double loss) {
+    //the same frame sizes for both, the losses have their own seed
+    srand(1);
+    {
+        PacerBench bench(config, loss, false);
+        PrintResult(loss, false, bench.Run());
+    }
+    srand(1);
+    {
+        PacerBench bench(config, loss, true);
+        PrintResult(loss, true, bench.Run());
+    }
+}
+
+int main(int argc, char** argv) {
+    int opt = 0;
+    double loss = -1.0;
+    BenchConfig config = {
+        .seconds    = DEF_SECONDS,
+        .fps        = DEF_FPS,
+        .kbps       = DEF_KBPS,
+        .gop        = DEF_GOP,
+        .rtt_ms     = DEF_RTT_MS,
+        .link_kbps  = DEF_LINK_KBPS,
+        .queue_ms   = DEF_QUEUE_MS,
+        .factor     = PACER_DEFAULT_FACTOR,
+        .burst      = 1.0
+    };
+
+    while ((opt = getopt(argc, argv, "l:b:r:c:q:p:s:f:v:g:h")) != -1) {
+        switch (opt) {
+            case 'l': loss = atof(optarg); break;
+            case 'b': config.burst = atof(optarg); break;
+            case 'r': config.rtt_ms = atoi(optarg); break;
+            case 'c': config.link_kbps = atoi(optarg); break;
+            case 'q': config.queue_ms = atoi(optarg); break;
+            case 'p': config.factor = atof(optarg); break;
+            case 's': config.seconds = atoi(optarg); break;
+            case 'f': config.fps = atoi(optarg); break;
+            case 'v': config.kbps = atoi(optarg); break;
+            case 'g': config.gop = atoi(optarg); break;
+            case 'h':
+            default:
+            {
+                printf("Usage: %s [-l wire loss percent, default 0/1/3/5]\n\
+    [-b average burst loss length in packets, default 1]\n\
+    [-r rtt ms, default %d]\n\
+    [-c bottleneck link kbps, default %d]\n\
+    [-q bottleneck queue ms at the link rate, default %d]\n\
+    [-p pacing factor of the video bitrate, default %.1f]\n\
+    [-s seconds, default %d] [-f fps, default %d]\n\
+    [-v video kbps, default %d] [-g gop frames, default %d]\n",
+                    argv[0], DEF_RTT_MS, DEF_LINK_KBPS, DEF_QUEUE_MS, PACER_DEFAULT_FACTOR,
+                    DEF_SECONDS, DEF_FPS, DEF_KBPS, DEF_GOP);
+                return -1;
+            }
+        }
+    }
+
+    if (config.seconds <= 0 || config.fps <= 0 || config.kbps <= 0 || config.gop <= 1
+        || config.rtt_ms < 0 || config.link_kbps <= 0 || config.queue_ms <= 0
+        || config.factor <= 0 || loss >= 100.0) {
+        std::cout << "please input the positive seconds, fps, kbps, link kbps, queue ms, pacing factor, gop(>1) and the loss under 100%.\r\n";
+        return -1;
+    }
+
+    s_logger = new Logger();
+    s_logger->SetLevel(LOGGER_ERROR_LEVEL);
+
+    printf("pacer bench, %ds %dfps %dkbps gop:%d, rtt:%dms, link:%dkbps queue:%dms, burst:%.1f, pacing factor:%.1f\r\n",
+            config.seconds, config.fps, config.kbps, config.gop, config.rtt_ms,
+            config.link_kbps, config.queue_ms, config.burst, config.factor);
+    if (loss >= 0) {
+        RunBench(config, loss);
+    } else {
+        for (double item : s_def_losses) {
+            RunBench(config, item);
+        }
+    }
+
+    delete s_logger;
+    return 0;
+}
@@ -0,0 +1,426 @@
+#include "cpp_streamer_interface.hpp"
+#include "cpp_streamer_factory.hpp"
+#include "logger.hpp"
+#include "media_packet.hpp"
+#include "jitterbuffer.hpp"
+#include "pack_handle_h264.hpp"
+#include "rtp_h264_pack.hpp"
+#include "byte_stream.hpp"
+#include "timeex.hpp"
+
+#include <iostream>
+#include <uv.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <unistd.h>
+#include <new>
+#include <memory>
+#include <vector>
+
+using namespace cpp_streamer;
+
+static Logger* s_logger = nullptr;
+static const int VIDEO_CLOCK_RATE = 90000;
+static const uint8_t TCC_EXT_ID   = 3;
+static const uint32_t VIDEO_SSRC  = 0x11223344;
+static const uint8_t VIDEO_PT     = 96;
+
+//count the heap allocations of the process, the bench reports them per received packet
+static int64_t s_alloc_count = 0;
+
+void* operator new(size_t size) {
+    s_alloc_count++;
+    void* p = malloc(size ? size : 1);
+    if (!p) {
+        throw std::bad_alloc();
+    }
+    return p;
+}
+
+void operator delete(void* p) noexcept {
+    free(p);
+}
+
+typedef std::vector<uint8_t> RecordPacket;
+
+/*
+ * record the h264 of a flv file as the rtp traffic of a webrtc sender:
+ * flv file --> flvdemux --> stapA(sps/pps)/single nalu/fuA rtp packets with the transport-cc extension
+ */
+class RtpRecorder : public CppStreamerInterface
+{
+public:
+    RtpRecorder(std::vector<RecordPacket>& packets):packets_(packets)
+    {
+        memset(tcc_ext_data_, 0, sizeof(tcc_ext_data_));
+        ByteStream::Write2Bytes(tcc_ext_data_, 0xBEDE);
+        ByteStream::Write2Bytes(tcc_ext_data_ + 2, 1);
+        tcc_ext_data_[4] = (uint8_t)((TCC_EXT_ID << 4) | 0x01);
+        tcc_ext_ = (HeaderExtension*)tcc_ext_data_;
+    }
+    virtual ~RtpRecorder()
+    {
+        if (flv_demux_streamer_) {
+            delete flv_demux_streamer_;
+            flv_demux_streamer_ = nullptr;
+        }
+    }
+
+public:
+    int MakeStreamers() {
+        flv_demux_streamer_ = CppStreamerFactory::MakeStreamer("flvdemux");
+        if (!flv_demux_streamer_) {
+            LogErrorf(s_logger, "make streamer flvdemux error");
+            return -1;
+        }
+        flv_demux_streamer_->SetLogger(s_logger);
+        flv_demux_streamer_->AddSinker(this);
+        return 0;
+    }
+
+    int InputFlvData(uint8_t* data, size_t data_len) {
+        Media_Packet_Ptr pkt_ptr = std::make_shared<Media_Packet>();
+        pkt_ptr->buffer_ptr_->AppendData((char*)data, data_len);
+        return flv_demux_streamer_->SourceData(pkt_ptr);
+    }
+
+public:
+    virtual std::string StreamerName() override {
+        return "rtprecorder";
+    }
+    virtual void SetLogger(Logger* logger) override {
+    }
+    virtual int AddSinker(CppStreamerInterface* sinker) override {
+        return 0;
+    }
+    virtual int RemoveSinker(const std::string& name) override {
+        return 0;
+    }
+    virtual int SourceData(Media_Packet_Ptr pkt_ptr) override {
+        if (pkt_ptr->av_type_ != MEDIA_VIDEO_TYPE || pkt_ptr->codec_type_ != MEDIA_CODEC_H264) {
+            return 0;
+        }
+        uint8_t* data = (uint8_t*)pkt_ptr->buffer_ptr_->Data();
+        size_t len    = pkt_ptr->buffer_ptr_->DataLen();
+        int pos = GetNaluTypePos(data);
+        if (pos < 3 || (size_t)pos >= len) {
+            return 0;
+        }
+        data += pos;
+        len  -= pos;
+        uint32_t ts = (uint32_t)(pkt_ptr->dts_ * VIDEO_CLOCK_RATE / 1000);
+
+        if (pkt_ptr->is_seq_hdr_) {
+            if (H264_IS_SPS(data[0]) && len < sizeof(sps_)) {
+                sps_len_ = len;
+                memcpy(sps_, data, len);
+            } else if (H264_IS_PPS(data[0]) && len < sizeof(pps_)) {
+                pps_len_ = len;
+                memcpy(pps_, data, len);
+            }
+            return 0;
+        }
+        if (H264_IS_SEI(data[0])) {
+            return 0;
+        }
+        if (pkt_ptr->is_key_frame_ && sps_len_ > 0 && pps_len_ > 0) {
+            std::vector<std::pair<uint8_t*, int>> data_vec;
+
+            data_vec.push_back({sps_, (int)sps_len_});
+            data_vec.push_back({pps_, (int)pps_len_});
+            Record(GenerateStapAPackets(data_vec, tcc_ext_), ts, false);
+        }
+        if (len <= kPayloadMaxSize) {
+            Record(GenerateSinglePackets(data, len, tcc_ext_), ts, true);
+            return 0;
+        }
+        std::vector<RtpPacket*> fuA_vec = GenerateFuAPackets(data, len, tcc_ext_);
+        for (size_t index = 0; index < fuA_vec.size(); index++) {
+            Record(fuA_vec[index], ts, index == (fuA_vec.size() - 1));
+        }
+        return 0;
+    }
+    virtual void StartNetwork(const std::string& url, void* loop_handle) override {
+    }
+    virtual void AddOption(const std::string& key, const std::string& value) override {
+    }
+    virtual void SetReporter(StreamerReport* reporter) override {
+    }
+
+private:
+    void Record(RtpPacket* pkt, uint32_t ts, bool marker) {
+        if (!pkt) {
+            return;
+        }
+        pkt->SetPayloadType(VIDEO_PT);
+        pkt->SetSsrc(VIDEO_SSRC);
+        pkt->SetSeq(seq_++);
+        pkt->SetTimestamp(ts);
+        pkt->SetMarker(marker ? 1 : 0);
+
+        packets_.push_back(RecordPacket(pkt->GetData(), pkt->GetData() + pkt->GetDataLength()));
+        delete pkt;
+    }
+
+private:
+    std::vector<RecordPacket>& packets_;
+    CppStreamerInterface* flv_demux_streamer_ = nullptr;
+    uint8_t tcc_ext_data_[8];
+    HeaderExtension* tcc_ext_ = nullptr;
+    uint16_t seq_   = 0;
+    uint8_t sps_[512];
+    size_t sps_len_ = 0;
+    uint8_t pps_[512];
+    size_t pps_len_ = 0;
+};
+
+/*
+ * the receive path of PeerConnection after the srtp decryption:
+ * datagram --> pooled slot --> jitter buffer --> h264 pack handle --> frames
+ */
+class RtpRecvPipeline : public JitterBufferCallbackI, public PackCallbackI
+{
+public:
+    RtpRecvPipeline(uv_loop_t* loop):jb_(MEDIA_VIDEO_TYPE, this, loop, s_logger)
+    {
+        pack_ = new PackHandleH264(this, loop, s_logger);
+    }
+    virtual ~RtpRecvPipeline()
+    {
+        if (pack_) {
+            delete pack_;
+            pack_ = nullptr;
+        }
+    }
+
+public:
+    void InputDatagram(uint8_t* data, size_t len) {
+        RtpPacketInfo* pkt_info = pool_.Get();
+        try {
+            pkt_info->Load(data, len);
+        } catch(CppStreamException& e) {
+            pkt_info->Release();
+            error_count_++;
+            return;
+        }
+        jb_.InputRtpPacket(VIDEO_CLOCK_RATE, pkt_info);
+    }
+
+public:
+    virtual void RtpPacketReset(RtpPacketInfo* pkt_info) override {
+        reset_count_++;
+    }
+    virtual void RtpPacketOutput(RtpPacketInfo* pkt_info) override {
+        pack_->InputRtpPacket(pkt_info);
+    }
+    virtual void PackHandleReset(RtpPacketInfo* pkt_info) override {
+        lost_count_++;
+    }
+    virtual void MediaPacketOutput(std::shared_ptr<Media_Packet> pkt_ptr) override {
+        frame_count_++;
+        frame_bytes_ += pkt_ptr->buffer_ptr_->DataLen();
+    }
+
+public:
+    RtpPacketPool pool_;//declared before the jitter buffer, it outlives the slots' owners
+    int64_t frame_count_ = 0;
+    int64_t frame_bytes_ = 0;
+    int64_t reset_count_ = 0;
+    int64_t lost_count_  = 0;
+    int64_t error_count_ = 0;
+
+private:
+    JitterBuffer jb_;
+    PackHandleBase* pack_ = nullptr;
+};
+
+//the rtp dump file: [2 bytes length, network order][rtp packet], ...
+static int ReadRtpDump(const char* filename, std::vector<RecordPacket>& packets) {
+    FILE* file_p = fopen(filename, "rb");
+    if (!file_p) {
+        return -1;
+    }
+    uint8_t len_data[2];
+    while (fread(len_data, 1, sizeof(len_data), file_p) == sizeof(len_data)) {
+        size_t len = ByteStream::Read2Bytes(len_data);
+        RecordPacket pkt(len);
+        if (len == 0 || len > RTP_PACKET_MAX_SIZE || fread(pkt.data(), 1, len, file_p) != len) {
+            break;
+        }
+        packets.push_back(pkt);
+    }
+    fclose(file_p);
+    return 0;
+}
+
+static int WriteRtpDump(const char* filename, const std::vector<RecordPacket>& packets) {
+    FILE* file_p = fopen(filename, "wb");
+    if (!file_p) {
+        return -1;
+    }
+    for (auto& pkt : packets) {
+        uint8_t len_data[2];
+        ByteStream::Write2Bytes(len_data, (uint16_t)pkt.size());
+        fwrite(len_data, 1, sizeof(len_data), file_p);
+        fwrite(pkt.data(), 1, pkt.size(), file_p);
+    }
+    fclose(file_p);
+    return 0;
+}
+
+static int RecordFlv(const char* filename, std::vector<RecordPacket>& packets) {
+    CppStreamerFactory::SetLogger(s_logger);
+    CppStreamerFactory::SetLibPath("./output/lib");
+
+    std::unique_ptr<RtpRecorder> recorder(new RtpRecorder(packets));
+    if (recorder->MakeStreamers() < 0) {
+        return -1;
+    }
+    FILE* file_p = fopen(filename, "rb");
+    if (!file_p) {
+        return -1;
+    }
+    uint8_t read_data[4096];
+    size_t read_n = 0;
+    do {
+        read_n = fread(read_data, 1, sizeof(read_data), file_p);
+        if (read_n > 0) {
+            recorder->InputFlvData(read_data, read_n);
+        }
+    } while (read_n > 0);
+    fclose(file_p);
+
+    recorder.reset();
+    CppStreamerFactory::ReleaseAll();
+    return 0;
+}
+
+/*
+ * replay the recorded packets for loop_count times through one pipeline,
+ * the sequences and timestamps go on over the loops, reorder_percent of the packets
+ * are swapped with the next one.
+ */
+static void Replay(const std::vector<RecordPacket>& packets, int loop_count, int reorder_percent) {
+    RtpRecvPipeline pipeline(uv_default_loop());
+    std::vector<size_t> order(packets.size());
+    uint8_t datagram[RTP_PACKET_MAX_SIZE];
+    int64_t bytes = 0;
+
+    for (size_t index = 0; index < order.size(); index++) {
+        order[index] = index;
+    }
+    srand(1);
+    for (size_t index = 0; index + 1 < order.size(); index++) {
+        if ((rand() % 100) < reorder_percent) {
+            std::swap(order[index], order[index + 1]);
+            index++;
+        }
+    }
+    RtpCommonHeader* first_header = (RtpCommonHeader*)packets.front().data();
+    RtpCommonHeader* last_header  = (RtpCommonHeader*)packets.back().data();
+    uint32_t ts_span = ntohl(last_header->timestamp) - ntohl(first_header->timestamp) + 3000;
+
+    int64_t alloc_start = s_alloc_count;
+    int64_t start_us    = now_microsec();
+    for (int loop = 0; loop < loop_count; loop++) {
+        uint16_t seq_base = (uint16_t)(loop * packets.size());
+        uint32_t ts_base  = (uint32_t)loop * ts_span;
+
+        for (size_t index : order) {
+            const RecordPacket& pkt = packets[index];
+            RtpCommonHeader* header = (RtpCommonHeader*)datagram;
+
+            //the recv buffer of the socket
+            memcpy(datagram, pkt.data(), pkt.size());
+            header->sequence  = htons((uint16_t)(seq_base + index));
+            header->timestamp = htonl(ntohl(header->timestamp) + ts_base);
+
+            pipeline.InputDatagram(datagram, pkt.size());
+            bytes += (int64_t)pkt.size();
+        }
+    }
+    int64_t cost_us = now_microsec() - start_us;
+    int64_t allocs  = s_alloc_count - alloc_start;
+    int64_t count   = (int64_t)packets.size() * loop_count;
+
+    if (cost_us <= 0) {
+        cost_us = 1;
+    }
+    printf("rtp recv bench on one core, packets:%ld, reorder:%d%%, cost:%ldms\r\n",
+            count, reorder_percent, cost_us / 1000);
+    printf("  %.0f pps, %.1f Mbps, frames:%ld, %.0f fps, frame bytes:%ld\r\n",
+            (double)count * 1000000.0 / cost_us, (double)bytes * 8 / cost_us,
+            pipeline.frame_count_, (double)pipeline.frame_count_ * 1000000.0 / cost_us,
+            pipeline.frame_bytes_);
+    printf("  allocations:%ld, %.3f per packet, %.2f per frame, pool slots allocated:%ld\r\n",
+            allocs, (double)allocs / count,
+            pipeline.frame_count_ > 0 ? (double)allocs / pipeline.frame_count_ : 0.0,
+            pipeline.pool_.AllocCount());
+    printf("  jitter buffer resets:%ld, pack lost reports:%ld, parse errors:%ld\r\n",
+            pipeline.reset_count_, pipeline.lost_count_, pipeline.error_count_);
+}
+
+int main(int argc, char** argv) {
+    char input_flv_name[128];
+    char input_dump_name[128];
+    char output_dump_name[128];
+    bool input_flv_name_ready   = false;
+    bool input_dump_name_ready  = false;
+    bool output_dump_name_ready = false;
+    int loop_count      = 20;
+    int reorder_percent = 0;
+    int opt = 0;
+
+    while ((opt = getopt(argc, argv, "i:p:w:n:r:h")) != -1) {
+        switch (opt) {
+            case 'i': strncpy(input_flv_name, optarg, sizeof(input_flv_name)); input_flv_name_ready = true; break;
+            case 'p': strncpy(input_dump_name, optarg, sizeof(input_dump_name)); input_dump_name_ready = true; break;
+            case 'w': strncpy(output_dump_name, optarg, sizeof(output_dump_name)); output_dump_name_ready = true; break;
+            case 'n': loop_count      = atoi(optarg); break;
+            case 'r': reorder_percent = atoi(optarg); break;
+            case 'h':
+            default:
+            {
+                printf("Usage: %s [-i input flv file, its h264 is recorded as rtp packets]\n\
+    [-p input rtp dump file]\n\
+    [-w write the recorded rtp packets to the dump file]\n\
+    [-n replay count, default 20]\n\
+    [-r reorder percent, default 0]\n",
+                    argv[0]);
+                return -1;
+            }
+        }
+    }
+
+    if (!input_flv_name_ready && !input_dump_name_ready) {
+        std::cout << "please input flv file or rtp dump file\r\n";
+        return -1;
+    }
+    if (loop_count <= 0 || reorder_percent < 0 || reorder_percent > 100) {
+        std::cout << "replay count or reorder percent error.\r\n";
+        return -1;
+    }
+
+    s_logger = new Logger();
+    s_logger->SetLevel(LOGGER_ERROR_LEVEL);
+
+    std::vector<RecordPacket> packets;
+    int ret = input_dump_name_ready ? ReadRtpDump(input_dump_name, packets) : RecordFlv(input_flv_name, packets);
+    if (ret < 0 || packets.empty()) {
+        std::cout << "record rtp packets error.\r\n";
+        delete s_logger;
+        return -1;
+    }
+    if (output_dump_name_ready && WriteRtpDump(output_dump_name, packets) < 0) {
+        std::cout << "write rtp dump file error.\r\n";
+    }
+
+    Replay(packets, loop_count, reorder_percent);
+
+    delete s_logger;
+    return 0;
+}
@@ -0,0 +1,379 @@
+#include "logger.hpp"
+#include "tcp_shard_server.hpp"
+#include "tcp_client.hpp"
+#include "http_server.hpp"
+#include "timer.hpp"
+#include "timeex.hpp"
+
+#include <iostream>
+#include <uv.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <unistd.h>
+#include <chrono>
+#include <thread>
+#include <memory>
+#include <vector>
+#include <atomic>
+
+using namespace cpp_streamer;
+
+static Logger* s_logger = nullptr;
+static const size_t SHARD_BENCH_MAX   = 256;
+static const size_t CONNECT_INTERVAL  = 100;//connections started per 10ms
+static const char* SHARD_BENCH_URI    = "/shard";
+
+static const uint16_t DEF_PORT        = 8090;
+static const size_t DEF_CONNECTIONS   = 1000;
+static const size_t DEF_CLIENT_THREAD = 2;
+static const int DEF_SECONDS          = 10;
+
+static std::atomic<int64_t> s_shard_requests[SHARD_BENCH_MAX];
+static thread_local size_t s_shard_index = 0;
+static std::atomic<bool> s_client_pause{false};
+static std::atomic<bool> s_client_exit{false};
+static std::atomic<int64_t> s_responses{0};
+
+//in the shard thread, counted on the shard of the thread
+static void OnShardRequest(const HttpRequest* request, std::shared_ptr<HttpResponse> response_ptr) {
+    s_shard_requests[s_shard_index]++;
+    response_ptr->SetStatusCode(200);
+    response_ptr->SetStatus("OK");
+    response_ptr->AddHeader("Content-Type", "text/plain");
+    response_ptr->Write("ok", 2);
+}
+
+/*
+ * every shard runs a listener-less HttpServer on its loop
+ */
+class HttpShards : public TcpShardCallbackI
+{
+protected:
+    virtual TcpServerCallbackI* OnShardStart(size_t index, uv_loop_t* loop) override {
+        s_shard_index = index;
+        HttpServer* server = new HttpServer(loop, "", "", s_logger);
+        server->AddHandle(SHARD_BENCH_URI, OnShardRequest);
+        return server;
+    }
+
+    virtual size_t OnShardSessionCount(size_t index, TcpServerCallbackI* server) override {
+        return static_cast<HttpServer*>(server)->GetSessionCount();
+    }
+
+    virtual void OnShardStop(size_t index, TcpServerCallbackI* server) override {
+        delete static_cast<HttpServer*>(server);
+    }
+};
+
+/*
+ * one keep-alive http client: the next request is sent when the response is done
+ */
+class ShardClient : public TcpClientCallback
+{
+public:
+    ShardClient(uv_loop_t* loop, uint16_t port):port_(port)
+    {
+        client_ = new TcpClient(loop, this, s_logger);
+    }
+    virtual ~ShardClient()
+    {
+        if (client_) {
+            delete client_;
+            client_ = nullptr;
+        }
+    }
+
+public:
+    void Start() {
+        try {
+            client_->Connect("127.0.0.1", port_);
+        } catch(CppStreamException& e) {
+            LogErrorf(s_logger, "client connect exception:%s", e.what());
+            closed_ = true;
+        }
+    }
+
+    bool IsClosed() { return closed_; }
+    bool IsConnected() { return connected_; }
+
+protected:
+    virtual void OnConnect(int ret_code) override {
+        if (ret_code < 0) {
+            LogErrorf(s_logger, "client connect error:%d", ret_code);
+            closed_ = true;
+            return;
+        }
+        connected_ = true;
+        client_->AsyncRead();
+        SendRequest();
+    }
+
+    virtual void OnWrite(int ret_code, size_t sent_size) override {
+        if (ret_code < 0) {
+            closed_ = true;
+        }
+    }
+
+    virtual void OnRead(int ret_code, const char* data, size_t data_size) override {
+        if (ret_code < 0) {
+            closed_ = true;
+            client_->Close();
+            return;
+        }
+        recv_.append(data, data_size);
+
+        while (true) {
+            size_t pos = recv_.find("\r\n\r\n");
+            if (pos == recv_.npos) {
+                return;
+            }
+            size_t body_len = 0;
+            size_t len_pos  = recv_.find("Content-Length:");
+            if (len_pos != recv_.npos && len_pos < pos) {
+                body_len = (size_t)atoi(recv_.c_str() + len_pos + strlen("Content-Length:"));
+            }
+            if (recv_.size() < pos + 4 + body_len) {
+                return;
+            }
+            recv_.erase(0, pos + 4 + body_len);
+            s_responses++;
+            SendRequest();
+        }
+    }
+
+private:
+    void SendRequest() {
+        if (s_client_pause) {
+            return;
+        }
+        std::string req = "GET /shard HTTP/1.1\r\nHost: 127.0.0.1\r\nAccept: */*\r\n\r\n";
+        client_->Send(req.c_str(), req.length());
+    }
+
+private:
+    TcpClient* client_ = nullptr;
+    uint16_t port_     = 0;
+    bool connected_    = false;
+    bool closed_       = false;
+    std::string recv_;
+};
+
+/*
+ * the clients of one client thread, connected in batches on its own loop
+ */
+class ShardClients : public TimerInterface
+{
+public:
+    ShardClients(uv_loop_t* loop, uint16_t port, size_t count):TimerInterface(loop, 10, true)
+                                                              , loop_(loop)
+    {
+        for (size_t i = 0; i < count; i++) {
+            clients_.push_back(new ShardClient(loop, port));
+        }
+    }
+    virtual ~ShardClients()
+    {
+        StopTimer();
+        for (ShardClient* client : clients_) {
+            delete client;
+        }
+        clients_.clear();
+    }
+
+public:
+    void Start() {
+        StartTimer();
+    }
+
+    void GetCount(size_t& connected, size_t& closed) {
+        for (ShardClient* client : clients_) {
+            if (client->IsConnected()) {
+                connected++;
+            }
+            if (client->IsClosed()) {
+                closed++;
+            }
+        }
+    }
+
+protected:
+    virtual void OnTimer() override {
+        size_t i = 0;
+        for (i = start_index_; i < start_index_ + CONNECT_INTERVAL && i < clients_.size(); i++) {
+            clients_[i]->Start();
+        }
+        start_index_ = i;
+
+        if (s_client_exit) {
+            uv_stop(loop_);
+        }
+    }
+
+private:
+    uv_loop_t* loop_ = nullptr;
+    std::vector<ShardClient*> clients_;
+    size_t start_index_ = 0;
+};
+
+static void OnClientWork(uint16_t port, size_t count, size_t* connected, size_t* closed) {
+    uv_loop_t loop;
+
+    uv_loop_init(&loop);
+    ShardClients* clients = new ShardClients(&loop, port, count);
+    clients->Start();
+    uv_run(&loop, UV_RUN_DEFAULT);
+
+    clients->GetCount(*connected, *closed);
+    delete clients;
+    //the client handles and the timer wheel are closed in the loop
+    uv_run(&loop, UV_RUN_DEFAULT);
+    uv_loop_close(&loop);
+}
+
+/*
+ * sharded http server bench on the loopback:
+ * client threads(keep-alive GET) --> SO_REUSEPORT listeners --> shard loops(HttpServer),
+ * report the requests/sec and the accepted connections, sessions and requests per shard,
+ * then stop the shards with the clients still connected.
+ */
+static int RunBench(uint16_t port, size_t shard_num, size_t connections, size_t thread_num, int seconds) {
+    HttpShards shards;
+    TcpShardServer server(port, shard_num, &shards, s_logger);
+
+    for (size_t index = 0; index < SHARD_BENCH_MAX; index++) {
+        s_shard_requests[index] = 0;
+    }
+    s_client_pause = false;
+    s_client_exit  = false;
+    s_responses    = 0;
+
+    if (server.Start() != 0) {
+        std::cout << "fail to start the shards on port:" << port << "\r\n";
+        return -1;
+    }
+
+    std::vector<std::shared_ptr<std::thread>> threads;
+    std::vector<size_t> connected(thread_num, 0);
+    std::vector<size_t> closed(thread_num, 0);
+    for (size_t index = 0; index < thread_num; index++) {
+        size_t count = connections / thread_num + (index < connections % thread_num ? 1 : 0);
+        threads.push_back(std::make_shared<std::thread>(OnClientWork, port, count,
+                    &connected[index], &closed[index]));
+    }
+
+    int64_t start_ms  = now_millisec();
+    int64_t last_ms   = start_ms;
+    int64_t last_resp = 0;
+    for (int second = 0; second < seconds; second++) {
+        std::this_thread::sleep_for(std::chrono::seconds(1));
+        int64_t now_ms = now_millisec();
+        int64_t resp   = s_responses;
+        printf("shards:%lu %2ds requests/sec:%ld\r\n", server.GetShardNum(), second + 1,
+                (resp - last_resp) * 1000 / (now_ms - last_ms));
+        last_resp = resp;
+        last_ms   = now_ms;
+    }
+
+    //let the responses in flight finish, the session counts are updated every second
+    s_client_pause = true;
+    std::this_thread::sleep_for(std::chrono::milliseconds(TCP_SHARD_STATS_MS + 100));
+    int64_t duration_ms = now_millisec() - start_ms;
+    int64_t total = 0;
+    for (size_t index = 0; index < server.GetShardNum(); index++) {
+        total += s_shard_requests[index];
+    }
+    printf("shards:%lu connections:%lu requests:%ld, %ld requests/sec\r\n", server.GetShardNum(),
+            connections, total, duration_ms > 0 ? total * 1000 / duration_ms : 0);
+    for (size_t index = 0; index < server.GetShardNum(); index++) {
+        printf("  shard:%lu accepted:%ld sessions:%ld requests:%ld(%.1f%%)\r\n", index,
+                server.GetAcceptCount(index), server.GetSessionCount(index),
+                (int64_t)s_shard_requests[index],
+                total > 0 ? (double)s_shard_requests[index] * 100.0 / total : 0.0);
+    }
+
+    //stop with the sessions alive: the listeners, the http servers and their sessions are released
+    int64_t stop_ms = now_millisec();
+    server.Stop();
+    stop_ms = now_millisec() - stop_ms;
+
+    s_client_exit = true;
+    for (auto& thread_ptr : threads) {
+        thread_ptr->join();
+    }
+    size_t connected_total = 0;
+    size_t closed_total    = 0;
+    for (size_t index = 0; index < thread_num; index++) {
+        connected_total += connected[index];
+        closed_total    += closed[index];
+    }
+    printf("shards:%lu stopped in %ldms, clients connected:%lu closed by the server:%lu\r\n",
+            server.GetShardNum(), stop_ms, connected_total, closed_total);
+    return 0;
+}
+
+int main(int argc, char** argv) {
+    int opt = 0;
+    uint16_t port      = DEF_PORT;
+    size_t shard_num   = 0;
+    size_t connections = DEF_CONNECTIONS;
+    size_t thread_num  = DEF_CLIENT_THREAD;
+    int seconds        = DEF_SECONDS;
+
+    while ((opt = getopt(argc, argv, "p:s:c:t:d:h")) != -1) {
+        switch (opt) {
+            case 'p': port = (uint16_t)atoi(optarg); break;
+            case 's': shard_num = (size_t)atoi(optarg); break;
+            case 'c': connections = (size_t)atoi(optarg); break;
+            case 't': thread_num = (size_t)atoi(optarg); break;
+            case 'd': seconds = atoi(optarg); break;
+            case 'h':
+            default:
+            {
+                printf("Usage: %s [-p port, default %d]\n\
+    [-s shards, default 1, 2, 4... up to the cores]\n\
+    [-c connections, default %lu] [-t client threads, default %lu]\n\
+    [-d seconds, default %d]\n",
+                    argv[0], DEF_PORT, DEF_CONNECTIONS, DEF_CLIENT_THREAD, DEF_SECONDS);
+                return -1;
+            }
+        }
+    }
+
+    if (port == 0 || shard_num > SHARD_BENCH_MAX || connections == 0 || thread_num == 0 || seconds <= 0) {
+        std::cout << "please input the port, the connections, the client threads, the seconds, and the shards under "
+                  << SHARD_BENCH_MAX << ".\r\n";
+        return -1;
+    }
+
+    s_logger = new Logger();
+    s_logger->SetLevel(LOGGER_ERROR_LEVEL);
+
+    std::vector<size_t> shard_nums;
+    if (shard_num > 0) {
+        shard_nums.push_back(shard_num);
+    } else {
+        size_t cores = std::thread::hardware_concurrency();
+        for (size_t num = 1; num <= cores && num <= SHARD_BENCH_MAX; num *= 2) {
+            shard_nums.push_back(num);
+        }
+        if (shard_nums.empty()) {
+            shard_nums.push_back(1);
+        }
+    }
+
+    printf("shard bench, port:%d connections:%lu client threads:%lu, %ds, cores:%u\r\n",
+            port, connections, thread_num, seconds, std::thread::hardware_concurrency());
+    for (size_t num : shard_nums) {
+        if (RunBench(port, num, connections, thread_num, seconds) != 0) {
+            delete s_logger;
+            return -1;
+        }
+    }
+
+    delete s_logger;
+    return 0;
+}
@@ -0,0 +1,175 @@
+#include "logger.hpp"
+#include "srtp_session.hpp"
+#include "rtprtcp_pub.hpp"
+#include "timeex.hpp"
+
+#include <iostream>
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+using namespace cpp_streamer;
+
+static Logger* s_logger = nullptr;
+static const int DEF_PACKET_COUNT = 1000000;
+static const int DEF_PAYLOAD_SIZE = 1200;
+static const int BATCH_COUNT      = 256;
+
+typedef struct {
+    CRYPTO_SUITE_ENUM suite;
+    const char* name;
+    size_t key_len;
+} BenchSuite;
+
+static const BenchSuite s_suites[] = {
+    { CRYPTO_SUITE_AES_CM_128_HMAC_SHA1_80, "AES_CM_128_HMAC_SHA1_80", 30 },
+    { CRYPTO_SUITE_AES_CM_128_HMAC_SHA1_32, "AES_CM_128_HMAC_SHA1_32", 30 },
+    { CRYPTO_SUITE_AEAD_AES_128_GCM,        "AEAD_AES_128_GCM",        28 },
+    { CRYPTO_SUITE_AEAD_AES_256_GCM,        "AEAD_AES_256_GCM",        44 }
+};
+
+typedef struct {
+    uint8_t data[RTP_PACKET_BUFFER_SIZE];
+    size_t len;
+} BenchPacket;
+
+static void MakeRtpHeader(BenchPacket& pkt, uint16_t seq, size_t payload_size) {
+    RtpCommonHeader* header = (RtpCommonHeader*)pkt.data;
+
+    memset(header, 0, sizeof(RtpCommonHeader));
+    header->version      = RTP_VERSION;
+    header->payload_type = 96;
+    header->sequence     = htons(seq);
+    header->timestamp    = htonl((uint32_t)seq * 3000);
+    header->ssrc         = htonl(0x12345678);
+    pkt.len = sizeof(RtpCommonHeader) + payload_size;
+}
+
+static double Pps(int64_t count, int64_t cost_us) {
+    if (cost_us <= 0) {
+        return 0.0;
+    }
+    return (double)count * 1000000.0 / (double)cost_us;
+}
+
+/*
+ * protect the packets in batches by one session and unprotect them by the peer session,
+ * the in place protect uses the packet tail room, the copy protect uses the encrypt buffer.
+ */
+static int RunSuite(const BenchSuite& item, int packet_count, size_t payload_size) {
+    std::vector<uint8_t> key(item.key_len);
+    for (auto& byte : key) {
+        byte = (uint8_t)(rand() & 0xff);
+    }
+    SRtpSession writer(SRTP_SESSION_OUT_TYPE, item.suite, key.data(), key.size());
+    SRtpSession reader(SRTP_SESSION_IN_TYPE, item.suite, key.data(), key.size());
+    SRtpSession copy_writer(SRTP_SESSION_OUT_TYPE, item.suite, key.data(), key.size());
+
+    std::vector<BenchPacket> packets(BATCH_COUNT);
+    for (auto& pkt : packets) {
+        memset(pkt.data, 0xab, sizeof(pkt.data));
+    }
+    int64_t inplace_us = 0;
+    int64_t copy_us    = 0;
+    int64_t unprotect_us = 0;
+    int64_t done       = 0;
+    uint16_t seq       = 0;
+
+    while (done < packet_count) {
+        int batch = (packet_count - done) > BATCH_COUNT ? BATCH_COUNT : (int)(packet_count - done);
+        uint16_t batch_seq = seq;
+
+        for (int index = 0; index < batch; index++) {
+            MakeRtpHeader(packets[index], batch_seq++, payload_size);
+        }
+        int64_t start_us = now_microsec();
+        for (int index = 0; index < batch; index++) {
+            uint8_t* data = packets[index].data;
+            size_t len    = packets[index].len;
+            if (!copy_writer.ProtectRtp(&data, &len, 0)) {
+                std::cout << "protect with copy error\r\n";
+                return -1;
+            }
+        }
+        copy_us += now_microsec() - start_us;
+
+        start_us = now_microsec();
+        for (int index = 0; index < batch; index++) {
+            uint8_t* data = packets[index].data;
+            if (!writer.ProtectRtp(&data, &packets[index].len, sizeof(packets[index].data))) {
+                std::cout << "protect in place error\r\n";
+                return -1;
+            }
+        }
+        inplace_us += now_microsec() - start_us;
+
+        start_us = now_microsec();
+        for (int index = 0; index < batch; index++) {
+            if (!reader.DecryptSrtp(packets[index].data, &packets[index].len)) {
+                std::cout << "unprotect error, seq:" << (int)(uint16_t)(seq + index) << "\r\n";
+                return -1;
+            }
+        }
+        unprotect_us += now_microsec() - start_us;
+
+        seq   = batch_seq;
+        done += batch;
+    }
+
+    double inplace_pps = Pps(done, inplace_us);
+    printf("%-24s protect in place: %10.0f pps %8.1f Mbps, protect with copy: %10.0f pps, unprotect: %10.0f pps\r\n",
+            item.name, inplace_pps, inplace_pps * (payload_size + sizeof(RtpCommonHeader)) * 8 / 1000000.0,
+            Pps(done, copy_us), Pps(done, unprotect_us));
+    return 0;
+}
+
+int main(int argc, char** argv) {
+    int opt = 0;
+    int packet_count = DEF_PACKET_COUNT;
+    int payload_size = DEF_PAYLOAD_SIZE;
+
+    while ((opt = getopt(argc, argv, "n:s:h")) != -1) {
+        switch (opt) {
+            case 'n': packet_count = atoi(optarg); break;
+            case 's': payload_size = atoi(optarg); break;
+            case 'h':
+            default:
+            {
+                printf("Usage: %s [-n packet count per suite]\n\
+    [-s rtp payload size, default %d]\n",
+                    argv[0], DEF_PAYLOAD_SIZE);
+                return -1;
+            }
+        }
+    }
+
+    if (packet_count <= 0 || payload_size <= 0
+        || payload_size + sizeof(RtpCommonHeader) > RTP_PACKET_MAX_SIZE) {
+        std::cout << "please input the packet count and a payload size under the rtp mtu.\r\n";
+        return -1;
+    }
+
+    s_logger = new Logger();
+    s_logger->SetLevel(LOGGER_ERROR_LEVEL);
+
+    try {
+        SRtpSession::Init(s_logger);
+        printf("srtp bench on one core, %s, packets:%d, payload size:%d\r\n",
+                srtp_get_version_string(), packet_count, payload_size);
+        for (auto& item : s_suites) {
+            if (RunSuite(item, packet_count, (size_t)payload_size) < 0) {
+                break;
+            }
+        }
+    } catch(CppStreamException& e) {
+        std::cout << "srtp bench exception:" << e.what() << "\r\n";
+    }
+
+    delete s_logger;
+    return 0;
+}
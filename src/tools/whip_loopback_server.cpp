@@ -0,0 +1,137 @@
+#include "rtc_loopback_server.hpp"
+#include "logger.hpp"
+#include "timer.hpp"
+#include "timeex.hpp"
+
+#include <iostream>
+#include <uv.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <string>
+#include <unistd.h>
+
+using namespace cpp_streamer;
+
+static Logger* s_logger = nullptr;
+
+/*
+ * the server side numbers of the loopback bench every report interval:
+ * the sessions, the srtp packets in and out, the cores used and the packets per core second.
+ */
+class LoopbackReporter : public TimerInterface
+{
+public:
+    LoopbackReporter(uv_loop_t* loop, RtcLoopbackServer* server,
+            uint32_t interval_ms):TimerInterface(loop, interval_ms)
+                                , server_(server)
+    {
+        last_us_     = now_microsec();
+        last_cpu_us_ = cpu_microsec();
+    }
+    virtual ~LoopbackReporter()
+    {
+        StopTimer();
+    }
+
+protected:
+    virtual void OnTimer() override {
+        int64_t now_us = now_microsec();
+        int64_t cpu_us = cpu_microsec();
+        int64_t recv_count = server_->GetRtpRecvCount();
+        int64_t send_count = server_->GetRtpSendCount();
+
+        double seconds     = (double)(now_us - last_us_) / 1000000.0;
+        double cpu_seconds = (double)(cpu_us - last_cpu_us_) / 1000000.0;
+        double cores       = (seconds > 0) ? cpu_seconds / seconds : 0;
+        int64_t packets    = (recv_count - last_recv_count_) + (send_count - last_send_count_);
+        size_t connected   = server_->GetConnectedCount();
+
+        printf("sessions:%lu, connected:%lu, rtp recv:%.0f/s, rtp send:%.0f/s, cores:%.3f, sessions/core:%.1f, packets/core:%.0f/s, connect %s\n",
+                server_->GetSessionCount(), connected,
+                (seconds > 0) ? (recv_count - last_recv_count_) / seconds : 0,
+                (seconds > 0) ? (send_count - last_send_count_) / seconds : 0,
+                cores,
+                (cores > 0) ? connected / cores : 0,
+                (cpu_seconds > 0) ? packets / cpu_seconds : 0,
+                server_->GetConnectStats().Dump().c_str());
+        fflush(stdout);
+
+        last_us_         = now_us;
+        last_cpu_us_     = cpu_us;
+        last_recv_count_ = recv_count;
+        last_send_count_ = send_count;
+    }
+
+private:
+    RtcLoopbackServer* server_ = nullptr;
+    int64_t last_us_          = 0;
+    int64_t last_cpu_us_      = 0;
+    int64_t last_recv_count_  = 0;
+    int64_t last_send_count_  = 0;
+};
+
+/*
+ ./whip_loopback_server -p 1985 -u 8000
+ ./whip_srs_bench -i input.ts -o "http://127.0.0.1:1985/rtc/v1/whip/?app=live&stream=1000" -n 100
+ ./whep_srs_bench -i "http://127.0.0.1:1985/rtc/v1/whip-play/?app=live&stream=1000_0" -n 100
+ */
+int main(int argc, char** argv) {
+    char server_ip[80];
+    char log_file[516];
+    uint16_t http_port = 1985;
+    uint16_t udp_port  = 8000;
+    int interval_s     = 5;
+
+    int opt = 0;
+    bool server_ip_ready = false;
+    bool log_file_ready  = false;
+
+    while ((opt = getopt(argc, argv, "s:p:u:t:l:h")) != -1) {
+        switch (opt) {
+            case 's': strncpy(server_ip, optarg, sizeof(server_ip)); server_ip_ready = true; break;
+            case 'p': http_port = (uint16_t)atoi(optarg); break;
+            case 'u': udp_port = (uint16_t)atoi(optarg); break;
+            case 't': interval_s = atoi(optarg); break;
+            case 'l': strncpy(log_file, optarg, sizeof(log_file)); log_file_ready = true; break;
+            case 'h':
+            default:
+            {
+                printf("Usage: %s [-s the candidate ip, default 127.0.0.1]\n\
+    [-p http port, default 1985]\n\
+    [-u udp port of the rtc sessions, default 8000]\n\
+    [-t report interval in seconds, default 5]\n\
+    [-l log file name]\n",
+                    argv[0]);
+                return -1;
+            }
+        }
+    }
+
+    if (!server_ip_ready) {
+        snprintf(server_ip, sizeof(server_ip), "127.0.0.1");
+    }
+    if (interval_s <= 0) {
+        std::cout << "the report interval is error.\r\n";
+        return -1;
+    }
+
+    s_logger = new Logger();
+    if (log_file_ready) {
+        s_logger->SetFilename(std::string(log_file));
+    }
+    s_logger->SetLevel(LOGGER_WARN_LEVEL);
+
+    uv_loop_t* loop = uv_default_loop();
+    RtcLoopbackServer server(loop, server_ip, http_port, udp_port, s_logger);
+    LoopbackReporter reporter(loop, &server, (uint32_t)interval_s * 1000);
+
+    reporter.StartTimer();
+    printf("whip loopback server is listening, whip:http://%s:%d%s, whep:http://%s:%d%s, udp port:%d\n",
+            server_ip, http_port, RTC_LOOPBACK_WHIP_URI,
+            server_ip, http_port, RTC_LOOPBACK_WHEP_URI, udp_port);
+    fflush(stdout);
+
+    uv_run(loop, UV_RUN_DEFAULT);
+    return 0;
+}
@@ -1,6 +1,7 @@
 #include "logger.hpp"
 #include "cpp_streamer_factory.hpp"
 #include "timer.hpp"
+#include "latency_stats.hpp"
 
 #include <iostream>
 #include <uv.h>
@@ -12,14 +13,18 @@
 #include <unistd.h>
 #include <chrono>
 #include <thread>
+#include <atomic>
 #include <memory>
 #include <vector>
 
 using namespace cpp_streamer;
 
 static Logger* s_logger = nullptr;
+static std::string s_vcodec = "h264";
 static const int BENCH_MAX = 100;
 static const size_t WHIPS_INTERVAL = 10;
+static const char* SYNTH_INPUT = "synth";//the synthsource streamer instead of the mpegts file
+static int s_synth_duration = 60;
 
 void CloseCallback(uv_async_t *handle);
 
@@ -46,6 +51,7 @@ public:
 protected:
     virtual void OnTimer() override {
         StartWhips();
+        StartSynth();
     }
 
     std::string GetUrl(size_t index) {
@@ -59,17 +65,28 @@ public:
     int MakeStreamers(uv_loop_t* loop_handle) {
         loop_ = loop_handle;
         uv_async_init(loop_, &async_, CloseCallback);
+        metrics_registry_.EnablePipelineLatency(true);
 
-        tsdemux_streamer_ = CppStreamerFactory::MakeStreamer("mpegtsdemux");
-        if (!tsdemux_streamer_) {
-            LogErrorf(logger_, "make streamer mpegtsdemux error");
-            return -1;
+        if (src_ts_ == SYNTH_INPUT) {
+            source_streamer_ = CppStreamerFactory::MakeStreamer("synthsource");
+            if (!source_streamer_) {
+                LogErrorf(logger_, "make streamer synthsource error");
+                return -1;
+            }
+            source_streamer_->AddOption("duration", std::to_string(s_synth_duration));
+        } else {
+            source_streamer_ = CppStreamerFactory::MakeStreamer("mpegtsdemux");
+            if (!source_streamer_) {
+                LogErrorf(logger_, "make streamer mpegtsdemux error");
+                return -1;
+            }
+            source_streamer_->AddOption("re", "true");
         }
-        LogInfof(logger_, "make mpegts demux streamer:%p, name:%s", 
-                tsdemux_streamer_, tsdemux_streamer_->StreamerName().c_str());
-        tsdemux_streamer_->SetLogger(logger_);
-        tsdemux_streamer_->AddOption("re", "true");
-        tsdemux_streamer_->SetReporter(this);
+        LogInfof(logger_, "make source streamer:%p, name:%s", 
+                source_streamer_, source_streamer_->StreamerName().c_str());
+        source_streamer_->SetLogger(logger_);
+        source_streamer_->SetReporter(this);
+        source_streamer_->SetMetrics(&metrics_registry_);
 
         for (size_t i = 0; i < bench_count_; i++) {
             CppStreamerInterface* whip_streamer = CppStreamerFactory::MakeStreamer("whip");
@@ -79,7 +96,10 @@ public:
             }
             whip_streamer->SetLogger(logger_);
             whip_streamer->SetReporter(this);
-            tsdemux_streamer_->AddSinker(whip_streamer);
+            whip_streamer->SetMetrics(&metrics_registry_);
+            whip_streamer->AddOption("keepalive", "true");
+            whip_streamer->AddOption("vcodec", s_vcodec);
+            source_streamer_->AddSinker(whip_streamer);
 
             whips_.push_back(whip_streamer);
         }
@@ -114,6 +134,20 @@ public:
         }
     }
 
+    //the synthsource runs on the loop, it starts when the work thread finds the whips ready
+    void StartSynth() {
+        if (!synth_ready_ || synth_started_) {
+            return;
+        }
+        synth_started_ = true;
+        try {
+            source_streamer_->StartNetwork("", loop_);
+        } catch(CppStreamException& e) {
+            LogErrorf(logger_, "synthsource start exception:%s", e.what());
+            AsyncClose();
+        }
+    }
+
     void Start() {
         if (!thread_ptr_) {
             thread_ptr_ = std::make_shared<std::thread>(&Mpegts2Whips::OnWork, this);
@@ -122,7 +156,10 @@ public:
     }
 
     void Stop() {
+        //the metrics of the streamers are released in Clean
+        LogWarnf(logger_, "pipeline latency:\n%s", metrics_registry_.DumpPipelineLatency().c_str());
         Clean();
+        LogInfof(logger_, "connect latency %s", connect_stats_.Dump().c_str());
         LogInfof(logger_, "job is done.");
         exit(0);
     }
@@ -152,6 +189,18 @@ protected:
             const std::string& value) override {
         LogWarnf(logger_, "report name:%s, type:%s, value:%s",
                 name.c_str(), type.c_str(), value.c_str());
+        if (type == "end") {
+            //the synthsource is over
+            AsyncClose();
+            return;
+        }
+        if (type == "connect_ms") {
+            connect_stats_.Add(atoll(value.c_str()));
+            if (connect_stats_.Count() == bench_count_) {
+                LogWarnf(logger_, "connect latency %s", connect_stats_.Dump().c_str());
+            }
+            return;
+        }
         if (type == "dtls") {
             if (value == "ready") {
                 int index = GetWhipIndex(name);
@@ -168,21 +217,21 @@ protected:
 
 protected:
     int InputTsData(uint8_t* data, size_t data_len) {
-        if (!tsdemux_streamer_) {
+        if (!source_streamer_) {
             LogErrorf(logger_, "mpegts demux streamer is not ready");
             return -1;
         }
         //LogInfof(logger_, "input data len:%u", data_len);
         Media_Packet_Ptr pkt_ptr = std::make_shared<Media_Packet>();
         pkt_ptr->buffer_ptr_->AppendData((char*)data, data_len);
-        tsdemux_streamer_->SourceData(pkt_ptr);
+        source_streamer_->SourceData(pkt_ptr);
         return 0;
     }
 
     void Clean() {
-        if (tsdemux_streamer_) {
-            delete tsdemux_streamer_;
-            tsdemux_streamer_ = nullptr;
+        if (source_streamer_) {
+            delete source_streamer_;
+            source_streamer_ = nullptr;
         }
         for (size_t i = 0; i < bench_count_; i++) {
             CppStreamerInterface* whip_streamer = whips_[i];
@@ -219,6 +268,12 @@ protected:
         }
         LogWarnf(logger_, "%d whip session is ready", whip_ready_count_);
 
+        if (src_ts_ == SYNTH_INPUT) {
+            //the loop closes it when the synthsource reports the end
+            synth_ready_ = true;
+            return;
+        }
+
         FILE* file_p = fopen(src_ts_.c_str(), "r");
         if (!file_p) {
             LogErrorf(s_logger, "open mpegts file error:%s", src_ts_.c_str());
@@ -255,11 +310,15 @@ private:
     size_t whip_ready_count_ = 0;
     size_t whip_index_ = 0;
     bool post_done_ = false;
+    std::atomic<bool> synth_ready_{false};
+    bool synth_started_ = false;
 
 private:
     Logger* logger_ = nullptr;
+    LatencyStats connect_stats_;
+    MetricsRegistry metrics_registry_;
     std::vector<CppStreamerInterface*> whips_;
-    CppStreamerInterface* tsdemux_streamer_    = nullptr;
+    CppStreamerInterface* source_streamer_     = nullptr;//mpegtsdemux or synthsource
 };
 
 void CloseCallback(uv_async_t *handle) {
@@ -278,7 +337,7 @@ int main(int argc, char** argv) {
     bool log_file_ready = false;
     int bench_count = 0;
 
-    while ((opt = getopt(argc, argv, "i:o:l:n:h")) != -1) {
+    while ((opt = getopt(argc, argv, "i:o:l:n:c:d:h")) != -1) {
         switch (opt) {
             case 'i': strncpy(input_ts_name, optarg, sizeof(input_ts_name)); input_ts_name_ready = true; break;
             /*eg: http://10.0.24.12:1985/rtc/v1/whip/?app=live&stream=1000*/
@@ -291,12 +350,16 @@ int main(int argc, char** argv) {
                 break;
             }
             case 'l': strncpy(log_file, optarg, sizeof(log_file)); log_file_ready = true; break;
+            case 'c': s_vcodec = optarg; break;
+            case 'd': s_synth_duration = atoi(optarg); break;
             case 'h':
             default: 
             {
-                printf("Usage: %s [-i input mpegts(h264+opus) file]\n\
+                printf("Usage: %s [-i input mpegts(h264/h265+opus) file, or synth for the synthetic h264+opus source]\n\
     [-o whip url]\n\
     [-n bench count]\n\
+    [-c video codec in the offer: h264 or h265, default h264]\n\
+    [-d duration seconds of the synth source, default 60]\n\
     [-l log file name]\n",
                     argv[0]); 
                 return -1;
@@ -309,6 +372,14 @@ int main(int argc, char** argv) {
         return -1;
     }
 
+    if (s_vcodec != "h264" && s_vcodec != "h265") {
+        std::cout << "please input the video codec h264 or h265.\r\n";
+        return -1;
+    }
+    if (strcmp(input_ts_name, SYNTH_INPUT) == 0 && (s_vcodec != "h264" || s_synth_duration <= 0)) {
+        std::cout << "the synth source is h264 with the duration over 0.\r\n";
+        return -1;
+    }
     if (bench_count <= 0) {
         std::cout << "please input whip bench count.\r\n";
         return -1;
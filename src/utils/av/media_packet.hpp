@@ -23,6 +23,10 @@ public:
     {
         buffer_ptr_ = std::make_shared<DataBuffer>(len);
     }
+    //the packet takes the buffer, eg. from a DataBufferPool
+    Media_Packet(std::shared_ptr<DataBuffer> buffer_ptr):buffer_ptr_(buffer_ptr)
+    {
+    }
     Media_Packet(const Media_Packet& input_packet)
     {
         copy_properties(input_packet);
@@ -65,6 +69,7 @@ public:
         this->streamname_ = pkt.streamname_;
         this->streamid_   = pkt.streamid_;
         this->typeid_     = pkt.typeid_;
+        this->ingress_us_ = pkt.ingress_us_;
     }
 
     void copy_properties(const std::shared_ptr<Media_Packet> pkt_ptr) {
@@ -82,6 +87,7 @@ public:
         this->streamname_ = pkt_ptr->streamname_;
         this->streamid_   = pkt_ptr->streamid_;
         this->typeid_     = pkt_ptr->typeid_;
+        this->ingress_us_ = pkt_ptr->ingress_us_;
     }
 
     std::string Dump(bool data_dump = false) {
@@ -142,6 +148,7 @@ public:
     bool is_key_frame_ = false;
     bool is_seq_hdr_   = false;
     bool has_flv_audio_asc_ = false;
+    int64_t ingress_us_ = 0;//the time it enters the streamer graph for the pipeline latency, 0: not stamped
     std::shared_ptr<DataBuffer> buffer_ptr_;
     int metadata_type_;
     std::map<std::string, std::string> metadata_;
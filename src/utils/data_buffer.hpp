@@ -6,11 +6,15 @@
 #include <string>
 #include <vector>
 #include <memory>
+#include <mutex>
 
 #define EXTRA_LEN (10*1024)
 
 #define PRE_RESERVE_HEADER_SIZE 200
 
+#define DATA_BUFFER_POOL_KEEP  32        //the free buffers kept by the pool
+#define DATA_BUFFER_POOL_ALIGN (4*1024)  //the new buffer size is aligned for reusing
+
 namespace cpp_streamer
 {
 class DataBuffer
@@ -132,6 +136,13 @@ public:
     size_t DataLen() {
         return data_len_;
     }
+    //the data length which is appended without reallocation after Reset()
+    size_t Capacity() {
+        if (buffer_size_ <= 2 * PRE_RESERVE_HEADER_SIZE) {
+            return 0;
+        }
+        return buffer_size_ - 2 * PRE_RESERVE_HEADER_SIZE;
+    }
     bool Require(size_t len) {
         if ((int)len <= data_len_) {
             return true;
@@ -180,5 +191,78 @@ private:
 
 typedef std::shared_ptr<DataBuffer> DATA_BUFFER_PTR;
 
+/*
+ * the DataBuffers reused by one producer of media packets, eg. the rtp depacketizer.
+ * a buffer goes back to the pool when its last shared_ptr is released on any thread,
+ * and the pool lives till all of its buffers are back.
+ */
+class DataBufferPool : public std::enable_shared_from_this<DataBufferPool>
+{
+public:
+    DataBufferPool(size_t keep = DATA_BUFFER_POOL_KEEP):keep_(keep)
+    {
+        free_.reserve(keep_);
+    }
+    ~DataBufferPool()
+    {
+        for (auto buffer : free_) {
+            delete buffer;
+        }
+        free_.clear();
+    }
+
+public:
+    //an empty buffer which holds len bytes without reallocation
+    DATA_BUFFER_PTR Get(size_t len) {
+        DataBuffer* buffer = nullptr;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            size_t found = free_.size();
+
+            //the smallest one which is large enough
+            for (size_t index = 0; index < free_.size(); index++) {
+                size_t capacity = free_[index]->Capacity();
+                if (capacity >= len && (found == free_.size() || capacity < free_[found]->Capacity())) {
+                    found = index;
+                }
+            }
+            if (found < free_.size()) {
+                buffer = free_[found];
+                free_[found] = free_.back();
+                free_.pop_back();
+            }
+        }
+        if (!buffer) {
+            size_t size = (len + DATA_BUFFER_POOL_ALIGN - 1) / DATA_BUFFER_POOL_ALIGN * DATA_BUFFER_POOL_ALIGN;
+            buffer = new DataBuffer(size + 2 * PRE_RESERVE_HEADER_SIZE);
+        }
+        std::shared_ptr<DataBufferPool> pool_ptr = shared_from_this();
+        return DATA_BUFFER_PTR(buffer, [pool_ptr](DataBuffer* item) {
+                    pool_ptr->Put(item);
+                });
+    }
+
+    size_t FreeCount() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return free_.size();
+    }
+
+private:
+    void Put(DataBuffer* buffer) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (free_.size() >= keep_) {
+            delete buffer;
+            return;
+        }
+        buffer->Reset();
+        free_.push_back(buffer);
+    }
+
+private:
+    size_t keep_ = DATA_BUFFER_POOL_KEEP;
+    std::mutex mutex_;
+    std::vector<DataBuffer*> free_;
+};
+
 }
 #endif //DATA_BUFFER_H
@@ -0,0 +1,68 @@
+#ifndef LATENCY_STATS_HPP
+#define LATENCY_STATS_HPP
+#include <stdint.h>
+#include <stddef.h>
+#include <vector>
+#include <string>
+#include <sstream>
+#include <algorithm>
+
+namespace cpp_streamer
+{
+
+/*
+ * latency samples in ms for the bench output: p50/p90/p99/max
+ */
+class LatencyStats
+{
+public:
+    LatencyStats() {
+    }
+    ~LatencyStats() {
+    }
+
+public:
+    void Add(int64_t ms) {
+        samples_.push_back(ms);
+        sorted_ = false;
+    }
+
+    size_t Count() { return samples_.size(); }
+
+    //percent: 0~100, nearest rank
+    int64_t Percentile(double percent) {
+        if (samples_.empty()) {
+            return 0;
+        }
+        if (!sorted_) {
+            std::sort(samples_.begin(), samples_.end());
+            sorted_ = true;
+        }
+        size_t rank = (size_t)(percent / 100.0 * samples_.size() + 0.5);
+        if (rank < 1) {
+            rank = 1;
+        } else if (rank > samples_.size()) {
+            rank = samples_.size();
+        }
+        return samples_[rank - 1];
+    }
+
+    std::string Dump() {
+        std::stringstream ss;
+
+        ss << "count:" << Count()
+           << ", p50:" << Percentile(50) << "ms"
+           << ", p90:" << Percentile(90) << "ms"
+           << ", p99:" << Percentile(99) << "ms"
+           << ", max:" << Percentile(100) << "ms";
+        return ss.str();
+    }
+
+private:
+    std::vector<int64_t> samples_;
+    bool sorted_ = false;
+};
+
+}
+
+#endif
@@ -0,0 +1,725 @@
+#ifndef METRICS_HPP
+#define METRICS_HPP
+#include "logger.hpp"
+#include "timeex.hpp"
+
+#include <stdint.h>
+#include <stddef.h>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <map>
+#include <sstream>
+#include <algorithm>
+
+namespace cpp_streamer
+{
+#define METRICS_SHARDS        16
+#define METRICS_NAME_PREFIX   "cpp_streamer_"
+#define METRICS_CACHE_LINE    64
+#define METRICS_PIPELINE_LATENCY "pipeline_latency_us"
+
+#define HDR_SUB_BUCKET_BITS   8   //256 values in a sub bucket range, under 0.8% error
+#define HDR_SUB_BUCKET_COUNT  (1 << HDR_SUB_BUCKET_BITS)
+#define HDR_SUB_BUCKET_HALF   (HDR_SUB_BUCKET_COUNT / 2)
+#define HDR_MAX_VALUE_BITS    40  //about 12 days in microseconds, the larger ones are clamped
+#define HDR_BUCKET_COUNT      (HDR_SUB_BUCKET_COUNT + (HDR_MAX_VALUE_BITS - HDR_SUB_BUCKET_BITS + 1) * HDR_SUB_BUCKET_HALF)
+
+typedef enum {
+    METRIC_COUNTER,
+    METRIC_GAUGE,
+    METRIC_HISTOGRAM,
+    METRIC_SUMMARY
+} METRIC_TYPE;
+
+//the shard of the calling thread, the threads are spread over the shards in turn
+inline size_t MetricShardIndex() {
+    static std::atomic<size_t> s_next_shard(0);
+    static thread_local size_t index = s_next_shard.fetch_add(1) % METRICS_SHARDS;
+
+    return index;
+}
+
+/*
+ * the counter is added on the shard of the thread without a lock,
+ * the threads adding at the same time do not share a cache line.
+ */
+class MetricCounter
+{
+public:
+    MetricCounter() {
+        for (size_t index = 0; index < METRICS_SHARDS; index++) {
+            shards_[index].value.store(0, std::memory_order_relaxed);
+        }
+    }
+    ~MetricCounter() {
+    }
+
+public:
+    void Add(int64_t value = 1) {
+        shards_[MetricShardIndex()].value.fetch_add(value, std::memory_order_relaxed);
+    }
+
+    int64_t Value() const {
+        int64_t total = 0;
+        for (size_t index = 0; index < METRICS_SHARDS; index++) {
+            total += shards_[index].value.load(std::memory_order_relaxed);
+        }
+        return total;
+    }
+
+private:
+    typedef struct {
+        std::atomic<int64_t> value;
+        char pad[METRICS_CACHE_LINE - sizeof(std::atomic<int64_t>)];
+    } CounterShard;
+
+    CounterShard shards_[METRICS_SHARDS];
+};
+
+class MetricGauge
+{
+public:
+    MetricGauge() {
+        value_.store(0, std::memory_order_relaxed);
+    }
+    ~MetricGauge() {
+    }
+
+public:
+    void Set(int64_t value) { value_.store(value, std::memory_order_relaxed); }
+    void Add(int64_t value) { value_.fetch_add(value, std::memory_order_relaxed); }
+    int64_t Value() const { return value_.load(std::memory_order_relaxed); }
+
+private:
+    std::atomic<int64_t> value_;
+};
+
+/*
+ * the buckets are fixed when it is made: bounds are the upper bounds in the
+ * ascending order, and the last bucket is +Inf for the values over them.
+ */
+class MetricHistogram
+{
+public:
+    MetricHistogram(const std::vector<int64_t>& bounds):bounds_(bounds)
+                                                        , counts_(new std::atomic<int64_t>[bounds.size() + 1])
+    {
+        for (size_t index = 0; index <= bounds_.size(); index++) {
+            counts_[index].store(0, std::memory_order_relaxed);
+        }
+        sum_.store(0, std::memory_order_relaxed);
+    }
+    ~MetricHistogram() {
+    }
+
+public:
+    void Observe(int64_t value) {
+        size_t index = 0;
+        while (index < bounds_.size() && value > bounds_[index]) {
+            index++;
+        }
+        counts_[index].fetch_add(1, std::memory_order_relaxed);
+        sum_.fetch_add(value, std::memory_order_relaxed);
+    }
+
+    const std::vector<int64_t>& Bounds() const { return bounds_; }
+
+    //counts: the count of every bucket, not cumulative, the last one is +Inf
+    void Get(std::vector<int64_t>& counts, int64_t& sum, int64_t& count) const {
+        counts.resize(bounds_.size() + 1);
+        count = 0;
+        for (size_t index = 0; index <= bounds_.size(); index++) {
+            counts[index] = counts_[index].load(std::memory_order_relaxed);
+            count += counts[index];
+        }
+        sum = sum_.load(std::memory_order_relaxed);
+    }
+
+private:
+    std::vector<int64_t> bounds_;
+    std::unique_ptr<std::atomic<int64_t>[]> counts_;
+    std::atomic<int64_t> sum_;
+};
+
+/*
+ * hdr style histogram of the log linear buckets: the values under 256 are exact,
+ * every power of 2 range over them is split into 128 buckets, so the percentiles keep
+ * the relative error under 1/128(0.8%) in any range with a fixed 35KB. Record is lock free.
+ */
+class MetricHdrHistogram
+{
+public:
+    MetricHdrHistogram():counts_(new std::atomic<int64_t>[HDR_BUCKET_COUNT])
+    {
+        for (size_t index = 0; index < HDR_BUCKET_COUNT; index++) {
+            counts_[index].store(0, std::memory_order_relaxed);
+        }
+        sum_.store(0, std::memory_order_relaxed);
+        max_.store(0, std::memory_order_relaxed);
+    }
+    ~MetricHdrHistogram() {
+    }
+
+public:
+    void Record(int64_t value) {
+        if (value < 0) {
+            value = 0;
+        } else if (value >= ((int64_t)1 << HDR_MAX_VALUE_BITS)) {
+            value = ((int64_t)1 << HDR_MAX_VALUE_BITS) - 1;
+        }
+        counts_[GetIndex(value)].fetch_add(1, std::memory_order_relaxed);
+        sum_.fetch_add(value, std::memory_order_relaxed);
+
+        int64_t max = max_.load(std::memory_order_relaxed);
+        while (value > max && !max_.compare_exchange_weak(max, value, std::memory_order_relaxed)) {
+        }
+    }
+
+    //add the counts of another one, for the percentiles of a stage over the streamers
+    void Merge(const MetricHdrHistogram& other) {
+        for (size_t index = 0; index < HDR_BUCKET_COUNT; index++) {
+            int64_t count = other.counts_[index].load(std::memory_order_relaxed);
+            if (count > 0) {
+                counts_[index].fetch_add(count, std::memory_order_relaxed);
+            }
+        }
+        sum_.fetch_add(other.Sum(), std::memory_order_relaxed);
+
+        int64_t other_max = other.Max();
+        int64_t max = max_.load(std::memory_order_relaxed);
+        while (other_max > max && !max_.compare_exchange_weak(max, other_max, std::memory_order_relaxed)) {
+        }
+    }
+
+    int64_t Count() const {
+        int64_t count = 0;
+        for (size_t index = 0; index < HDR_BUCKET_COUNT; index++) {
+            count += counts_[index].load(std::memory_order_relaxed);
+        }
+        return count;
+    }
+
+    int64_t Sum() const { return sum_.load(std::memory_order_relaxed); }
+    int64_t Max() const { return max_.load(std::memory_order_relaxed); }
+
+    //percent: 0~100, nearest rank, the highest value of the bucket it falls in
+    int64_t Percentile(double percent) const {
+        int64_t count = Count();
+        if (count == 0) {
+            return 0;
+        }
+        int64_t rank = (int64_t)(percent / 100.0 * count + 0.5);
+        if (rank < 1) {
+            rank = 1;
+        } else if (rank > count) {
+            rank = count;
+        }
+        int64_t total = 0;
+        for (size_t index = 0; index < HDR_BUCKET_COUNT; index++) {
+            total += counts_[index].load(std::memory_order_relaxed);
+            if (total >= rank) {
+                int64_t value = GetHighestValue(index);
+                return value < Max() ? value : Max();
+            }
+        }
+        return Max();
+    }
+
+private:
+    static size_t GetIndex(int64_t value) {
+        if (value < HDR_SUB_BUCKET_COUNT) {
+            return (size_t)value;
+        }
+        int msb = 63 - __builtin_clzll((unsigned long long)value);
+        int shift = msb - (HDR_SUB_BUCKET_BITS - 1);
+
+        return HDR_SUB_BUCKET_COUNT + (shift - 1) * HDR_SUB_BUCKET_HALF
+            + (size_t)((value >> shift) - HDR_SUB_BUCKET_HALF);
+    }
+
+    static int64_t GetHighestValue(size_t index) {
+        if (index < HDR_SUB_BUCKET_COUNT) {
+            return (int64_t)index;
+        }
+        int shift = (int)((index - HDR_SUB_BUCKET_COUNT) / HDR_SUB_BUCKET_HALF) + 1;
+        int64_t top = (int64_t)((index - HDR_SUB_BUCKET_COUNT) % HDR_SUB_BUCKET_HALF) + HDR_SUB_BUCKET_HALF;
+
+        return ((top + 1) << shift) - 1;
+    }
+
+private:
+    std::unique_ptr<std::atomic<int64_t>[]> counts_;
+    std::atomic<int64_t> sum_;
+    std::atomic<int64_t> max_;
+};
+
+//the percentiles of the summaries in the prometheus output and the latency dump
+static const std::vector<double> METRICS_SUMMARY_PERCENTS = {50, 99, 99.9};
+
+typedef struct {
+    std::string name;
+    std::string help;
+    METRIC_TYPE type;
+    std::string streamer;
+    std::string stage;
+    int64_t value;               //the counter or gauge value, the count of the histogram
+    int64_t sum;                 //the sum of the histogram
+    std::vector<int64_t> bounds; //the upper bounds of the histogram buckets
+    std::vector<int64_t> counts; //the histogram bucket counts, the last one is +Inf
+    std::vector<int64_t> percentiles;//the summary values of METRICS_SUMMARY_PERCENTS
+} MetricSample;
+
+/*
+ * the metrics keyed by name and the streamer(and the stage) labels:
+ * the registry lock is only taken to register, unregister and snapshot,
+ * the metrics returned are updated by the streamers without a lock.
+ * the metrics of a streamer are released by Unregister, so the registry
+ * must outlive the streamers registered in it.
+ */
+class MetricsRegistry
+{
+public:
+    MetricsRegistry() {
+    }
+    ~MetricsRegistry() {
+    }
+
+public:
+    MetricCounter* GetCounter(const std::string& name, const std::string& help,
+            const std::string& streamer, const std::string& stage = "") {
+        std::lock_guard<std::mutex> lock(mutex_);
+        MetricItem& item = GetItem(name, help, METRIC_COUNTER, streamer, stage);
+
+        if (!item.counter) {
+            item.counter.reset(new MetricCounter());
+        }
+        return item.counter.get();
+    }
+
+    MetricGauge* GetGauge(const std::string& name, const std::string& help,
+            const std::string& streamer, const std::string& stage = "") {
+        std::lock_guard<std::mutex> lock(mutex_);
+        MetricItem& item = GetItem(name, help, METRIC_GAUGE, streamer, stage);
+
+        if (!item.gauge) {
+            item.gauge.reset(new MetricGauge());
+        }
+        return item.gauge.get();
+    }
+
+    //the bounds of the histogram registered first are kept
+    MetricHistogram* GetHistogram(const std::string& name, const std::string& help,
+            const std::string& streamer, const std::string& stage,
+            const std::vector<int64_t>& bounds) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        MetricItem& item = GetItem(name, help, METRIC_HISTOGRAM, streamer, stage);
+
+        if (!item.histogram) {
+            item.histogram.reset(new MetricHistogram(bounds));
+        }
+        return item.histogram.get();
+    }
+
+    MetricHdrHistogram* GetHdrHistogram(const std::string& name, const std::string& help,
+            const std::string& streamer, const std::string& stage) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        MetricItem& item = GetItem(name, help, METRIC_SUMMARY, streamer, stage);
+
+        if (!item.hdr) {
+            item.hdr.reset(new MetricHdrHistogram());
+        }
+        return item.hdr.get();
+    }
+
+    /*
+     * the pipeline latency: the packets are stamped when they enter the streamer graph,
+     * and every streamer records the time since then when they leave it.
+     * it is off by default, and only the streamers registered after enabling it record.
+     */
+    void EnablePipelineLatency(bool enable) { pipeline_latency_ = enable; }
+    bool IsPipelineLatencyEnabled() { return pipeline_latency_; }
+
+    //the pipeline latency percentiles of every stage merged over its streamers,
+    //one line per stage, in the order of p50 which is the order of the graph
+    std::string DumpPipelineLatency() {
+        std::vector<std::pair<std::string, std::unique_ptr<MetricHdrHistogram>>> stages;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            auto iter = families_.find(METRICS_PIPELINE_LATENCY);
+            if (iter != families_.end()) {
+                for (auto& item_pair : iter->second.items) {
+                    MetricItem& item = item_pair.second;
+                    size_t index = 0;
+
+                    while (index < stages.size() && stages[index].first != item.stage) {
+                        index++;
+                    }
+                    if (index == stages.size()) {
+                        stages.push_back(std::make_pair(item.stage,
+                                    std::unique_ptr<MetricHdrHistogram>(new MetricHdrHistogram())));
+                    }
+                    stages[index].second->Merge(*item.hdr);
+                }
+            }
+        }
+        std::sort(stages.begin(), stages.end(),
+            [](const std::pair<std::string, std::unique_ptr<MetricHdrHistogram>>& a,
+               const std::pair<std::string, std::unique_ptr<MetricHdrHistogram>>& b) {
+                return a.second->Percentile(50) < b.second->Percentile(50);
+            });
+        std::stringstream ss;
+
+        for (const auto& stage : stages) {
+            ss << "stage:" << stage.first
+               << ", count:" << stage.second->Count()
+               << ", p50:" << stage.second->Percentile(50) << "us"
+               << ", p99:" << stage.second->Percentile(99) << "us"
+               << ", p999:" << stage.second->Percentile(99.9) << "us"
+               << ", max:" << stage.second->Max() << "us\n";
+        }
+        return ss.str();
+    }
+
+    //release all the metrics of the streamer, the pointers got before are invalid
+    void Unregister(const std::string& streamer) {
+        std::lock_guard<std::mutex> lock(mutex_);
+
+        for (auto iter = families_.begin(); iter != families_.end();) {
+            std::map<std::string, MetricItem>& items = iter->second.items;
+
+            for (auto item_iter = items.begin(); item_iter != items.end();) {
+                if (item_iter->second.streamer == streamer) {
+                    item_iter = items.erase(item_iter);
+                } else {
+                    item_iter++;
+                }
+            }
+            if (items.empty()) {
+                iter = families_.erase(iter);
+            } else {
+                iter++;
+            }
+        }
+    }
+
+    //the values of every metric at the moment, ordered by name and labels
+    std::vector<MetricSample> Snapshot() {
+        std::vector<MetricSample> samples;
+        std::lock_guard<std::mutex> lock(mutex_);
+
+        for (auto& family : families_) {
+            for (auto& item_pair : family.second.items) {
+                MetricItem& item = item_pair.second;
+                MetricSample sample;
+
+                sample.name     = family.first;
+                sample.help     = family.second.help;
+                sample.type     = family.second.type;
+                sample.streamer = item.streamer;
+                sample.stage    = item.stage;
+                sample.value    = 0;
+                sample.sum      = 0;
+                if (item.counter) {
+                    sample.value = item.counter->Value();
+                } else if (item.gauge) {
+                    sample.value = item.gauge->Value();
+                } else if (item.histogram) {
+                    sample.bounds = item.histogram->Bounds();
+                    item.histogram->Get(sample.counts, sample.sum, sample.value);
+                } else if (item.hdr) {
+                    sample.value = item.hdr->Count();
+                    sample.sum   = item.hdr->Sum();
+                    for (double percent : METRICS_SUMMARY_PERCENTS) {
+                        sample.percentiles.push_back(item.hdr->Percentile(percent));
+                    }
+                }
+                samples.push_back(sample);
+            }
+        }
+        return samples;
+    }
+
+    //prometheus text exposition format 0.0.4
+    std::string DumpPrometheus() {
+        std::vector<MetricSample> samples = Snapshot();
+        std::stringstream ss;
+        std::string last_name;
+
+        for (const auto& sample : samples) {
+            std::string name = METRICS_NAME_PREFIX + sample.name;
+
+            if (sample.name != last_name) {
+                last_name = sample.name;
+                if (!sample.help.empty()) {
+                    ss << "# HELP " << name << " " << sample.help << "\n";
+                }
+                ss << "# TYPE " << name << " " << GetTypeString(sample.type) << "\n";
+            }
+            std::string labels = "streamer=\"" + EscapeLabel(sample.streamer) + "\"";
+            if (!sample.stage.empty()) {
+                labels += ",stage=\"" + EscapeLabel(sample.stage) + "\"";
+            }
+            if (sample.type == METRIC_COUNTER || sample.type == METRIC_GAUGE) {
+                ss << name << "{" << labels << "} " << sample.value << "\n";
+                continue;
+            }
+            if (sample.type == METRIC_SUMMARY) {
+                for (size_t index = 0; index < sample.percentiles.size(); index++) {
+                    ss << name << "{" << labels << ",quantile=\""
+                       << METRICS_SUMMARY_PERCENTS[index] / 100.0 << "\"} " << sample.percentiles[index] << "\n";
+                }
+                ss << name << "_sum{" << labels << "} " << sample.sum << "\n";
+                ss << name << "_count{" << labels << "} " << sample.value << "\n";
+                continue;
+            }
+            int64_t cumulative = 0;
+            for (size_t index = 0; index < sample.counts.size(); index++) {
+                cumulative += sample.counts[index];
+                ss << name << "_bucket{" << labels << ",le=\"";
+                if (index < sample.bounds.size()) {
+                    ss << sample.bounds[index];
+                } else {
+                    ss << "+Inf";
+                }
+                ss << "\"} " << cumulative << "\n";
+            }
+            ss << name << "_sum{" << labels << "} " << sample.sum << "\n";
+            ss << name << "_count{" << labels << "} " << sample.value << "\n";
+        }
+        return ss.str();
+    }
+
+private:
+    typedef struct {
+        std::string streamer;
+        std::string stage;
+        std::unique_ptr<MetricCounter> counter;
+        std::unique_ptr<MetricGauge> gauge;
+        std::unique_ptr<MetricHistogram> histogram;
+        std::unique_ptr<MetricHdrHistogram> hdr;
+    } MetricItem;
+
+    typedef struct {
+        METRIC_TYPE type;
+        std::string help;
+        std::map<std::string, MetricItem> items;//key: streamer and stage
+    } MetricFamily;
+
+private:
+    MetricItem& GetItem(const std::string& name, const std::string& help, METRIC_TYPE type,
+            const std::string& streamer, const std::string& stage) {
+        auto iter = families_.find(name);
+        if (iter == families_.end()) {
+            iter = families_.insert(std::make_pair(name, MetricFamily())).first;
+            iter->second.type = type;
+            iter->second.help = help;
+        } else if (iter->second.type != type) {
+            CSM_THROW_ERROR("metric %s is registered as %s, not %s", name.c_str(),
+                    GetTypeString(iter->second.type), GetTypeString(type));
+        }
+        std::string key = streamer;
+        key += '\0';
+        key += stage;
+
+        MetricItem& item = iter->second.items[key];
+        item.streamer = streamer;
+        item.stage    = stage;
+        return item;
+    }
+
+    static const char* GetTypeString(METRIC_TYPE type) {
+        if (type == METRIC_COUNTER) {
+            return "counter";
+        }
+        if (type == METRIC_GAUGE) {
+            return "gauge";
+        }
+        if (type == METRIC_SUMMARY) {
+            return "summary";
+        }
+        return "histogram";
+    }
+
+    static std::string EscapeLabel(const std::string& value) {
+        std::string escaped;
+
+        for (char c : value) {
+            if (c == '\\' || c == '"') {
+                escaped += '\\';
+                escaped += c;
+            } else if (c == '\n') {
+                escaped += "\\n";
+            } else {
+                escaped += c;
+            }
+        }
+        return escaped;
+    }
+
+private:
+    std::mutex mutex_;
+    std::map<std::string, MetricFamily> families_;
+    bool pipeline_latency_ = false;
+};
+
+//the stage latency in microseconds: 10us ~ 1s
+static const std::vector<int64_t> METRICS_LATENCY_US_BOUNDS = {
+    10, 50, 100, 500, 1000, 5000, 10000, 50000, 100000, 500000, 1000000
+};
+
+/*
+ * the common metrics of a streamer: the media packets and bytes it handles(the input
+ * ones, or the output ones of the network sources), the drops, the queue depth and
+ * the latency of its stages. nothing is done before it is registered.
+ */
+class StreamerMetrics
+{
+public:
+    StreamerMetrics() {
+    }
+    ~StreamerMetrics() {
+        Unregister();
+    }
+    StreamerMetrics(const StreamerMetrics&) = delete;
+    StreamerMetrics& operator=(const StreamerMetrics&) = delete;
+
+public:
+    void Register(MetricsRegistry* registry, const std::string& streamer) {
+        Unregister();
+        if (!registry) {
+            return;
+        }
+        streamer_ = streamer;
+        packets_  = registry->GetCounter("packets_total", "the media packets handled by the streamer", streamer);
+        bytes_    = registry->GetCounter("bytes_total", "the media bytes handled by the streamer", streamer);
+        drops_    = registry->GetCounter("drops_total", "the packets or frames dropped by the streamer", streamer);
+        queue_depth_ = registry->GetGauge("queue_depth", "the packets waiting in the streamer queue", streamer);
+        registry_ = registry;
+        latency_  = AddStage("process");
+        if (registry->IsPipelineLatencyEnabled()) {
+            //the stage is the kind of the streamer: flvdemux of flvdemux_xxxx
+            pipeline_ = registry->GetHdrHistogram(METRICS_PIPELINE_LATENCY,
+                    "the time from the packets entering the streamer graph to leaving the streamer",
+                    streamer, streamer.substr(0, streamer.find('_')));
+        }
+    }
+
+    void Unregister() {
+        if (!registry_) {
+            return;
+        }
+        registry_->Unregister(streamer_);
+        registry_    = nullptr;
+        packets_     = nullptr;
+        bytes_       = nullptr;
+        drops_       = nullptr;
+        queue_depth_ = nullptr;
+        latency_     = nullptr;
+        pipeline_    = nullptr;
+        stage_begin_us_ = 0;
+        ingress_us_     = 0;
+    }
+
+    MetricsRegistry* GetRegistry() { return registry_; }
+
+    //the latency histogram of one more stage, nullptr before registered
+    MetricHistogram* AddStage(const std::string& stage) {
+        if (!registry_) {
+            return nullptr;
+        }
+        return registry_->GetHistogram("stage_latency_us", "the time the packets spend in the stage",
+                streamer_, stage, METRICS_LATENCY_US_BOUNDS);
+    }
+
+public:
+    void OnPacket(size_t bytes) {
+        if (!registry_) {
+            return;
+        }
+        packets_->Add();
+        bytes_->Add((int64_t)bytes);
+    }
+
+    void OnDrop(int64_t count = 1) {
+        if (registry_ && count > 0) {
+            drops_->Add(count);
+        }
+    }
+
+    void SetQueueDepth(size_t depth) {
+        if (registry_) {
+            queue_depth_->Set((int64_t)depth);
+        }
+    }
+
+    /*
+     * the stage begins when the packet comes in(or is taken from the queue), and ends
+     * when the result goes out, before the sinkers which are called synchronously.
+     * the outputs of one input are all measured from the same beginning.
+     */
+    void BeginStage() {
+        if (registry_) {
+            stage_begin_us_ = now_microsec();
+        }
+    }
+
+    void EndStage(MetricHistogram* stage = nullptr) {
+        if (!registry_ || stage_begin_us_ <= 0) {
+            return;
+        }
+        (stage ? stage : latency_)->Observe(now_microsec() - stage_begin_us_);
+    }
+
+    /*
+     * the packet comes in: it enters the graph here if it is not stamped upstream.
+     * the new packets the streamer makes of it take the same ingress when they go out.
+     */
+    void OnIngress(int64_t& ingress_us) {
+        if (!pipeline_) {
+            return;
+        }
+        if (ingress_us <= 0) {
+            ingress_us = now_microsec();
+        }
+        ingress_us_ = ingress_us;
+    }
+
+    //the packets paced by the timestamps enter the graph when they are released
+    void OnRelease(int64_t& ingress_us) {
+        if (pipeline_) {
+            ingress_us = now_microsec();
+        }
+    }
+
+    //the packet goes out to the sinkers or the network
+    void OnOutput(int64_t& ingress_us) {
+        if (!pipeline_) {
+            return;
+        }
+        if (ingress_us <= 0) {
+            ingress_us = ingress_us_;
+        }
+        if (ingress_us > 0) {
+            pipeline_->Record(now_microsec() - ingress_us);
+        }
+    }
+
+private:
+    MetricsRegistry* registry_ = nullptr;
+    std::string streamer_;
+    MetricCounter* packets_    = nullptr;
+    MetricCounter* bytes_      = nullptr;
+    MetricCounter* drops_      = nullptr;
+    MetricGauge* queue_depth_  = nullptr;
+    MetricHistogram* latency_  = nullptr;
+    MetricHdrHistogram* pipeline_ = nullptr;
+    int64_t stage_begin_us_    = 0;
+    int64_t ingress_us_        = 0;
+};
+
+}
+
+#endif
@@ -2,6 +2,8 @@
 #define TIME_EX_HPP
 #include <chrono>
 #include <stdint.h>
+#include <sys/time.h>
+#include <sys/resource.h>
 #include <string>
 #include <cmath>
 
@@ -31,6 +33,17 @@ inline int64_t now_microsec() {
     return int64_t(mil.count());
 }
 
+//the user and system cpu time of the process, for the cores used by a bench
+inline int64_t cpu_microsec() {
+    struct rusage usage;
+
+    if (getrusage(RUSAGE_SELF, &usage) != 0) {
+        return 0;
+    }
+    return (int64_t)(usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) * 1000000
+        + (int64_t)(usage.ru_utime.tv_usec + usage.ru_stime.tv_usec);
+}
+
 inline std::string get_now_str() {
     std::time_t t = std::time(nullptr);
     auto tm = std::localtime(&t);
@@ -1,23 +1,37 @@
 #ifndef TIMER_HPP
 #define TIMER_HPP
+#include "timer_wheel.hpp"
 #include <uv.h>
 #include <stdint.h>
 
 inline void OnUvTimerCallback(uv_timer_t *handle);
+inline void OnWheelTimerCallback(TimerWheelNode* node);
 
 class TimerInterface
 {
 friend void OnUvTimerCallback(uv_timer_t *handle);
+friend void OnWheelTimerCallback(TimerWheelNode* node);
 
 public:
-    TimerInterface(uv_loop_t* loop, uint32_t timeout_ms):timeout_ms_(timeout_ms)
+    //use_wheel: share the loop's timer wheel instead of owning a uv_timer
+    TimerInterface(uv_loop_t* loop, uint32_t timeout_ms, bool use_wheel = false):timeout_ms_(timeout_ms)
     {
+        if (use_wheel) {
+            wheel_ = TimerWheel::Attach(loop);
+            wheel_node_.cb_   = OnWheelTimerCallback;
+            wheel_node_.data_ = this;
+            return;
+        }
         uv_timer_init(loop, &timer_);
         timer_.data = this;
     }
 
     virtual ~TimerInterface() {
         StopTimer();
+        if (wheel_) {
+            TimerWheel::Detach(wheel_);
+            wheel_ = nullptr;
+        }
     }
 
 public:
@@ -29,6 +43,10 @@ public:
             return;
         }
         running_ = true;
+        if (wheel_) {
+            wheel_->Schedule(&wheel_node_, timeout_ms_);
+            return;
+        }
         uv_timer_start(&timer_, OnUvTimerCallback, timeout_ms_, timeout_ms_);
     }
 
@@ -37,6 +55,10 @@ public:
             return;
         }
         running_ = false;
+        if (wheel_) {
+            wheel_->Cancel(&wheel_node_);
+            return;
+        }
         uv_timer_stop(&timer_);
     }
 
@@ -44,6 +66,10 @@ private:
     uv_timer_t timer_;
     uint32_t timeout_ms_;
     bool running_ = false;
+
+private:
+    TimerWheel* wheel_ = nullptr;
+    TimerWheelNode wheel_node_;
 };
 
 inline void OnUvTimerCallback(uv_timer_t *handle) {
@@ -53,4 +79,14 @@ inline void OnUvTimerCallback(uv_timer_t *handle) {
     }
 }
 
+inline void OnWheelTimerCallback(TimerWheelNode* node) {
+    TimerInterface* timer = (TimerInterface*)node->data_;
+    if (!timer || !timer->running_) {
+        return;
+    }
+    //rearm before the callback, like the uv_timer repeat, OnTimer may stop it
+    timer->wheel_->Schedule(&timer->wheel_node_, timer->timeout_ms_);
+    timer->OnTimer();
+}
+
 #endif
@@ -0,0 +1,307 @@
+#ifndef TIMER_WHEEL_HPP
+#define TIMER_WHEEL_HPP
+#include <uv.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <map>
+#include <mutex>
+
+/*
+ * hierarchical timing wheel, one per uv loop, driven by a single uv_timer.
+ * tick is 1ms(uv_now), the root level has 256 slots, the upper levels have
+ * 64 slots each and cascade down when the lower level wraps:
+ *   level 0: 256ms, level 1: 16s, level 2: 17min, level 3: 18h
+ * schedule and cancel are O(1) on intrusive lists, the nodes with the same
+ * deadline share a slot and are fired by the same uv_timer callback.
+ */
+#define TIMER_WHEEL_ROOT_BITS  8
+#define TIMER_WHEEL_LEVEL_BITS 6
+#define TIMER_WHEEL_LEVELS     4
+#define TIMER_WHEEL_ROOT_SIZE  (1 << TIMER_WHEEL_ROOT_BITS)
+#define TIMER_WHEEL_LEVEL_SIZE (1 << TIMER_WHEEL_LEVEL_BITS)
+#define TIMER_WHEEL_ROOT_MASK  (TIMER_WHEEL_ROOT_SIZE - 1)
+#define TIMER_WHEEL_LEVEL_MASK (TIMER_WHEEL_LEVEL_SIZE - 1)
+
+class TimerWheel;
+class TimerWheelNode;
+
+typedef void (*TimerWheelCallback)(TimerWheelNode* node);
+
+inline void OnUvTimerWheelCallback(uv_timer_t* handle);
+inline void OnUvTimerWheelClose(uv_handle_t* handle);
+
+class TimerWheelNode
+{
+friend class TimerWheel;
+
+public:
+    TimerWheelNode() {
+        prev_ = next_ = this;
+    }
+    ~TimerWheelNode() {
+        Unlink();
+    }
+
+public:
+    bool IsLinked() {
+        return next_ != this;
+    }
+
+public:
+    TimerWheelCallback cb_ = nullptr;
+    void* data_            = nullptr;
+
+private:
+    void Unlink() {
+        prev_->next_ = next_;
+        next_->prev_ = prev_;
+        prev_ = next_ = this;
+    }
+
+    void LinkTail(TimerWheelNode* head) {
+        prev_ = head->prev_;
+        next_ = head;
+        head->prev_->next_ = this;
+        head->prev_ = this;
+    }
+
+private:
+    TimerWheelNode* prev_;
+    TimerWheelNode* next_;
+    uint64_t expire_tick_ = 0;
+};
+
+class TimerWheel
+{
+friend void OnUvTimerWheelCallback(uv_timer_t* handle);
+friend void OnUvTimerWheelClose(uv_handle_t* handle);
+
+public:
+    static TimerWheel* Attach(uv_loop_t* loop) {
+        std::lock_guard<std::mutex> lock(GetMutex());
+        std::map<uv_loop_t*, TimerWheel*>& wheels = GetWheels();
+
+        TimerWheel* wheel = nullptr;
+        auto iter = wheels.find(loop);
+        if (iter == wheels.end()) {
+            wheel = new TimerWheel(loop);
+            wheels[loop] = wheel;
+        } else {
+            wheel = iter->second;
+        }
+        wheel->ref_count_++;
+        return wheel;
+    }
+
+    static void Detach(TimerWheel* wheel) {
+        std::lock_guard<std::mutex> lock(GetMutex());
+
+        if (--wheel->ref_count_ > 0) {
+            return;
+        }
+        GetWheels().erase(wheel->loop_);
+        uv_timer_stop(&wheel->timer_);
+        uv_close((uv_handle_t*)&wheel->timer_, OnUvTimerWheelClose);
+    }
+
+public:
+    void Schedule(TimerWheelNode* node, uint32_t timeout_ms) {
+        if (node->IsLinked()) {
+            Cancel(node);
+        }
+        uint64_t now = uv_now(loop_);
+        if (count_ == 0 && now > current_tick_) {
+            //nothing to cascade, jump to now directly
+            current_tick_ = now;
+        }
+        uint64_t expire = now + timeout_ms;
+        if (expire <= current_tick_) {
+            expire = current_tick_ + 1;
+        }
+        node->expire_tick_ = expire;
+        AddNode(node);
+        count_++;
+
+        if (in_advance_) {
+            //the timer is updated when the advance is done
+            return;
+        }
+        if (!timer_running_ || expire < next_wake_tick_) {
+            UpdateTimer();
+        }
+    }
+
+    void Cancel(TimerWheelNode* node) {
+        if (!node->IsLinked()) {
+            return;
+        }
+        node->Unlink();
+        count_--;
+        //the uv_timer is left as it is, an empty wake only advances the wheel
+    }
+
+    size_t Count() {
+        return count_;
+    }
+
+private:
+    TimerWheel(uv_loop_t* loop):loop_(loop)
+    {
+        uv_timer_init(loop, &timer_);
+        timer_.data = this;
+        current_tick_ = uv_now(loop);
+    }
+
+    ~TimerWheel() {
+    }
+
+    static std::mutex& GetMutex() {
+        static std::mutex s_mutex;
+        return s_mutex;
+    }
+
+    static std::map<uv_loop_t*, TimerWheel*>& GetWheels() {
+        static std::map<uv_loop_t*, TimerWheel*> s_wheels;
+        return s_wheels;
+    }
+
+    void AddNode(TimerWheelNode* node) {
+        uint64_t expire = node->expire_tick_;
+        uint64_t delta  = expire - current_tick_;
+        TimerWheelNode* head = nullptr;
+
+        if (delta < TIMER_WHEEL_ROOT_SIZE) {
+            head = &root_[expire & TIMER_WHEEL_ROOT_MASK];
+        } else {
+            int level = 0;
+            uint64_t span = (uint64_t)1 << (TIMER_WHEEL_ROOT_BITS + TIMER_WHEEL_LEVEL_BITS);
+            while (level < TIMER_WHEEL_LEVELS - 2 && delta >= span) {
+                level++;
+                span <<= TIMER_WHEEL_LEVEL_BITS;
+            }
+            if (delta >= span) {
+                //out of range, park it in the last slot of the top level
+                expire = current_tick_ + span - 1;
+            }
+            int shift = TIMER_WHEEL_ROOT_BITS + level * TIMER_WHEEL_LEVEL_BITS;
+            head = &levels_[level][(expire >> shift) & TIMER_WHEEL_LEVEL_MASK];
+        }
+        node->LinkTail(head);
+    }
+
+    //move the nodes of the upper level slot down, return the slot index
+    int Cascade(int level) {
+        int shift = TIMER_WHEEL_ROOT_BITS + level * TIMER_WHEEL_LEVEL_BITS;
+        int index = (int)((current_tick_ >> shift) & TIMER_WHEEL_LEVEL_MASK);
+        TimerWheelNode* head = &levels_[level][index];
+
+        TimerWheelNode pending;
+        while (head->IsLinked()) {
+            TimerWheelNode* node = head->next_;
+            node->Unlink();
+            node->LinkTail(&pending);
+        }
+        while (pending.IsLinked()) {
+            TimerWheelNode* node = pending.next_;
+            node->Unlink();
+            AddNode(node);
+        }
+        return index;
+    }
+
+    void Advance(uint64_t now) {
+        while (current_tick_ < now) {
+            if (count_ == 0) {
+                current_tick_ = now;
+                break;
+            }
+            current_tick_++;
+
+            int index = (int)(current_tick_ & TIMER_WHEEL_ROOT_MASK);
+            for (int level = 0; index == 0 && level < TIMER_WHEEL_LEVELS - 1; level++) {
+                index = Cascade(level);
+            }
+
+            TimerWheelNode* head = &root_[current_tick_ & TIMER_WHEEL_ROOT_MASK];
+            if (!head->IsLinked()) {
+                continue;
+            }
+            //detach the expired slot first, the callbacks may schedule or cancel
+            TimerWheelNode expired;
+            while (head->IsLinked()) {
+                TimerWheelNode* node = head->next_;
+                node->Unlink();
+                node->LinkTail(&expired);
+            }
+            while (expired.IsLinked()) {
+                TimerWheelNode* node = expired.next_;
+                node->Unlink();
+                count_--;
+                if (node->cb_) {
+                    node->cb_(node);
+                }
+            }
+        }
+    }
+
+    void UpdateTimer() {
+        if (count_ == 0) {
+            if (timer_running_) {
+                uv_timer_stop(&timer_);
+                timer_running_ = false;
+            }
+            return;
+        }
+
+        //the next non-empty root slot, or the next cascade point
+        uint64_t wake = (current_tick_ | TIMER_WHEEL_ROOT_MASK) + 1;
+        for (uint64_t tick = current_tick_ + 1; tick < wake; tick++) {
+            if (root_[tick & TIMER_WHEEL_ROOT_MASK].IsLinked()) {
+                wake = tick;
+                break;
+            }
+        }
+        uint64_t now = uv_now(loop_);
+        uint64_t timeout = (wake > now) ? (wake - now) : 0;
+
+        next_wake_tick_ = wake;
+        timer_running_  = true;
+        uv_timer_start(&timer_, OnUvTimerWheelCallback, timeout, 0);
+    }
+
+    void OnTimer() {
+        timer_running_ = false;
+        in_advance_    = true;
+        Advance(uv_now(loop_));
+        in_advance_    = false;
+        UpdateTimer();
+    }
+
+private:
+    uv_loop_t* loop_ = nullptr;
+    uv_timer_t timer_;
+    bool timer_running_      = false;
+    bool in_advance_         = false;
+    uint64_t next_wake_tick_ = 0;
+    uint64_t current_tick_   = 0;
+    size_t count_            = 0;
+    int ref_count_           = 0;
+
+private:
+    TimerWheelNode root_[TIMER_WHEEL_ROOT_SIZE];
+    TimerWheelNode levels_[TIMER_WHEEL_LEVELS - 1][TIMER_WHEEL_LEVEL_SIZE];
+};
+
+inline void OnUvTimerWheelCallback(uv_timer_t* handle) {
+    TimerWheel* wheel = (TimerWheel*)handle->data;
+    if (wheel) {
+        wheel->OnTimer();
+    }
+}
+
+inline void OnUvTimerWheelClose(uv_handle_t* handle) {
+    TimerWheel* wheel = (TimerWheel*)handle->data;
+    delete wheel;
+}
+
+#endif